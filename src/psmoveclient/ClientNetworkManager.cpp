@@ -1,6 +1,7 @@
 //-- includes -----
 #include "ClientNetworkManager.h"
 #include "ClientLog.h"
+#include "CompactDataFrame.h"
 #include "PackedMessage.h"
 #include "PSMoveProtocol.pb.h"
 #include <cassert>
@@ -120,6 +121,31 @@ public:
 
     }
 
+    // Blocks until the next socket operation completes (or the timeout passes) instead of sleeping,
+    // so that a response is handled the moment it arrives
+    void wait(int timeout_ms)
+    {
+        if (timeout_ms > 0 && !m_connection_stopped)
+        {
+            asio::deadline_timer timeout_timer(m_io_service, boost::posix_time::milliseconds(timeout_ms));
+            timeout_timer.async_wait([](const boost::system::error_code &) {});
+
+            // Make sure queued writes are in flight before going to sleep
+            start_udp_queued_data_frame_write();
+
+            // poll() stops the io_service whenever it runs out of ready handlers
+            m_io_service.reset();
+
+            // This call executes exactly one callback: either a socket operation or the timeout
+            m_io_service.run_one();
+
+            // The canceled timeout callback gets run (and discarded) by the next poll()
+            timeout_timer.cancel();
+        }
+
+        poll();
+    }
+
     void stop()
     {
         // drain any pending requests
@@ -280,6 +306,8 @@ private:
         DeviceInputDataFramePtr data_frame(new PSMoveProtocol::DeviceInputDataFrame);
         data_frame->set_connection_id(m_tcp_connection_id);
         data_frame->set_device_category(PSMoveProtocol::DeviceInputDataFrame_DeviceCategory_INVALID);
+        // Our receive buffer holds a whole batch of output data frames
+        data_frame->set_accepts_batched_output_data_frames(true);
 
         m_packed_input_data_frame.set_msg(data_frame);
         if (m_packed_input_data_frame.pack(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)))
@@ -293,7 +321,7 @@ private:
             // Start an asynchronous operation to send the data frame
             // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
             m_udp_socket.async_send_to(
-                boost::asio::buffer(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)),
+                boost::asio::buffer(m_input_data_frame_buffer, HEADER_SIZE + msg_size),
                 m_udp_server_endpoint,
                 boost::bind(&ClientNetworkManagerImpl::handle_udp_write_connection_id, this, _1));
         }
@@ -600,7 +628,7 @@ private:
                         // Start an asynchronous operation to send the data frame
                         // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
                         m_udp_socket.async_send_to(
-                            boost::asio::buffer(m_input_data_frame_buffer, sizeof(m_input_data_frame_buffer)),
+                            boost::asio::buffer(m_input_data_frame_buffer, HEADER_SIZE + msg_size),
                             m_udp_server_endpoint,
                             boost::bind(&ClientNetworkManagerImpl::handle_udp_write_device_data_frame_complete, this, _1));
                     }
@@ -648,11 +676,12 @@ private:
                 boost::bind(
                     &ClientNetworkManagerImpl::handle_udp_read_data_frame, 
                     this,
-                    asio::placeholders::error));
+                    asio::placeholders::error,
+                    asio::placeholders::bytes_transferred));
         }
     }
 
-    void handle_udp_read_data_frame(const boost::system::error_code& error)
+    void handle_udp_read_data_frame(const boost::system::error_code& error, std::size_t bytes_transferred)
     {
         if (m_connection_stopped)
             return;
@@ -661,8 +690,8 @@ private:
         {
             CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_read_data_frame") << "Received DataFrame" << std::endl;
 
-            // Process the data frame now that we have received all of it
-            handle_udp_data_frame_received();
+            // Process the data frames now that we have received all of them
+            handle_udp_data_frame_received(static_cast<unsigned>(bytes_transferred));
 
             // Start reading the next incoming data frame
             start_udp_read_data_frame();
@@ -680,29 +709,67 @@ private:
         }
     }
 
-    // Called when enough data was read into m_data_frame_read_buffer for a complete data frame message. 
-    // Parse the data_frame and forward it on to the response handler.
-    void handle_udp_data_frame_received()
+    // Called when a datagram of one or more data frame messages was read into m_output_data_frame_buffer.
+    // Each data frame has its own length header. A zero length or the end of the datagram ends the batch.
+    // Compact controller frames have COMPACT_CONTROLLER_RECORD_FLAG set in their length header.
+    // Parse the data_frames and forward them on to the response handler.
+    void handle_udp_data_frame_received(unsigned datagram_size)
     {
         // No longer is there a pending read
         m_has_pending_udp_read= false;
 
         CLIENT_LOG_DEBUG("ClientNetworkManager::handle_udp_data_frame_received") << "Parsing DataFrame" << std::endl;
         
-        // TODO: Switch on data frame type to choose which m_packed_data_frame_X to use.
-        unsigned msg_len = m_packed_output_data_frame.decode_header(m_output_data_frame_buffer, sizeof(m_output_data_frame_buffer));
-        unsigned total_len= HEADER_SIZE+msg_len;
-        CLIENT_LOG_DEBUG("    ") << show_hex(m_output_data_frame_buffer, total_len) << std::endl;
-        CLIENT_LOG_DEBUG("    ") << msg_len << " bytes" << std::endl;
-
-        // Parse the response buffer
-        if (m_packed_output_data_frame.unpack(m_output_data_frame_buffer, total_len))
+        bool bMalformed= false;
+        unsigned offset= 0;
+        while (offset + HEADER_SIZE <= datagram_size)
         {
-            const PSMoveProtocol::DeviceOutputDataFrame *data_frame = m_packed_output_data_frame.get_msg().get();
+            const uint8_t *packed_data_frame= &m_output_data_frame_buffer[offset];
+
+            // TODO: Switch on data frame type to choose which m_packed_data_frame_X to use.
+            const unsigned header = m_packed_output_data_frame.decode_header(packed_data_frame, datagram_size - offset);
+            const bool bIsCompactControllerFrame= (header & COMPACT_CONTROLLER_RECORD_FLAG) != 0;
+            unsigned msg_len = header & ~COMPACT_CONTROLLER_RECORD_FLAG;
+            unsigned total_len= HEADER_SIZE+msg_len;
+
+            // Padding after the last data frame
+            if (msg_len == 0)
+            {
+                break;
+            }
 
-            m_data_frame_listener->handle_data_frame(data_frame);
+            // A data frame can't run past the end of the datagram
+            if (total_len > datagram_size - offset)
+            {
+                bMalformed= true;
+                break;
+            }
+
+            CLIENT_LOG_DEBUG("    ") << show_hex(packed_data_frame, total_len) << std::endl;
+            CLIENT_LOG_DEBUG("    ") << msg_len << " bytes" << std::endl;
+
+            // Compact frames are applied straight out of the receive buffer
+            if (bIsCompactControllerFrame)
+            {
+                m_data_frame_listener->handle_compact_controller_data_frame(&packed_data_frame[HEADER_SIZE], msg_len);
+                offset+= total_len;
+            }
+            // Parse the response buffer
+            else if (m_packed_output_data_frame.unpack(packed_data_frame, total_len))
+            {
+                const PSMoveProtocol::DeviceOutputDataFrame *data_frame = m_packed_output_data_frame.get_msg().get();
+
+                m_data_frame_listener->handle_data_frame(data_frame);
+                offset+= total_len;
+            }
+            else
+            {
+                bMalformed= true;
+                break;
+            }
         }
-        else
+
+        if (bMalformed)
         {
             CLIENT_LOG_ERROR("ClientNetworkManager::handle_udp_data_frame_received") << "Error malformed response" << std::endl;
             stop();
@@ -737,7 +804,7 @@ private:
     vector<uint8_t> m_response_read_buffer;
     PackedMessage<PSMoveProtocol::Response> m_packed_response;
 
-    uint8_t m_output_data_frame_buffer[HEADER_SIZE+MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE];
+    uint8_t m_output_data_frame_buffer[MAX_OUTPUT_DATA_FRAME_BATCH_SIZE];
     PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> m_packed_output_data_frame;
 
     uint8_t m_input_data_frame_buffer[HEADER_SIZE + MAX_INPUT_DATA_FRAME_MESSAGE_SIZE];
@@ -805,6 +872,11 @@ void ClientNetworkManager::update()
     m_implementation_ptr->poll();
 }
 
+void ClientNetworkManager::update_blocking(int timeout_ms)
+{
+    m_implementation_ptr->wait(timeout_ms);
+}
+
 void ClientNetworkManager::shutdown()
 {
     m_implementation_ptr->stop();
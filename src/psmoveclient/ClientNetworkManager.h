@@ -27,6 +27,7 @@ public:
     void send_request(RequestPtr request);
     void send_device_data_frame(DeviceInputDataFramePtr data_frame);
     void update();
+    void update_blocking(int timeout_ms); ///< Like update(), but first waits up to timeout_ms for network activity
     void shutdown();
 
 private:
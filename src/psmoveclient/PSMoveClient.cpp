@@ -7,7 +7,6 @@
 #include "SharedTrackerState.h"
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <algorithm>
 #include <iostream>
 #include <thread>
@@ -31,7 +30,11 @@ static void processPSMoveRecenterAction(PSMController *controller);
 static void processDualShock4RecenterAction(PSMController *controller);
 
 static void applyControllerDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMController *controller);
+static void applyCompactControllerDataFrame(const unsigned char *compact_frame, const int compact_frame_size, CompactControllerFrame *keyframe, PSMController *controller);
+static void resetCompactControllerKeyframe(CompactControllerFrame *keyframe);
+static void updateControllerDataFrameStatistics(PSMController *controller);
 static void applyPSMoveDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMPSMove *psmove);
+static void applyCompactPSMoveState(const CompactControllerState &state, const unsigned int section_mask, PSMPSMove *psmove);
 static void applyPSNaviDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMPSNavi *psnavi);
 static void applyDualShock4DataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMDualShock4 *ds4);
 static void applyVirtualControllerDataFrame(const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, PSMVirtualController *virtual_controller);
@@ -82,7 +85,16 @@ public:
             // Map all of the shared memory for read/write access
             m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_write);
 
-            bSuccess = true;
+            // Refuse frames laid out by a service that predates the frame ring
+            if (getFrameHeader()->isValidLayout(m_region->get_size()))
+            {
+                bSuccess = true;
+            }
+            else
+            {
+                dispose();
+                CLIENT_LOG_ERROR("SharedMemory::initialize()") << "Unsupported shared memory layout: " << m_shared_memory_name;
+            }
         }
         catch (boost::interprocess::interprocess_exception &ex)
         {
@@ -123,18 +135,10 @@ public:
 
     bool readVideoFrame()
     {
-        bool bNewFrame = false;
-        SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(sharedFrameState->mutex);
+        static const int k_max_read_attempt_count = 3;
 
-        // Make sure the target buffer is big enough to read the video frame into
-        size_t buffer_size =
-            SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
-
-        // Make sure the shared memory is the size we expect
-        size_t total_shared_mem_size =
-            SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height);
-        assert(m_region->get_size() >= total_shared_mem_size);
+        bool bNewFrame = false;
+        const SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
 
         // Re-allocate the buffer if any of the video properties changed
         if (m_frame_width != sharedFrameState->width ||
@@ -150,22 +154,46 @@ public:
             allocateVideoBuffer();
         }
 
-        // Copy over the video frame if the frame index changed
-        if (m_last_frame_index != sharedFrameState->frame_index)
+        size_t buffer_size =
+            SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
+
+        // Copy over the latest video frame if the frame index changed.
+        // If the service lapped us mid copy, try again with the newer frame.
+        for (int read_attempt = 0; !bNewFrame && read_attempt < k_max_read_attempt_count; ++read_attempt)
         {
-            if (buffer_size > 0)
+            unsigned int frame_index = 0;
+            const unsigned char *frame_buffer = sharedFrameState->acquireLatestFrame(&frame_index);
+
+            if (frame_buffer == nullptr || frame_index == m_last_frame_index)
             {
-                std::memcpy(m_bgr_frame_buffer, sharedFrameState->getBufferMutable(), buffer_size);
+                break;
             }
 
-            m_last_frame_index = sharedFrameState->frame_index;
+            if (buffer_size > 0)
+            {
+                std::memcpy(m_bgr_frame_buffer, frame_buffer, buffer_size);
+            }
 
-            bNewFrame = true;
+            if (sharedFrameState->isFrameStillValid(frame_index))
+            {
+                m_last_frame_index = frame_index;
+                bNewFrame = true;
+            }
         }
 
         return bNewFrame;
     }
 
+    const unsigned char *getVideoFrameBufferInPlace(unsigned int *out_frame_index) const
+    {
+        return getFrameHeader()->acquireLatestFrame(out_frame_index);
+    }
+
+    bool getIsVideoFrameStillValid(unsigned int frame_index) const
+    {
+        return getFrameHeader()->isFrameStillValid(frame_index);
+    }
+
     void allocateVideoBuffer()
     {
         size_t buffer_size = SharedVideoFrameHeader::computeVideoBufferSize(m_frame_stride, m_frame_height);
@@ -191,12 +219,12 @@ public:
     inline int getVideoFrameWidth() const { return m_frame_width; }
     inline int getVideoFrameHeight() const { return m_frame_height; }
     inline int getVideoFrameStride() const { return m_frame_stride; }
-    inline int getLastVideoFrameIndex() const { return m_last_frame_index; }
+    inline unsigned int getLastVideoFrameIndex() const { return m_last_frame_index; }
 
 protected:
-    SharedVideoFrameHeader *getFrameHeader()
+    const SharedVideoFrameHeader *getFrameHeader() const
     {
-        return reinterpret_cast<SharedVideoFrameHeader *>(m_region->get_address());
+        return reinterpret_cast<const SharedVideoFrameHeader *>(m_region->get_address());
     }
 
 private:
@@ -205,7 +233,7 @@ private:
     boost::interprocess::mapped_region *m_region;
     unsigned char *m_bgr_frame_buffer;
     int m_frame_width, m_frame_height, m_frame_stride;
-    int m_last_frame_index;
+    unsigned int m_last_frame_index;
 };
 
 // -- methods -----
@@ -320,6 +348,8 @@ bool PSMoveClient::startup(e_log_severity_level log_level)
 		{
 			m_controllers[controller_id].ControllerID= controller_id;
 			m_controllers[controller_id].ControllerType= PSMController_None;
+
+			resetCompactControllerKeyframe(&m_compact_controller_keyframes[controller_id]);
 		}
 
 		memset(m_trackers, 0, sizeof(PSMTracker)*PSMOVESERVICE_MAX_TRACKER_COUNT);
@@ -341,6 +371,23 @@ bool PSMoveClient::startup(e_log_severity_level log_level)
 }
 
 void PSMoveClient::update()
+{
+    begin_update();
+
+    // Process incoming/outgoing networking requests
+    m_network_manager->update();
+}
+
+void PSMoveClient::update_blocking(int timeout_ms)
+{
+    begin_update();
+
+    // Sleep until something arrives from the service (or the timeout passes),
+    // then process incoming/outgoing networking requests
+    m_network_manager->update_blocking(timeout_ms);
+}
+
+void PSMoveClient::begin_update()
 {
 	// If this system button pressed flag wasn't checked last frame, 
 	// then drop it so we don't have a stale flag
@@ -357,9 +404,6 @@ void PSMoveClient::update()
 
     // Publish modified device state back to the service
     publish();
-
-    // Process incoming/outgoing networking requests
-    m_network_manager->update();
 }
 
 void PSMoveClient::process_messages()
@@ -750,6 +794,14 @@ PSMRequestID PSMoveClient::start_controller_data_stream(PSMControllerID controll
 			request->mutable_request_start_psmove_data_stream()->set_disable_roi(true);
 		}
 
+		if ((flags & PSMStreamFlags_useCompactDataFrames) > 0)
+		{
+			request->mutable_request_start_psmove_data_stream()->set_use_compact_data_frames(true);
+		}
+
+		// The service starts the new stream with a fresh keyframe and sequence numbers
+		resetCompactControllerKeyframe(&m_compact_controller_keyframes[controller_id]);
+
 		m_request_manager->send_request(request);
 
 		requestID= request->request_id();
@@ -773,6 +825,8 @@ PSMRequestID PSMoveClient::stop_controller_data_stream(PSMControllerID controlle
 
 		m_request_manager->send_request(request);
 
+		resetCompactControllerKeyframe(&m_compact_controller_keyframes[controller_id]);
+
 		requestID= request->request_id();
 	}
 
@@ -1051,6 +1105,46 @@ const unsigned char *PSMoveClient::get_video_frame_buffer(PSMTrackerID tracker_i
 
 	return buffer;
 }
+
+const unsigned char *PSMoveClient::get_video_frame_buffer_in_place(PSMTrackerID tracker_id, unsigned int *out_sequence) const
+{
+	const unsigned char *buffer= nullptr;
+
+	if (IS_VALID_TRACKER_INDEX(tracker_id))
+	{
+		const PSMTracker *tracker= &m_trackers[tracker_id];
+
+		if (tracker->opaque_shared_memory_accesor != nullptr)
+		{
+			const SharedVideoFrameReadOnlyAccessor *shared_memory_accesor = 
+				reinterpret_cast<const SharedVideoFrameReadOnlyAccessor *>(tracker->opaque_shared_memory_accesor);
+
+			buffer= shared_memory_accesor->getVideoFrameBufferInPlace(out_sequence);
+		}
+	}
+
+	return buffer;
+}
+
+bool PSMoveClient::get_is_video_frame_valid(PSMTrackerID tracker_id, unsigned int sequence) const
+{
+	bool bIsValid= false;
+
+	if (IS_VALID_TRACKER_INDEX(tracker_id))
+	{
+		const PSMTracker *tracker= &m_trackers[tracker_id];
+
+		if (tracker->opaque_shared_memory_accesor != nullptr)
+		{
+			const SharedVideoFrameReadOnlyAccessor *shared_memory_accesor = 
+				reinterpret_cast<const SharedVideoFrameReadOnlyAccessor *>(tracker->opaque_shared_memory_accesor);
+
+			bIsValid= shared_memory_accesor->getIsVideoFrameStillValid(sequence);
+		}
+	}
+
+	return bIsValid;
+}
     
 bool PSMoveClient::allocate_hmd_listener(PSMHmdID hmd_id)
 {
@@ -1253,6 +1347,22 @@ void PSMoveClient::handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame
     }
 }
 
+void PSMoveClient::handle_compact_controller_data_frame(const unsigned char *compact_frame, int compact_frame_size)
+{
+	const PSMControllerID controller_id= compact_controller_frame_get_controller_id(compact_frame, compact_frame_size);
+
+	CLIENT_LOG_TRACE("handle_compact_controller_data_frame") 
+		<< "received compact data frame for ControllerID: " 
+		<< controller_id << std::endl;
+
+	if (IS_VALID_CONTROLLER_INDEX(controller_id))
+	{
+		PSMController *controller= get_controller_view(controller_id);
+
+		applyCompactControllerDataFrame(compact_frame, compact_frame_size, &m_compact_controller_keyframes[controller_id], controller);
+	}
+}
+
 static void applyControllerDataFrame(
 	const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet, 
 	PSMController *controller)
@@ -1267,23 +1377,7 @@ static void applyControllerDataFrame(
     controller->OutputSequenceNum = controller_packet.sequence_num();
     controller->IsConnected = controller_packet.isconnected();
 
-    // Compute the data frame receive window statistics if we have received enough samples
-    {
-        long long now = 
-            std::chrono::duration_cast< std::chrono::milliseconds >(
-                std::chrono::system_clock::now().time_since_epoch()).count();
-        long long diff= now - controller->DataFrameLastReceivedTime;
-
-        if (diff > 0)
-        {
-            float seconds= static_cast<float>(diff) / 1000.f;
-            float fps= 1.f / seconds;
-
-            controller->DataFrameAverageFPS= (0.9f)*controller->DataFrameAverageFPS + (0.1f)*fps;
-        }
-
-        controller->DataFrameLastReceivedTime= now;
-    }
+    updateControllerDataFrameStatistics(controller);
    
 	// Don't bother updating the rest of the controller state if it's not connected
 	if (!controller->IsConnected)
@@ -1311,6 +1405,77 @@ static void applyControllerDataFrame(
     }
 }
 
+static void applyCompactControllerDataFrame(
+	const unsigned char *compact_frame,
+	const int compact_frame_size,
+	CompactControllerFrame *keyframe,
+	PSMController *controller)
+{
+	CompactControllerFrame frame;
+	bool bIsKeyframe= false;
+
+	// Deltas written against a keyframe we never got are dropped until the next keyframe arrives
+	if (!compact_controller_frame_read(
+			compact_frame,
+			compact_frame_size,
+			(keyframe->controller_id != -1) ? keyframe : nullptr,
+			&frame, 
+			&bIsKeyframe))
+		return;
+
+	// Keep the newest keyframe, keyframes can arrive out of order too
+	if (bIsKeyframe && (keyframe->controller_id == -1 || frame.sequence_num > keyframe->sequence_num))
+	{
+		*keyframe= frame;
+	}
+
+	CompactControllerState state;
+	compact_controller_frame_dequantize(&frame, &state);
+
+	// Ignore old packets
+	if (state.sequence_num <= controller->OutputSequenceNum)
+		return;
+
+	// Only PSMove controllers stream compact data frames
+	controller->bValid = true;
+	controller->ControllerType = PSMController_Move;
+	controller->OutputSequenceNum = state.sequence_num;
+	controller->IsConnected = state.bIsConnected;
+
+	updateControllerDataFrameStatistics(controller);
+
+	// Don't bother updating the rest of the controller state if it's not connected
+	if (!controller->IsConnected)
+		return;
+
+	applyCompactPSMoveState(state, frame.section_mask, &controller->ControllerState.PSMoveState);
+}
+
+static void resetCompactControllerKeyframe(CompactControllerFrame *keyframe)
+{
+	memset(keyframe, 0, sizeof(CompactControllerFrame));
+	keyframe->controller_id= -1;
+}
+
+static void updateControllerDataFrameStatistics(PSMController *controller)
+{
+    // Compute the data frame receive window statistics if we have received enough samples
+    long long now = 
+        std::chrono::duration_cast< std::chrono::milliseconds >(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    long long diff= now - controller->DataFrameLastReceivedTime;
+
+    if (diff > 0)
+    {
+        float seconds= static_cast<float>(diff) / 1000.f;
+        float fps= 1.f / seconds;
+
+        controller->DataFrameAverageFPS= (0.9f)*controller->DataFrameAverageFPS + (0.1f)*fps;
+    }
+
+    controller->DataFrameLastReceivedTime= now;
+}
+
 static void applyPSMoveDataFrame(
 	const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet,
 	PSMPSMove *psmove)
@@ -1478,6 +1643,80 @@ static void applyPSMoveDataFrame(
 	psmove->BatteryValue = static_cast<PSMBatteryState>(psmove_packet.battery_value());
 }
 
+static void applyCompactPSMoveState(
+	const CompactControllerState &state,
+	const unsigned int section_mask,
+	PSMPSMove *psmove)
+{
+    psmove->bHasValidHardwareCalibration = state.bHasValidHardwareCalibration;
+    psmove->bIsTrackingEnabled = state.bIsTrackingEnabled;
+    psmove->bIsCurrentlyTracking = state.bIsCurrentlyTracking;
+	psmove->bIsOrientationValid = state.bIsOrientationValid;
+	psmove->bIsPositionValid = state.bIsPositionValid;
+
+    psmove->Pose.Orientation.w= state.orientation_wxyz[0];
+    psmove->Pose.Orientation.x= state.orientation_wxyz[1];
+    psmove->Pose.Orientation.y= state.orientation_wxyz[2];
+    psmove->Pose.Orientation.z= state.orientation_wxyz[3];
+
+    psmove->Pose.Position.x= state.position_cm[0];
+    psmove->Pose.Position.y= state.position_cm[1];
+    psmove->Pose.Position.z= state.position_cm[2];
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Physics)) != 0)
+    {
+        psmove->PhysicsData.LinearVelocityCmPerSec = { state.velocity_cm_per_sec[0], state.velocity_cm_per_sec[1], state.velocity_cm_per_sec[2] };
+        psmove->PhysicsData.LinearAccelerationCmPerSecSqr = { state.acceleration_cm_per_sec_sqr[0], state.acceleration_cm_per_sec_sqr[1], state.acceleration_cm_per_sec_sqr[2] };
+        psmove->PhysicsData.AngularVelocityRadPerSec = { state.angular_velocity_rad_per_sec[0], state.angular_velocity_rad_per_sec[1], state.angular_velocity_rad_per_sec[2] };
+        psmove->PhysicsData.AngularAccelerationRadPerSecSqr = { state.angular_acceleration_rad_per_sec_sqr[0], state.angular_acceleration_rad_per_sec_sqr[1], state.angular_acceleration_rad_per_sec_sqr[2] };
+		psmove->PhysicsData.TimeInSeconds= -1.0;
+    }
+    else
+    {
+        memset(&psmove->PhysicsData, 0, sizeof(PSMPhysicsData));
+    }
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_RawSensor)) != 0)
+    {
+        psmove->RawSensorData.Magnetometer = { state.raw_magnetometer[0], state.raw_magnetometer[1], state.raw_magnetometer[2] };
+        psmove->RawSensorData.Accelerometer = { state.raw_accelerometer[0], state.raw_accelerometer[1], state.raw_accelerometer[2] };
+        psmove->RawSensorData.Gyroscope = { state.raw_gyroscope[0], state.raw_gyroscope[1], state.raw_gyroscope[2] };
+		psmove->RawSensorData.TimeInSeconds= -1.0;
+    }
+    else
+    {
+		memset(&psmove->RawSensorData, 0, sizeof(PSMPSMoveRawSensorData));
+	}
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_CalibratedSensor)) != 0)
+	{
+		psmove->CalibratedSensorData.Magnetometer = { state.calibrated_magnetometer[0], state.calibrated_magnetometer[1], state.calibrated_magnetometer[2] };
+		psmove->CalibratedSensorData.Accelerometer = { state.calibrated_accelerometer_g[0], state.calibrated_accelerometer_g[1], state.calibrated_accelerometer_g[2] };
+		psmove->CalibratedSensorData.Gyroscope = { state.calibrated_gyroscope_rad_per_sec[0], state.calibrated_gyroscope_rad_per_sec[1], state.calibrated_gyroscope_rad_per_sec[2] };
+		psmove->CalibratedSensorData.TimeInSeconds = -1.0;
+	}
+	else
+	{
+		memset(&psmove->CalibratedSensorData, 0, sizeof(PSMPSMoveCalibratedSensorData));
+	}
+
+	// Raw tracker data is never sent compact
+	memset(&psmove->RawTrackerData, 0, sizeof(PSMRawTrackerData));
+
+	applyPSMButtonState(psmove->TriangleButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIANGLE);
+	applyPSMButtonState(psmove->CircleButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CIRCLE);
+	applyPSMButtonState(psmove->CrossButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_CROSS);
+	applyPSMButtonState(psmove->SquareButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SQUARE);
+	applyPSMButtonState(psmove->SelectButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_SELECT);
+	applyPSMButtonState(psmove->StartButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_START);
+	applyPSMButtonState(psmove->PSButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_PS);
+	applyPSMButtonState(psmove->MoveButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_MOVE);
+	applyPSMButtonState(psmove->TriggerButton, state.button_bitmask, PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket_ButtonType_TRIGGER);
+
+	psmove->TriggerValue = static_cast<unsigned char>(state.trigger_value);
+	psmove->BatteryValue = static_cast<PSMBatteryState>(state.battery_value);
+}
+
 static void applyPSNaviDataFrame(
 	const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket& controller_packet,
 	PSMPSNavi *psnavi)
@@ -2160,6 +2399,8 @@ void PSMoveClient::handle_server_connection_closed()
 {
     CLIENT_LOG_INFO("handle_server_connection_closed") << "Disconnected from service" << std::endl;
 
+    reset_compact_controller_keyframes();
+
     enqueue_event_message(PSMEventMessage::PSMEvent_disconnectedFromService, ResponsePtr());
 }
 
@@ -2171,6 +2412,17 @@ void PSMoveClient::handle_server_connection_close_failed(const boost::system::er
 void PSMoveClient::handle_server_connection_socket_error(const boost::system::error_code& ec)
 {
     CLIENT_LOG_ERROR("handle_server_connection_close_failed") << "Socket error: " << ec.message() << std::endl;
+
+    // A reconnected service starts its compact streams over
+    reset_compact_controller_keyframes();
+}
+
+void PSMoveClient::reset_compact_controller_keyframes()
+{
+	for (PSMControllerID controller_id= 0; controller_id < PSMOVESERVICE_MAX_CONTROLLER_COUNT; ++controller_id)    
+	{
+		resetCompactControllerKeyframe(&m_compact_controller_keyframes[controller_id]);
+	}
 }
 
 // Request Manager Callback
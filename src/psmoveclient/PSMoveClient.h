@@ -6,6 +6,7 @@
 #include "PSMoveProtocolInterface.h"
 #include "ClientNetworkInterface.h"
 #include "ClientLog.h"
+#include "CompactDataFrame.h"
 #include <deque>
 #include <map>
 #include <vector>
@@ -37,6 +38,7 @@ public:
     // -- ClientPSMoveAPI System -----
     bool startup(e_log_severity_level log_level);
     void update();
+    void update_blocking(int timeout_ms);
 	void process_messages();
     bool poll_next_message(PSMMessage *message, size_t message_size);
     void shutdown();
@@ -66,6 +68,8 @@ public:
 	bool poll_video_stream(PSMTrackerID tracker_id);
 	void close_video_stream(PSMTrackerID tracker_id);
 	const unsigned char *get_video_frame_buffer(PSMTrackerID tracker_id) const;
+	const unsigned char *get_video_frame_buffer_in_place(PSMTrackerID tracker_id, unsigned int *out_sequence) const;
+	bool get_is_video_frame_valid(PSMTrackerID tracker_id, unsigned int sequence) const;
 
     bool allocate_hmd_listener(PSMHmdID HmdID);
     void free_hmd_listener(PSMHmdID HmdID);   
@@ -82,10 +86,12 @@ public:
     bool cancel_callback(PSMRequestID request_id);
     
 protected:
+    void begin_update();
     void publish();
 
     // IDataFrameListener
     virtual void handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame) override;
+    virtual void handle_compact_controller_data_frame(const unsigned char *compact_frame, int compact_frame_size) override;
 
     // INotificationListener
     virtual void handle_notification(ResponsePtr notification) override;
@@ -107,6 +113,9 @@ protected:
     bool execute_callback(const PSMResponseMessage *response_message);
     void enqueue_response_message(const PSMResponseMessage *response_message);
 
+    // Compact controller streams start over with a new keyframe after a stream restart or reconnect
+    void reset_compact_controller_keyframes();
+
 private:
     //-- Pending requests -----
     class ClientRequestManager *m_request_manager;
@@ -116,6 +125,7 @@ private:
     
     //-- Controller Views -----
 	PSMController m_controllers[PSMOVESERVICE_MAX_CONTROLLER_COUNT];
+	CompactControllerFrame m_compact_controller_keyframes[PSMOVESERVICE_MAX_CONTROLLER_COUNT]; ///< controller_id is -1 until a keyframe arrives
 
     //-- Tracker Views -----
 	PSMTracker m_trackers[PSMOVESERVICE_MAX_TRACKER_COUNT];
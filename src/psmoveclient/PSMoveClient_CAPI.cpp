@@ -10,6 +10,7 @@
 
 #include <map>
 #include <assert.h>
+#include <cmath>
 
 #ifdef _MSC_VER
 	#pragma warning(disable:4996)  // ignore strncpy warning
@@ -44,6 +45,14 @@ public:
         return timeSinceStart > m_duration;
     }
 
+    int GetRemainingMilliseconds() const
+    {
+        std::chrono::time_point<std::chrono::high_resolution_clock> now= std::chrono::high_resolution_clock::now();
+        std::chrono::duration<float, std::milli> timeRemaining= m_duration - (now - m_startTime);
+
+        return (timeRemaining.count() > 0.f) ? static_cast<int>(std::ceil(timeRemaining.count())) : 0;
+    }
+
 private:
     std::chrono::time_point<std::chrono::high_resolution_clock> m_startTime;
     std::chrono::duration<float, std::milli> m_duration;
@@ -82,13 +91,13 @@ public:
     
 			while (!m_bReceived && !timeout.HasElapsed())
 			{
-				_PAUSE(10);
-
-				// Process responses, events and controller updates from the service
-				PSM_Update();
+				// Wait for the service to send something rather than sleeping a fixed amount,
+				// then process responses, events and controller updates from the service
+				g_psm_client->update_blocking(timeout.GetRemainingMilliseconds());
+				g_psm_client->process_messages();
 			}
 
-			if (timeout.HasElapsed())
+			if (!m_bReceived)
 			{
 				g_psm_client->cancel_callback(m_request_id);
 				result= PSMResult_Timeout;
@@ -171,14 +180,17 @@ PSMResult PSM_Initialize(const char* host, const char* port, int timeout_ms)
     {
         PSMCallbackTimeout timeout(timeout_ms);
 
-        while (!g_psm_client->pollHasConnectionStatusChanged() && !timeout.HasElapsed())
+        bool bHasConnectionStatusChanged= false;
+
+        while (!bHasConnectionStatusChanged && !timeout.HasElapsed())
         {
-            _PAUSE(10);
-			g_psm_client->update();
+			g_psm_client->update_blocking(timeout.GetRemainingMilliseconds());
 			g_psm_client->process_messages();
+
+            bHasConnectionStatusChanged= g_psm_client->pollHasConnectionStatusChanged();
         }
 
-        if (!timeout.HasElapsed())
+        if (bHasConnectionStatusChanged)
         {
             result= g_psm_client->getIsConnected() ? PSMResult_Success : PSMResult_Error;
         }
@@ -1195,6 +1207,40 @@ PSMResult PSM_GetTrackerVideoFrameBuffer(PSMTrackerID tracker_id, const unsigned
     return result;
 }
 
+PSMResult PSM_GetTrackerVideoFrameBufferInPlace(PSMTrackerID tracker_id, const unsigned char **out_buffer, unsigned int *out_sequence)
+{
+    PSMResult result= PSMResult_Error;
+	assert(out_buffer != nullptr);
+	assert(out_sequence != nullptr);
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+        const unsigned char *buffer= g_psm_client->get_video_frame_buffer_in_place(tracker_id, out_sequence);
+		if (buffer != nullptr)
+		{
+			*out_buffer= buffer;
+			result= PSMResult_Success;
+		}
+    }
+
+    return result;
+}
+
+PSMResult PSM_GetIsTrackerVideoFrameValid(PSMTrackerID tracker_id, unsigned int sequence)
+{
+    PSMResult result= PSMResult_Error;
+
+    if (g_psm_client != nullptr && IS_VALID_TRACKER_INDEX(tracker_id))
+    {
+		if (g_psm_client->get_is_video_frame_valid(tracker_id, sequence))
+		{
+			result= PSMResult_Success;
+		}
+    }
+
+    return result;
+}
+
 PSMResult PSM_GetTrackerFrustum(PSMTrackerID tracker_id, PSMFrustum *out_frustum)
 {
     PSMResult result= PSMResult_Error;
@@ -111,6 +111,7 @@ typedef enum
 	PSMStreamFlags_includeCalibratedSensorData = 0x08,	///< Add calibrated IMU sensor state
     PSMStreamFlags_includeRawTrackerData = 0x10,		///< Add raw optical tracking projection info
 	PSMStreamFlags_disableROI = 0x20,					///< Disable Region-of-Interest tracking optimization
+	PSMStreamFlags_useCompactDataFrames = 0x40,			///< Stream quantized, delta encoded PSMove data frames (ignored for other controllers and with includeRawTrackerData)
 } PSMControllerDataStreamFlags;
 
 /// The possible rumble channels available to the comtrollers
@@ -913,6 +914,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerList(PSMControllerList *out_cont
 		- PSMStreamFlags_includeCalibratedSensorData = add calibrated sensor data values
 		- PSMStreamFlags_includeRawTrackerData = add tracker projection info for each tacker
 		- PSMStreamFlags_disableROI = turns off RegionOfInterest optimization used to reduce CPU load when finding tracking bulb
+		- PSMStreamFlags_useCompactDataFrames = send PSMove state quantized and delta encoded to save bandwidth.
+		  Other controller types and streams with raw tracker data keep getting full data frames.
 	\param timeout_ms The conection timeout period in milliseconds, usually PSM_DEFAULT_TIMEOUT
 	\return PSMResult_Success upon receiving result, PSMResult_Timeoout, or PSMResult_Error on request error.
  */
@@ -1102,6 +1105,8 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetControllerListAsync(PSMRequestID *out_requ
 		- PSMStreamFlags_includeCalibratedSensorData = add calibrated sensor data values
 		- PSMStreamFlags_includeRawTrackerData = add tracker projection info for each tacker
 		- PSMStreamFlags_disableROI = turns off RegionOfInterest optimization used to reduce CPU load when finding tracking bulb
+		- PSMStreamFlags_useCompactDataFrames = send PSMove state quantized and delta encoded to save bandwidth.
+		  Other controller types and streams with raw tracker data keep getting full data frames.
 	\param[out] out_request_id The id of the request sent to PSMoveService. Can be used to register callback with \ref PSM_RegisterCallback.
 	\return PSMResult_RequestSent on success or PSMResult_Error if there was no valid connection
  */
@@ -1276,6 +1281,25 @@ PSM_PUBLIC_FUNCTION(PSMResult) PSM_CloseTrackerVideoStream(PSMTrackerID tracker_
  */
 PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetTrackerVideoFrameBuffer(PSMTrackerID tracker_id, const unsigned char **out_buffer); 
 
+/** \brief Get the latest video frame of an opened tracker video stream without copying it
+	Points straight into the shared memory frame ring, so no \ref PSM_PollTrackerVideoStream call is needed.
+	PSMoveService keeps writing new frames while the client reads, but a frame is only overwritten 
+	a few frame periods after it is published. Call \ref PSM_GetIsTrackerVideoFrameValid once done 
+	reading the frame to find out if it was overwritten in the meantime.
+	\param tracker_id The tracker to get the latest video frame from
+	\param[out] out_buffer A pointer to the frame in shared memory (tracker dimension x 3 bytes)
+	\param[out] out_sequence The sequence number of the frame, which goes up by one with each new frame
+	\return PSMResult_Success if there was a frame available to read
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetTrackerVideoFrameBufferInPlace(PSMTrackerID tracker_id, const unsigned char **out_buffer, unsigned int *out_sequence);
+
+/** \brief Checks that a frame from \ref PSM_GetTrackerVideoFrameBufferInPlace wasn't overwritten while being read
+	\param tracker_id The tracker the frame came from
+	\param sequence The sequence number returned with the frame
+	\return PSMResult_Success if the frame is still intact, PSMResult_Error if it has been (or is being) overwritten
+ */
+PSM_PUBLIC_FUNCTION(PSMResult) PSM_GetIsTrackerVideoFrameValid(PSMTrackerID tracker_id, unsigned int sequence);
+
 /** \brief Helper function to fetch tracking frustum properties from a tracker
 	\param The id of the tracker we wish to get the tracking frustum properties for
 	\param out_frustum The tracking frustum properties to write the result into
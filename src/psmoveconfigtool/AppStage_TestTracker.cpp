@@ -37,6 +37,7 @@ AppStage_TestTracker::AppStage_TestTracker(App *app)
     , m_bStreamIsActive(false)
     , m_tracker_view(nullptr)
     , m_video_texture(nullptr)
+    , m_last_video_frame_sequence(0)
 { }
 
 void AppStage_TestTracker::enter()
@@ -66,17 +67,24 @@ void AppStage_TestTracker::exit()
 
 void AppStage_TestTracker::update()
 {
-    // Try and read the next video frame from shared memory
+    // Upload the latest video frame straight out of shared memory
     if (m_video_texture != nullptr)
     {
-        if (PSM_PollTrackerVideoStream(m_tracker_view->tracker_info.tracker_id) == PSMResult_Success)
-        {
-			const unsigned char *buffer= nullptr;
-			if (PSM_GetTrackerVideoFrameBuffer(m_tracker_view->tracker_info.tracker_id, &buffer) == PSMResult_Success)
+		const PSMTrackerID tracker_id= m_tracker_view->tracker_info.tracker_id;
+		const unsigned char *buffer= nullptr;
+		unsigned int sequence= 0;
+
+		if (PSM_GetTrackerVideoFrameBufferInPlace(tracker_id, &buffer, &sequence) == PSMResult_Success &&
+			sequence != m_last_video_frame_sequence)
+		{
+			m_video_texture->copyBufferIntoTexture(buffer);
+
+			// If the frame got overwritten mid upload, upload the newer one next update
+			if (PSM_GetIsTrackerVideoFrameValid(tracker_id, sequence) == PSMResult_Success)
 			{
-				m_video_texture->copyBufferIntoTexture(buffer);
+				m_last_video_frame_sequence= sequence;
 			}
-        }
+		}
     }
 }
 
@@ -242,6 +250,7 @@ void AppStage_TestTracker::handle_tracker_start_stream_response(
                     GL_RGB, // texture format
                     GL_BGR, // buffer format
                     nullptr);
+                thisPtr->m_last_video_frame_sequence = 0;
             }
         } break;
 
@@ -53,6 +53,7 @@ private:
     bool m_bStreamIsActive;
     PSMTracker *m_tracker_view;
     class TextureAsset *m_video_texture;
+    unsigned int m_last_video_frame_sequence;
 };
 
 #endif // APP_STAGE_TEST_TRACKER_H
\ No newline at end of file
@@ -1127,4 +1127,70 @@ eigen_alignment_compute_camera_fundamental_matrix(
 
 	// Compute the fundamental matrix from camera A to camera B
 	F_ab = Kb.inverse().transpose() * E * Ka.inverse();
-}
\ No newline at end of file
+}
+
+bool
+eigen_alignment_triangulate_weighted_point(
+	const Eigen::Matrix<float, 3, 4> *pinhole_matrices,
+	const Eigen::Vector2f *screen_locations,
+	const float *weights,
+	const int camera_count,
+	Eigen::Vector3f *out_point)
+{
+	// Normal equations of the weighted plane distance problem.
+	// Accumulated in double since pinhole matrix rows mix pixel and cm scales.
+	Eigen::Matrix3d AtA = Eigen::Matrix3d::Zero();
+	Eigen::Vector3d Atb = Eigen::Vector3d::Zero();
+	double weight_sum = 0.0;
+
+	for (int camera_index = 0; camera_index < camera_count; ++camera_index)
+	{
+		const double weight = static_cast<double>(weights[camera_index]);
+
+		if (weight <= 0.0)
+		{
+			continue;
+		}
+
+		const Eigen::Matrix<double, 3, 4> P = pinhole_matrices[camera_index].cast<double>();
+		const Eigen::Vector2d screen_location = screen_locations[camera_index].cast<double>();
+
+		// x*P3 - P1 and y*P3 - P2 are the planes through the camera center containing the ray to (x, y)
+		for (int axis = 0; axis < 2; ++axis)
+		{
+			const Eigen::Matrix<double, 1, 4> plane = screen_location(axis) * P.row(2) - P.row(axis);
+			const Eigen::Vector3d normal = plane.head<3>().transpose();
+			const double normal_length_sqr = normal.squaredNorm();
+
+			if (normal_length_sqr > k_real64_epsilon)
+			{
+				const double plane_weight = weight / normal_length_sqr;
+
+				AtA += plane_weight * normal * normal.transpose();
+				Atb -= (plane_weight * plane(3)) * normal;
+			}
+		}
+
+		weight_sum += weight;
+	}
+
+	if (weight_sum <= 0.0)
+	{
+		return false;
+	}
+
+	// Normalize so the determinant only depends on how well the rays cross (~sin^2 of their angle)
+	AtA /= weight_sum;
+	Atb /= weight_sum;
+
+	Eigen::Matrix3d AtA_inverse;
+	bool bIsInvertible = false;
+	AtA.computeInverseWithCheck(AtA_inverse, bIsInvertible, 1e-9);
+
+	if (bIsInvertible)
+	{
+		*out_point = (AtA_inverse * Atb).cast<float>();
+	}
+
+	return bIsInvertible;
+}
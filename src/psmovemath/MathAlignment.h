@@ -183,4 +183,17 @@ eigen_alignment_compute_camera_fundamental_matrix(
 	const Eigen::Matrix3f &Kb, // intrinsic matrix of camera B
 	Eigen::Matrix3f &F_ab); // Output Fundamental matric F_ab
 
+// Triangulates the world space point seen at a screen location by each of several pinhole cameras
+// in a single weighted linear least squares solve.
+// * Each camera contributes the two planes through its center that contain the ray to its screen location
+// * Planes are normalized so residuals are distances, then scaled by the camera weight (must be >= 0)
+// * Returns false if the weighted rays don't pin down a single point
+bool
+eigen_alignment_triangulate_weighted_point(
+	const Eigen::Matrix<float, 3, 4> *pinhole_matrices,
+	const Eigen::Vector2f *screen_locations,
+	const float *weights,
+	const int camera_count,
+	Eigen::Vector3f *out_point);
+
 #endif // MATH_UTILITY_H
@@ -0,0 +1,512 @@
+//-- includes -----
+#include "CompactDataFrame.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+//-- constants -----
+// Bytes each section takes on the wire
+static const int k_section_sizes[CompactControllerSection_COUNT] = {
+    7,  // Status: flags, 32 button bits, trigger, battery
+    6,  // Orientation: 2 bit largest component index + 3 x 15 bits
+    9,  // Position: 3 x 24 bits
+    18, // RawSensor: 9 x 16 bits
+    18, // CalibratedSensor: 9 x 16 bits
+    24, // Physics: 12 x 16 bits
+};
+
+// Status flag bits
+static const unsigned char k_status_connected = 0x01;
+static const unsigned char k_status_valid_hardware_calibration = 0x02;
+static const unsigned char k_status_tracking_enabled = 0x04;
+static const unsigned char k_status_currently_tracking = 0x08;
+static const unsigned char k_status_orientation_valid = 0x10;
+static const unsigned char k_status_position_valid = 0x20;
+
+// Header flag bits
+static const unsigned char k_header_keyframe = 0x01;
+
+// Fixed point scales, chosen to cover the sensor ranges the controllers report
+static const float k_position_units_per_cm = 100.f;               // 0.1mm, +/-838m
+static const float k_orientation_component_max = 0.70710678f;     // 1/sqrt(2)
+static const float k_orientation_component_units = 16383.f;        // Centered on 16384 so that 0 is exact
+static const float k_accelerometer_units_per_g = 4096.f;          // +/-8g
+static const float k_gyroscope_units_per_rad_per_sec = 1024.f;    // +/-32 rad/s
+static const float k_magnetometer_units = 16384.f;                // +/-2
+static const float k_velocity_units_per_cm_per_sec = 10.f;        // +/-3276 cm/s
+static const float k_acceleration_units_per_cm_per_sec_sqr = 1.f; // +/-32767 cm/s^2
+static const float k_angular_velocity_units_per_rad_per_sec = 512.f;        // +/-64 rad/s
+static const float k_angular_acceleration_units_per_rad_per_sec_sqr = 16.f; // +/-2048 rad/s^2
+
+//-- private methods -----
+static inline int round_and_clamp(float value, int min_value, int max_value)
+{
+    const float rounded = floorf(value + 0.5f);
+
+    if (rounded <= static_cast<float>(min_value))
+        return min_value;
+    if (rounded >= static_cast<float>(max_value))
+        return max_value;
+
+    return static_cast<int>(rounded);
+}
+
+static inline void write_u16(unsigned char *buffer, unsigned int value)
+{
+    buffer[0] = static_cast<unsigned char>(value & 0xFF);
+    buffer[1] = static_cast<unsigned char>((value >> 8) & 0xFF);
+}
+
+static inline unsigned int read_u16(const unsigned char *buffer)
+{
+    return static_cast<unsigned int>(buffer[0]) | (static_cast<unsigned int>(buffer[1]) << 8);
+}
+
+static inline void write_u32(unsigned char *buffer, unsigned int value)
+{
+    write_u16(buffer, value & 0xFFFF);
+    write_u16(buffer + 2, value >> 16);
+}
+
+static inline unsigned int read_u32(const unsigned char *buffer)
+{
+    return read_u16(buffer) | (read_u16(buffer + 2) << 16);
+}
+
+static inline void write_s16(unsigned char *buffer, float value, float units)
+{
+    write_u16(buffer, static_cast<unsigned int>(round_and_clamp(value * units, -32767, 32767)) & 0xFFFF);
+}
+
+static inline float read_s16(const unsigned char *buffer, float units)
+{
+    return static_cast<float>(static_cast<short>(read_u16(buffer))) / units;
+}
+
+static inline void write_s24(unsigned char *buffer, float value, float units)
+{
+    const unsigned int bits = static_cast<unsigned int>(round_and_clamp(value * units, -8388607, 8388607));
+
+    buffer[0] = static_cast<unsigned char>(bits & 0xFF);
+    buffer[1] = static_cast<unsigned char>((bits >> 8) & 0xFF);
+    buffer[2] = static_cast<unsigned char>((bits >> 16) & 0xFF);
+}
+
+static inline float read_s24(const unsigned char *buffer, float units)
+{
+    unsigned int bits =
+        static_cast<unsigned int>(buffer[0]) |
+        (static_cast<unsigned int>(buffer[1]) << 8) |
+        (static_cast<unsigned int>(buffer[2]) << 16);
+
+    // Sign extend
+    if ((bits & 0x800000) != 0)
+    {
+        bits |= 0xFF000000;
+    }
+
+    return static_cast<float>(static_cast<int>(bits)) / units;
+}
+
+static void write_vector3_s16(unsigned char *buffer, const float *v, float units)
+{
+    write_s16(buffer, v[0], units);
+    write_s16(buffer + 2, v[1], units);
+    write_s16(buffer + 4, v[2], units);
+}
+
+static void read_vector3_s16(const unsigned char *buffer, float units, float *out_v)
+{
+    out_v[0] = read_s16(buffer, units);
+    out_v[1] = read_s16(buffer + 2, units);
+    out_v[2] = read_s16(buffer + 4, units);
+}
+
+static void write_vector3i_s16(unsigned char *buffer, const int *v)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const int value = v[axis] < -32768 ? -32768 : (v[axis] > 32767 ? 32767 : v[axis]);
+
+        write_u16(buffer + 2*axis, static_cast<unsigned int>(value) & 0xFFFF);
+    }
+}
+
+static void read_vector3i_s16(const unsigned char *buffer, int *out_v)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        out_v[axis] = static_cast<short>(read_u16(buffer + 2*axis));
+    }
+}
+
+// Drops the largest component of the unit quaternion, which the other three imply.
+// The sign is flipped so the dropped component is positive, since q and -q are the same rotation.
+static void write_orientation(unsigned char *buffer, const float *q_wxyz)
+{
+    float length_sqr = 0.f;
+    int largest_index = 0;
+    for (int index = 0; index < 4; ++index)
+    {
+        length_sqr += q_wxyz[index] * q_wxyz[index];
+
+        if (fabsf(q_wxyz[index]) > fabsf(q_wxyz[largest_index]))
+        {
+            largest_index = index;
+        }
+    }
+
+    unsigned long long bits = static_cast<unsigned long long>(largest_index);
+    if (length_sqr > 0.f)
+    {
+        const float scale = (q_wxyz[largest_index] < 0.f ? -1.f : 1.f) / sqrtf(length_sqr);
+
+        for (int index = 0; index < 4; ++index)
+        {
+            if (index != largest_index)
+            {
+                const float component = q_wxyz[index] * scale / k_orientation_component_max;
+                const int quantized =
+                    round_and_clamp(component * k_orientation_component_units, -16383, 16383) + 16384;
+
+                bits = (bits << 15) | static_cast<unsigned long long>(quantized);
+            }
+        }
+    }
+    else
+    {
+        // Not a rotation, keep the identity
+        bits = 0;
+        for (int index = 1; index < 4; ++index)
+        {
+            bits = (bits << 15) | 16384;
+        }
+    }
+
+    for (int byte_index = 0; byte_index < 6; ++byte_index)
+    {
+        buffer[byte_index] = static_cast<unsigned char>((bits >> (8 * byte_index)) & 0xFF);
+    }
+}
+
+static void read_orientation(const unsigned char *buffer, float *out_q_wxyz)
+{
+    unsigned long long bits = 0;
+    for (int byte_index = 5; byte_index >= 0; --byte_index)
+    {
+        bits = (bits << 8) | buffer[byte_index];
+    }
+
+    const int largest_index = static_cast<int>((bits >> 45) & 0x3);
+    float sum_sqr = 0.f;
+    int shift = 30;
+    for (int index = 0; index < 4; ++index)
+    {
+        if (index != largest_index)
+        {
+            const float quantized = static_cast<float>((bits >> shift) & 0x7FFF);
+            const float component = (quantized - 16384.f) / k_orientation_component_units * k_orientation_component_max;
+
+            out_q_wxyz[index] = component;
+            sum_sqr += component * component;
+            shift -= 15;
+        }
+    }
+
+    out_q_wxyz[largest_index] = sum_sqr < 1.f ? sqrtf(1.f - sum_sqr) : 0.f;
+}
+
+//-- public interface -----
+void compact_controller_frame_quantize(
+    const CompactControllerState *state,
+    const unsigned int section_mask,
+    CompactControllerFrame *out_frame)
+{
+    memset(out_frame, 0, sizeof(CompactControllerFrame));
+    out_frame->controller_id = state->controller_id;
+    out_frame->sequence_num = state->sequence_num;
+    out_frame->section_mask = section_mask & (COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_COUNT) - 1);
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Status)) != 0)
+    {
+        unsigned char *section = out_frame->sections[CompactControllerSection_Status];
+        unsigned char flags = 0;
+
+        if (state->bIsConnected) flags |= k_status_connected;
+        if (state->bHasValidHardwareCalibration) flags |= k_status_valid_hardware_calibration;
+        if (state->bIsTrackingEnabled) flags |= k_status_tracking_enabled;
+        if (state->bIsCurrentlyTracking) flags |= k_status_currently_tracking;
+        if (state->bIsOrientationValid) flags |= k_status_orientation_valid;
+        if (state->bIsPositionValid) flags |= k_status_position_valid;
+
+        section[0] = flags;
+        write_u32(section + 1, state->button_bitmask);
+        section[5] = static_cast<unsigned char>(state->trigger_value);
+        section[6] = static_cast<unsigned char>(state->battery_value);
+    }
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Orientation)) != 0)
+    {
+        write_orientation(out_frame->sections[CompactControllerSection_Orientation], state->orientation_wxyz);
+    }
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Position)) != 0)
+    {
+        unsigned char *section = out_frame->sections[CompactControllerSection_Position];
+
+        write_s24(section, state->position_cm[0], k_position_units_per_cm);
+        write_s24(section + 3, state->position_cm[1], k_position_units_per_cm);
+        write_s24(section + 6, state->position_cm[2], k_position_units_per_cm);
+    }
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_RawSensor)) != 0)
+    {
+        unsigned char *section = out_frame->sections[CompactControllerSection_RawSensor];
+
+        write_vector3i_s16(section, state->raw_magnetometer);
+        write_vector3i_s16(section + 6, state->raw_accelerometer);
+        write_vector3i_s16(section + 12, state->raw_gyroscope);
+    }
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_CalibratedSensor)) != 0)
+    {
+        unsigned char *section = out_frame->sections[CompactControllerSection_CalibratedSensor];
+
+        write_vector3_s16(section, state->calibrated_magnetometer, k_magnetometer_units);
+        write_vector3_s16(section + 6, state->calibrated_accelerometer_g, k_accelerometer_units_per_g);
+        write_vector3_s16(section + 12, state->calibrated_gyroscope_rad_per_sec, k_gyroscope_units_per_rad_per_sec);
+    }
+
+    if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Physics)) != 0)
+    {
+        unsigned char *section = out_frame->sections[CompactControllerSection_Physics];
+
+        write_vector3_s16(section, state->velocity_cm_per_sec, k_velocity_units_per_cm_per_sec);
+        write_vector3_s16(section + 6, state->acceleration_cm_per_sec_sqr, k_acceleration_units_per_cm_per_sec_sqr);
+        write_vector3_s16(section + 12, state->angular_velocity_rad_per_sec, k_angular_velocity_units_per_rad_per_sec);
+        write_vector3_s16(section + 18, state->angular_acceleration_rad_per_sec_sqr, k_angular_acceleration_units_per_rad_per_sec_sqr);
+    }
+}
+
+void compact_controller_frame_dequantize(
+    const CompactControllerFrame *frame,
+    CompactControllerState *out_state)
+{
+    memset(out_state, 0, sizeof(CompactControllerState));
+    out_state->controller_id = frame->controller_id;
+    out_state->sequence_num = frame->sequence_num;
+    out_state->orientation_wxyz[0] = 1.f;
+
+    if ((frame->section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Status)) != 0)
+    {
+        const unsigned char *section = frame->sections[CompactControllerSection_Status];
+        const unsigned char flags = section[0];
+
+        out_state->bIsConnected = (flags & k_status_connected) != 0;
+        out_state->bHasValidHardwareCalibration = (flags & k_status_valid_hardware_calibration) != 0;
+        out_state->bIsTrackingEnabled = (flags & k_status_tracking_enabled) != 0;
+        out_state->bIsCurrentlyTracking = (flags & k_status_currently_tracking) != 0;
+        out_state->bIsOrientationValid = (flags & k_status_orientation_valid) != 0;
+        out_state->bIsPositionValid = (flags & k_status_position_valid) != 0;
+        out_state->button_bitmask = read_u32(section + 1);
+        out_state->trigger_value = section[5];
+        out_state->battery_value = section[6];
+    }
+
+    if ((frame->section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Orientation)) != 0)
+    {
+        read_orientation(frame->sections[CompactControllerSection_Orientation], out_state->orientation_wxyz);
+    }
+
+    if ((frame->section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Position)) != 0)
+    {
+        const unsigned char *section = frame->sections[CompactControllerSection_Position];
+
+        out_state->position_cm[0] = read_s24(section, k_position_units_per_cm);
+        out_state->position_cm[1] = read_s24(section + 3, k_position_units_per_cm);
+        out_state->position_cm[2] = read_s24(section + 6, k_position_units_per_cm);
+    }
+
+    if ((frame->section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_RawSensor)) != 0)
+    {
+        const unsigned char *section = frame->sections[CompactControllerSection_RawSensor];
+
+        read_vector3i_s16(section, out_state->raw_magnetometer);
+        read_vector3i_s16(section + 6, out_state->raw_accelerometer);
+        read_vector3i_s16(section + 12, out_state->raw_gyroscope);
+    }
+
+    if ((frame->section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_CalibratedSensor)) != 0)
+    {
+        const unsigned char *section = frame->sections[CompactControllerSection_CalibratedSensor];
+
+        read_vector3_s16(section, k_magnetometer_units, out_state->calibrated_magnetometer);
+        read_vector3_s16(section + 6, k_accelerometer_units_per_g, out_state->calibrated_accelerometer_g);
+        read_vector3_s16(section + 12, k_gyroscope_units_per_rad_per_sec, out_state->calibrated_gyroscope_rad_per_sec);
+    }
+
+    if ((frame->section_mask & COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Physics)) != 0)
+    {
+        const unsigned char *section = frame->sections[CompactControllerSection_Physics];
+
+        read_vector3_s16(section, k_velocity_units_per_cm_per_sec, out_state->velocity_cm_per_sec);
+        read_vector3_s16(section + 6, k_acceleration_units_per_cm_per_sec_sqr, out_state->acceleration_cm_per_sec_sqr);
+        read_vector3_s16(section + 12, k_angular_velocity_units_per_rad_per_sec, out_state->angular_velocity_rad_per_sec);
+        read_vector3_s16(section + 18, k_angular_acceleration_units_per_rad_per_sec_sqr, out_state->angular_acceleration_rad_per_sec_sqr);
+    }
+}
+
+// Wire layout:
+// [controller_id:8][flags:8][section_mask:8][sequence_num:32]([keyframe_offset:16] if not a keyframe)
+// followed by each section in the section mask, in section order
+int compact_controller_frame_write(
+    const CompactControllerFrame *frame,
+    const CompactControllerFrame *keyframe,
+    unsigned char *buffer,
+    const int buffer_size,
+    bool *out_wrote_keyframe)
+{
+    const int keyframe_offset = (keyframe != nullptr) ? frame->sequence_num - keyframe->sequence_num : -1;
+    const bool bIsKeyframe =
+        keyframe == nullptr ||
+        keyframe->controller_id != frame->controller_id ||
+        keyframe->section_mask != frame->section_mask ||
+        keyframe_offset < 0 || keyframe_offset > 0xFFFF;
+
+    unsigned int written_section_mask = frame->section_mask;
+    if (!bIsKeyframe)
+    {
+        for (int section_index = 0; section_index < CompactControllerSection_COUNT; ++section_index)
+        {
+            if (memcmp(frame->sections[section_index], keyframe->sections[section_index], k_section_sizes[section_index]) == 0)
+            {
+                written_section_mask &= ~COMPACT_CONTROLLER_SECTION_BIT(section_index);
+            }
+        }
+    }
+
+    int write_size = bIsKeyframe ? COMPACT_CONTROLLER_FRAME_HEADER_SIZE - 2 : COMPACT_CONTROLLER_FRAME_HEADER_SIZE;
+    for (int section_index = 0; section_index < CompactControllerSection_COUNT; ++section_index)
+    {
+        if ((written_section_mask & COMPACT_CONTROLLER_SECTION_BIT(section_index)) != 0)
+        {
+            write_size += k_section_sizes[section_index];
+        }
+    }
+
+    if (write_size > buffer_size || frame->controller_id < 0 || frame->controller_id > 0xFF)
+    {
+        return 0;
+    }
+
+    buffer[0] = static_cast<unsigned char>(frame->controller_id);
+    buffer[1] = bIsKeyframe ? k_header_keyframe : 0;
+    buffer[2] = static_cast<unsigned char>(written_section_mask);
+    write_u32(buffer + 3, static_cast<unsigned int>(frame->sequence_num));
+
+    int offset = 7;
+    if (!bIsKeyframe)
+    {
+        write_u16(buffer + offset, static_cast<unsigned int>(keyframe_offset));
+        offset += 2;
+    }
+
+    for (int section_index = 0; section_index < CompactControllerSection_COUNT; ++section_index)
+    {
+        if ((written_section_mask & COMPACT_CONTROLLER_SECTION_BIT(section_index)) != 0)
+        {
+            memcpy(buffer + offset, frame->sections[section_index], k_section_sizes[section_index]);
+            offset += k_section_sizes[section_index];
+        }
+    }
+    assert(offset == write_size);
+
+    if (out_wrote_keyframe != nullptr)
+    {
+        *out_wrote_keyframe = bIsKeyframe;
+    }
+
+    return write_size;
+}
+
+int compact_controller_frame_get_controller_id(const unsigned char *buffer, const int buffer_size)
+{
+    return (buffer_size >= COMPACT_CONTROLLER_FRAME_HEADER_SIZE - 2) ? buffer[0] : -1;
+}
+
+bool compact_controller_frame_read(
+    const unsigned char *buffer,
+    const int buffer_size,
+    const CompactControllerFrame *keyframe,
+    CompactControllerFrame *out_frame,
+    bool *out_is_keyframe)
+{
+    if (buffer_size < COMPACT_CONTROLLER_FRAME_HEADER_SIZE - 2)
+    {
+        return false;
+    }
+
+    const int controller_id = buffer[0];
+    const bool bIsKeyframe = (buffer[1] & k_header_keyframe) != 0;
+    const unsigned int section_mask = buffer[2];
+    const int sequence_num = static_cast<int>(read_u32(buffer + 3));
+    int offset = 7;
+
+    if (section_mask >= COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_COUNT))
+    {
+        return false;
+    }
+
+    if (bIsKeyframe)
+    {
+        memset(out_frame, 0, sizeof(CompactControllerFrame));
+        out_frame->section_mask = section_mask;
+    }
+    else
+    {
+        if (buffer_size < COMPACT_CONTROLLER_FRAME_HEADER_SIZE)
+        {
+            return false;
+        }
+
+        const int keyframe_offset = static_cast<int>(read_u16(buffer + offset));
+        offset += 2;
+
+        // A delta is useless without the keyframe it was written against
+        if (keyframe == nullptr ||
+            keyframe->controller_id != controller_id ||
+            keyframe->sequence_num != sequence_num - keyframe_offset ||
+            (section_mask & ~keyframe->section_mask) != 0)
+        {
+            return false;
+        }
+
+        assert(out_frame != keyframe);
+        memcpy(out_frame, keyframe, sizeof(CompactControllerFrame));
+    }
+
+    for (int section_index = 0; section_index < CompactControllerSection_COUNT; ++section_index)
+    {
+        if ((section_mask & COMPACT_CONTROLLER_SECTION_BIT(section_index)) != 0)
+        {
+            if (offset + k_section_sizes[section_index] > buffer_size)
+            {
+                return false;
+            }
+
+            memcpy(out_frame->sections[section_index], buffer + offset, k_section_sizes[section_index]);
+            offset += k_section_sizes[section_index];
+        }
+    }
+
+    out_frame->controller_id = controller_id;
+    out_frame->sequence_num = sequence_num;
+
+    if (out_is_keyframe != nullptr)
+    {
+        *out_is_keyframe = bIsKeyframe;
+    }
+
+    return offset == buffer_size;
+}
@@ -0,0 +1,105 @@
+#ifndef COMPACT_DATA_FRAME_H
+#define COMPACT_DATA_FRAME_H
+
+//-- constants -----
+/// Sections of a compact controller data frame, in the order they are written
+enum eCompactControllerSection
+{
+    CompactControllerSection_Status,            ///< Connection and tracking flags, buttons, trigger and battery
+    CompactControllerSection_Orientation,       ///< Smallest three quaternion, 15 bits per component
+    CompactControllerSection_Position,          ///< 24 bits per axis in 0.1mm units
+    CompactControllerSection_RawSensor,         ///< 16 bits per axis
+    CompactControllerSection_CalibratedSensor,  ///< 16 bits per axis, fixed point
+    CompactControllerSection_Physics,           ///< 16 bits per axis, fixed point
+
+    CompactControllerSection_COUNT
+};
+
+#define COMPACT_CONTROLLER_SECTION_BIT(section)     (1u << (section))
+#define MAX_COMPACT_CONTROLLER_SECTION_SIZE         24
+#define COMPACT_CONTROLLER_FRAME_HEADER_SIZE        9
+#define MAX_COMPACT_CONTROLLER_FRAME_SIZE           (COMPACT_CONTROLLER_FRAME_HEADER_SIZE + CompactControllerSection_COUNT*MAX_COMPACT_CONTROLLER_SECTION_SIZE)
+
+/// Set in the length header of a data frame datagram record that holds a raw compact controller frame
+/// rather than a packed DeviceOutputDataFrame, so the client can apply it straight from the receive buffer
+#define COMPACT_CONTROLLER_RECORD_FLAG              0x80000000u
+
+//-- definitions -----
+/// Controller state as it goes into and comes out of a compact data frame
+struct CompactControllerState
+{
+    int controller_id;
+    int sequence_num;
+
+    bool bIsConnected;
+    bool bHasValidHardwareCalibration;
+    bool bIsTrackingEnabled;
+    bool bIsCurrentlyTracking;
+    bool bIsOrientationValid;
+    bool bIsPositionValid;
+    unsigned int button_bitmask;
+    int trigger_value;
+    int battery_value;
+
+    float orientation_wxyz[4];
+    float position_cm[3];
+
+    int raw_magnetometer[3];
+    int raw_accelerometer[3];
+    int raw_gyroscope[3];
+
+    float calibrated_magnetometer[3];
+    float calibrated_accelerometer_g[3];
+    float calibrated_gyroscope_rad_per_sec[3];
+
+    float velocity_cm_per_sec[3];
+    float acceleration_cm_per_sec_sqr[3];
+    float angular_velocity_rad_per_sec[3];
+    float angular_acceleration_rad_per_sec_sqr[3];
+};
+
+/// Quantized controller state, kept section by section so that frames can be diffed with memcmp
+struct CompactControllerFrame
+{
+    int controller_id;
+    int sequence_num;
+    unsigned int section_mask; ///< COMPACT_CONTROLLER_SECTION_BIT of each section this frame carries
+    unsigned char sections[CompactControllerSection_COUNT][MAX_COMPACT_CONTROLLER_SECTION_SIZE];
+};
+
+//-- interface -----
+/// Quantizes the given sections of the state. The other sections are zeroed.
+void compact_controller_frame_quantize(
+    const CompactControllerState *state,
+    const unsigned int section_mask,
+    CompactControllerFrame *out_frame);
+
+/// Expands a frame back out. Sections the frame doesn't carry come out zeroed.
+void compact_controller_frame_dequantize(
+    const CompactControllerFrame *frame,
+    CompactControllerState *out_state);
+
+/// Writes the frame as a delta against the keyframe, i.e. only the sections that differ from it.
+/// Writes a keyframe with every section instead when there is no keyframe (nullptr) or the frame can't be
+/// expressed against it. Returns the number of bytes written, or 0 if the buffer is too small.
+int compact_controller_frame_write(
+    const CompactControllerFrame *frame,
+    const CompactControllerFrame *keyframe,
+    unsigned char *buffer,
+    const int buffer_size,
+    bool *out_wrote_keyframe);
+
+/// Returns the controller id of a written frame, or -1 if the buffer is too short to hold a frame.
+int compact_controller_frame_get_controller_id(const unsigned char *buffer, const int buffer_size);
+
+/// Reads a written frame. A delta is applied on top of the keyframe it was written against,
+/// which can't be out_frame itself. Returns false, leaving out_frame undefined, if the buffer is malformed
+/// or if the frame is a delta and the given keyframe (which may be nullptr) isn't the one it was written against.
+bool compact_controller_frame_read(
+    const unsigned char *buffer,
+    const int buffer_size,
+    const CompactControllerFrame *keyframe,
+    CompactControllerFrame *out_frame,
+    bool *out_is_keyframe);
+
+#endif // COMPACT_DATA_FRAME_H
@@ -7,6 +7,8 @@
 
 //-- constants -----
 #define MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE 500
+// Largest UDP datagram of batched output data frames, kept under a typical 1500 byte MTU
+#define MAX_OUTPUT_DATA_FRAME_BATCH_SIZE 1400
 #define MAX_INPUT_DATA_FRAME_MESSAGE_SIZE 64
 
 // See ControllerManager.h in PSMoveService
@@ -43,6 +45,9 @@ class IDataFrameListener
 {
 public:
     virtual void handle_data_frame(const PSMoveProtocol::DeviceOutputDataFrame *data_frame) = 0;
+
+    // Called with a raw compact controller frame (see CompactDataFrame.h) still in the receive buffer
+    virtual void handle_compact_controller_data_frame(const unsigned char *compact_frame, int compact_frame_size) = 0;
 };
 
 class IResponseListener
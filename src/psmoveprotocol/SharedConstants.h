@@ -5,6 +5,8 @@
 #define PSMOVESERVICE_DEFAULT_PORT      "9512"
 
 #define MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE 500
+// Largest UDP datagram of batched output data frames, kept under a typical 1500 byte MTU
+#define MAX_OUTPUT_DATA_FRAME_BATCH_SIZE 1400
 #define MAX_INPUT_DATA_FRAME_MESSAGE_SIZE 64
 
 // See ControllerManager.h in PSMoveService
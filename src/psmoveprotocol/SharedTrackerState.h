@@ -5,37 +5,127 @@
 #define BOOST_INTERPROCESS_SHARED_DIR_PATH "shared_mem"
 #endif // WIN32
 
-#include <boost/interprocess/sync/interprocess_mutex.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+
+// The slot sequence numbers are shared between processes, so they must not fall back to a lock
+#if ATOMIC_INT_LOCK_FREE != 2
+#error "SharedVideoFrameHeader requires lock free std::atomic<unsigned int>"
+#endif
+
+//-- constants -----
+// Tags the v2 (seqlock ring) layout so that readers can refuse a block written by an older service
+#define SHARED_VIDEO_FRAME_LAYOUT_MAGIC 0x32565350 // "PSV2"
+
+// The service writes frame N into slot N % SHARED_VIDEO_FRAME_SLOT_COUNT,
+// so the latest frame stays untouched for SHARED_VIDEO_FRAME_SLOT_COUNT-1 frame periods
+#define SHARED_VIDEO_FRAME_SLOT_COUNT 4
+
+//-- definitions -----
+struct SharedVideoFrameSlot
+{
+    // Seqlock sequence: the index of the frame held in the slot, or 0 while the service is writing into it
+    std::atomic<unsigned int> frame_index;
+};
 
 class SharedVideoFrameHeader
 {
 public:
     SharedVideoFrameHeader()
-        : mutex()
+        : magic(SHARED_VIDEO_FRAME_LAYOUT_MAGIC)
         , width(0)
         , height(0)
         , stride(0)
-        , frame_index(0)
+        , slot_count(SHARED_VIDEO_FRAME_SLOT_COUNT)
+        , latest_frame_index(0)
     {
+        for (int slot_index = 0; slot_index < SHARED_VIDEO_FRAME_SLOT_COUNT; ++slot_index)
+        {
+            slots[slot_index].frame_index = 0;
+        }
     }
-    
-    //Mutex to protect access to the shared memory
-    boost::interprocess::interprocess_mutex mutex;
 
+    unsigned int magic;
     int width;
     int height;
     int stride;
-    int frame_index;
-    // Buffer stored past the end of the header
+    int slot_count;
+
+    // Index of the last frame written, 0 until the first one
+    std::atomic<unsigned int> latest_frame_index;
+    SharedVideoFrameSlot slots[SHARED_VIDEO_FRAME_SLOT_COUNT];
+    // Slot buffers stored past the end of the header
+
+    bool isValidLayout(size_t region_size) const
+    {
+        return
+            region_size >= sizeof(SharedVideoFrameHeader) &&
+            magic == SHARED_VIDEO_FRAME_LAYOUT_MAGIC &&
+            slot_count == SHARED_VIDEO_FRAME_SLOT_COUNT &&
+            region_size >= computeTotalSize(stride, height);
+    }
+
+    const unsigned char *getSlotBuffer(unsigned int frame_index) const
+    {
+        return
+            reinterpret_cast<const unsigned char *>(this) + sizeof(SharedVideoFrameHeader) +
+            getSlotIndex(frame_index)*computeVideoBufferSize(stride, height);
+    }
+
+    unsigned char *getSlotBufferMutable(unsigned int frame_index)
+    {
+        return const_cast<unsigned char *>(getSlotBuffer(frame_index));
+    }
+
+    // Writer side: never waits on readers.
+    // Only one thread may write at a time.
+    void writeVideoFrame(const unsigned char *buffer)
+    {
+        unsigned int frame_index = latest_frame_index.load(std::memory_order_relaxed) + 1;
+        if (frame_index == 0)
+        {
+            // 0 marks a slot that is being written
+            frame_index = 1;
+        }
+
+        SharedVideoFrameSlot &slot = slots[getSlotIndex(frame_index)];
+
+        slot.frame_index.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(getSlotBufferMutable(frame_index), buffer, computeVideoBufferSize(stride, height));
+        slot.frame_index.store(frame_index, std::memory_order_release);
+
+        latest_frame_index.store(frame_index, std::memory_order_release);
+    }
 
-    const unsigned char *getBuffer() const
+    // Reader side: returns the latest frame in place, or nullptr if there is none yet.
+    // The frame may be overwritten while it is being read, so check isFrameStillValid() once done with it.
+    const unsigned char *acquireLatestFrame(unsigned int *out_frame_index) const
     {
-        return reinterpret_cast<const unsigned char *>(this) + sizeof(SharedVideoFrameHeader);
+        const unsigned int frame_index = latest_frame_index.load(std::memory_order_acquire);
+
+        if (frame_index == 0 ||
+            slots[getSlotIndex(frame_index)].frame_index.load(std::memory_order_acquire) != frame_index)
+        {
+            return nullptr;
+        }
+
+        *out_frame_index = frame_index;
+        return getSlotBuffer(frame_index);
+    }
+
+    // True if the frame returned by acquireLatestFrame() wasn't overwritten while it was being read
+    bool isFrameStillValid(unsigned int frame_index) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        return slots[getSlotIndex(frame_index)].frame_index.load(std::memory_order_relaxed) == frame_index;
     }
 
-    unsigned char *getBufferMutable()
+    static unsigned int getSlotIndex(unsigned int frame_index)
     {
-        return const_cast<unsigned char *>(getBuffer());
+        return frame_index % SHARED_VIDEO_FRAME_SLOT_COUNT;
     }
 
     static size_t computeVideoBufferSize(int stride, int height)
@@ -45,8 +135,8 @@ public:
 
     static size_t computeTotalSize(int stride, int height)
     {
-        return sizeof(SharedVideoFrameHeader) + computeVideoBufferSize(stride, height);
+        return sizeof(SharedVideoFrameHeader) + SHARED_VIDEO_FRAME_SLOT_COUNT*computeVideoBufferSize(stride, height);
     }
 };
 
-#endif // SHARED_TRACKER_STATE_H
\ No newline at end of file
+#endif // SHARED_TRACKER_STATE_H
@@ -43,6 +43,16 @@ ControllerDeviceEnumerator::ControllerDeviceEnumerator(
         enumerators[3] = new VirtualControllerEnumerator;
 		enumerator_count = 4;
 		break;
+	case eAPIType::CommunicationType_NON_HID:
+		// Same layout as CommunicationType_ALL, starting past the empty HID slot
+		enumerators = new DeviceEnumerator *[4];
+		enumerators[0] = nullptr;
+		enumerators[1] = new ControllerUSBDeviceEnumerator;
+		enumerators[2] = new ControllerGamepadEnumerator;
+        enumerators[3] = new VirtualControllerEnumerator;
+		enumerator_count = 4;
+		enumerator_index = 1;
+		break;
 	}
 
 	if (is_valid())
@@ -94,6 +104,16 @@ ControllerDeviceEnumerator::ControllerDeviceEnumerator(
         enumerators[3] = new VirtualControllerEnumerator;
 		enumerator_count = 4;
 		break;
+	case eAPIType::CommunicationType_NON_HID:
+		// Same layout as CommunicationType_ALL, starting past the empty HID slot
+		enumerators = new DeviceEnumerator *[4];
+		enumerators[0] = nullptr;
+		enumerators[1] = new ControllerUSBDeviceEnumerator(deviceTypeFilter);
+		enumerators[2] = new ControllerGamepadEnumerator(deviceTypeFilter);
+        enumerators[3] = new VirtualControllerEnumerator;
+		enumerator_count = 4;
+		enumerator_index = 1;
+		break;
 	}
 
 	if (is_valid())
@@ -164,6 +184,7 @@ ControllerDeviceEnumerator::eAPIType ControllerDeviceEnumerator::get_api_type()
 		result = (enumerator_index < enumerator_count) ? ControllerDeviceEnumerator::CommunicationType_VIRTUAL : ControllerDeviceEnumerator::CommunicationType_INVALID;
 		break;
 	case eAPIType::CommunicationType_ALL:
+	case eAPIType::CommunicationType_NON_HID:
 		if (enumerator_index < enumerator_count)
 		{
 			switch (enumerator_index)
@@ -214,6 +235,7 @@ const ControllerHidDeviceEnumerator *ControllerDeviceEnumerator::get_hid_control
 		enumerator = nullptr;
 		break;
 	case eAPIType::CommunicationType_ALL:
+	case eAPIType::CommunicationType_NON_HID:
 		if (enumerator_index < enumerator_count)
 		{
 			enumerator = (enumerator_index == 0) ? static_cast<ControllerHidDeviceEnumerator *>(enumerators[0]) : nullptr;
@@ -247,6 +269,7 @@ const ControllerUSBDeviceEnumerator *ControllerDeviceEnumerator::get_usb_control
 		enumerator = nullptr;
 		break;
 	case eAPIType::CommunicationType_ALL:
+	case eAPIType::CommunicationType_NON_HID:
 		if (enumerator_index < enumerator_count)
 		{
 			enumerator = (enumerator_index == 1) ? static_cast<ControllerUSBDeviceEnumerator *>(enumerators[1]) : nullptr;
@@ -280,6 +303,7 @@ const ControllerGamepadEnumerator *ControllerDeviceEnumerator::get_gamepad_contr
 		enumerator = nullptr;
 		break;
 	case eAPIType::CommunicationType_ALL:
+	case eAPIType::CommunicationType_NON_HID:
 		if (enumerator_index < enumerator_count)
 		{
 			enumerator = (enumerator_index == 2) ? static_cast<ControllerGamepadEnumerator *>(enumerators[2]) : nullptr;
@@ -313,6 +337,7 @@ const VirtualControllerEnumerator *ControllerDeviceEnumerator::get_virtual_contr
 		enumerator = (enumerator_index < enumerator_count) ? static_cast<VirtualControllerEnumerator *>(enumerators[0]) : nullptr;
 		break;
 	case eAPIType::CommunicationType_ALL:
+	case eAPIType::CommunicationType_NON_HID:
 		if (enumerator_index < enumerator_count)
 		{
 			enumerator = (enumerator_index == 3) ? static_cast<VirtualControllerEnumerator *>(enumerators[3]) : nullptr;
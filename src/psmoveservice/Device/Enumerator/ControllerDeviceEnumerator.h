@@ -14,7 +14,8 @@ public:
 		CommunicationType_USB,
 		CommunicationType_GAMEPAD,
         CommunicationType_VIRTUAL,
-		CommunicationType_ALL
+		CommunicationType_ALL,
+		CommunicationType_NON_HID // USB, gamepad and virtual controllers
 	};
 
     ControllerDeviceEnumerator(eAPIType api_type);
@@ -1,5 +1,6 @@
 // -- includes -----
 #include "ControllerHidDeviceEnumerator.h"
+#include "HidApiMutex.h"
 #include "ServerUtility.h"
 #include "USBDeviceInfo.h"
 #include "assert.h"
@@ -39,7 +40,10 @@ ControllerHidDeviceEnumerator::ControllerHidDeviceEnumerator()
 	assert(m_deviceType >= 0 && GET_DEVICE_TYPE_INDEX(m_deviceType) < MAX_CONTROLLER_TYPE_INDEX);
 
 	HIDApiDeviceFilter &dev_info = g_supported_hid_controller_infos[GET_DEVICE_TYPE_INDEX(m_deviceType)];
-	devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+	{
+		std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
+		devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+	}
 	cur_dev = devs;
 
 	if (!is_valid())
@@ -59,7 +63,10 @@ ControllerHidDeviceEnumerator::ControllerHidDeviceEnumerator(
 	assert(m_deviceType >= 0 && GET_DEVICE_TYPE_INDEX(m_deviceType) < MAX_CONTROLLER_TYPE_INDEX);
 
 	HIDApiDeviceFilter &dev_info = g_supported_hid_controller_infos[GET_DEVICE_TYPE_INDEX(m_deviceType)];
-	devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+	{
+		std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
+		devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+	}
 	cur_dev = devs;
 
 	if (!is_valid())
@@ -72,6 +79,7 @@ ControllerHidDeviceEnumerator::~ControllerHidDeviceEnumerator()
 {
 	if (devs != nullptr)
 	{
+		std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
 		hid_free_enumeration(devs);
 	}
 }
@@ -143,6 +151,7 @@ bool ControllerHidDeviceEnumerator::next()
 			// Free any previous enumeration
 			if (devs != nullptr)
 			{
+				std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
 				hid_free_enumeration(devs);
 				cur_dev = nullptr;
 				devs = nullptr;
@@ -156,7 +165,10 @@ bool ControllerHidDeviceEnumerator::next()
 				if (dev_info.bHIDApiSupported)
 				{
 					// Create a new HID enumeration
-					devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+					{
+						std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
+						devs = hid_enumerate(dev_info.filter.vendor_id, dev_info.filter.product_id);
+					}
 					cur_dev = devs;
 					foundValid = is_valid();
 				}
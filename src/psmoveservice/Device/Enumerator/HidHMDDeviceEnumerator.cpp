@@ -1,5 +1,6 @@
 // -- includes -----
 #include "HidHMDDeviceEnumerator.h"
+#include "HidApiMutex.h"
 #include "ServerUtility.h"
 #include "USBDeviceInfo.h" // for MAX_USB_DEVICE_PORT_PATH, t_usb_device_handle
 #include "assert.h"
@@ -102,6 +103,7 @@ std::string HidHMDDeviceEnumerator::get_interface_path(int interface_number) con
 void HidHMDDeviceEnumerator::build_interface_list()
 {
 	USBDeviceFilter &dev_info = g_supported_hmd_infos[GET_DEVICE_TYPE_INDEX(m_deviceType)];
+	std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
 	hid_device_info * devs = hid_enumerate(dev_info.vendor_id, dev_info.product_id);
 
 	current_device_identifier = "";
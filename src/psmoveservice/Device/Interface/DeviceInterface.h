@@ -292,7 +292,8 @@ struct CommonControllerState : CommonDeviceState
     enum BatteryLevel Battery;
     unsigned int AllButtons;                    // all-buttons, used to detect changes
 
-    //TODO: high-precision timestamp. Need to do in hidapi?
+    double DeviceTimestampSeconds;              // When the device sampled this state, in host clock seconds
+    bool bIsDeviceTimestampValid;               // false if the device doesn't timestamp its reports
     
     inline CommonControllerState()
     {
@@ -305,6 +306,8 @@ struct CommonControllerState : CommonDeviceState
         DeviceType= SUPPORTED_CONTROLLER_TYPE_COUNT; // invalid
         Battery= Batt_MAX;
         AllButtons= 0;
+        DeviceTimestampSeconds= 0.0;
+        bIsDeviceTimestampValid= false;
     }
 };
 
@@ -529,6 +532,12 @@ public:
     // Returns a pointer to the last video frame buffer captured
     virtual const unsigned char *getVideoFrameBuffer() const = 0;
 
+    // Takes the newest captured video frame for reading, or returns nullptr if there isn't a new one.
+    // The buffer isn't written to by the camera until the next call, so it can be used without copying.
+    // The size is the size the frame was captured at, which can differ from getVideoFrameDimensions()
+    // for a frame captured just before the camera was reconfigured.
+    virtual const unsigned char *acquireVideoFrameBuffer(int *out_width, int *out_height, int *out_stride) = 0;
+
     static const char *getDriverTypeString(eDriverType device_type)
     {
         const char *result = nullptr;
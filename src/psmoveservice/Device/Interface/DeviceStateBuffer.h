@@ -0,0 +1,118 @@
+#ifndef DEVICE_STATE_BUFFER_H
+#define DEVICE_STATE_BUFFER_H
+
+// -- includes -----
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+// -- constants -----
+#define DEVICE_STATE_BUFFER_CACHE_LINE_SIZE 64
+
+// -- definitions -----
+/// Fixed capacity history of the most recent device states.
+/// Pushing into a full buffer overwrites the oldest state, so there are no allocations after construction.
+/// One thread may push while another reads, seqlock style: a push first claims its slot by bumping the claim count
+/// and fencing, then overwrites the slot and publishes it with a release store of the write count.
+/// copyState() checks the claim count after copying to detect a state that was overwritten while it was being copied.
+/// getState()/back() hand out pointers into the buffer and are only safe on the thread that pushes.
+template <typename t_state, size_t k_capacity>
+class DeviceStateBuffer
+{
+public:
+    static_assert(k_capacity > 0 && (k_capacity & (k_capacity - 1)) == 0, "capacity must be a power of two");
+
+    DeviceStateBuffer()
+        : m_claim_count(0)
+        , m_write_count(0)
+    {
+    }
+
+    DeviceStateBuffer(const DeviceStateBuffer &) = delete;
+    DeviceStateBuffer &operator=(const DeviceStateBuffer &) = delete;
+
+    inline size_t capacity() const { return k_capacity; }
+
+    /// Number of states that can be looked back at
+    inline size_t size() const
+    {
+        const size_t write_count = m_write_count.load(std::memory_order_acquire);
+
+        return (write_count < k_capacity) ? write_count : k_capacity;
+    }
+
+    inline bool empty() const { return m_write_count.load(std::memory_order_acquire) == 0; }
+
+    /// Producer only: forget all states
+    inline void clear()
+    {
+        m_write_count.store(0, std::memory_order_release);
+        m_claim_count.store(0, std::memory_order_relaxed);
+    }
+
+    /// Producer only: append a state, overwriting the oldest one when full
+    void push_back(const t_state &state)
+    {
+        const size_t write_count = m_write_count.load(std::memory_order_relaxed);
+
+        // Claim the slot before touching it, so a reader that sees any of the new bytes also sees the claim
+        m_claim_count.store(write_count + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_slots[write_count & k_index_mask] = state;
+        m_write_count.store(write_count + 1, std::memory_order_release);
+    }
+
+    /// Producer only: the state lookBack pushes ago (0 = newest), or nullptr if it's no longer in the buffer
+    const t_state *getState(int lookBack) const
+    {
+        const size_t write_count = m_write_count.load(std::memory_order_acquire);
+        const size_t available = (write_count < k_capacity) ? write_count : k_capacity;
+
+        return (lookBack >= 0 && static_cast<size_t>(lookBack) < available)
+            ? &m_slots[(write_count - lookBack - 1) & k_index_mask]
+            : nullptr;
+    }
+
+    /// Producer only: the newest state. The buffer must not be empty.
+    inline const t_state &back() const
+    {
+        assert(!empty());
+        return *getState(0);
+    }
+
+    /// Safe from any single consumer thread: copy out the state lookBack pushes ago.
+    /// The oldest slot is the next one to be overwritten, so this reaches back at most capacity-1 states.
+    /// Returns false if there is no such state or the producer overwrote it mid copy.
+    bool copyState(int lookBack, t_state &out_state) const
+    {
+        const size_t write_count = m_write_count.load(std::memory_order_acquire);
+        const size_t available = (write_count < k_capacity) ? write_count : k_capacity - 1;
+
+        if (lookBack < 0 || static_cast<size_t>(lookBack) >= available)
+        {
+            return false;
+        }
+
+        const size_t read_index = write_count - lookBack - 1;
+        out_state = m_slots[read_index & k_index_mask];
+
+        // Pairs with the fence in push_back(): if the copy saw any of an overwrite, the claim for it is visible here.
+        // The slot gets overwritten by the push that claims count read_index + capacity + 1.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_claim_count.load(std::memory_order_relaxed) - read_index <= k_capacity;
+    }
+
+private:
+    static const size_t k_index_mask = k_capacity - 1;
+
+    // Pad the producer's counters onto their own cache line, away from the neighboring members and the states.
+    // Padding rather than alignas, since devices get heap allocated and pre C++17 new ignores over-alignment.
+    char m_pad_before[DEVICE_STATE_BUFFER_CACHE_LINE_SIZE];
+    std::atomic<size_t> m_claim_count;
+    std::atomic<size_t> m_write_count;
+    char m_pad_after[DEVICE_STATE_BUFFER_CACHE_LINE_SIZE - 2*sizeof(std::atomic<size_t>)];
+    t_state m_slots[k_capacity];
+};
+
+#endif // DEVICE_STATE_BUFFER_H
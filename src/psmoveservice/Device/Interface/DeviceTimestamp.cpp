@@ -0,0 +1,120 @@
+// -- includes -----
+#include "DeviceTimestamp.h"
+
+#include <algorithm>
+#include <chrono>
+
+// -- constants -----
+// A report that reaches us later than this after it was sampled gets its timestamp pulled forward
+static const double k_max_report_latency_seconds = 0.05;
+
+// How long to count ticks against the host clock before trusting the measured tick period
+static const double k_min_rate_window_seconds = 2.0;
+
+// How often the timestamps get pulled forward to the tightest receive time seen
+static const double k_offset_window_seconds = 2.0;
+
+// How far the measured tick period may stray from the nominal one before it's considered bogus
+static const double k_max_tick_period_error = 0.5;
+
+// -- public methods -----
+DeviceTimestampReconstructor::DeviceTimestampReconstructor(
+    int counter_bit_count,
+    double nominal_tick_seconds)
+    : m_counter_mask(counter_bit_count >= 32 ? 0xFFFFFFFFu : ((1u << counter_bit_count) - 1))
+    , m_nominal_tick_seconds(nominal_tick_seconds)
+{
+    reset();
+}
+
+void DeviceTimestampReconstructor::reset()
+{
+    m_tick_seconds = m_nominal_tick_seconds;
+    m_bIsValid = false;
+    m_last_raw_counter = 0;
+    m_last_host_receive_seconds = 0.0;
+    m_last_timestamp_seconds = 0.0;
+    m_rate_window_ticks = 0;
+    m_rate_window_start_host_seconds = 0.0;
+    m_offset_window_min_slack_seconds = 0.0;
+    m_offset_window_start_host_seconds = 0.0;
+}
+
+double DeviceTimestampReconstructor::update(
+    unsigned int raw_counter,
+    double host_receive_seconds)
+{
+    const double host_elapsed_seconds = host_receive_seconds - m_last_host_receive_seconds;
+    const double wrap_seconds = (static_cast<double>(m_counter_mask) + 1.0) * m_tick_seconds;
+
+    // If too much time passed since the last report we can't tell how many times the counter wrapped
+    if (!m_bIsValid || host_elapsed_seconds < 0.0 || host_elapsed_seconds >= 0.5 * wrap_seconds)
+    {
+        anchor(raw_counter, host_receive_seconds);
+        return m_last_timestamp_seconds;
+    }
+
+    const unsigned int delta_ticks = (raw_counter - m_last_raw_counter) & m_counter_mask;
+
+    // Measure the tick period against the host clock over a long enough window to average out receive jitter
+    m_rate_window_ticks += delta_ticks;
+    const double rate_window_seconds = host_receive_seconds - m_rate_window_start_host_seconds;
+    if (rate_window_seconds >= k_min_rate_window_seconds && m_rate_window_ticks > 0)
+    {
+        const double measured_tick_seconds = rate_window_seconds / static_cast<double>(m_rate_window_ticks);
+
+        if (measured_tick_seconds >= m_nominal_tick_seconds * (1.0 - k_max_tick_period_error) &&
+            measured_tick_seconds <= m_nominal_tick_seconds * (1.0 + k_max_tick_period_error))
+        {
+            m_tick_seconds = measured_tick_seconds;
+        }
+    }
+
+    double timestamp_seconds = m_last_timestamp_seconds + static_cast<double>(delta_ticks) * m_tick_seconds;
+
+    // Keep the device clock from drifting away from the host clock:
+    // a report can't be sampled after it was received, or long before it.
+    timestamp_seconds = std::min(timestamp_seconds, host_receive_seconds);
+    timestamp_seconds = std::max(timestamp_seconds, host_receive_seconds - k_max_report_latency_seconds);
+    timestamp_seconds = std::max(timestamp_seconds, m_last_timestamp_seconds);
+
+    // The clamps above only catch a device clock that runs ahead. If it fell behind (i.e. before the tick
+    // period was measured) shift it forward by the smallest receive latency seen over the last window.
+    const double slack_seconds = host_receive_seconds - timestamp_seconds;
+    m_offset_window_min_slack_seconds = std::min(m_offset_window_min_slack_seconds, slack_seconds);
+    if (host_receive_seconds - m_offset_window_start_host_seconds >= k_offset_window_seconds)
+    {
+        timestamp_seconds += m_offset_window_min_slack_seconds;
+        m_offset_window_min_slack_seconds = k_max_report_latency_seconds;
+        m_offset_window_start_host_seconds = host_receive_seconds;
+    }
+
+    m_last_raw_counter = raw_counter;
+    m_last_host_receive_seconds = host_receive_seconds;
+    m_last_timestamp_seconds = timestamp_seconds;
+
+    return timestamp_seconds;
+}
+
+double DeviceTimestampReconstructor::getHostSeconds()
+{
+    const std::chrono::duration<double> host_time = std::chrono::steady_clock::now().time_since_epoch();
+
+    return host_time.count();
+}
+
+// -- private methods -----
+void DeviceTimestampReconstructor::anchor(
+    unsigned int raw_counter,
+    double host_receive_seconds)
+{
+    m_last_raw_counter = raw_counter & m_counter_mask;
+    m_last_host_receive_seconds = host_receive_seconds;
+    m_last_timestamp_seconds =
+        m_bIsValid ? std::max(host_receive_seconds, m_last_timestamp_seconds) : host_receive_seconds;
+    m_rate_window_ticks = 0;
+    m_rate_window_start_host_seconds = host_receive_seconds;
+    m_offset_window_min_slack_seconds = k_max_report_latency_seconds;
+    m_offset_window_start_host_seconds = host_receive_seconds;
+    m_bIsValid = true;
+}
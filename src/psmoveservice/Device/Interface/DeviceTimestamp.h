@@ -0,0 +1,51 @@
+#ifndef DEVICE_TIMESTAMP_H
+#define DEVICE_TIMESTAMP_H
+
+// -- definitions -----
+/// Rebuilds a monotonic timestamp from the wrapping sample counter that a device stamps its reports with.
+/// The counter is unwrapped into a running tick count, the tick period is re-estimated against the host
+/// clock to remove drift, the offset is periodically re-pinned to the fastest receive, and the result is expressed in host clock seconds so it can be compared
+/// against the time a report was received.
+class DeviceTimestampReconstructor
+{
+public:
+    DeviceTimestampReconstructor(int counter_bit_count, double nominal_tick_seconds);
+
+    /// Forget the counter history (i.e. when the device reconnects)
+    void reset();
+
+    /// Feed the raw counter of a report along with the host time (in seconds) it was received at.
+    /// Returns the reconstructed time the report was sampled at, in host clock seconds.
+    /// The returned timestamps never go backwards and never run ahead of the host receive times.
+    double update(unsigned int raw_counter, double host_receive_seconds);
+
+    /// The host clock timestamps are measured against, in seconds.
+    /// This is the monotonic steady clock, so only differences between its readings are meaningful.
+    static double getHostSeconds();
+
+    inline bool getIsValid() const { return m_bIsValid; }
+    inline double getTickSeconds() const { return m_tick_seconds; }
+    inline double getLastTimestampSeconds() const { return m_last_timestamp_seconds; }
+
+private:
+    void anchor(unsigned int raw_counter, double host_receive_seconds);
+
+    unsigned int m_counter_mask;
+    double m_nominal_tick_seconds;
+    double m_tick_seconds;
+
+    bool m_bIsValid;
+    unsigned int m_last_raw_counter;
+    double m_last_host_receive_seconds;
+    double m_last_timestamp_seconds;
+
+    // Tick rate estimation window
+    long long m_rate_window_ticks;
+    double m_rate_window_start_host_seconds;
+
+    // Offset correction window
+    double m_offset_window_min_slack_seconds;
+    double m_offset_window_start_host_seconds;
+};
+
+#endif // DEVICE_TIMESTAMP_H
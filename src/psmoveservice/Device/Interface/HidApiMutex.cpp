@@ -0,0 +1,10 @@
+// -- includes -----
+#include "HidApiMutex.h"
+
+// -- public methods -----
+std::mutex &getHidApiMutex()
+{
+    static std::mutex s_hidapi_mutex;
+
+    return s_hidapi_mutex;
+}
@@ -0,0 +1,14 @@
+#ifndef HID_API_MUTEX_H
+#define HID_API_MUTEX_H
+
+// -- includes -----
+#include <mutex>
+
+// -- definitions -----
+/// hidapi keeps process wide state (the device enumeration, the platform's device list) that isn't
+/// safe to use from two threads at once. Enumerating, opening and closing hid devices all take this lock,
+/// since the device open worker does them while the main loop can close a device.
+/// Reads and writes on an already open handle don't need it.
+std::mutex &getHidApiMutex();
+
+#endif // HID_API_MUTEX_H
@@ -0,0 +1,146 @@
+// -- includes -----
+#include "HidInputReportReader.h"
+#include "DeviceTimestamp.h"
+#include "ServerLog.h"
+#include "ServerUtility.h"
+#include "ServerWakeupSignal.h"
+
+#include "hidapi.h"
+
+#include <cstring>
+
+// -- constants -----
+// How long a read blocks before the thread checks if it's been asked to exit
+static const int k_read_timeout_ms = 100;
+
+// -- public methods -----
+HidInputReportReader::HidInputReportReader()
+    : m_device_handle(nullptr)
+    , m_report_size(0)
+    , m_thread_name()
+    , m_read_thread()
+    , m_bExitRequested(false)
+    , m_bReadFailed(false)
+    , m_dropped_report_count(0)
+    , m_report_queue()
+{
+}
+
+HidInputReportReader::~HidInputReportReader()
+{
+    stop();
+}
+
+bool HidInputReportReader::start(
+    hid_device *device_handle,
+    int report_size,
+    const char *thread_name)
+{
+    if (getIsRunning())
+    {
+        SERVER_LOG_WARNING("HidInputReportReader::start") << m_thread_name << " already running. Ignoring request.";
+        return true;
+    }
+
+    if (device_handle == nullptr || report_size <= 0 || report_size > HID_INPUT_REPORT_MAX_SIZE)
+    {
+        SERVER_LOG_ERROR("HidInputReportReader::start") << "Invalid device handle or report size(" << report_size << ")";
+        return false;
+    }
+
+    m_device_handle = device_handle;
+    m_report_size = report_size;
+    m_thread_name = thread_name;
+    m_bExitRequested = false;
+    m_bReadFailed = false;
+    m_dropped_report_count = 0;
+    m_read_thread = std::thread(&HidInputReportReader::readThreadFunc, this);
+
+    SERVER_LOG_INFO("HidInputReportReader::start") << "Started " << m_thread_name;
+
+    return true;
+}
+
+void HidInputReportReader::stop()
+{
+    if (getIsRunning())
+    {
+        m_bExitRequested = true;
+        m_read_thread.join();
+
+        // Drop whatever the main thread didn't get around to reading
+        m_report_queue.consume_all([](const HidInputReport &) {});
+
+        SERVER_LOG_INFO("HidInputReportReader::stop") << "Stopped " << m_thread_name
+            << " (" << m_dropped_report_count.load() << " reports dropped on a full queue)";
+
+        m_device_handle = nullptr;
+    }
+}
+
+int HidInputReportReader::popReport(
+    unsigned char *out_buffer,
+    int buffer_size,
+    double &out_host_receive_seconds)
+{
+    // Read the failure flag first so that reports queued before the failure still get read
+    const bool bReadFailed = m_bReadFailed.load();
+    HidInputReport report;
+    int result = 0;
+
+    if (m_report_queue.pop(report))
+    {
+        result = (report.length < buffer_size) ? report.length : buffer_size;
+        memcpy(out_buffer, report.data, result);
+        out_host_receive_seconds = report.host_receive_seconds;
+    }
+    else if (bReadFailed)
+    {
+        result = -1;
+    }
+
+    return result;
+}
+
+// -- private methods -----
+void HidInputReportReader::readThreadFunc()
+{
+    ServerUtility::set_current_thread_name(m_thread_name.c_str());
+
+    while (!m_bExitRequested)
+    {
+        HidInputReport report;
+        const int res = hid_read_timeout(m_device_handle, report.data, m_report_size, k_read_timeout_ms);
+
+        if (res > 0)
+        {
+            report.length = res;
+            report.host_receive_seconds = DeviceTimestampReconstructor::getHostSeconds();
+
+            if (m_report_queue.push(report))
+            {
+                ServerWakeupSignal::get_instance()->notify();
+            }
+            else
+            {
+                // The main thread fell behind. Newer reports matter more, but the SPSC producer
+                // can't pop the oldest one, so this one gets dropped instead.
+                ++m_dropped_report_count;
+            }
+        }
+        else if (res < 0)
+        {
+            char hidapi_err_mbs[256];
+
+            if (ServerUtility::convert_wcs_to_mbs(hid_error(m_device_handle), hidapi_err_mbs, sizeof(hidapi_err_mbs)))
+            {
+                SERVER_LOG_ERROR("HidInputReportReader::readThreadFunc") << m_thread_name << " HID ERROR: " << hidapi_err_mbs;
+            }
+
+            // Let the main thread see the failure through popReport() and close the device
+            m_bReadFailed = true;
+            ServerWakeupSignal::get_instance()->notify();
+            break;
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef HID_INPUT_REPORT_READER_H
+#define HID_INPUT_REPORT_READER_H
+
+// -- includes -----
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
+// -- constants -----
+#define HID_INPUT_REPORT_MAX_SIZE 128
+#define HID_INPUT_REPORT_QUEUE_SIZE 64
+
+// -- pre-declarations -----
+typedef struct hid_device_ hid_device;
+
+// -- definitions -----
+struct HidInputReport
+{
+    unsigned char data[HID_INPUT_REPORT_MAX_SIZE];
+    int length;
+    double host_receive_seconds;
+};
+
+/// Reads input reports from an open HID device on its own thread.
+/// The thread blocks in hid_read_timeout(), stamps each report with the host time it arrived,
+/// hands it to the main thread through a lock-free SPSC queue and wakes up the main loop.
+/// Reports are left raw so the device can parse them with its config on the main thread.
+class HidInputReportReader
+{
+public:
+    HidInputReportReader();
+    ~HidInputReportReader();
+
+    /// Start reading reports of the given size from an already open device.
+    /// The device must stay open until stop() is called.
+    bool start(hid_device *device_handle, int report_size, const char *thread_name);
+
+    /// Stop the read thread and drop any unread reports
+    void stop();
+
+    inline bool getIsRunning() const { return m_device_handle != nullptr; }
+
+    /// Main thread only: pop the oldest unread report into the given buffer.
+    /// Same convention as hid_read(): returns the number of bytes read, 0 if no report is waiting,
+    /// or -1 if the read thread hit an error and every report before the error has been read.
+    int popReport(unsigned char *out_buffer, int buffer_size, double &out_host_receive_seconds);
+
+private:
+    void readThreadFunc();
+
+    hid_device *m_device_handle;
+    int m_report_size;
+    std::string m_thread_name;
+    std::thread m_read_thread;
+    std::atomic_bool m_bExitRequested;
+    std::atomic_bool m_bReadFailed;
+    std::atomic_int m_dropped_report_count;
+    boost::lockfree::spsc_queue<HidInputReport, boost::lockfree::capacity<HID_INPUT_REPORT_QUEUE_SIZE> > m_report_queue;
+};
+
+#endif // HID_INPUT_REPORT_READER_H
@@ -0,0 +1,181 @@
+// -- includes -----
+#include "HidOutputReportWriter.h"
+#include "ServerLog.h"
+#include "ServerUtility.h"
+
+#include "hidapi.h"
+
+#include <cstring>
+
+// -- public methods -----
+HidOutputReportWriter::HidOutputReportWriter()
+    : m_device_handle(nullptr)
+    , m_write_func(nullptr)
+    , m_thread_name()
+    , m_min_write_interval(0)
+    , m_repeat_interval(0)
+    , m_write_thread()
+    , m_pending_report_length(0)
+    , m_bPendingReportRepeats(false)
+    , m_bHasPendingReport(false)
+    , m_bExitRequested(false)
+    , m_coalesced_report_count(0)
+{
+}
+
+HidOutputReportWriter::~HidOutputReportWriter()
+{
+    stop();
+}
+
+bool HidOutputReportWriter::start(
+    hid_device *device_handle,
+    hid_write_func write_func,
+    const char *thread_name,
+    int min_write_interval_ms,
+    int repeat_interval_ms)
+{
+    if (getIsRunning())
+    {
+        SERVER_LOG_WARNING("HidOutputReportWriter::start") << m_thread_name << " already running. Ignoring request.";
+        return true;
+    }
+
+    if (device_handle == nullptr || write_func == nullptr)
+    {
+        SERVER_LOG_ERROR("HidOutputReportWriter::start") << "Invalid device handle or write function";
+        return false;
+    }
+
+    m_device_handle = device_handle;
+    m_write_func = write_func;
+    m_thread_name = thread_name;
+    m_min_write_interval = std::chrono::milliseconds(min_write_interval_ms);
+    m_repeat_interval = std::chrono::milliseconds(repeat_interval_ms);
+    m_bHasPendingReport = false;
+    m_bExitRequested = false;
+    m_coalesced_report_count = 0;
+    m_write_thread = std::thread(&HidOutputReportWriter::writeThreadFunc, this);
+
+    SERVER_LOG_INFO("HidOutputReportWriter::start") << "Started " << m_thread_name;
+
+    return true;
+}
+
+void HidOutputReportWriter::stop()
+{
+    if (getIsRunning())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_report_mutex);
+            m_bExitRequested = true;
+        }
+        m_report_cv.notify_one();
+        m_write_thread.join();
+
+        SERVER_LOG_INFO("HidOutputReportWriter::stop") << "Stopped " << m_thread_name
+            << " (" << m_coalesced_report_count << " reports coalesced)";
+
+        m_device_handle = nullptr;
+    }
+}
+
+bool HidOutputReportWriter::postReport(
+    const unsigned char *data,
+    int length,
+    bool bRepeat)
+{
+    if (!getIsRunning() || length <= 0 || length > HID_OUTPUT_REPORT_MAX_SIZE)
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_report_mutex);
+
+        if (m_bHasPendingReport)
+        {
+            ++m_coalesced_report_count;
+        }
+
+        memcpy(m_pending_report, data, length);
+        m_pending_report_length = length;
+        m_bPendingReportRepeats = bRepeat;
+        m_bHasPendingReport = true;
+    }
+    m_report_cv.notify_one();
+
+    return true;
+}
+
+// -- private methods -----
+void HidOutputReportWriter::writeThreadFunc()
+{
+    ServerUtility::set_current_thread_name(m_thread_name.c_str());
+
+    // The last report handed to the device, kept around for repeating
+    unsigned char report[HID_OUTPUT_REPORT_MAX_SIZE];
+    int report_length = 0;
+    bool bReportRepeats = false;
+    bool bLastWriteFailed = false;
+    std::chrono::time_point<std::chrono::steady_clock> last_write_time;
+
+    std::unique_lock<std::mutex> lock(m_report_mutex);
+    for (;;)
+    {
+        auto has_work = [this]() { return m_bHasPendingReport || m_bExitRequested; };
+
+        // Sleep until there is a new report, or it's time to repeat the last one
+        if (bReportRepeats)
+        {
+            m_report_cv.wait_until(lock, last_write_time + m_repeat_interval, has_work);
+        }
+        else
+        {
+            m_report_cv.wait(lock, has_work);
+        }
+
+        if (m_bHasPendingReport)
+        {
+            // Don't write faster than the device accepts.
+            // Anything posted while waiting replaces the pending report.
+            if (report_length > 0 && !m_bExitRequested)
+            {
+                m_report_cv.wait_until(
+                    lock, last_write_time + m_min_write_interval, [this]() { return m_bExitRequested; });
+            }
+
+            memcpy(report, m_pending_report, m_pending_report_length);
+            report_length = m_pending_report_length;
+            bReportRepeats = m_bPendingReportRepeats;
+            m_bHasPendingReport = false;
+        }
+        else if (m_bExitRequested)
+        {
+            break;
+        }
+        else if (!bReportRepeats || std::chrono::steady_clock::now() < last_write_time + m_repeat_interval)
+        {
+            // Spurious wakeup
+            continue;
+        }
+
+        // Write outside the lock so postReport() never waits on the device
+        lock.unlock();
+        const int res = m_write_func(m_device_handle, report, report_length);
+        last_write_time = std::chrono::steady_clock::now();
+
+        // Only log the first of a run of failures, repeated reports would flood the log
+        if (res < 0 && !bLastWriteFailed)
+        {
+            char hidapi_err_mbs[256];
+
+            if (ServerUtility::convert_wcs_to_mbs(hid_error(m_device_handle), hidapi_err_mbs, sizeof(hidapi_err_mbs)))
+            {
+                SERVER_LOG_ERROR("HidOutputReportWriter::writeThreadFunc") << m_thread_name << " HID ERROR: " << hidapi_err_mbs;
+            }
+        }
+        bLastWriteFailed = res < 0;
+        lock.lock();
+    }
+}
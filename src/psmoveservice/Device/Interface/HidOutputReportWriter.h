@@ -0,0 +1,67 @@
+#ifndef HID_OUTPUT_REPORT_WRITER_H
+#define HID_OUTPUT_REPORT_WRITER_H
+
+// -- includes -----
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// -- constants -----
+#define HID_OUTPUT_REPORT_MAX_SIZE 128
+
+// -- pre-declarations -----
+typedef struct hid_device_ hid_device;
+
+// -- definitions -----
+/// Writes output reports (LED color, rumble, ...) to an open HID device on its own thread,
+/// so a slow bluetooth write never stalls the main loop.
+/// Only the newest posted report is kept: a report posted before the previous one was written replaces it.
+/// Writes are spaced at least min_write_interval_ms apart, and a report posted with bRepeat set
+/// is re-sent every repeat_interval_ms until a newer report replaces it.
+class HidOutputReportWriter
+{
+public:
+    /// Same signature as hid_write(), so devices that need a different write call can supply one
+    typedef int (*hid_write_func)(hid_device *device, const unsigned char *data, size_t length);
+
+    HidOutputReportWriter();
+    ~HidOutputReportWriter();
+
+    /// Start writing to an already open device. The device must stay open until stop() is called.
+    bool start(
+        hid_device *device_handle, hid_write_func write_func, const char *thread_name,
+        int min_write_interval_ms, int repeat_interval_ms);
+
+    /// Write out the last posted report if it hasn't been yet, then stop the write thread
+    void stop();
+
+    inline bool getIsRunning() const { return m_device_handle != nullptr; }
+
+    /// Main thread only: queue up a report to write, replacing any report that hasn't been written yet.
+    /// Never waits on a write in progress.
+    bool postReport(const unsigned char *data, int length, bool bRepeat);
+
+private:
+    void writeThreadFunc();
+
+    hid_device *m_device_handle;
+    hid_write_func m_write_func;
+    std::string m_thread_name;
+    std::chrono::milliseconds m_min_write_interval;
+    std::chrono::milliseconds m_repeat_interval;
+    std::thread m_write_thread;
+
+    // Guards everything below. Only ever held to copy a report in or out, never across a write.
+    std::mutex m_report_mutex;
+    std::condition_variable m_report_cv;
+    unsigned char m_pending_report[HID_OUTPUT_REPORT_MAX_SIZE];
+    int m_pending_report_length;
+    bool m_bPendingReportRepeats;
+    bool m_bHasPendingReport;
+    bool m_bExitRequested;
+    int m_coalesced_report_count;
+};
+
+#endif // HID_OUTPUT_REPORT_WRITER_H
@@ -179,7 +179,18 @@ ControllerManager::poll_devices()
 DeviceEnumerator *
 ControllerManager::allocate_device_enumerator()
 {
-	return new ControllerDeviceEnumerator(ControllerDeviceEnumerator::CommunicationType_ALL);
+	// HID controllers are left to the background open worker when it's running
+	return new ControllerDeviceEnumerator(
+		getIsBackgroundOpenRunning()
+		? ControllerDeviceEnumerator::CommunicationType_NON_HID
+		: ControllerDeviceEnumerator::CommunicationType_ALL);
+}
+
+DeviceEnumerator *
+ControllerManager::allocate_background_device_enumerator()
+{
+	// The gamepad api and the USB device manager belong to the main loop, only hidapi can be used from the worker
+	return new ControllerDeviceEnumerator(ControllerDeviceEnumerator::CommunicationType_HID);
 }
 
 void
@@ -71,6 +71,7 @@ protected:
 
 	// Controller enumerator methods
     class DeviceEnumerator *allocate_device_enumerator() override;
+    class DeviceEnumerator *allocate_background_device_enumerator() override;
     void free_device_enumerator(class DeviceEnumerator *) override;
     ServerDeviceView *allocate_device_view(int device_id) override;
 	int getListUpdatedResponseType() override;
@@ -7,6 +7,8 @@
 #include "OrientationFilter.h"
 #ifdef WIN32
 #include "PlatformDeviceAPIWin32.h"
+#elif defined(__linux__)
+#include "PlatformDeviceAPILinux.h"
 #endif // WIN32
 #include "ServerControllerView.h"
 #include "ServerHMDView.h"
@@ -29,6 +31,7 @@ static const int k_default_tracker_reconnect_interval= 10000; // ms
 static const int k_default_tracker_poll_interval= 13; // 1000/75 ms
 static const int k_default_hmd_reconnect_interval= 10000; // ms
 static const int k_default_hmd_poll_interval= 2; // ms
+static const bool k_default_background_device_open_enabled= true;
 
 class DeviceManagerConfig : public PSMoveConfig
 {
@@ -45,6 +48,7 @@ public:
         , hmd_poll_interval(k_default_hmd_poll_interval)
 		, gamepad_api_enabled(true)
 		, platform_api_enabled(true)
+        , background_device_open_enabled(k_default_background_device_open_enabled)
     {};
 
     const boost::property_tree::ptree
@@ -61,6 +65,7 @@ public:
         pt.put("hmd_poll_interval", hmd_poll_interval); 
 		pt.put("gamepad_api_enabled", gamepad_api_enabled);
 		pt.put("platform_api_enabled", platform_api_enabled);
+        pt.put("background_device_open_enabled", background_device_open_enabled);
 
         return pt;
     }
@@ -80,6 +85,7 @@ public:
             hmd_poll_interval = pt.get<int>("hmd_poll_interval", k_default_hmd_poll_interval);
 		    gamepad_api_enabled = pt.get<bool>("gamepad_api_enabled", gamepad_api_enabled);
 		    platform_api_enabled = pt.get<bool>("platform_api_enabled", platform_api_enabled);
+            background_device_open_enabled = pt.get<bool>("background_device_open_enabled", k_default_background_device_open_enabled);
         }
         else
         {
@@ -98,6 +104,8 @@ public:
     int hmd_poll_interval;    
 	bool gamepad_api_enabled;
 	bool platform_api_enabled;
+    // Enumerate and open HID controllers on a worker thread instead of the main loop
+    bool background_device_open_enabled;
 };
 
 // DeviceManager - This is the interface used by PSMoveService
@@ -144,6 +152,9 @@ DeviceManager::startup()
 #ifdef WIN32
 		m_platform_api_type = _eDevicePlatformApiType_Win32;
 		m_platform_api = new PlatformDeviceAPIWin32;
+#elif defined(__linux__)
+		m_platform_api_type = _eDevicePlatformApiType_Linux;
+		m_platform_api = new PlatformDeviceAPILinux;
 #endif
 		SERVER_LOG_INFO("DeviceManager::startup") << "Platform Hotplug API is ENABLED";
 	}
@@ -152,9 +163,14 @@ DeviceManager::startup()
 		SERVER_LOG_INFO("DeviceManager::startup") << "Platform Hotplug API is DISABLED";
 	}
 
-	if (m_platform_api != nullptr)
+	if (m_platform_api != nullptr && !m_platform_api->startup(this))
 	{
-		success &= m_platform_api->startup(this);
+		// Not fatal, the device managers just go back to polling for device changes
+		SERVER_LOG_WARNING("DeviceManager::startup") << "Failed to start the Platform Hotplug API. Falling back to periodic device reconnects.";
+		m_platform_api->shutdown();
+		delete m_platform_api;
+		m_platform_api = nullptr;
+		m_platform_api_type = _eDevicePlatformApiType_None;
 	}
 
 	// Register for hotplug events if this platform supports them
@@ -176,6 +192,7 @@ DeviceManager::startup()
     m_controller_manager->reconnect_interval = controller_reconnect_interval;
     m_controller_manager->poll_interval = m_config->controller_poll_interval;
 	m_controller_manager->gamepad_api_enabled= m_config->gamepad_api_enabled;
+    m_controller_manager->background_open_enabled= m_config->background_device_open_enabled;
     success &= m_controller_manager->startup();
     
     m_tracker_manager->reconnect_interval = tracker_reconnect_interval;
@@ -184,6 +201,9 @@ DeviceManager::startup()
 
     m_hmd_manager->reconnect_interval = hmd_reconnect_interval;
     m_hmd_manager->poll_interval = m_config->hmd_poll_interval;
+    // HMDs always open on the main loop. The Morpheus sets up its command interface with libusb
+    // control transfers, which have to stay on the thread that owns its libusb context.
+    m_hmd_manager->background_open_enabled= false;
     success &= m_hmd_manager->startup();    
     
     m_instance= this;
@@ -211,6 +231,18 @@ DeviceManager::update()
     m_hmd_manager->publish(); // publish hmd state to any listening clients (common case)
 }
 
+int
+DeviceManager::getMillisecondsUntilNextUpdate(int max_wait_ms) const
+{
+    int wait_ms = max_wait_ms;
+
+    wait_ms = m_controller_manager->getMillisecondsUntilNextPoll(wait_ms);
+    wait_ms = m_tracker_manager->getMillisecondsUntilNextPoll(wait_ms);
+    wait_ms = m_hmd_manager->getMillisecondsUntilNextPoll(wait_ms);
+
+    return wait_ms;
+}
+
 void
 DeviceManager::shutdown()
 {
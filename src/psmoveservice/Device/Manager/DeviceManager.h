@@ -15,6 +15,9 @@ enum eDevicePlatformApiType
 #ifdef WIN32
 	_eDevicePlatformApiType_Win32,
 #endif // WIN32
+#ifdef __linux__
+	_eDevicePlatformApiType_Linux,
+#endif // __linux__
 };
 
 //-- typedefs -----
@@ -49,6 +52,9 @@ public:
     void update();  /**< Poll all connected devices for each specific manager. */
     void shutdown();/**< Shutdown the interfaces for each specific manager. */
 
+    /// How long (ms) the main loop can wait before update() has polling or reconnecting to do, capped at max_wait_ms
+    int getMillisecondsUntilNextUpdate(int max_wait_ms) const;
+
     static inline DeviceManager *getInstance()
     { return m_instance; }
 
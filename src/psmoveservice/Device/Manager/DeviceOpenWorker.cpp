@@ -0,0 +1,238 @@
+// -- includes -----
+#include "DeviceOpenWorker.h"
+#include "DeviceEnumerator.h"
+#include "DeviceInterface.h"
+#include "ServerLog.h"
+#include "ServerUtility.h"
+#include "ServerWakeupSignal.h"
+
+// -- public methods -----
+DeviceOpenWorker::DeviceOpenWorker()
+    : m_client(nullptr)
+    , m_thread_name()
+    , m_worker_thread()
+    , m_bEnumerationInFlight(false)
+    , m_bEnumerationQueued(false)
+    , m_bExitRequested(false)
+    , m_bEnumerationRequested(false)
+    , m_pending_match(nullptr)
+    , m_bPendingMatchAnswered(false)
+    , m_bPendingMatchIsOpen(false)
+    , m_opened_devices()
+    , m_bEnumerationFinished(false)
+{
+}
+
+DeviceOpenWorker::~DeviceOpenWorker()
+{
+    stop();
+}
+
+bool DeviceOpenWorker::start(
+    IDeviceOpenWorkerClient *client,
+    const char *thread_name)
+{
+    if (getIsRunning())
+    {
+        SERVER_LOG_WARNING("DeviceOpenWorker::start") << m_thread_name << " already running. Ignoring request.";
+        return true;
+    }
+
+    if (client == nullptr)
+    {
+        SERVER_LOG_ERROR("DeviceOpenWorker::start") << "Invalid client";
+        return false;
+    }
+
+    m_client = client;
+    m_thread_name = thread_name;
+    m_bEnumerationInFlight = false;
+    m_bEnumerationQueued = false;
+    m_bExitRequested = false;
+    m_bEnumerationRequested = false;
+    m_pending_match = nullptr;
+    m_bEnumerationFinished = false;
+    m_worker_thread = std::thread(&DeviceOpenWorker::workerThreadFunc, this);
+
+    SERVER_LOG_INFO("DeviceOpenWorker::start") << "Started " << m_thread_name;
+
+    return true;
+}
+
+void DeviceOpenWorker::stop()
+{
+    if (getIsRunning())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bExitRequested = true;
+        }
+        m_worker_cv.notify_one();
+        m_worker_thread.join();
+
+        // Nobody is going to take these now
+        for (IDeviceInterface *device : m_opened_devices)
+        {
+            device->close();
+            delete device;
+        }
+        m_opened_devices.clear();
+
+        SERVER_LOG_INFO("DeviceOpenWorker::stop") << "Stopped " << m_thread_name;
+
+        m_client = nullptr;
+    }
+}
+
+void DeviceOpenWorker::requestEnumeration()
+{
+    if (!getIsRunning())
+    {
+        return;
+    }
+
+    if (m_bEnumerationInFlight)
+    {
+        m_bEnumerationQueued = true;
+    }
+    else
+    {
+        m_bEnumerationInFlight = true;
+        m_bEnumerationQueued = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bEnumerationRequested = true;
+        }
+        m_worker_cv.notify_one();
+    }
+}
+
+void DeviceOpenWorker::poll(bool bCanHandOverDevices)
+{
+    if (!getIsRunning())
+    {
+        return;
+    }
+
+    std::vector<IDeviceInterface *> opened_devices;
+    bool bEnumerationFinished = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // The worker is blocked until this is answered, so the enumerator can't change under us
+        if (m_pending_match != nullptr && !m_bPendingMatchAnswered)
+        {
+            m_bPendingMatchIsOpen = m_client->handle_background_device_enumerated(m_pending_match);
+            m_bPendingMatchAnswered = true;
+            m_worker_cv.notify_one();
+        }
+
+        if (bCanHandOverDevices)
+        {
+            // Every device opened during the pass is posted before the pass is flagged finished
+            opened_devices.swap(m_opened_devices);
+            bEnumerationFinished = m_bEnumerationFinished;
+            m_bEnumerationFinished = false;
+        }
+    }
+
+    for (IDeviceInterface *device : opened_devices)
+    {
+        m_client->handle_background_device_opened(device);
+    }
+
+    if (bEnumerationFinished)
+    {
+        m_bEnumerationInFlight = false;
+        m_client->handle_background_enumeration_finished();
+
+        if (m_bEnumerationQueued)
+        {
+            requestEnumeration();
+        }
+    }
+}
+
+// -- private methods -----
+void DeviceOpenWorker::workerThreadFunc()
+{
+    ServerUtility::set_current_thread_name(m_thread_name.c_str());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_worker_cv.wait(lock, [this]() { return m_bEnumerationRequested || m_bExitRequested; });
+
+        if (m_bExitRequested)
+        {
+            break;
+        }
+
+        m_bEnumerationRequested = false;
+
+        // Enumeration and device opens can block for a while, so they run without the lock held
+        lock.unlock();
+        DeviceEnumerator *enumerator = m_client->allocate_background_device_enumerator();
+        lock.lock();
+
+        while (enumerator != nullptr && enumerator->is_valid() && !m_bExitRequested)
+        {
+            // Have the main thread check the device against the open devices
+            m_pending_match = enumerator;
+            m_bPendingMatchAnswered = false;
+            ServerWakeupSignal::get_instance()->notify();
+
+            m_worker_cv.wait(lock, [this]() { return m_bPendingMatchAnswered || m_bExitRequested; });
+            m_pending_match = nullptr;
+
+            if (m_bExitRequested)
+            {
+                break;
+            }
+
+            const bool bIsNewDevice = !m_bPendingMatchIsOpen;
+
+            lock.unlock();
+            IDeviceInterface *device = bIsNewDevice ? openDevice(enumerator) : nullptr;
+            enumerator->next();
+            lock.lock();
+
+            if (device != nullptr)
+            {
+                m_opened_devices.push_back(device);
+                ServerWakeupSignal::get_instance()->notify();
+            }
+        }
+
+        if (enumerator != nullptr)
+        {
+            lock.unlock();
+            m_client->free_device_enumerator(enumerator);
+            lock.lock();
+        }
+
+        if (!m_bExitRequested)
+        {
+            m_bEnumerationFinished = true;
+            ServerWakeupSignal::get_instance()->notify();
+        }
+    }
+}
+
+IDeviceInterface *DeviceOpenWorker::openDevice(const DeviceEnumerator *enumerator)
+{
+    IDeviceInterface *device = m_client->allocate_background_device_interface(enumerator);
+
+    if (device != nullptr && !device->open(enumerator))
+    {
+        SERVER_LOG_ERROR("DeviceOpenWorker::openDevice") <<
+            "Device (" << enumerator->get_path() << ") failed to open!";
+
+        delete device;
+        device = nullptr;
+    }
+
+    return device;
+}
@@ -0,0 +1,86 @@
+#ifndef DEVICE_OPEN_WORKER_H
+#define DEVICE_OPEN_WORKER_H
+
+// -- includes -----
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -- pre-declarations -----
+class DeviceEnumerator;
+class IDeviceInterface;
+
+// -- definitions -----
+/// Hooks the DeviceOpenWorker uses to find and create devices, and to hand them back to the main thread.
+class IDeviceOpenWorkerClient
+{
+public:
+    virtual ~IDeviceOpenWorkerClient() {}
+
+    // Called on the worker thread. These must not touch anything the main loop owns.
+    virtual DeviceEnumerator *allocate_background_device_enumerator() = 0;
+    virtual void free_device_enumerator(DeviceEnumerator *enumerator) = 0;
+    virtual IDeviceInterface *allocate_background_device_interface(const DeviceEnumerator *enumerator) = 0;
+
+    // Called on the main thread from DeviceOpenWorker::poll().
+    // Returns true if the enumerated device is already open, in which case the worker skips it.
+    virtual bool handle_background_device_enumerated(const DeviceEnumerator *enumerator) = 0;
+    // Takes ownership of a device the worker opened
+    virtual void handle_background_device_opened(IDeviceInterface *opened_device) = 0;
+    // Every device in the enumeration pass has been checked and, if new, opened and handed over
+    virtual void handle_background_enumeration_finished() = 0;
+};
+
+/// Enumerates devices and opens the new ones on its own thread, so a slow device open
+/// (feature report reads, config saves, ...) never stalls the main loop.
+/// Checking if an enumerated device is already open is bounced back to the main thread,
+/// since the main loop can close an open device at any time.
+class DeviceOpenWorker
+{
+public:
+    DeviceOpenWorker();
+    ~DeviceOpenWorker();
+
+    bool start(IDeviceOpenWorkerClient *client, const char *thread_name);
+
+    /// Waits for any open in progress to finish, then closes and frees
+    /// the opened devices that haven't been handed over yet
+    void stop();
+
+    inline bool getIsRunning() const { return m_client != nullptr; }
+
+    /// Main thread only: start an enumeration pass.
+    /// If a pass is already running another one is started as soon as it finishes.
+    void requestEnumeration();
+
+    /// Main thread only: answers the worker's pending already-open check and,
+    /// if bCanHandOverDevices is set, hands the devices it opened over to the client.
+    void poll(bool bCanHandOverDevices);
+
+private:
+    void workerThreadFunc();
+    IDeviceInterface *openDevice(const DeviceEnumerator *enumerator);
+
+    IDeviceOpenWorkerClient *m_client;
+    std::string m_thread_name;
+    std::thread m_worker_thread;
+
+    // Main thread only
+    bool m_bEnumerationInFlight;
+    bool m_bEnumerationQueued;
+
+    // Guards everything below
+    std::mutex m_mutex;
+    std::condition_variable m_worker_cv;
+    bool m_bExitRequested;
+    bool m_bEnumerationRequested;
+    const DeviceEnumerator *m_pending_match;
+    bool m_bPendingMatchAnswered;
+    bool m_bPendingMatchIsOpen;
+    std::vector<IDeviceInterface *> m_opened_devices;
+    bool m_bEnumerationFinished;
+};
+
+#endif // DEVICE_OPEN_WORKER_H
@@ -8,14 +8,22 @@
 #include "ServerUtility.h"
 #include "ServerRequestHandler.h"
 
+#include <algorithm>
+#include <cmath>
+
 //-- methods -----
 /// Constructor and set intervals (ms) for reconnect and polling
 DeviceTypeManager::DeviceTypeManager(const int recon_int, const int poll_int)
     : reconnect_interval(recon_int)
     , poll_interval(poll_int)
+    , background_open_enabled(false)
     , m_deviceViews(nullptr)
 	, m_bIsDeviceListDirty(false)
+    , m_open_worker()
+    , m_bBackgroundDeviceListChanged(false)
 {
+    memset(m_exists_in_background_enumerator, 0, sizeof(m_exists_in_background_enumerator));
+    memset(m_opened_in_background, 0, sizeof(m_opened_in_background));
 }
 
 DeviceTypeManager::~DeviceTypeManager()
@@ -30,6 +38,7 @@ DeviceTypeManager::startup()
     assert(m_deviceViews == nullptr);
 
     const int maxDeviceCount = getMaxDevices();
+    assert(maxDeviceCount <= DEVICE_TYPE_MANAGER_MAX_DEVICES);
     m_deviceViews = new ServerDeviceViewPtr[maxDeviceCount];
 
     // Allocate all of the device views
@@ -43,6 +52,11 @@ DeviceTypeManager::startup()
 	// Rebuild the device list the first chance we get
 	m_bIsDeviceListDirty = true;
 
+    if (background_open_enabled)
+    {
+        m_open_worker.start(this, "Device Open Worker");
+    }
+
     return true;
 }
 
@@ -50,6 +64,9 @@ DeviceTypeManager::startup()
 void
 DeviceTypeManager::shutdown()
 {
+    // Finish any open in progress before the views go away
+    m_open_worker.stop();
+
 	if (m_deviceViews != nullptr)
 	{
 		// Close any controllers that were opened
@@ -97,6 +114,9 @@ DeviceTypeManager::poll()
 		}
 	}
 
+    // Answer the background open worker and take over any devices it opened
+    m_open_worker.poll(can_update_connected_devices());
+
 	if (m_bIsDeviceListDirty)
     {
         if (update_connected_devices())
@@ -107,6 +127,40 @@ DeviceTypeManager::poll()
     }
 }
 
+int
+DeviceTypeManager::getMillisecondsUntilNextPoll(int max_wait_ms) const
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
+    double wait_ms = static_cast<double>(max_wait_ms);
+
+    // Open devices get polled every poll_interval.
+    // A device list that failed to update gets retried on the next poll.
+    bool bNeedsPolling = m_bIsDeviceListDirty;
+    if (m_deviceViews != nullptr)
+    {
+        for (int device_id = 0; !bNeedsPolling && device_id < getMaxDevices(); ++device_id)
+        {
+            bNeedsPolling = m_deviceViews[device_id]->getIsOpen();
+        }
+    }
+
+    if (bNeedsPolling)
+    {
+        std::chrono::duration<double, std::milli> update_diff = now - m_last_poll_time;
+
+        wait_ms = std::min(wait_ms, poll_interval - update_diff.count());
+    }
+
+	if (reconnect_interval > 0)
+	{
+		std::chrono::duration<double, std::milli> reconnect_diff = now - m_last_reconnect_time;
+
+        wait_ms = std::min(wait_ms, reconnect_interval - reconnect_diff.count());
+	}
+
+    return (wait_ms > 0.0) ? static_cast<int>(std::ceil(wait_ms)) : 0;
+}
+
 bool
 DeviceTypeManager::update_connected_devices()
 {
@@ -116,12 +170,16 @@ DeviceTypeManager::update_connected_devices()
     if (can_update_connected_devices())
     {
         const int maxDeviceCount = getMaxDevices();
-        bool exists_in_enumerator[64];
+        bool exists_in_enumerator[DEVICE_TYPE_MANAGER_MAX_DEVICES];
         bool bSendControllerUpdatedNotification = false;
 
+        // The background devices get enumerated and opened on the worker thread.
+        // It hands them over through handle_background_device_opened().
+        m_open_worker.requestEnumeration();
+
         // Initialize temp table used to keep track of open devices
         // still found in the enumerator
-        assert(maxDeviceCount <= 64);
+        assert(maxDeviceCount <= DEVICE_TYPE_MANAGER_MAX_DEVICES);
         memset(exists_in_enumerator, 0, sizeof(exists_in_enumerator));
 
         // Step 1
@@ -162,6 +220,7 @@ DeviceTypeManager::update_connected_devices()
 
                             // Mark the device as having showed up in the enumerator
                             exists_in_enumerator[device_id_] = true;
+                            m_opened_in_background[device_id_] = false;
 
                             // Send notificiation to clients that a new device was added
                             bSendControllerUpdatedNotification = true;
@@ -187,14 +246,15 @@ DeviceTypeManager::update_connected_devices()
         }
 
         // Step 2
-        // Close any device that is open and wasn't found in the enumerator
+        // Close any device that is open and wasn't found in the enumerator.
+        // Devices opened in the background are left to handle_background_enumeration_finished().
         for (int device_id = 0; device_id < maxDeviceCount; ++device_id)
         {
             ServerDeviceViewPtr existingDevice = getDeviceViewPtr(device_id);
 
             // This probably shouldn't happen very often (at all?) as polling should catch
             // disconnected devices first.
-            if (existingDevice->getIsOpen() && !exists_in_enumerator[device_id])
+            if (existingDevice->getIsOpen() && !exists_in_enumerator[device_id] && !m_opened_in_background[device_id])
             {
                 const char *device_type_name =
                     CommonDeviceState::getDeviceTypeString(existingDevice->getDevice()->getDeviceType());
@@ -218,6 +278,99 @@ DeviceTypeManager::update_connected_devices()
     return success;
 }
 
+DeviceEnumerator *
+DeviceTypeManager::allocate_background_device_enumerator()
+{
+    return nullptr;
+}
+
+IDeviceInterface *
+DeviceTypeManager::allocate_background_device_interface(const DeviceEnumerator *enumerator)
+{
+    // Views never change after startup, and the device factory doesn't touch the view
+    return getDeviceViewPtr(0)->allocate_device_interface(enumerator);
+}
+
+bool
+DeviceTypeManager::handle_background_device_enumerated(const DeviceEnumerator *enumerator)
+{
+    int device_id = find_open_device_device_id(enumerator);
+
+    if (device_id != -1)
+    {
+        // Mark the device as having showed up in the enumerator
+        m_exists_in_background_enumerator[device_id] = true;
+    }
+
+    return device_id != -1;
+}
+
+void
+DeviceTypeManager::handle_background_device_opened(IDeviceInterface *opened_device)
+{
+    int device_id = find_first_closed_device_device_id();
+
+    if (device_id != -1)
+    {
+        ServerDeviceViewPtr availableDeviceView = getDeviceViewPtr(device_id);
+        const char *device_type_name = CommonDeviceState::getDeviceTypeString(opened_device->getDeviceType());
+
+        if (availableDeviceView->adopt(opened_device))
+        {
+            SERVER_LOG_INFO("DeviceTypeManager::handle_background_device_opened") <<
+                "Device device_id " << device_id << " (" << device_type_name << ") opened";
+
+            m_exists_in_background_enumerator[device_id] = true;
+            m_opened_in_background[device_id] = true;
+            m_bBackgroundDeviceListChanged = true;
+        }
+        else
+        {
+            SERVER_LOG_ERROR("DeviceTypeManager::handle_background_device_opened") <<
+                "Device device_id " << device_id << " (" << device_type_name << ") failed to open!";
+        }
+    }
+    else
+    {
+        SERVER_LOG_ERROR("DeviceTypeManager::handle_background_device_opened") <<
+            "Can't connect any more new devices. Too many open device.";
+
+        opened_device->close();
+        delete opened_device;
+    }
+}
+
+void
+DeviceTypeManager::handle_background_enumeration_finished()
+{
+    // Close any background device that is open and wasn't found in the enumerator
+    for (int device_id = 0; device_id < getMaxDevices(); ++device_id)
+    {
+        ServerDeviceViewPtr existingDevice = getDeviceViewPtr(device_id);
+
+        if (existingDevice->getIsOpen() && m_opened_in_background[device_id] && 
+            !m_exists_in_background_enumerator[device_id])
+        {
+            const char *device_type_name =
+                CommonDeviceState::getDeviceTypeString(existingDevice->getDevice()->getDeviceType());
+
+            SERVER_LOG_WARNING("DeviceTypeManager::handle_background_enumeration_finished") << "Closing device "
+                << device_id << " (" << device_type_name << ") since it's no longer in the device list.";
+            existingDevice->close();
+            m_bBackgroundDeviceListChanged = true;
+        }
+    }
+
+    // List of open devices changed, tell the clients
+    if (m_bBackgroundDeviceListChanged)
+    {
+        send_device_list_changed_notification();
+        m_bBackgroundDeviceListChanged = false;
+    }
+
+    memset(m_exists_in_background_enumerator, 0, sizeof(m_exists_in_background_enumerator));
+}
+
 void
 DeviceTypeManager::publish()
 {
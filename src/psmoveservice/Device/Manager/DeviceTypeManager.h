@@ -2,6 +2,7 @@
 #define DEVICE_TYPE_MANAGER_H
 
 //-- includes -----
+#include "DeviceOpenWorker.h"
 #include "DevicePlatformInterface.h"
 #include "PSMoveProtocolInterface.h"
 
@@ -12,9 +13,12 @@
 class ServerDeviceView;
 typedef std::shared_ptr<ServerDeviceView> ServerDeviceViewPtr;
 
+//-- constants -----
+#define DEVICE_TYPE_MANAGER_MAX_DEVICES 64
+
 //-- definitions -----
 /// ABC for device managers for controllers, trackers, hmds.
-class DeviceTypeManager : public IDeviceHotplugListener
+class DeviceTypeManager : public IDeviceHotplugListener, public IDeviceOpenWorkerClient
 {
 public:
     DeviceTypeManager(const int recon_int = 1000, const int poll_int = 2);
@@ -26,6 +30,10 @@ public:
     void poll();
     virtual void publish();
 
+    /// How long (ms) until poll() next has work to do on its own, capped at max_wait_ms.
+    /// Work signaled from other threads (device open worker, hid reader, ...) wakes the main loop separately.
+    int getMillisecondsUntilNextPoll(int max_wait_ms) const;
+
     virtual int getMaxDevices() const = 0;
 
     /**
@@ -44,6 +52,9 @@ public:
     int reconnect_interval;
     int poll_interval;
 
+    // Enumerate and open the devices from allocate_background_device_enumerator() on a worker thread
+    bool background_open_enabled;
+
 protected:
     virtual void poll_devices();
 
@@ -60,6 +71,18 @@ protected:
     virtual void free_device_enumerator(class DeviceEnumerator *) = 0;
     virtual ServerDeviceView *allocate_device_view(int device_id) = 0;
 
+    // Devices that are safe to enumerate and open off the main thread (nullptr if none).
+    // allocate_device_enumerator() should leave these out while the background open worker is running.
+    class DeviceEnumerator *allocate_background_device_enumerator() override;
+    inline bool getIsBackgroundOpenRunning() const
+    { return m_open_worker.getIsRunning(); }
+
+    // IDeviceOpenWorkerClient
+    IDeviceInterface *allocate_background_device_interface(const class DeviceEnumerator *enumerator) override;
+    bool handle_background_device_enumerated(const class DeviceEnumerator *enumerator) override;
+    void handle_background_device_opened(IDeviceInterface *opened_device) override;
+    void handle_background_enumeration_finished() override;
+
     void send_device_list_changed_notification();
 
     virtual int getListUpdatedResponseType() = 0;
@@ -73,6 +96,11 @@ protected:
     ServerDeviceViewPtr *m_deviceViews;
 
 	bool m_bIsDeviceListDirty;
+
+    DeviceOpenWorker m_open_worker;
+    bool m_bBackgroundDeviceListChanged;
+    bool m_exists_in_background_enumerator[DEVICE_TYPE_MANAGER_MAX_DEVICES];
+    bool m_opened_in_background[DEVICE_TYPE_MANAGER_MAX_DEVICES];
 };
 
 #endif // DEVICE_TYPE_MANAGER
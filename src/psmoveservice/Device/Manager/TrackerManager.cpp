@@ -25,7 +25,16 @@ TrackerManagerConfig::TrackerManagerConfig(const std::string &fnamebase)
 	ignore_pose_from_one_tracker = false;
     optical_tracking_timeout= 100;
 	tracker_sleep_ms = 1;
+	use_wakeup_signal = true;
+	wakeup_max_wait_ms = 100;
+	log_wakeup_latency = false;
 	use_bgr_to_hsv_lookup_table = true;
+	use_tracker_worker_threads = true;
+	use_fused_hsv_threshold = true;
+	use_integer_hsv_converter = true;
+	use_color_classification_table = false;
+	use_blob_extractor = true;
+	video_stream_frame_interval = 1;
 	exclude_opposed_cameras = false;
 	min_valid_projection_area= 16;
 	disable_roi = false;
@@ -54,6 +63,15 @@ TrackerManagerConfig::config2ptree()
     pt.put("optical_tracking_timeout", optical_tracking_timeout);
 	pt.put("use_bgr_to_hsv_lookup_table", use_bgr_to_hsv_lookup_table);
 	pt.put("tracker_sleep_ms", tracker_sleep_ms);
+	pt.put("use_wakeup_signal", use_wakeup_signal);
+	pt.put("wakeup_max_wait_ms", wakeup_max_wait_ms);
+	pt.put("log_wakeup_latency", log_wakeup_latency);
+	pt.put("use_tracker_worker_threads", use_tracker_worker_threads);
+	pt.put("use_fused_hsv_threshold", use_fused_hsv_threshold);
+	pt.put("use_integer_hsv_converter", use_integer_hsv_converter);
+	pt.put("use_color_classification_table", use_color_classification_table);
+	pt.put("use_blob_extractor", use_blob_extractor);
+	pt.put("video_stream_frame_interval", video_stream_frame_interval);
 
 	pt.put("excluded_opposed_cameras", exclude_opposed_cameras);	
 
@@ -86,6 +104,15 @@ TrackerManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
         optical_tracking_timeout= pt.get<int>("optical_tracking_timeout", optical_tracking_timeout);
 		use_bgr_to_hsv_lookup_table = pt.get<bool>("use_bgr_to_hsv_lookup_table", use_bgr_to_hsv_lookup_table);
 		tracker_sleep_ms = pt.get<int>("tracker_sleep_ms", tracker_sleep_ms);
+		use_wakeup_signal = pt.get<bool>("use_wakeup_signal", use_wakeup_signal);
+		wakeup_max_wait_ms = pt.get<int>("wakeup_max_wait_ms", wakeup_max_wait_ms);
+		log_wakeup_latency = pt.get<bool>("log_wakeup_latency", log_wakeup_latency);
+		use_tracker_worker_threads = pt.get<bool>("use_tracker_worker_threads", use_tracker_worker_threads);
+		use_fused_hsv_threshold = pt.get<bool>("use_fused_hsv_threshold", use_fused_hsv_threshold);
+		use_integer_hsv_converter = pt.get<bool>("use_integer_hsv_converter", use_integer_hsv_converter);
+		use_color_classification_table = pt.get<bool>("use_color_classification_table", use_color_classification_table);
+		use_blob_extractor = pt.get<bool>("use_blob_extractor", use_blob_extractor);
+		video_stream_frame_interval = pt.get<int>("video_stream_frame_interval", video_stream_frame_interval);
 		exclude_opposed_cameras = pt.get<bool>("excluded_opposed_cameras", exclude_opposed_cameras);
 		min_valid_projection_area = pt.get<float>("min_valid_projection_area", min_valid_projection_area);	
 		disable_roi = pt.get<bool>("disable_roi", disable_roi);
@@ -196,6 +223,27 @@ TrackerManager::closeAllTrackers()
     send_device_list_changed_notification();
 }
 
+void
+TrackerManager::poll_devices()
+{
+    if (can_poll_connected_devices())
+    {
+        // Kick off every tracker's worker thread first so that the video frames
+        // are processed in parallel. Each ServerTrackerView::poll() then waits on its worker.
+        for (int tracker_id = 0; tracker_id < k_max_devices; ++tracker_id)
+        {
+            ServerTrackerViewPtr tracker_view = getTrackerViewPtr(tracker_id);
+
+            if (tracker_view->getIsOpen())
+            {
+                tracker_view->startVideoFrameProcessing();
+            }
+        }
+    }
+
+    DeviceTypeManager::poll_devices();
+}
+
 bool
 TrackerManager::can_update_connected_devices()
 {
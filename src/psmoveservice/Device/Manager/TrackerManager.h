@@ -54,7 +54,16 @@ public:
     long version;
     int optical_tracking_timeout;
 	int tracker_sleep_ms;
+	bool use_wakeup_signal;
+	int wakeup_max_wait_ms;
+	bool log_wakeup_latency;
 	bool use_bgr_to_hsv_lookup_table;
+	bool use_tracker_worker_threads;
+	bool use_fused_hsv_threshold;
+	bool use_integer_hsv_converter;
+	bool use_color_classification_table;
+	bool use_blob_extractor;
+	int video_stream_frame_interval;
 	bool exclude_opposed_cameras;
 	float min_valid_projection_area;
 	bool disable_roi;
@@ -108,6 +117,7 @@ public:
     void freeTrackingColorID(eCommonTrackingColorID color_id);
 
 protected:
+    void poll_devices() override;
     bool can_update_connected_devices() override;
     void mark_tracker_list_dirty();
 
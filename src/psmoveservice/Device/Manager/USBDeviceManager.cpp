@@ -7,8 +7,12 @@
 #include "NullUSBApi.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
+#include "ServerWakeupSignal.h"
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <vector>
 #include <map>
@@ -25,6 +29,10 @@ const char * k_nullusb_api_name= "nullusb_api";
 const char * k_libusb_api_name= "libusb_api";
 const char * k_winusb_api_name= "winusb_api";
 
+// Upper bound on a single wait for a transfer result.
+// Results normally wake the waiting thread well before this.
+const int k_max_transfer_result_wait_ms= 100;
+
 //-- private implementation -----
 
 //-- USB Manager Config -----
@@ -81,6 +89,7 @@ public:
 		, m_transfers_enabled(false)
         , m_thread_started(false)
 		, m_next_usb_device_handle(0)
+		, m_posted_result_count(0)
     {
 
     }
@@ -272,12 +281,15 @@ public:
 
 			if (request_queue.push(requestState))
 			{
-				// Give the other thread a chance to process the request
-				ServerUtility::sleep_ms(10);
+				// Kick the worker thread out of its usb event wait so it picks up the request now
+				m_usb_api->wakeup();
 				bAddedRequest= true;
 			}
 		}
-		else
+
+		// Report requests that can't be queued through the callback too,
+		// so the callback always fires exactly once
+		if (!bAddedRequest)
 		{
 			USBTransferResult result;
 			memset(&result, 0, sizeof(USBTransferResult));
@@ -383,9 +395,43 @@ public:
 		}
 
 		result_queue.push(state);
+
+		// Wake up anyone blocked on a transfer result
+		signalResultPosted();
+
+		// Let the main loop know there is a result to process
+		ServerWakeupSignal::get_instance()->notify();
+	}
+
+	unsigned int getPostedResultCount()
+	{
+		std::lock_guard<std::mutex> lock(m_result_mutex);
+		return m_posted_result_count;
+	}
+
+	// Blocks until a result is posted after getPostedResultCount() returned last_result_count,
+	// or the worker thread exits, or timeout_ms elapses
+	void waitForPostedResult(unsigned int last_result_count, int timeout_ms)
+	{
+		std::unique_lock<std::mutex> lock(m_result_mutex);
+
+		m_result_cv.wait_for(
+			lock, 
+			std::chrono::milliseconds(timeout_ms), 
+			[this, last_result_count]() { return m_posted_result_count != last_result_count; });
 	}
 
 protected:
+    void signalResultPosted()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_result_mutex);
+            ++m_posted_result_count;
+        }
+
+        m_result_cv.notify_all();
+    }
+
     void startWorkerThread()
     {
         if (!m_thread_started)
@@ -507,19 +553,27 @@ protected:
                 m_exit_signaled= true;
             }
         }
+
+        // Requests queued after the last processRequests() are now up to the main thread,
+        // so wake up any thread blocked waiting on them
+        signalResultPosted();
     }
 
     void cleanupCanceledRequests(bool bForceCleanup)
     {
-        for (auto it = m_canceled_bulk_transfer_bundles.begin(); it != m_canceled_bulk_transfer_bundles.end(); ++it)
+        for (auto it = m_canceled_bulk_transfer_bundles.begin(); it != m_canceled_bulk_transfer_bundles.end(); )
         {
             IUSBBulkTransferBundle *bundle = *it;
 
             if (bundle->getActiveTransferCount() == 0 || bForceCleanup)
             {
-                m_canceled_bulk_transfer_bundles.erase(it);
+                it = m_canceled_bulk_transfer_bundles.erase(it);
                 delete bundle;
             }
+            else
+            {
+                ++it;
+            }
         }
     }
 
@@ -829,6 +883,11 @@ private:
     std::vector<USBDeviceFilter> m_device_whitelist;
 	t_usb_device_map m_device_state_map;
 	t_usb_device_handle m_next_usb_device_handle;
+
+	// Result signal for threads blocked on a transfer
+	std::mutex m_result_mutex;
+	std::condition_variable m_result_cv;
+	unsigned int m_posted_result_count;
 };
 
 //-- public interface -----
@@ -931,34 +990,55 @@ bool usb_device_submit_transfer_request_async(
 
 // Send the transfer request to the worker thread and block until it completes
 USBTransferResult usb_device_submit_transfer_request_blocking(const USBTransferRequest &request)
+{
+	USBTransferResult result;
+
+	usb_device_submit_transfer_requests_blocking(&request, &result, 1);
+
+	return result;
+}
+
+// Send all of the transfer requests to the worker thread and block until they all complete
+void usb_device_submit_transfer_requests_blocking(
+	const USBTransferRequest *requests,
+	USBTransferResult *out_results,
+	const int request_count)
 {
 	USBDeviceManagerImpl *deviceManagerImpl= USBDeviceManager::getInstance()->getImplementation();
 
-	USBTransferResult result;
-	bool bIsPending = true;
+	// Only touched on this thread, since update() is what executes the callbacks
+	int pending_count = request_count;
 
-	// Submit the async usb control transfer request to the worker thread
-	deviceManagerImpl->submitTransferRequest(
-		request,
-		[&result, &bIsPending](USBTransferResult &r)
-		{
-			result = r;
-			bIsPending = false;
-		}
-	);
+	// Submit every request up front so the worker thread has them all in flight at once.
+	// The callback fires exactly once per request, even if the submit fails.
+	for (int request_index = 0; request_index < request_count; ++request_index)
+	{
+		USBTransferResult *result = &out_results[request_index];
+
+		deviceManagerImpl->submitTransferRequest(
+			requests[request_index],
+			[result, &pending_count](USBTransferResult &r)
+			{
+				*result = r;
+				--pending_count;
+			}
+		);
+	}
 
-	// Spin until the transfer completes
-	while (bIsPending)
+	while (pending_count > 0)
 	{
-		// Give the worker thread a chance to do work
-		ServerUtility::sleep_ms(1);
+		const unsigned int posted_result_count = deviceManagerImpl->getPostedResultCount();
 
-		// Poll to see if the transfer completed
-		// (will execute the callback on completion)
+		// Execute the callbacks of any completed transfers
+		// (or process the requests right here if the worker thread isn't running)
 		deviceManagerImpl->update();
-	}
 
-	return result;
+		// Sleep until the worker thread posts another result
+		if (pending_count > 0)
+		{
+			deviceManagerImpl->waitForPostedResult(posted_result_count, k_max_transfer_result_wait_ms);
+		}
+	}
 }
 
 // -- Device Queries ----
@@ -86,6 +86,13 @@ bool usb_device_submit_transfer_request_async(
 // Send the transfer request to the worker thread and block until it completes
 USBTransferResult usb_device_submit_transfer_request_blocking(const USBTransferRequest &request);
 
+// Send all of the transfer requests to the worker thread and block until they all complete.
+// out_results[i] receives the result of requests[i].
+void usb_device_submit_transfer_requests_blocking(
+	const USBTransferRequest *requests, 
+	USBTransferResult *out_results, 
+	const int request_count);
+
 // -- Device Queries ----
 bool usb_device_can_be_opened(struct USBDeviceEnumerator* enumerator, char *outReason, size_t bufferSize);
 bool usb_device_get_filter(t_usb_device_handle handle, USBDeviceFilter &outDeviceInfo);
@@ -11,6 +11,17 @@
 
 #include <assert.h>
 
+//-- constants -----
+// libusb_interrupt_event_handler() (libusb >= 1.0.21) lets wakeup() cut poll() short,
+// so poll() can block for a long time waiting on transfers.
+// Without it new requests sit in the queue until poll() times out, so keep the timeout short.
+#if defined(LIBUSB_API_VERSION) && (LIBUSB_API_VERSION >= 0x01000105)
+#define LIBUSB_HAS_INTERRUPT_EVENT_HANDLER
+static const int k_poll_timeout_ms = 50;
+#else
+static const int k_poll_timeout_ms = 2;
+#endif
+
 //-- definitions -----
 struct APIContext
 {
@@ -52,12 +63,21 @@ void LibUSBApi::poll()
 {
 	struct timeval tv;
 	tv.tv_sec = 0;
-	tv.tv_usec = 50 * 1000; // ms
+	tv.tv_usec = k_poll_timeout_ms * 1000; // ms
 
 	// Give libusb a chance to process transfer requests and post events
 	libusb_handle_events_timeout_completed(m_apiContext->lib_usb_context, &tv, NULL);
 }
 
+void LibUSBApi::wakeup()
+{
+#ifdef LIBUSB_HAS_INTERRUPT_EVENT_HANDLER
+	// Interrupts the event handling in poll()
+	libusb_interrupt_event_handler(m_apiContext->lib_usb_context);
+#endif
+	// Otherwise poll() picks up the new request within k_poll_timeout_ms
+}
+
 void LibUSBApi::shutdown()
 {
 	if (m_apiContext->lib_usb_context != nullptr)
@@ -45,10 +45,15 @@ bool LibUSBBulkTransferBundle::initialize()
     bool bSuccess = (m_active_transfer_count == 0);
     uint8_t bulk_endpoint = 0;
 
-    // Find the bulk transfer endpoint          
+    // Use the requested endpoint or find the bulk transfer endpoint
     if (bSuccess)
     {
-        if (find_bulk_transfer_endpoint(m_device, bulk_endpoint))
+        if (m_request.endpoint != 0)
+        {
+            bulk_endpoint = m_request.endpoint;
+            libusb_clear_halt(m_device_handle, bulk_endpoint);
+        }
+        else if (find_bulk_transfer_endpoint(m_device, bulk_endpoint))
         {
             libusb_clear_halt(m_device_handle, bulk_endpoint);
         }
@@ -98,7 +103,19 @@ bool LibUSBBulkTransferBundle::initialize()
         {
             bulk_transfer_requests[transfer_index] = libusb_alloc_transfer(0);
 
-            if (bulk_transfer_requests[transfer_index] != nullptr)
+            if (bulk_transfer_requests[transfer_index] != nullptr && m_request.bIsInterruptTransfer)
+            {
+                libusb_fill_interrupt_transfer(
+                    bulk_transfer_requests[transfer_index],
+                    m_device_handle,
+                    bulk_endpoint,
+                    transfer_buffer + transfer_index*m_request.transfer_packet_size,
+                    m_request.transfer_packet_size,
+                    transfer_callback_function,
+                    reinterpret_cast<void*>(this),
+                    0);
+            }
+            else if (bulk_transfer_requests[transfer_index] != nullptr)
             {
                 libusb_fill_bulk_transfer(
                     bulk_transfer_requests[transfer_index],
@@ -185,7 +202,9 @@ static void LIBUSB_CALL transfer_callback_function(struct libusb_transfer *bulk_
     const auto &request = bundle->getTransferRequest();
     enum libusb_transfer_status status = bulk_transfer->status;
 
-    if (status == LIBUSB_TRANSFER_COMPLETED)
+    // Don't hand out data that completed after the transfers were canceled,
+    // the owner of the callback may already be going away
+    if (status == LIBUSB_TRANSFER_COMPLETED && !bundle->getIsCanceled())
     {
 
         // NOTE: This callback is getting executed on the worker thread!
@@ -298,4 +317,9 @@ t_usb_device_handle LibUSBBulkTransferBundle::getUSBDeviceHandle() const
 int LibUSBBulkTransferBundle::getActiveTransferCount() const
 {
 	return m_active_transfer_count;
+}
+
+bool LibUSBBulkTransferBundle::getIsCanceled() const
+{
+	return m_is_canceled;
 }
\ No newline at end of file
@@ -27,6 +27,7 @@ public:
 	const USBRequestPayload_BulkTransfer &getTransferRequest() const override;
 	t_usb_device_handle getUSBDeviceHandle() const override;
 	int getActiveTransferCount() const override;
+	bool getIsCanceled() const;
 
     // Helpers
     // Search for an input transfer endpoint in the endpoint descriptor
@@ -20,6 +20,10 @@ void NullUSBApi::poll()
 {
 }
 
+void NullUSBApi::wakeup()
+{
+}
+
 void NullUSBApi::shutdown()
 {
 }
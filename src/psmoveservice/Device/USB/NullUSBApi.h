@@ -11,6 +11,7 @@ public:
 
 	bool startup() override;
 	void poll() override;
+	void wakeup() override;
 	void shutdown() override;
 
 	USBDeviceEnumerator* device_enumerator_create() override;
@@ -62,6 +62,7 @@ public:
 
 	virtual bool startup() = 0;
 	virtual void poll() = 0;
+	virtual void wakeup() = 0; // Makes a poll() blocked on another thread return early
 	virtual void shutdown() = 0;
 
 	virtual USBDeviceEnumerator* device_enumerator_create() = 0;
@@ -110,6 +110,8 @@ struct USBRequestPayload_BulkTransfer
     int in_flight_transfer_packet_count;
     usb_bulk_transfer_cb_fn on_data_callback;
     void *transfer_callback_userdata;
+    unsigned char endpoint; // 0 = use the first bulk endpoint of the device
+    bool bIsInterruptTransfer; // Stream from an interrupt endpoint instead of a bulk endpoint
     bool bAutoResubmit;
 };
 
@@ -24,6 +24,7 @@
 //-- constants -----
 static const float k_min_time_delta_seconds = 1 / 120.f;
 static const float k_max_time_delta_seconds = 1 / 30.f;
+static const float k_min_device_time_delta_seconds = 1 / 1000.f;
 
 //-- macros -----
 #define SET_BUTTON_BIT(bitmask, bit_index, button_state) \
@@ -115,6 +116,8 @@ ServerControllerView::ServerControllerView(const int device_id)
     , m_lastPollSeqNumProcessed(-1)
     , m_last_filter_update_timestamp()
     , m_last_filter_update_timestamp_valid(false)
+    , m_last_device_timestamp_seconds(0.0)
+    , m_last_device_timestamp_valid(false)
 {
     m_tracking_color = std::make_tuple(0x00, 0x00, 0x00);
     m_LED_override_color = std::make_tuple(0x00, 0x00, 0x00);
@@ -124,14 +127,40 @@ ServerControllerView::~ServerControllerView()
 {
 }
 
-bool ServerControllerView::allocate_device_interface(
-    const class DeviceEnumerator *enumerator)
+IDeviceInterface *ServerControllerView::allocate_device_interface(
+    const class DeviceEnumerator *enumerator) const
 {
+    IControllerInterface *device= nullptr;
+
     switch (enumerator->get_device_type())
     {
+    case CommonDeviceState::PSMove:
+        device= new PSMoveController();
+        break;
+    case CommonDeviceState::PSNavi:
+        device= new PSNaviController();
+        break;
+    case CommonDeviceState::PSDualShock4:
+        device= new PSDualShock4Controller();
+        break;
+    case CommonDeviceState::VirtualController:
+        device= new VirtualController();
+        break;
+    default:
+        break;
+    }
+
+    return device;
+}
+
+bool ServerControllerView::attach_device_interface(
+    IDeviceInterface *device)
+{
+    switch (device->getDeviceType())
+    {
     case CommonDeviceState::PSMove:
         {
-            m_device = new PSMoveController();
+            m_device = static_cast<IControllerInterface *>(device);
             m_tracker_pose_estimations = new ControllerOpticalPoseEstimation[TrackerManager::k_max_devices];
             m_pose_filter= nullptr; // no pose filter until the device is opened
 
@@ -145,13 +174,13 @@ bool ServerControllerView::allocate_device_interface(
         } break;
     case CommonDeviceState::PSNavi:
         {
-            m_device= new PSNaviController();
+            m_device= static_cast<IControllerInterface *>(device);
             m_pose_filter= nullptr;
             m_multicam_pose_estimation = nullptr;
         } break;
     case CommonDeviceState::PSDualShock4:
         {
-            m_device = new PSDualShock4Controller();
+            m_device = static_cast<IControllerInterface *>(device);
             m_tracker_pose_estimations = new ControllerOpticalPoseEstimation[TrackerManager::k_max_devices];
             m_pose_filter = nullptr; // no pose filter until the device is opened
 
@@ -165,7 +194,7 @@ bool ServerControllerView::allocate_device_interface(
         } break;
     case CommonDeviceState::VirtualController:
         {
-            m_device = new VirtualController();
+            m_device = static_cast<IControllerInterface *>(device);
             m_tracker_pose_estimations = new ControllerOpticalPoseEstimation[TrackerManager::k_max_devices];
             m_pose_filter = nullptr; // no pose filter until the device is opened
 
@@ -214,10 +243,10 @@ void ServerControllerView::free_device_interface()
     }
 }
 
-bool ServerControllerView::open(const class DeviceEnumerator *enumerator)
+bool ServerControllerView::adopt(IDeviceInterface *opened_device)
 {
-    // Attempt to open the controller
-    bool bSuccess= ServerDeviceView::open(enumerator);
+    // Attempt to take over the opened controller
+    bool bSuccess= ServerDeviceView::adopt(opened_device);
     bool bAllocateTrackingColor = false;
 
     // Setup the orientation filter based on the controller configuration
@@ -308,6 +337,7 @@ bool ServerControllerView::open(const class DeviceEnumerator *enumerator)
     // Clear the filter update timestamp
     m_last_filter_update_timestamp = std::chrono::time_point<std::chrono::high_resolution_clock>();
     m_last_filter_update_timestamp_valid= false;
+    m_last_device_timestamp_valid= false;
 
     return bSuccess;
 }
@@ -468,7 +498,7 @@ void ServerControllerView::updateOpticalPoseEstimation(TrackerManager* tracker_m
                         // set partially valid state
                         ControllerOpticalPoseEstimation newTrackerPoseEstimate= trackerPoseEstimateRef;
 
-                        if (tracker->computeProjectionForController(
+                        if (tracker->fetchProjectionForController(
                                 this, 
                                 &trackingShape,
                                 &newTrackerPoseEstimate))
@@ -621,7 +651,8 @@ void ServerControllerView::updateStateAndPredict()
     m_last_filter_update_timestamp_valid = true;
 
     // Evenly apply the list of controller state updates over the time since last filter update
-    float per_state_time_delta_seconds = time_delta_seconds / static_cast<float>(firstLookBackIndex + 1);
+    // (only used for controllers that don't timestamp their samples)
+    const float even_time_delta_seconds = time_delta_seconds / static_cast<float>(firstLookBackIndex + 1);
 
     // Process the polled controller states forward in time
     // computing the new orientation along the way.
@@ -629,6 +660,23 @@ void ServerControllerView::updateStateAndPredict()
     {
         const CommonControllerState *controllerState= getState(lookBackIndex);
 
+        // Integrate over the time between samples as measured by the controller's own sample clock
+        float per_state_time_delta_seconds = even_time_delta_seconds;
+        if (controllerState->bIsDeviceTimestampValid)
+        {
+            if (m_last_device_timestamp_valid)
+            {
+                const double device_time_delta_seconds = 
+                    controllerState->DeviceTimestampSeconds - m_last_device_timestamp_seconds;
+
+                per_state_time_delta_seconds = 
+                    clampf(static_cast<float>(device_time_delta_seconds), k_min_device_time_delta_seconds, k_max_time_delta_seconds);
+            }
+
+            m_last_device_timestamp_seconds = controllerState->DeviceTimestampSeconds;
+            m_last_device_timestamp_valid = true;
+        }
+
         switch (controllerState->DeviceType)
         {
         case CommonControllerState::PSMove:
@@ -1788,20 +1836,27 @@ pose_filter_factory(
 {
     static IPoseFilter *filter= nullptr;
 
-    if (position_filter_type == "PoseKalman" && orientation_filter_type == "PoseKalman")
+    if ((position_filter_type == "PoseKalman" && orientation_filter_type == "PoseKalman") ||
+        (position_filter_type == "PoseKalmanFloat" && orientation_filter_type == "PoseKalmanFloat"))
     {
+        // "PoseKalmanFloat" runs the same filter in single precision
+        const KalmanPoseFilterPrecision precision=
+            (position_filter_type == "PoseKalmanFloat")
+            ? KalmanPoseFilterPrecisionFloat
+            : KalmanPoseFilterPrecisionDouble;
+
         switch (deviceType)
         {
         case CommonDeviceState::PSMove:
         case CommonDeviceState::VirtualController:
             {
-                KalmanPoseFilterPSMove *kalmanFilter = new KalmanPoseFilterPSMove();
+                KalmanPoseFilterPSMove *kalmanFilter = new KalmanPoseFilterPSMove(precision);
                 kalmanFilter->init(constants);
                 filter= kalmanFilter;
             } break;
         case CommonDeviceState::PSDualShock4:
             {
-                KalmanPoseFilterDS4 *kalmanFilter = new KalmanPoseFilterDS4();
+                KalmanPoseFilterDS4 *kalmanFilter = new KalmanPoseFilterDS4(precision);
                 kalmanFilter->init(constants);
                 filter= kalmanFilter;
             } break;
@@ -2048,6 +2103,7 @@ update_filters_for_psmove(
                 poseFilter,
                 filterPacket);
 
+            // The two frames are sampled evenly across the time since the previous report
             poseFilter->update(delta_time / 2.f, filterPacket);
         }
         }
@@ -2372,80 +2428,84 @@ static void computeSpherePoseForControllerFromMultipleTrackers(
         screen_area_sum += poseEstimate.projection.screen_area;
     }
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
+    // Gather every tracker to triangulate from, weighted by its projection area.
+    // When excluding opposed cameras, a tracker only counts if some other tracker isn't opposed to it.
+    const ServerTrackerView *triangulation_trackers[TrackerManager::k_max_devices];
+    CommonDeviceScreenLocation triangulation_locations[TrackerManager::k_max_devices];
+    float triangulation_weights[TrackerManager::k_max_devices];
+    int triangulation_count = 0;
     int biggest_prjection_id = -1;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceScreenLocation &screen_location = position2d_list[list_index];
         const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
+        const float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
+        bool bHasTriangulationPartner = !cfg.exclude_opposed_cameras;
 
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
+        for (int other_list_index = 0; 
+            other_list_index < projections_found && !bHasTriangulationPartner; 
+            ++other_list_index)
         {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceScreenLocation &other_screen_location = position2d_list[other_list_index];
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-            // if trackers are on poposite sides
-            if (cfg.exclude_opposed_cameras)
+            if (other_list_index != list_index)
             {
-                if ((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
-                    (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0))
-                {
-                    float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
-                    float other_screen_area = tracker_pose_estimations[other_tracker_id].projection.screen_area;
-
-                    biggest_prjection_id = screen_area > other_screen_area ? tracker_id : other_tracker_id;
+                const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
+                const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
 
-                    continue;
-                }
+                // if trackers are on opposite sides
+                bHasTriangulationPartner =
+                    !((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
+                      (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0));
             }
+        }
 
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePosition world_position =
-                ServerTrackerView::triangulateWorldPosition(
-                    tracker.get(), &screen_location,
-                    other_tracker.get(), &other_screen_location);
-
-            average_world_position.x += world_position.x;
-            average_world_position.y += world_position.y;
-            average_world_position.z += world_position.z;
+        if (bHasTriangulationPartner)
+        {
+            triangulation_trackers[triangulation_count] = tracker.get();
+            triangulation_locations[triangulation_count] = position2d_list[list_index];
+            triangulation_weights[triangulation_count] = screen_area;
+            ++triangulation_count;
+        }
 
-            ++pair_count;
+        if (biggest_prjection_id == -1 || 
+            screen_area > tracker_pose_estimations[biggest_prjection_id].projection.screen_area)
+        {
+            biggest_prjection_id = tracker_id;
         }
     }
 
-    if (pair_count == 0 && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
+    // Triangulate a world position from all of the trackers at once
+    CommonDevicePosition world_position;
+    const bool bTriangulated =
+        triangulation_count >= 2 &&
+        ServerTrackerView::triangulateWorldPositionFromMultipleTrackers(
+            triangulation_trackers,
+            triangulation_locations,
+            triangulation_weights,
+            triangulation_count,
+            &world_position);
+
+    if (!bTriangulated && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
     {
-        // Position not triangulated from opposed camera, estimate from one tracker only.
-
+        // Position not triangulated from opposed or degenerate cameras, estimate from one tracker only.
         computeSpherePoseForControllerFromSingleTracker(
             controllerView,
             tracker_manager->getTrackerViewPtr(biggest_prjection_id),
             &tracker_pose_estimations[biggest_prjection_id],
-            multicam_pose_estimation);		
+            multicam_pose_estimation);
     }
-    else if(pair_count > 0)
+    else if (bTriangulated)
     {
-        // Compute the average position
-        const float N = static_cast<float>(pair_count);
-
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
-
-        // Store the averaged tracking position
+        // Store the triangulated tracking position
         const float q = tracker_manager->getConfig().controller_position_smoothing;
         if (q <= 0.01f)
         {
-            multicam_pose_estimation->position_cm = average_world_position;
+            multicam_pose_estimation->position_cm = world_position;
         }
         else
         {
-            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * average_world_position.x;
-            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * average_world_position.y;
-            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * average_world_position.z;
+            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * world_position.x;
+            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * world_position.y;
+            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * world_position.z;
         }
 
         multicam_pose_estimation->bCurrentlyTracking = true;
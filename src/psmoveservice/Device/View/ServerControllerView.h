@@ -46,9 +46,11 @@ public:
     ServerControllerView(const int device_id);
     virtual ~ServerControllerView();
 
-    bool open(const class DeviceEnumerator *enumerator) override;
+    bool adopt(IDeviceInterface *opened_device) override;
     void close() override;
 
+    IDeviceInterface *allocate_device_interface(const class DeviceEnumerator *enumerator) const override;
+
 	// Tell the pose filter that the controller is aligned with global forward 
 	// with the given pose relative to it's identity pose.
 	// Recenter the pose filter state accordingly.
@@ -181,7 +183,7 @@ public:
 protected:
     void set_tracking_enabled_internal(bool bEnabled);
     void update_LED_color_internal();
-    bool allocate_device_interface(const class DeviceEnumerator *enumerator) override;
+    bool attach_device_interface(IDeviceInterface *device) override;
     void free_device_interface() override;
     void publish_device_data_frame() override;
 
@@ -209,6 +211,8 @@ private:
     int m_lastPollSeqNumProcessed;
     std::chrono::time_point<std::chrono::high_resolution_clock> m_last_filter_update_timestamp;
     bool m_last_filter_update_timestamp_valid;
+    double m_last_device_timestamp_seconds;
+    bool m_last_device_timestamp_valid;
 };
 
 #endif // SERVER_CONTROLLER_VIEW_H
@@ -24,19 +24,43 @@ bool
 ServerDeviceView::open(const DeviceEnumerator *enumerator)
 {
     // Attempt to allocate the device 
-    bool bSuccess= allocate_device_interface(enumerator);
+    IDeviceInterface *device= allocate_device_interface(enumerator);
+    bool bSuccess= device != nullptr;
     
     // Attempt to open the device
     if (bSuccess)
     {
-        bSuccess= getDevice()->open(enumerator);
+        bSuccess= device->open(enumerator);
+
+        if (!bSuccess)
+        {
+            delete device;
+        }
     }
     
+    if (bSuccess)
+    {
+        bSuccess= adopt(device);
+    }
+
+    return bSuccess;
+}
+
+bool
+ServerDeviceView::adopt(IDeviceInterface *opened_device)
+{
+    bool bSuccess= attach_device_interface(opened_device);
+
     if (bSuccess)
     {
         // Consider a successful opening as an update
         m_pollNoDataCount= 0;
     }
+    else
+    {
+        opened_device->close();
+        delete opened_device;
+    }
 
     return bSuccess;
 }
@@ -58,7 +82,21 @@ bool ServerDeviceView::poll()
     // Only poll data from open, bluetooth controllers
     if (device != nullptr && device->getIsReadyToPoll())
     {
-        switch (device->poll())
+        bSuccessfullyUpdated= handle_poll_result(device->poll());
+    }
+    
+    return bSuccessfullyUpdated;
+}
+
+bool ServerDeviceView::handle_poll_result(IDeviceInterface::ePollResult poll_result)
+{
+    bool bSuccessfullyUpdated= true;
+    
+    IDeviceInterface* device = getDevice();
+
+    if (device != nullptr)
+    {
+        switch (poll_result)
         {
         case IDeviceInterface::_PollResultSuccessNoData:
             {
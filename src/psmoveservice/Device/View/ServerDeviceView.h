@@ -13,13 +13,21 @@ public:
     ServerDeviceView(const int device_id);
     virtual ~ServerDeviceView();
     
-    virtual bool open(const class DeviceEnumerator *enumerator);
+    // Creates and opens the device for the enumerated entry on the calling thread, then adopts it
+    bool open(const class DeviceEnumerator *enumerator);
+    // Takes ownership of an already opened device and sets up the view around it.
+    // The device is closed and freed if that fails.
+    virtual bool adopt(IDeviceInterface *opened_device);
     virtual void close();
 
     virtual bool poll();
     virtual void publish();
     
     bool matchesDeviceEnumerator(const class DeviceEnumerator *enumerator) const;
+
+    // Creates (but doesn't open) the device for the enumerated entry.
+    // Doesn't touch the view, so the background device open worker can call it from its own thread.
+    virtual IDeviceInterface *allocate_device_interface(const class DeviceEnumerator *enumerator) const = 0;
     
     // getters
     inline int getDeviceID() const
@@ -61,10 +69,15 @@ public:
     { m_bHasUnpublishedState= true; }
     
 protected:
-    virtual bool allocate_device_interface(const class DeviceEnumerator *enumerator) = 0;
+    // Takes ownership of the device and allocates the view state for its type
+    virtual bool attach_device_interface(IDeviceInterface *device) = 0;
     virtual void free_device_interface() = 0;
     virtual void publish_device_data_frame() = 0;
 
+    // Updates the poll failure count and new data timestamp from the result of an IDeviceInterface::poll().
+    // Returns false if the device was closed because of the poll result.
+    bool handle_poll_result(IDeviceInterface::ePollResult poll_result);
+
     bool m_bHasUnpublishedState;
     int m_pollNoDataCount;
     int m_sequence_number;
@@ -93,13 +93,32 @@ ServerHMDView::~ServerHMDView()
 {
 }
 
-bool ServerHMDView::allocate_device_interface(const class DeviceEnumerator *enumerator)
+IDeviceInterface *ServerHMDView::allocate_device_interface(const class DeviceEnumerator *enumerator) const
 {
+    IHMDInterface *device = nullptr;
+
     switch (enumerator->get_device_type())
     {
+    case CommonDeviceState::Morpheus:
+        device = new MorpheusHMD();
+        break;
+    case CommonDeviceState::VirtualHMD:
+        device = new VirtualHMD();
+        break;
+    default:
+        break;
+    }
+
+    return device;
+}
+
+bool ServerHMDView::attach_device_interface(IDeviceInterface *device)
+{
+    switch (device->getDeviceType())
+    {
     case CommonDeviceState::Morpheus:
         {
-            m_device = new MorpheusHMD();
+            m_device = static_cast<IHMDInterface *>(device);
 			m_pose_filter = nullptr; // no pose filter until the device is opened
 
 			m_tracker_pose_estimations = new HMDOpticalPoseEstimation[TrackerManager::k_max_devices];
@@ -113,7 +132,7 @@ bool ServerHMDView::allocate_device_interface(const class DeviceEnumerator *enum
         } break;
     case CommonDeviceState::VirtualHMD:
         {
-            m_device = new VirtualHMD();
+            m_device = static_cast<IHMDInterface *>(device);
 			m_pose_filter = nullptr; // no pose filter until the device is opened
 
 			m_tracker_pose_estimations = new HMDOpticalPoseEstimation[TrackerManager::k_max_devices];
@@ -165,10 +184,10 @@ void ServerHMDView::free_device_interface()
     }
 }
 
-bool ServerHMDView::open(const class DeviceEnumerator *enumerator)
+bool ServerHMDView::adopt(IDeviceInterface *opened_device)
 {
-    // Attempt to open the controller
-    bool bSuccess = ServerDeviceView::open(enumerator);
+    // Attempt to take over the opened HMD
+    bool bSuccess = ServerDeviceView::adopt(opened_device);
 
     // Setup the orientation filter based on the controller configuration
     if (bSuccess)
@@ -328,7 +347,7 @@ void ServerHMDView::updateOpticalPoseEstimation(TrackerManager* tracker_manager)
                         // set partially valid state
                         HMDOpticalPoseEstimation newTrackerPoseEstimate= trackerPoseEstimateRef;
 
-                        if (tracker->computeProjectionForHMD(
+                        if (tracker->fetchProjectionForHMD(
                                 this, 
                                 &trackingShape,
                                 &newTrackerPoseEstimate))
@@ -1485,79 +1504,84 @@ static void computeSpherePoseForHmdFromMultipleTrackers(
         screen_area_sum += poseEstimate.projection.screen_area;
     }
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
+    // Gather every tracker to triangulate from, weighted by its projection area.
+    // When excluding opposed cameras, a tracker only counts if some other tracker isn't opposed to it.
+    const ServerTrackerView *triangulation_trackers[TrackerManager::k_max_devices];
+    CommonDeviceScreenLocation triangulation_locations[TrackerManager::k_max_devices];
+    float triangulation_weights[TrackerManager::k_max_devices];
+    int triangulation_count = 0;
     int biggest_prjection_id = -1;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceScreenLocation &screen_location = position2d_list[list_index];
         const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
+        const float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
+        bool bHasTriangulationPartner = !cfg.exclude_opposed_cameras;
 
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
+        for (int other_list_index = 0; 
+            other_list_index < projections_found && !bHasTriangulationPartner; 
+            ++other_list_index)
         {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceScreenLocation &other_screen_location = position2d_list[other_list_index];
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-            // if trackers are on opposite sides
-            if (cfg.exclude_opposed_cameras)
+            if (other_list_index != list_index)
             {
-                if ((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
-                    (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0))
-                {
-                    float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
-                    float other_screen_area = tracker_pose_estimations[other_tracker_id].projection.screen_area;
-
-                    biggest_prjection_id = screen_area > other_screen_area ? tracker_id : other_tracker_id;
+                const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
+                const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
 
-                    continue;
-                }
+                // if trackers are on opposite sides
+                bHasTriangulationPartner =
+                    !((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
+                      (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0));
             }
+        }
 
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePosition world_position =
-                ServerTrackerView::triangulateWorldPosition(
-                    tracker.get(), &screen_location,
-                    other_tracker.get(), &other_screen_location);
-
-            average_world_position.x += world_position.x;
-            average_world_position.y += world_position.y;
-            average_world_position.z += world_position.z;
+        if (bHasTriangulationPartner)
+        {
+            triangulation_trackers[triangulation_count] = tracker.get();
+            triangulation_locations[triangulation_count] = position2d_list[list_index];
+            triangulation_weights[triangulation_count] = screen_area;
+            ++triangulation_count;
+        }
 
-            ++pair_count;
+        if (biggest_prjection_id == -1 || 
+            screen_area > tracker_pose_estimations[biggest_prjection_id].projection.screen_area)
+        {
+            biggest_prjection_id = tracker_id;
         }
     }
 
-    if (pair_count == 0 && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
+    // Triangulate a world position from all of the trackers at once
+    CommonDevicePosition world_position;
+    const bool bTriangulated =
+        triangulation_count >= 2 &&
+        ServerTrackerView::triangulateWorldPositionFromMultipleTrackers(
+            triangulation_trackers,
+            triangulation_locations,
+            triangulation_weights,
+            triangulation_count,
+            &world_position);
+
+    if (!bTriangulated && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
     {
-        // Position not triangulated from opposed camera, estimate from one tracker only.
+        // Position not triangulated from opposed or degenerate cameras, estimate from one tracker only.
         computeSpherePoseForHmdFromSingleTracker(
             hmdView,
             tracker_manager->getTrackerViewPtr(biggest_prjection_id),
             &tracker_pose_estimations[biggest_prjection_id],
-            multicam_pose_estimation);		
+            multicam_pose_estimation);
     }
-    else if(pair_count > 0)
+    else if (bTriangulated)
     {
-        // Compute the average position
-        const float N = static_cast<float>(pair_count);
-
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
-
-        // Store the averaged tracking position
+        // Store the triangulated tracking position
         const float q = tracker_manager->getConfig().controller_position_smoothing;
         if (q <= 0.01f)
         {
-            multicam_pose_estimation->position_cm = average_world_position;
+            multicam_pose_estimation->position_cm = world_position;
         }
         else
         {
-            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * average_world_position.x;
-            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * average_world_position.y;
-            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * average_world_position.z;
+            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * world_position.x;
+            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * world_position.y;
+            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * world_position.z;
         }
 
         multicam_pose_estimation->bCurrentlyTracking = true;
@@ -1597,79 +1621,84 @@ static void computePointCloudPoseForHmdFromMultipleTrackers(
         screen_area_sum += poseEstimate.projection.screen_area;
     }
 
-    // Compute triangulations amongst all pairs of projections
-    int pair_count = 0;
+    // Gather every tracker to triangulate from, weighted by its projection area.
+    // When excluding opposed cameras, a tracker only counts if some other tracker isn't opposed to it.
+    const ServerTrackerView *triangulation_trackers[TrackerManager::k_max_devices];
+    CommonDeviceScreenLocation triangulation_locations[TrackerManager::k_max_devices];
+    float triangulation_weights[TrackerManager::k_max_devices];
+    int triangulation_count = 0;
     int biggest_prjection_id = -1;
-    CommonDevicePosition average_world_position = { 0.f, 0.f, 0.f };
     for (int list_index = 0; list_index < projections_found; ++list_index)
     {
         const int tracker_id = valid_projection_tracker_ids[list_index];
-        const CommonDeviceScreenLocation &screen_location = position2d_list[list_index];
         const ServerTrackerViewPtr tracker = tracker_manager->getTrackerViewPtr(tracker_id);
+        const float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
+        bool bHasTriangulationPartner = !cfg.exclude_opposed_cameras;
 
-        for (int other_list_index = list_index + 1; other_list_index < projections_found; ++other_list_index)
+        for (int other_list_index = 0; 
+            other_list_index < projections_found && !bHasTriangulationPartner; 
+            ++other_list_index)
         {
-            const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
-            const CommonDeviceScreenLocation &other_screen_location = position2d_list[other_list_index];
-            const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
-            // if trackers are on opposite sides
-            if (cfg.exclude_opposed_cameras)
+            if (other_list_index != list_index)
             {
-                if ((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
-                    (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0))
-                {
-                    float screen_area = tracker_pose_estimations[tracker_id].projection.screen_area;
-                    float other_screen_area = tracker_pose_estimations[other_tracker_id].projection.screen_area;
-
-                    biggest_prjection_id = screen_area > other_screen_area ? tracker_id : other_tracker_id;
+                const int other_tracker_id = valid_projection_tracker_ids[other_list_index];
+                const ServerTrackerViewPtr other_tracker = tracker_manager->getTrackerViewPtr(other_tracker_id);
 
-                    continue;
-                }
+                // if trackers are on opposite sides
+                bHasTriangulationPartner =
+                    !((tracker->getTrackerPose().PositionCm.x > 0) == (other_tracker->getTrackerPose().PositionCm.x < 0) &&
+                      (tracker->getTrackerPose().PositionCm.z > 0) == (other_tracker->getTrackerPose().PositionCm.z < 0));
             }
+        }
 
-            // Using the screen locations on two different trackers we can triangulate a world position
-            CommonDevicePosition world_position =
-                ServerTrackerView::triangulateWorldPosition(
-                    tracker.get(), &screen_location,
-                    other_tracker.get(), &other_screen_location);
-
-            average_world_position.x += world_position.x;
-            average_world_position.y += world_position.y;
-            average_world_position.z += world_position.z;
+        if (bHasTriangulationPartner)
+        {
+            triangulation_trackers[triangulation_count] = tracker.get();
+            triangulation_locations[triangulation_count] = position2d_list[list_index];
+            triangulation_weights[triangulation_count] = screen_area;
+            ++triangulation_count;
+        }
 
-            ++pair_count;
+        if (biggest_prjection_id == -1 || 
+            screen_area > tracker_pose_estimations[biggest_prjection_id].projection.screen_area)
+        {
+            biggest_prjection_id = tracker_id;
         }
     }
 
-    if (pair_count == 0 && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
+    // Triangulate a world position from all of the trackers at once
+    CommonDevicePosition world_position;
+    const bool bTriangulated =
+        triangulation_count >= 2 &&
+        ServerTrackerView::triangulateWorldPositionFromMultipleTrackers(
+            triangulation_trackers,
+            triangulation_locations,
+            triangulation_weights,
+            triangulation_count,
+            &world_position);
+
+    if (!bTriangulated && biggest_prjection_id >= 0 && !DeviceManager::getInstance()->m_tracker_manager->getConfig().ignore_pose_from_one_tracker)
     {
-        // Position not triangulated from opposed camera, estimate from one tracker only.
+        // Position not triangulated from opposed or degenerate cameras, estimate from one tracker only.
         computePointCloudPoseForHmdFromSingleTracker(
             hmdView,
             tracker_manager->getTrackerViewPtr(biggest_prjection_id),
             &tracker_pose_estimations[biggest_prjection_id],
-            multicam_pose_estimation);		
+            multicam_pose_estimation);
     }
-    else if(pair_count > 0)
+    else if (bTriangulated)
     {
-        // Compute the average position
-        const float N = static_cast<float>(pair_count);
-
-        average_world_position.x /= N;
-        average_world_position.y /= N;
-        average_world_position.z /= N;
-
-        // Store the averaged tracking position
+        // Store the triangulated tracking position
         const float q = tracker_manager->getConfig().controller_position_smoothing;
         if (q <= 0.01f)
         {
-            multicam_pose_estimation->position_cm = average_world_position;
+            multicam_pose_estimation->position_cm = world_position;
         }
         else
         {
-            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * average_world_position.x;
-            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * average_world_position.y;
-            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * average_world_position.z;
+            multicam_pose_estimation->position_cm.x = q * multicam_pose_estimation->position_cm.x + (1 - q) * world_position.x;
+            multicam_pose_estimation->position_cm.y = q * multicam_pose_estimation->position_cm.y + (1 - q) * world_position.y;
+            multicam_pose_estimation->position_cm.z = q * multicam_pose_estimation->position_cm.z + (1 - q) * world_position.z;
         }
 
         multicam_pose_estimation->bCurrentlyTracking = true;
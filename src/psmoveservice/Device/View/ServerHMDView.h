@@ -46,9 +46,11 @@ public:
     ServerHMDView(const int device_id);
     ~ServerHMDView();
 
-    bool open(const class DeviceEnumerator *enumerator) override;
+    bool adopt(IDeviceInterface *opened_device) override;
     void close() override;
 
+    IDeviceInterface *allocate_device_interface(const class DeviceEnumerator *enumerator) const override;
+
 	// Recreate and initialize the pose filter for the HMD
 	void resetPoseFilter();
 
@@ -128,7 +130,7 @@ public:
 
 protected:
 	void set_tracking_enabled_internal(bool bEnabled);
-    bool allocate_device_interface(const class DeviceEnumerator *enumerator) override;
+    bool attach_device_interface(IDeviceInterface *device) override;
     void free_device_interface() override;
     void publish_device_data_frame() override;
     static void generate_hmd_data_frame_for_stream(
@@ -15,17 +15,25 @@
 #include "ServerRequestHandler.h"
 #include "SharedTrackerState.h"
 #include "TrackerManager.h"
+#include "ControllerManager.h"
+#include "HMDManager.h"
 #include "PoseFilterInterface.h"
+#include "TrackerBlobExtractor.h"
+#include "TrackerColorThreshold.h"
 
 #include <boost/interprocess/shared_memory_object.hpp>
 #include <boost/interprocess/mapped_region.hpp>
-#include <boost/interprocess/sync/scoped_lock.hpp>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 #include "opencv2/opencv.hpp"
 #include "opencv2/calib3d/calib3d.hpp"
 
 #include <algorithm>
+#include <cstring>
 
 #define USE_OPEN_CV_ELLIPSE_FIT
 
@@ -43,6 +51,9 @@ typedef std::vector<t_opencv_float_contour> t_opencv_float_contour_list;
 template<typename t_opencv_contour_type>
 cv::Point2f computeSafeCenterOfMassForContour(const t_opencv_contour_type &contour);
 
+//-- utility methods
+static void computeDisjointRectCover(const std::vector<cv::Rect2i> &rects, std::vector<cv::Rect2i> &out_cover);
+
 //-- private methods -----
 class SharedVideoFrameReadWriteAccessor
 {
@@ -84,23 +95,22 @@ public:
                     permissions);
 
             // Resize the shared memory
-            m_shared_memory_object->truncate(SharedVideoFrameHeader::computeTotalSize(stride, width));
+            m_shared_memory_object->truncate(SharedVideoFrameHeader::computeTotalSize(stride, height));
 
             // Map all of the shared memory for read/write access
             m_region = new boost::interprocess::mapped_region(*m_shared_memory_object, boost::interprocess::read_write);
 
             // Initialize the shared memory (call constructor using placement new)
-            // This make sure the mutex has the constructor called on it.
+            // This make sure the slot sequence numbers have the constructor called on them.
             SharedVideoFrameHeader *frameState = new (getFrameHeader()) SharedVideoFrameHeader();
             
             frameState->width = width;
             frameState->height = height;
             frameState->stride = stride;
-            frameState->frame_index = 0;
             std::memset(
-                frameState->getBufferMutable(),
+                frameState->getSlotBufferMutable(0),
                 0,
-                SharedVideoFrameHeader::computeVideoBufferSize(stride, height));
+                SHARED_VIDEO_FRAME_SLOT_COUNT*SharedVideoFrameHeader::computeVideoBufferSize(stride, height));
 
             bSuccess = true;
         }
@@ -119,7 +129,6 @@ public:
         if (m_region != nullptr)
         {
             // Call the destructor manually on the frame header since it was constructed via placement new
-            // This will make sure the mutex has the destructor called on it.
             getFrameHeader()->~SharedVideoFrameHeader();
             
             delete m_region;
@@ -141,16 +150,10 @@ public:
     void writeVideoFrame(const unsigned char *buffer)
     {
         SharedVideoFrameHeader *sharedFrameState = getFrameHeader();
-        boost::interprocess::scoped_lock<boost::interprocess::interprocess_mutex> lock(sharedFrameState->mutex);
-
-        size_t buffer_size = 
-            SharedVideoFrameHeader::computeVideoBufferSize(sharedFrameState->stride, sharedFrameState->height);
-        size_t total_shared_mem_size =
-            SharedVideoFrameHeader::computeTotalSize(sharedFrameState->stride, sharedFrameState->height);
-        assert(m_region->get_size() >= total_shared_mem_size);
+        assert(sharedFrameState->isValidLayout(m_region->get_size()));
 
-        ++sharedFrameState->frame_index;
-        std::memcpy(sharedFrameState->getBufferMutable(), buffer, buffer_size);
+        // Lock free: clients that are still reading an older slot never hold up the tracker loop
+        sharedFrameState->writeVideoFrame(buffer);
     }
 
 protected:
@@ -332,16 +335,38 @@ private:
 OpenCVBGRToHSVMapper *OpenCVBGRToHSVMapper::m_instance = nullptr;
 int OpenCVBGRToHSVMapper::m_refCount= 0;
 
+// A tracking color to find in the current frame and where to look for it
+struct OpenCVColorSegmentationRequest
+{
+    eCommonTrackingColorID tracked_color_id;
+    CommonHSVColorRange hsvColorRange;
+    cv::Rect2i ROI;
+    int max_contour_count;
+};
+
+// The blobs found for one tracking color in the current frame
+struct OpenCVColorSegmentation
+{
+    bool bIsValid;
+    cv::Rect2i ROI; // ROI the blobs were searched in, before clamping to the frame
+    t_opencv_int_contour_list contours; // largest first
+};
+
 class OpenCVBufferState
 {
 public:
     OpenCVBufferState(ITrackerInterface *device)
         : bgrBuffer(nullptr)
         , bgrShmemBuffer(nullptr)
+        , bOverlayEnabled(false)
         , hsvBuffer(nullptr)
         , gsLowerBuffer(nullptr)
         , gsUpperBuffer(nullptr)
         , maskedBuffer(nullptr)
+        , colorBitsBuffer(nullptr)
+        , colorClassificationTable(nullptr)
+        , blobExtractor(nullptr)
+        , bFrameSegmented(false)
     {
         device->getVideoFrameDimensions(&frameWidth, &frameHeight, nullptr);
 
@@ -353,7 +378,9 @@ public:
         maskedBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC3);
         
         const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
-        if (cfg.use_bgr_to_hsv_lookup_table)
+        bUseFusedHSVThreshold = cfg.use_fused_hsv_threshold;
+        bUseIntegerHSVConverter = cfg.use_integer_hsv_converter;
+        if (cfg.use_bgr_to_hsv_lookup_table && !bUseFusedHSVThreshold && !bUseIntegerHSVConverter)
         {
             bgr2hsv = OpenCVBGRToHSVMapper::allocate();
         }
@@ -361,13 +388,51 @@ public:
         {
             bgr2hsv = nullptr;
         }
+
+        if (cfg.use_color_classification_table)
+        {
+            colorBitsBuffer = new cv::Mat(frameHeight, frameWidth, CV_8UC1);
+            colorClassificationTable = new HSVColorClassificationTable;
+
+            for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+            {
+                classifiedColorRanges[color_id].clear();
+                bClassifiedColorUsed[color_id] = false;
+            }
+            colorClassificationTable->build(classifiedColorRanges, bClassifiedColorUsed);
+        }
+
+        if (cfg.use_blob_extractor)
+        {
+            blobExtractor = new TrackerBlobExtractor;
+        }
         
+        for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+        {
+            colorSegmentations[color_id].bIsValid = false;
+        }
+
         //Apply default ROI (full frame).
         applyROI(cv::Rect2i(cv::Point(0,0), cv::Size(frameWidth, frameHeight)));
     }
 
     virtual ~OpenCVBufferState()
     {
+        if (blobExtractor != nullptr)
+        {
+            delete blobExtractor;
+        }
+
+        if (colorClassificationTable != nullptr)
+        {
+            delete colorClassificationTable;
+        }
+
+        if (colorBitsBuffer != nullptr)
+        {
+            delete colorBitsBuffer;
+        }
+
         if (maskedBuffer != nullptr)
         {
             delete maskedBuffer;
@@ -404,28 +469,180 @@ public:
         }
     }
 
-    void writeVideoFrame(const unsigned char *video_buffer)
+    // Wraps the captured video frame in place, since the camera leaves it alone until the next frame is taken.
+    // The frame is only copied when the debug overlay needs a buffer of its own to draw on.
+    // Returns false (and leaves the buffers alone) if the frame wasn't captured at the size of these buffers.
+    bool writeVideoFrame(const unsigned char *video_buffer, int width, int height, int stride, bool bDrawOverlay)
+    {
+        if (width != frameWidth || height != frameHeight || stride != frameWidth * 3)
+        {
+            return false;
+        }
+
+        *bgrBuffer = cv::Mat(frameHeight, frameWidth, CV_8UC3, const_cast<unsigned char *>(video_buffer));
+
+        bOverlayEnabled = bDrawOverlay;
+        if (bOverlayEnabled)
+        {
+            bgrBuffer->copyTo(*bgrShmemBuffer);
+        }
+
+        // Blobs are found once for each new frame
+        for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+        {
+            colorSegmentations[color_id].bIsValid = false;
+        }
+        bFrameSegmented = false;
+
+        return true;
+    }
+
+    inline bool getIsOverlayEnabled() const
+    {
+        return bOverlayEnabled;
+    }
+
+    inline bool getIsFrameSegmented() const
+    {
+        return bFrameSegmented;
+    }
+
+    inline const OpenCVColorSegmentation *getColorSegmentation(eCommonTrackingColorID tracked_color_id) const
+    {
+        const OpenCVColorSegmentation &segmentation = colorSegmentations[tracked_color_id];
+
+        return segmentation.bIsValid ? &segmentation : nullptr;
+    }
+
+    // Finds the blobs of every requested tracking color in the current frame.
+    // Pixels where ROIs overlap are only converted to HSV (or classified) once.
+    void segmentFrame(const std::vector<OpenCVColorSegmentationRequest> &requests)
+    {
+        std::vector<cv::Rect2i> clamped_rois;
+        for (const OpenCVColorSegmentationRequest &request : requests)
+        {
+            clamped_rois.push_back(clampROI(request.ROI));
+        }
+
+        std::vector<cv::Rect2i> frame_regions;
+        computeDisjointRectCover(clamped_rois, frame_regions);
+
+        if (colorClassificationTable != nullptr)
+        {
+            updateColorClassificationTable(requests);
+
+            for (const cv::Rect2i &region : frame_regions)
+            {
+                const cv::Mat bgrRegion(*bgrBuffer, region);
+                cv::Mat colorBitsRegion(*colorBitsBuffer, region);
+
+                colorClassificationTable->classifyImage(bgrRegion, colorBitsRegion);
+            }
+        }
+        else if (!bUseFusedHSVThreshold)
+        {
+            for (const cv::Rect2i &region : frame_regions)
+            {
+                updateHsvBuffer(region);
+            }
+        }
+
+        for (size_t request_index = 0; request_index < requests.size(); ++request_index)
+        {
+            segmentTrackedColor(requests[request_index], clamped_rois[request_index], colorClassificationTable != nullptr);
+        }
+
+        bFrameSegmented = true;
+    }
+
+    // Finds the blobs of a tracking color that wasn't part of this frame's segmentation.
+    // Thresholds the color directly since its pixels may not have been classified.
+    void segmentUnrequestedColor(const OpenCVColorSegmentationRequest &request)
+    {
+        const cv::Rect2i clamped_roi = clampROI(request.ROI);
+
+        if (colorClassificationTable == nullptr && !bUseFusedHSVThreshold)
+        {
+            updateHsvBuffer(clamped_roi);
+        }
+
+        segmentTrackedColor(request, clamped_roi, false);
+    }
+
+private:
+    // Rebuilds the classification table if the presets of the tracked colors changed
+    void updateColorClassificationTable(const std::vector<OpenCVColorSegmentationRequest> &requests)
+    {
+        CommonHSVColorRange color_ranges[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+        bool color_used[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+        for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+        {
+            color_ranges[color_id].clear();
+            color_used[color_id] = false;
+        }
+
+        for (const OpenCVColorSegmentationRequest &request : requests)
+        {
+            color_ranges[request.tracked_color_id] = request.hsvColorRange;
+            color_used[request.tracked_color_id] = true;
+        }
+
+        bool bPresetsChanged = false;
+        for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+        {
+            if (color_used[color_id] != bClassifiedColorUsed[color_id] ||
+                (color_used[color_id] && 
+                 memcmp(&color_ranges[color_id], &classifiedColorRanges[color_id], sizeof(CommonHSVColorRange)) != 0))
+            {
+                classifiedColorRanges[color_id] = color_ranges[color_id];
+                bClassifiedColorUsed[color_id] = color_used[color_id];
+                bPresetsChanged = true;
+            }
+        }
+
+        if (bPresetsChanged)
+        {
+            colorClassificationTable->build(classifiedColorRanges, bClassifiedColorUsed);
+        }
+    }
+
+    void segmentTrackedColor(
+        const OpenCVColorSegmentationRequest &request,
+        const cv::Rect2i &clamped_roi,
+        const bool bUseColorBits)
     {
-        const cv::Mat videoBufferMat(frameHeight, frameWidth, CV_8UC3, const_cast<unsigned char *>(video_buffer));
+        OpenCVColorSegmentation &segmentation = colorSegmentations[request.tracked_color_id];
+
+        applyROI(clamped_roi);
+        computeBiggestNContours(
+            request.tracked_color_id, request.hsvColorRange, bUseColorBits, 
+            segmentation.contours, request.max_contour_count);
 
-        videoBufferMat.copyTo(*bgrBuffer);
-        videoBufferMat.copyTo(*bgrShmemBuffer);
+        segmentation.ROI = request.ROI;
+        segmentation.bIsValid = true;
     }
     
-    void updateHsvBuffer()
+    void updateHsvBuffer(const cv::Rect2i &region)
     {
+        const cv::Mat bgrRegion(*bgrBuffer, region);
+        cv::Mat hsvRegion(*hsvBuffer, region);
+
         // Convert the video buffer to the HSV color space
-        if (bgr2hsv != nullptr)
+        if (bUseIntegerHSVConverter)
         {
-            bgr2hsv->cvtColor(bgrROI, hsvROI);
+            convertBGRToHSV(bgrRegion, hsvRegion);
+        }
+        else if (bgr2hsv != nullptr)
+        {
+            bgr2hsv->cvtColor(bgrRegion, hsvRegion);
         }
         else
         {
-            cv::cvtColor(bgrROI, hsvROI, cv::COLOR_BGR2HSV);
+            cv::cvtColor(bgrRegion, hsvRegion, cv::COLOR_BGR2HSV);
         }
     }
-    
-    void applyROI(cv::Rect2i ROI)
+
+    cv::Rect2i clampROI(cv::Rect2i ROI) const
     {
         // Make sure the ROI box is always clamped in bounds of the frame buffer
         int x0= std::min(std::max(ROI.tl().x, 0), frameWidth-1);
@@ -451,6 +668,13 @@ public:
             ROI.width = frameWidth;
             ROI.height = frameHeight;
         }
+
+        return ROI;
+    }
+    
+    void applyROI(cv::Rect2i ROI)
+    {
+        ROI = clampROI(ROI);
        
         //Create the ROI matrices.
         //It's not a full copy, so this isn't too slow.
@@ -459,26 +683,45 @@ public:
         hsvROI = cv::Mat(*hsvBuffer, ROI);
         gsLowerROI = cv::Mat(*gsLowerBuffer, ROI);
         gsUpperROI = cv::Mat(*gsUpperBuffer, ROI);
-        
-        updateHsvBuffer();
+        if (colorBitsBuffer != nullptr)
+        {
+            colorBitsROI = cv::Mat(*colorBitsBuffer, ROI);
+        }
         
         //Draw ROI.
-        cv::rectangle(*bgrShmemBuffer, ROI, cv::Scalar(255, 0, 0));
+        if (bOverlayEnabled)
+        {
+            cv::rectangle(*bgrShmemBuffer, ROI, cv::Scalar(255, 0, 0));
+        }
     }
 
     // Return points in raw image space:
     // i.e. [0, 0] at lower left  to [frameWidth-1, frameHeight-1] at lower right
     bool computeBiggestNContours(
+        const eCommonTrackingColorID tracked_color_id,
         const CommonHSVColorRange &hsvColorRange,
+        const bool bUseColorBits,
         t_opencv_int_contour_list &out_biggest_N_contours,
-        std::vector<double> &out_contour_areas,
         const int max_contour_count,
         const int min_points_in_contour = 6)
     {
         out_biggest_N_contours.clear();
-        out_contour_areas.clear();
         
+        // Pick the tracked color out of the per-frame color classification
+        if (bUseColorBits)
+        {
+            computeColorMaskFromClassification(colorBitsROI, tracked_color_id, gsLowerROI);
+        }
+        // Convert the BGR image to HSV and clamp it in a single pass
+        else if (bUseFusedHSVThreshold)
+        {
+            HSVColorThreshold threshold;
+            threshold.setColorRange(hsvColorRange);
+
+            computeHSVThresholdMask(bgrROI, threshold, gsLowerROI);
+        }
         // Clamp the HSV image, taking into account wrapping the hue angle
+        else
         {
             const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
             const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
@@ -527,7 +770,28 @@ public:
         
         //TODO: Why no blurring of the gsLowerBuffer?
 
+        // Label the blobs of the mask in one pass and only trace the contours of the biggest ones
+        if (blobExtractor != nullptr)
+        {
+            cv::Size size; cv::Point ofs;
+            gsLowerROI.locateROI(size, ofs);
+            blobExtractor->extractBlobs(gsLowerROI, ofs.x, ofs.y, max_contour_count);
+
+            for (const TrackerBlob &blob : blobExtractor->getBlobs())
+            {
+                t_opencv_int_contour contour;
+                blobExtractor->computeBlobContour(blob, contour);
+
+                if (contour.size() > min_points_in_contour)
+                {
+                    removeFrameEdgePoints(contour);
+
+                    out_biggest_N_contours.push_back(contour);
+                }
+            }
+        }
         // Find the largest convex blob in the filtered grayscale buffer
+        else
         {
             struct ContourInfo
             {
@@ -577,36 +841,43 @@ public:
 
                 if (contour.size() > min_points_in_contour)
                 {
-                    // Remove any points in contour on edge of camera/ROI
-                    // TODO: Contours touching image border will be clipped,
-                    // so this might not be necessary.
-                    t_opencv_int_contour::iterator it = contour.begin();
-                    while (it != contour.end()) 
-                    {
-                        if (it->x == 0 || it->x == (frameWidth - 1) || it->y == 0 || it->y == (frameHeight - 1))
-                        {
-                            it = contour.erase(it);
-                        }
-                        else
-                        {
-                            ++it;
-                        }
-                    }
+                    removeFrameEdgePoints(contour);
 
                     // Add cleaned up contour to the output list
                     out_biggest_N_contours.push_back(contour);
-                    // Add its area to the output list too.
-                    out_contour_areas.push_back(contour_info.contour_area);
                 }
             }
         }
 
         return (out_biggest_N_contours.size() > 0);
     }
-    
+
+    // Remove any points in contour on edge of camera/ROI
+    // TODO: Contours touching image border will be clipped,
+    // so this might not be necessary.
+    void removeFrameEdgePoints(t_opencv_int_contour &contour) const
+    {
+        const int max_x = frameWidth - 1;
+        const int max_y = frameHeight - 1;
+
+        contour.erase(
+            std::remove_if(
+                contour.begin(), contour.end(),
+                [max_x, max_y](const cv::Point &p) {
+                    return p.x == 0 || p.x == max_x || p.y == 0 || p.y == max_y;
+            }),
+            contour.end());
+    }
+
+public:
     void
     draw_contour(const t_opencv_int_contour &contour)
     {
+        if (!bOverlayEnabled)
+        {
+            return;
+        }
+
         // Draws the contour directly onto the shared mem buffer.
         // This is useful for debugging
         std::vector<t_opencv_int_contour> contours = {contour};
@@ -621,6 +892,11 @@ public:
     void
     draw_pose_projection(const CommonDeviceTrackingProjection &pose_projection)
     {
+        if (!bOverlayEnabled)
+        {
+            return;
+        }
+
         // Draw the projection of the pose onto the shared mem buffer.
         switch (pose_projection.shape_type)
         {
@@ -698,8 +974,9 @@ public:
     int frameWidth;
     int frameHeight;
 
-    cv::Mat *bgrBuffer; // source video frame
+    cv::Mat *bgrBuffer; // source video frame (wraps the camera's frame buffer)
     cv::Mat *bgrShmemBuffer; //Frame onto which we draw debug lines, and transmit via shared mem.
+    bool bOverlayEnabled; // bgrShmemBuffer holds the current frame and debug lines get drawn on it
     cv::Mat bgrROI;
     cv::Mat *hsvBuffer; // source frame converted to HSV color space
     cv::Mat hsvROI;
@@ -709,6 +986,156 @@ public:
     cv::Mat gsUpperROI;
     cv::Mat *maskedBuffer; // bgr image ANDed together with grayscale mask
     OpenCVBGRToHSVMapper *bgr2hsv; // Used to convert an rgb image to an hsv image
+    bool bUseFusedHSVThreshold; // Threshold straight from bgrROI, skipping hsvBuffer and gsUpperBuffer
+    bool bUseIntegerHSVConverter; // Table-free replacement for bgr2hsv with identical output
+    cv::Mat *colorBitsBuffer; // bitmask of the tracking colors each pixel matches
+    cv::Mat colorBitsROI;
+    HSVColorClassificationTable *colorClassificationTable; // Maps a bgr color to a tracking color bitmask
+    TrackerBlobExtractor *blobExtractor; // Replaces findContours on the whole mask when set
+    CommonHSVColorRange classifiedColorRanges[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+    bool bClassifiedColorUsed[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+    OpenCVColorSegmentation colorSegmentations[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES]; // blobs found in the current frame
+    bool bFrameSegmented;
+};
+
+// Runs a job on a dedicated thread each time it is signaled.
+// The owner blocks in waitForJob() until the job started by beginJob() has finished.
+class TrackerWorkerThread
+{
+public:
+    TrackerWorkerThread(const std::string &thread_name, std::function<void()> job)
+        : m_thread_name(thread_name)
+        , m_job(job)
+        , m_exit_signaled(false)
+        , m_job_pending(false)
+    {
+    }
+
+    virtual ~TrackerWorkerThread()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        if (!m_thread.joinable())
+        {
+            m_exit_signaled = false;
+            m_job_pending = false;
+            m_thread = std::thread(&TrackerWorkerThread::thread_func, this);
+        }
+    }
+
+    void stop()
+    {
+        if (m_thread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exit_signaled = true;
+            }
+            m_job_requested_cv.notify_one();
+            m_thread.join();
+
+            // Release anyone still waiting on a job that will never run
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_job_pending = false;
+            }
+            m_job_finished_cv.notify_all();
+        }
+    }
+
+    void beginJob()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job_pending = true;
+        }
+        m_job_requested_cv.notify_one();
+    }
+
+    void waitForJob()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_job_finished_cv.wait(lock, [this] { return !m_job_pending; });
+    }
+
+protected:
+    void thread_func()
+    {
+        ServerUtility::set_current_thread_name(m_thread_name.c_str());
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            m_job_requested_cv.wait(lock, [this] { return m_job_pending || m_exit_signaled; });
+
+            if (m_exit_signaled)
+            {
+                break;
+            }
+
+            lock.unlock();
+            m_job();
+            lock.lock();
+
+            m_job_pending = false;
+            m_job_finished_cv.notify_all();
+        }
+    }
+
+private:
+    std::string m_thread_name;
+    std::function<void()> m_job;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_job_requested_cv;
+    std::condition_variable m_job_finished_cv;
+    bool m_exit_signaled;
+    bool m_job_pending;
+};
+
+// Output of one run of ServerTrackerView::process_video_frame().
+// Only touched by the worker between beginJob() and waitForJob(),
+// and only by the main thread outside of that window.
+struct TrackerWorkerResults
+{
+    // Set by the main thread before the job starts (not reset by clear())
+    bool bWantsVideoOverlay;
+
+    IDeviceInterface::ePollResult poll_result;
+    bool bHasPollResult;
+    bool bWroteVideoFrame;
+    bool bDroppedVideoFrame;
+
+    ControllerOpticalPoseEstimation controller_pose_estimates[ControllerManager::k_max_devices];
+    bool bControllerProjectionComputed[ControllerManager::k_max_devices];
+    bool bControllerProjectionValid[ControllerManager::k_max_devices];
+
+    HMDOpticalPoseEstimation hmd_pose_estimates[HMDManager::k_max_devices];
+    bool bHMDProjectionComputed[HMDManager::k_max_devices];
+    bool bHMDProjectionValid[HMDManager::k_max_devices];
+
+    void clear()
+    {
+        poll_result = IDeviceInterface::_PollResultFailure;
+        bHasPollResult = false;
+        bWroteVideoFrame = false;
+        bDroppedVideoFrame = false;
+
+        for (int controller_id = 0; controller_id < ControllerManager::k_max_devices; ++controller_id)
+        {
+            bControllerProjectionComputed[controller_id] = false;
+            bControllerProjectionValid[controller_id] = false;
+        }
+
+        for (int hmd_id = 0; hmd_id < HMDManager::k_max_devices; ++hmd_id)
+        {
+            bHMDProjectionComputed[hmd_id] = false;
+            bHMDProjectionValid[hmd_id] = false;
+        }
+    }
 };
 
 // -- Utility Methods -----
@@ -774,14 +1201,29 @@ ServerTrackerView::ServerTrackerView(const int device_id)
     : ServerDeviceView(device_id)
     , m_shared_memory_accesor(nullptr)
     , m_shared_memory_video_stream_count(0)
+    , m_video_stream_frame_counter(0)
     , m_opencv_buffer_state(nullptr)
+    , m_worker_thread(nullptr)
+    , m_worker_results(nullptr)
+    , m_worker_job_started(false)
     , m_device(nullptr)
 {
     ServerUtility::format_string(m_shared_memory_name, sizeof(m_shared_memory_name), "tracker_view_%d", device_id);
+    memset(m_pinhole_matrix, 0, sizeof(m_pinhole_matrix));
 }
 
 ServerTrackerView::~ServerTrackerView()
 {
+    if (m_worker_thread != nullptr)
+    {
+        delete m_worker_thread;
+    }
+
+    if (m_worker_results != nullptr)
+    {
+        delete m_worker_results;
+    }
+
     if (m_shared_memory_accesor != nullptr)
     {
         delete m_shared_memory_accesor;
@@ -822,14 +1264,17 @@ ServerTrackerView::getSharedMemoryStreamName() const
     return std::string(m_shared_memory_name);
 }
 
-bool ServerTrackerView::open(const class DeviceEnumerator *enumerator)
+bool ServerTrackerView::adopt(IDeviceInterface *opened_device)
 {
-    bool bSuccess = ServerDeviceView::open(enumerator);
+    bool bSuccess = ServerDeviceView::adopt(opened_device);
 
     if (bSuccess)
     {
         int width, height, stride;
 
+        // The tracker pose and intrinsics have been loaded from the tracker config
+        update_pinhole_matrix();
+
         // Make sure the shared memory block has been removed first
         boost::interprocess::shared_memory_object::remove(m_shared_memory_name);
 
@@ -849,6 +1294,21 @@ bool ServerTrackerView::open(const class DeviceEnumerator *enumerator)
 
             // Allocate the OpenCV scratch buffers used for finding tracking blobs
             m_opencv_buffer_state = new OpenCVBufferState(m_device);
+
+            // Optionally move video frame polling and blob finding onto a worker thread
+            const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+            if (cfg.use_tracker_worker_threads)
+            {
+                char thread_name[32];
+                ServerUtility::format_string(thread_name, sizeof(thread_name), "TrackerWorker%d", getDeviceID());
+
+                m_worker_results = new TrackerWorkerResults;
+                m_worker_results->clear();
+                m_worker_results->bWantsVideoOverlay = false;
+                m_worker_thread = new TrackerWorkerThread(thread_name, [this] { process_video_frame(); });
+                m_worker_thread->start();
+                m_worker_job_started = false;
+            }
         }
         else
         {
@@ -861,54 +1321,269 @@ bool ServerTrackerView::open(const class DeviceEnumerator *enumerator)
 
 void ServerTrackerView::close()
 {
+    // Stop the worker thread before the device it polls goes away
+    if (m_worker_thread != nullptr)
+    {
+        delete m_worker_thread;
+        m_worker_thread = nullptr;
+        m_worker_job_started = false;
+    }
+
+    if (m_worker_results != nullptr)
+    {
+        delete m_worker_results;
+        m_worker_results = nullptr;
+    }
+
     if (m_shared_memory_accesor != nullptr)
     {
         delete m_shared_memory_accesor;
         m_shared_memory_accesor = nullptr;
     }
 
-    ServerDeviceView::close();
-}
+    ServerDeviceView::close();
+}
+
+void ServerTrackerView::startSharedMemoryVideoStream()
+{
+    // Make sure the first subscriber gets the very next frame
+    if (m_shared_memory_video_stream_count == 0)
+    {
+        m_video_stream_frame_counter = 0;
+    }
+
+    ++m_shared_memory_video_stream_count;
+}
+
+void ServerTrackerView::stopSharedMemoryVideoStream()
+{
+    assert(m_shared_memory_video_stream_count > 0);
+    --m_shared_memory_video_stream_count;
+}
+
+void ServerTrackerView::startVideoFrameProcessing()
+{
+    if (m_worker_thread != nullptr && !m_worker_job_started)
+    {
+        // Decide on the overlay here so the worker never touches the video stream state
+        m_worker_results->bWantsVideoOverlay = get_wants_video_overlay();
+        m_worker_thread->beginJob();
+        m_worker_job_started = true;
+    }
+}
+
+bool ServerTrackerView::poll()
+{
+    if (m_worker_thread != nullptr)
+    {
+        bool bSuccess = true;
+
+        // The worker thread already polled the device and cached the video frame.
+        // Apply the poll result on this thread since it may close the device.
+        if (m_worker_job_started)
+        {
+            m_worker_thread->waitForJob();
+            m_worker_job_started = false;
+
+            if (m_worker_results->bWroteVideoFrame)
+            {
+                advance_video_stream_frame_counter();
+            }
+            else if (m_worker_results->bDroppedVideoFrame)
+            {
+                handle_dropped_video_frame();
+            }
+
+            if (m_worker_results->bHasPollResult)
+            {
+                bSuccess = handle_poll_result(m_worker_results->poll_result);
+            }
+        }
+
+        return bSuccess;
+    }
+
+    bool bSuccess = true;
+
+    if (m_device != nullptr && m_device->getIsReadyToPoll())
+    {
+        IDeviceInterface::ePollResult poll_result = m_device->poll();
+
+        if (poll_result == IDeviceInterface::_PollResultSuccessNewData)
+        {
+            if (write_video_frame(get_wants_video_overlay()))
+            {
+                advance_video_stream_frame_counter();
+            }
+            else
+            {
+                // Nothing usable to track in
+                poll_result = IDeviceInterface::_PollResultSuccessNoData;
+                handle_dropped_video_frame();
+            }
+        }
+
+        bSuccess = handle_poll_result(poll_result);
+    }
+
+    return bSuccess;
+}
+
+bool ServerTrackerView::write_video_frame(bool bDrawOverlay)
+{
+    int width, height, stride;
+    const unsigned char *buffer = m_device->acquireVideoFrameBuffer(&width, &height, &stride);
+
+    if (buffer == nullptr || m_opencv_buffer_state == nullptr)
+    {
+        return false;
+    }
+
+    // Cache the raw video frame.
+    // A frame captured before a resize doesn't fit the buffers, so it gets dropped.
+    return m_opencv_buffer_state->writeVideoFrame(buffer, width, height, stride, bDrawOverlay);
+}
+
+void ServerTrackerView::handle_dropped_video_frame()
+{
+    // Usually the frame was just captured before a resize and the next one will fit.
+    // But the camera can also settle on a different size than was asked for,
+    // in which case the buffers have to follow it.
+    int width, height;
+
+    if (m_opencv_buffer_state != nullptr &&
+        m_device->getVideoFrameDimensions(&width, &height, nullptr) &&
+        (width != m_opencv_buffer_state->frameWidth || height != m_opencv_buffer_state->frameHeight))
+    {
+        SERVER_LOG_INFO("ServerTrackerView::handle_dropped_video_frame") << "Tracker(" << getDeviceID()
+            << ") video frame size changed to " << width << "x" << height << ". Reallocating video buffers.";
+        reallocate_video_frame_buffers();
+    }
+}
+
+void ServerTrackerView::process_video_frame()
+{
+    // Runs on the worker thread while the main thread is blocked in TrackerManager::poll_devices()
+    m_worker_results->clear();
+
+    if (m_device == nullptr || !m_device->getIsReadyToPoll())
+    {
+        return;
+    }
+
+    m_worker_results->poll_result = m_device->poll();
+    m_worker_results->bHasPollResult = true;
+
+    if (m_worker_results->poll_result != IDeviceInterface::_PollResultSuccessNewData)
+    {
+        return;
+    }
+
+    if (!write_video_frame(m_worker_results->bWantsVideoOverlay))
+    {
+        // Nothing usable to track in
+        m_worker_results->poll_result = IDeviceInterface::_PollResultSuccessNoData;
+        m_worker_results->bDroppedVideoFrame = true;
+        return;
+    }
+    m_worker_results->bWroteVideoFrame = true;
+
+    // Find the blobs of every tracked device in one pass over the frame
+    update_frame_segmentation();
+
+    // Find the projection of every tracked controller in the new frame
+    ControllerManager *controller_manager = DeviceManager::getInstance()->m_controller_manager;
+    for (int controller_id = 0; controller_id < controller_manager->getMaxDevices(); ++controller_id)
+    {
+        ServerControllerViewPtr controller_view = controller_manager->getControllerViewPtr(controller_id);
+        CommonDeviceTrackingShape tracking_shape;
+
+        if (controller_view->getIsOpen() &&
+            controller_view->getIsTrackingEnabled() &&
+            controller_view->getTrackingShape(tracking_shape))
+        {
+            ControllerOpticalPoseEstimation &pose_estimate = m_worker_results->controller_pose_estimates[controller_id];
+
+            pose_estimate = *controller_view->getTrackerPoseEstimate(getDeviceID());
+            m_worker_results->bControllerProjectionValid[controller_id] =
+                computeProjectionForController(controller_view.get(), &tracking_shape, &pose_estimate);
+            m_worker_results->bControllerProjectionComputed[controller_id] = true;
+        }
+    }
+
+    // Same for every tracked HMD
+    HMDManager *hmd_manager = DeviceManager::getInstance()->m_hmd_manager;
+    for (int hmd_id = 0; hmd_id < hmd_manager->getMaxDevices(); ++hmd_id)
+    {
+        ServerHMDViewPtr hmd_view = hmd_manager->getHMDViewPtr(hmd_id);
+        CommonDeviceTrackingShape tracking_shape;
+
+        if (hmd_view->getIsOpen() &&
+            hmd_view->getIsTrackingEnabled() &&
+            hmd_view->getTrackingShape(tracking_shape))
+        {
+            HMDOpticalPoseEstimation &pose_estimate = m_worker_results->hmd_pose_estimates[hmd_id];
+
+            pose_estimate = *hmd_view->getTrackerPoseEstimate(getDeviceID());
+            m_worker_results->bHMDProjectionValid[hmd_id] =
+                computeProjectionForHMD(hmd_view.get(), &tracking_shape, &pose_estimate);
+            m_worker_results->bHMDProjectionComputed[hmd_id] = true;
+        }
+    }
+}
+
+bool ServerTrackerView::get_wants_video_overlay() const
+{
+    // The debug overlay is only drawn and published while a client is watching the video stream,
+    // and then only every Nth frame
+    if (m_shared_memory_video_stream_count <= 0 || m_shared_memory_accesor == nullptr)
+    {
+        return false;
+    }
+
+    const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+    const int frame_interval = std::max(cfg.video_stream_frame_interval, 1);
 
-void ServerTrackerView::startSharedMemoryVideoStream()
-{
-    ++m_shared_memory_video_stream_count;
+    return (m_video_stream_frame_counter % frame_interval) == 0;
 }
 
-void ServerTrackerView::stopSharedMemoryVideoStream()
+void ServerTrackerView::advance_video_stream_frame_counter()
 {
-    assert(m_shared_memory_video_stream_count > 0);
-    --m_shared_memory_video_stream_count;
+    if (m_shared_memory_video_stream_count <= 0 || m_shared_memory_accesor == nullptr)
+    {
+        return;
+    }
+
+    const TrackerManagerConfig &cfg= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+    const int frame_interval = std::max(cfg.video_stream_frame_interval, 1);
+
+    m_video_stream_frame_counter = (m_video_stream_frame_counter + 1) % frame_interval;
 }
 
-bool ServerTrackerView::poll()
+IDeviceInterface *ServerTrackerView::allocate_device_interface(const class DeviceEnumerator *enumerator) const
 {
-    bool bSuccess = ServerDeviceView::poll();
+    ITrackerInterface *device = nullptr;
 
-    if (bSuccess && m_device != nullptr)
+    switch (enumerator->get_device_type())
     {
-        const unsigned char *buffer = m_device->getVideoFrameBuffer();
-
-        if (buffer != nullptr)
-        {
-            // Cache the raw video frame
-            if (m_opencv_buffer_state != nullptr)
-            {
-                m_opencv_buffer_state->writeVideoFrame(buffer);
-            }
-        }
+    case CommonDeviceState::PS3EYE:
+    {
+        device = new PS3EyeTracker();
+    } break;
+    default:
+        break;
     }
 
-    return bSuccess;
+    return device;
 }
 
-bool ServerTrackerView::allocate_device_interface(const class DeviceEnumerator *enumerator)
+bool ServerTrackerView::attach_device_interface(IDeviceInterface *device)
 {
-    switch (enumerator->get_device_type())
+    switch (device->getDeviceType())
     {
     case CommonDeviceState::PS3EYE:
     {
-        m_device = new PS3EyeTracker();
+        m_device = static_cast<ITrackerInterface *>(device);
     } break;
     default:
         break;
@@ -931,8 +1606,9 @@ void ServerTrackerView::free_device_interface()
 
 void ServerTrackerView::publish_device_data_frame()
 {
-    // Copy the video frame to shared memory (if requested)
-    if (m_shared_memory_accesor != nullptr && m_shared_memory_video_stream_count > 0)
+    // Copy the video frame to shared memory (if requested and the overlay was drawn this frame)
+    if (m_shared_memory_accesor != nullptr && m_shared_memory_video_stream_count > 0 &&
+        m_opencv_buffer_state != nullptr && m_opencv_buffer_state->getIsOverlayEnabled())
     {
         m_shared_memory_accesor->writeVideoFrame(m_opencv_buffer_state->bgrShmemBuffer->data);
     }
@@ -971,6 +1647,7 @@ void ServerTrackerView::generate_tracker_data_frame_for_stream(
 void ServerTrackerView::loadSettings()
 {
     m_device->loadSettings();
+    update_pinhole_matrix();
 }
 
 void ServerTrackerView::saveSettings()
@@ -987,6 +1664,14 @@ void ServerTrackerView::setFrameWidth(double value, bool bUpdateConfig)
 {
     if (value == m_device->getFrameWidth()) return;
 
+    // change frame width
+    m_device->setFrameWidth(value, bUpdateConfig);
+
+    reallocate_video_frame_buffers();
+}
+
+void ServerTrackerView::reallocate_video_frame_buffers()
+{
     // close buffer
     if (m_shared_memory_accesor != nullptr)
     {
@@ -994,8 +1679,11 @@ void ServerTrackerView::setFrameWidth(double value, bool bUpdateConfig)
         m_shared_memory_accesor = nullptr;
     }
 
-    // change frame width
-    m_device->setFrameWidth(value, bUpdateConfig);
+    if (m_opencv_buffer_state != nullptr)
+    {
+        delete m_opencv_buffer_state;
+        m_opencv_buffer_state = nullptr;
+    }
 
     // reopen buffer
     int width, height, stride;
@@ -1014,7 +1702,7 @@ void ServerTrackerView::setFrameWidth(double value, bool bUpdateConfig)
             delete m_shared_memory_accesor;
             m_shared_memory_accesor = nullptr;
 
-            SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to allocated shared memory: " << m_shared_memory_name;
+            SERVER_LOG_ERROR("ServerTrackerView::reallocate_video_frame_buffers()") << "Failed to allocated shared memory: " << m_shared_memory_name;
         }
 
         // Allocate the OpenCV scratch buffers used for finding tracking blobs
@@ -1022,7 +1710,7 @@ void ServerTrackerView::setFrameWidth(double value, bool bUpdateConfig)
     }
     else
     {
-        SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to video frame dimensions";
+        SERVER_LOG_ERROR("ServerTrackerView::reallocate_video_frame_buffers()") << "Failed to video frame dimensions";
     }
 }
 
@@ -1035,43 +1723,10 @@ void ServerTrackerView::setFrameHeight(double value, bool bUpdateConfig)
 {
     if (value == m_device->getFrameHeight()) return;
 
-    // close buffer
-    if (m_shared_memory_accesor != nullptr)
-    {
-        delete m_shared_memory_accesor;
-        m_shared_memory_accesor = nullptr;
-    }
-
     // change frame height
     m_device->setFrameHeight(value, bUpdateConfig);
 
-    // reopen buffer
-    int width, height, stride;
-
-    // Make sure the shared memory block has been removed first
-    boost::interprocess::shared_memory_object::remove(m_shared_memory_name);
-
-    // Query the video frame first so that we know how big to make the buffer
-    if (m_device->getVideoFrameDimensions(&width, &height, &stride))
-    {
-        assert(m_shared_memory_accesor == nullptr);
-        m_shared_memory_accesor = new SharedVideoFrameReadWriteAccessor();
-
-        if (!m_shared_memory_accesor->initialize(m_shared_memory_name, width, height, stride))
-        {
-            delete m_shared_memory_accesor;
-            m_shared_memory_accesor = nullptr;
-
-            SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to allocated shared memory: " << m_shared_memory_name;
-        }
-
-        // Allocate the OpenCV scratch buffers used for finding tracking blobs
-        m_opencv_buffer_state = new OpenCVBufferState(m_device);
-    }
-    else
-    {
-        SERVER_LOG_ERROR("ServerTrackerView::open()") << "Failed to video frame dimensions";
-    }
+    reallocate_video_frame_buffers();
 }
 
 double ServerTrackerView::getFrameRate() const
@@ -1128,6 +1783,7 @@ void ServerTrackerView::setCameraIntrinsics(
         principalX, principalY,
         distortionK1, distortionK2, distortionK3,
         distortionP1, distortionP2);
+    update_pinhole_matrix();
 }
 
 CommonDevicePose ServerTrackerView::getTrackerPose() const
@@ -1139,6 +1795,7 @@ void ServerTrackerView::setTrackerPose(
     const struct CommonDevicePose *pose)
 {
     m_device->setTrackerPose(pose);
+    update_pinhole_matrix();
 }
 
 void ServerTrackerView::getPixelDimensions(float &outWidth, float &outHeight) const
@@ -1234,30 +1891,65 @@ void ServerTrackerView::getHMDTrackingColorPreset(
     return m_device->getTrackingColorPreset(hmd_id, color, out_preset);
 }
 
-bool
-ServerTrackerView::computeProjectionForController(
-    const ServerControllerView* tracked_controller,
-    const CommonDeviceTrackingShape *tracking_shape,
-    ControllerOpticalPoseEstimation *out_pose_estimate)
+void
+ServerTrackerView::update_frame_segmentation()
 {
-    bool bSuccess = true;
+    std::vector<OpenCVColorSegmentationRequest> requests;
 
-    // Get the HSV filter used to find the tracking blob
-    CommonHSVColorRange hsvColorRange;
-    if (bSuccess)
+    // Gather the tracking color and ROI of every tracked controller ...
+    ControllerManager *controller_manager = DeviceManager::getInstance()->m_controller_manager;
+    for (int controller_id = 0; controller_id < controller_manager->getMaxDevices(); ++controller_id)
     {
-        eCommonTrackingColorID tracked_color_id = tracked_controller->getTrackingColorID();
+        ServerControllerViewPtr controller_view = controller_manager->getControllerViewPtr(controller_id);
+        CommonDeviceTrackingShape tracking_shape;
+        OpenCVColorSegmentationRequest request;
 
-        if (tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
+        if (controller_view->getIsOpen() &&
+            controller_view->getIsTrackingEnabled() &&
+            controller_view->getTrackingShape(tracking_shape) &&
+            get_segmentation_request(controller_view.get(), &tracking_shape, &request))
         {
-            getControllerTrackingColorPreset(tracked_controller, tracked_color_id, &hsvColorRange);
+            requests.push_back(request);
         }
-        else
+    }
+
+    // ... and HMD
+    HMDManager *hmd_manager = DeviceManager::getInstance()->m_hmd_manager;
+    for (int hmd_id = 0; hmd_id < hmd_manager->getMaxDevices(); ++hmd_id)
+    {
+        ServerHMDViewPtr hmd_view = hmd_manager->getHMDViewPtr(hmd_id);
+        CommonDeviceTrackingShape tracking_shape;
+        OpenCVColorSegmentationRequest request;
+
+        if (hmd_view->getIsOpen() &&
+            hmd_view->getIsTrackingEnabled() &&
+            hmd_view->getTrackingShape(tracking_shape) &&
+            get_segmentation_request(hmd_view.get(), &tracking_shape, &request))
         {
-            bSuccess = false;
+            requests.push_back(request);
         }
     }
 
+    m_opencv_buffer_state->segmentFrame(requests);
+}
+
+bool
+ServerTrackerView::get_segmentation_request(
+    const ServerControllerView* tracked_controller,
+    const CommonDeviceTrackingShape *tracking_shape,
+    OpenCVColorSegmentationRequest *out_request) const
+{
+    const eCommonTrackingColorID tracked_color_id = tracked_controller->getTrackingColorID();
+
+    if (tracked_color_id == eCommonTrackingColorID::INVALID_COLOR)
+    {
+        return false;
+    }
+
+    // Get the HSV filter used to find the tracking blob
+    out_request->tracked_color_id = tracked_color_id;
+    getControllerTrackingColorPreset(tracked_controller, tracked_color_id, &out_request->hsvColorRange);
+
     // Compute a region of interest in the tracker buffer around where we expect to find the tracking shape
     const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
     const bool bRoiDisabled = tracked_controller->getIsROIDisabled() || trackerMgrConfig.disable_roi;
@@ -1266,21 +1958,166 @@ ServerTrackerView::computeProjectionForController(
         tracked_controller->getTrackerPoseEstimate(this->getDeviceID());
     const bool bIsTracking = priorPoseEst->bCurrentlyTracking;
 
-    cv::Rect2i ROI= computeTrackerROIForPoseProjection(
+    out_request->ROI= computeTrackerROIForPoseProjection(
         bRoiDisabled,
-        this,		
+        this,
         bIsTracking ? tracked_controller->getPoseFilter() : nullptr,
         bIsTracking ? &priorPoseEst->projection : nullptr,
         tracking_shape);
 
-    m_opencv_buffer_state->applyROI(ROI);
+    // Controllers are tracked from their single biggest blob
+    out_request->max_contour_count = 1;
+
+    return true;
+}
+
+bool
+ServerTrackerView::get_segmentation_request(
+    const ServerHMDView* tracked_hmd,
+    const CommonDeviceTrackingShape *tracking_shape,
+    OpenCVColorSegmentationRequest *out_request) const
+{
+    const eCommonTrackingColorID tracked_color_id = tracked_hmd->getTrackingColorID();
+
+    if (tracked_color_id == eCommonTrackingColorID::INVALID_COLOR)
+    {
+        return false;
+    }
+
+    // Get the HSV filter used to find the tracking blobs
+    out_request->tracked_color_id = tracked_color_id;
+    getHMDTrackingColorPreset(tracked_hmd, tracked_color_id, &out_request->hsvColorRange);
+
+    // Compute a region of interest in the tracker buffer around where we expect to find the tracking shape
+    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+    const bool bRoiDisabled = tracked_hmd->getIsROIDisabled() || trackerMgrConfig.disable_roi;
+
+    const HMDOpticalPoseEstimation *priorPoseEst= 
+        tracked_hmd->getTrackerPoseEstimate(this->getDeviceID());
+    const bool bIsTracking = priorPoseEst->bCurrentlyTracking;
+
+    out_request->ROI = computeTrackerROIForPoseProjection(
+        bRoiDisabled,
+        this, 
+        bIsTracking ? tracked_hmd->getPoseFilter() : nullptr,
+        bIsTracking ? &priorPoseEst->projection : nullptr,
+        tracking_shape);
+
+    // HMDs can be tracked from a cloud of blobs
+    out_request->max_contour_count = CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT;
+
+    return true;
+}
+
+const OpenCVColorSegmentation *
+ServerTrackerView::get_color_segmentation(const OpenCVColorSegmentationRequest *request)
+{
+    // Segment the frame for all tracked devices on the first request after a new frame
+    if (!m_opencv_buffer_state->getIsFrameSegmented())
+    {
+        update_frame_segmentation();
+    }
+
+    const OpenCVColorSegmentation *segmentation = 
+        m_opencv_buffer_state->getColorSegmentation(request->tracked_color_id);
+
+    // The device wasn't tracked when the frame was segmented
+    if (segmentation == nullptr)
+    {
+        m_opencv_buffer_state->segmentUnrequestedColor(*request);
+        segmentation = m_opencv_buffer_state->getColorSegmentation(request->tracked_color_id);
+    }
+
+    return segmentation;
+}
+
+void
+ServerTrackerView::update_pinhole_matrix()
+{
+    const cv::Matx34f pinhole_matrix = computeOpenCVCameraPinholeMatrix(m_device);
+
+    for (int row = 0; row < 3; ++row)
+    {
+        for (int col = 0; col < 4; ++col)
+        {
+            m_pinhole_matrix[row][col] = pinhole_matrix(row, col);
+        }
+    }
+}
+
+bool
+ServerTrackerView::fetchProjectionForController(
+    const ServerControllerView* tracked_controller,
+    const CommonDeviceTrackingShape *tracking_shape,
+    ControllerOpticalPoseEstimation *out_pose_estimate)
+{
+    const int controller_id = tracked_controller->getDeviceID();
+
+    if (m_worker_results != nullptr && 
+        controller_id >= 0 && controller_id < ControllerManager::k_max_devices &&
+        m_worker_results->bControllerProjectionComputed[controller_id])
+    {
+        if (m_worker_results->bControllerProjectionValid[controller_id])
+        {
+            *out_pose_estimate = m_worker_results->controller_pose_estimates[controller_id];
+            return true;
+        }
+
+        return false;
+    }
+
+    return computeProjectionForController(tracked_controller, tracking_shape, out_pose_estimate);
+}
+
+bool
+ServerTrackerView::fetchProjectionForHMD(
+    const ServerHMDView* tracked_hmd,
+    const CommonDeviceTrackingShape *tracking_shape,
+    HMDOpticalPoseEstimation *out_pose_estimate)
+{
+    const int hmd_id = tracked_hmd->getDeviceID();
+
+    if (m_worker_results != nullptr &&
+        hmd_id >= 0 && hmd_id < HMDManager::k_max_devices &&
+        m_worker_results->bHMDProjectionComputed[hmd_id])
+    {
+        if (m_worker_results->bHMDProjectionValid[hmd_id])
+        {
+            *out_pose_estimate = m_worker_results->hmd_pose_estimates[hmd_id];
+            return true;
+        }
+
+        return false;
+    }
+
+    return computeProjectionForHMD(tracked_hmd, tracking_shape, out_pose_estimate);
+}
+
+bool
+ServerTrackerView::computeProjectionForController(
+    const ServerControllerView* tracked_controller,
+    const CommonDeviceTrackingShape *tracking_shape,
+    ControllerOpticalPoseEstimation *out_pose_estimate)
+{
+    bool bSuccess = true;
+
+    // Get the tracking color and where to look for it in this frame
+    OpenCVColorSegmentationRequest segmentation_request;
+    bSuccess = get_segmentation_request(tracked_controller, tracking_shape, &segmentation_request);
+
+    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
+    const bool bRoiDisabled = tracked_controller->getIsROIDisabled() || trackerMgrConfig.disable_roi;
 
-    // Find the contour associated with the controller
+    // Select the contour associated with the controller from the blobs found this frame
+    cv::Rect2i ROI;
     t_opencv_int_contour_list biggest_contours;
-    std::vector<double> contour_areas;
     if (bSuccess)
     {
-        bSuccess = m_opencv_buffer_state->computeBiggestNContours(hsvColorRange, biggest_contours, contour_areas, 1);
+        const OpenCVColorSegmentation *segmentation = get_color_segmentation(&segmentation_request);
+
+        ROI = segmentation->ROI;
+        biggest_contours = segmentation->contours;
+        bSuccess = biggest_contours.size() > 0;
     }
     
     // Process the contour for its 2D and 3D pose.
@@ -1425,46 +2262,18 @@ bool ServerTrackerView::computeProjectionForHMD(
 {
     bool bSuccess = true;
 
-    // Get the HSV filter used to find the tracking blob
-    CommonHSVColorRange hsvColorRange;
-    if (bSuccess)
-    {
-        eCommonTrackingColorID tracked_color_id = tracked_hmd->getTrackingColorID();
-
-        if (tracked_color_id != eCommonTrackingColorID::INVALID_COLOR)
-        {
-            getHMDTrackingColorPreset(tracked_hmd, tracked_color_id, &hsvColorRange);
-        }
-        else
-        {
-            bSuccess = false;
-        }
-    }
-    
-    // Compute a region of interest in the tracker buffer around where we expect to find the tracking shape
-    const TrackerManagerConfig &trackerMgrConfig= DeviceManager::getInstance()->m_tracker_manager->getConfig();
-    const bool bRoiDisabled = tracked_hmd->getIsROIDisabled() || trackerMgrConfig.disable_roi;
-
-    const HMDOpticalPoseEstimation *priorPoseEst= 
-        tracked_hmd->getTrackerPoseEstimate(this->getDeviceID());
-    const bool bIsTracking = priorPoseEst->bCurrentlyTracking;
-
-    cv::Rect2i ROI = computeTrackerROIForPoseProjection(
-        bRoiDisabled,
-        this, 
-        bIsTracking ? tracked_hmd->getPoseFilter() : nullptr,
-        bIsTracking ? &priorPoseEst->projection : nullptr,
-        tracking_shape);
-    m_opencv_buffer_state->applyROI(ROI);
+    // Get the tracking color and where to look for it in this frame
+    OpenCVColorSegmentationRequest segmentation_request;
+    bSuccess = get_segmentation_request(tracked_hmd, tracking_shape, &segmentation_request);
 
-    // Find the N best contours associated with the HMD
+    // Select the N best contours associated with the HMD from the blobs found this frame
     t_opencv_int_contour_list biggest_contours;
-    std::vector<double> contour_areas;
     if (bSuccess)
     {
-        bSuccess = 
-            m_opencv_buffer_state->computeBiggestNContours(
-                hsvColorRange, biggest_contours, contour_areas, CommonDeviceTrackingProjection::MAX_POINT_CLOUD_POINT_COUNT);
+        const OpenCVColorSegmentation *segmentation = get_color_segmentation(&segmentation_request);
+
+        biggest_contours = segmentation->contours;
+        bSuccess = biggest_contours.size() > 0;
     }
 
     // Compute the tracker relative 3d position of the controller from the contour
@@ -1861,11 +2670,11 @@ ServerTrackerView::triangulateWorldPosition(
     cv::Mat projPoints1 = cv::Mat(cv::Point2f(screen_location->x, screen_location->y));
     cv::Mat projPoints2 = cv::Mat(cv::Point2f(other_screen_location->x, other_screen_location->y));
 
-    // Compute the pinhole camera matrix for each tracker that allows you to raycast
+    // Fetch the pinhole camera matrix for each tracker that allows you to raycast
     // from the tracker center in world space through the screen location, into the world
     // See: http://docs.opencv.org/2.4/modules/calib3d/doc/camera_calibration_and_3d_reconstruction.html
-    cv::Mat projMat1 = cv::Mat(computeOpenCVCameraPinholeMatrix(tracker->m_device));
-    cv::Mat projMat2 = cv::Mat(computeOpenCVCameraPinholeMatrix(other_tracker->m_device));
+    cv::Mat projMat1 = cv::Mat(cv::Matx34f(&tracker->m_pinhole_matrix[0][0]));
+    cv::Mat projMat2 = cv::Mat(cv::Matx34f(&other_tracker->m_pinhole_matrix[0][0]));
 
     // Triangulate the world position from the two cameras
     cv::Mat point3D(1, 1, CV_32FC4);
@@ -1907,11 +2716,11 @@ ServerTrackerView::triangulateWorldPositions(
         projPoints2.push_back(cv::Point2f(p2.x, p2.y));
     }
 
-    // Compute the pinhole camera matrix for each tracker that allows you to raycast
+    // Fetch the pinhole camera matrix for each tracker that allows you to raycast
     // from the tracker center in world space through the screen location, into the world
     // See: http://docs.opencv.org/2.4/modules/calib3d/doc/camera_calibration_and_3d_reconstruction.html
-    cv::Mat projMat1 = cv::Mat(computeOpenCVCameraPinholeMatrix(tracker->m_device));
-    cv::Mat projMat2 = cv::Mat(computeOpenCVCameraPinholeMatrix(other_tracker->m_device));
+    cv::Mat projMat1 = cv::Mat(cv::Matx34f(&tracker->m_pinhole_matrix[0][0]));
+    cv::Mat projMat2 = cv::Mat(cv::Matx34f(&other_tracker->m_pinhole_matrix[0][0]));
 
     // Triangulate the world positions from the two cameras
     cv::Mat points3D(1, screen_location_count, CV_32FC4);
@@ -1929,6 +2738,43 @@ ServerTrackerView::triangulateWorldPositions(
     }
 }
 
+bool
+ServerTrackerView::triangulateWorldPositionFromMultipleTrackers(
+    const ServerTrackerView * const *trackers,
+    const CommonDeviceScreenLocation *screen_locations,
+    const float *weights,
+    const int tracker_count,
+    CommonDevicePosition *out_result)
+{
+    assert(tracker_count <= TrackerManager::k_max_devices);
+
+    // Fixed size scratch so the solve never touches the heap
+    Eigen::Matrix<float, 3, 4> pinhole_matrices[TrackerManager::k_max_devices];
+    Eigen::Vector2f eigen_screen_locations[TrackerManager::k_max_devices];
+    for (int tracker_index = 0; tracker_index < tracker_count; ++tracker_index)
+    {
+        const CommonDeviceScreenLocation &screen_location = screen_locations[tracker_index];
+
+        pinhole_matrices[tracker_index] =
+            Eigen::Map<const Eigen::Matrix<float, 3, 4, Eigen::RowMajor> >(&trackers[tracker_index]->m_pinhole_matrix[0][0]);
+        eigen_screen_locations[tracker_index] = Eigen::Vector2f(screen_location.x, screen_location.y);
+    }
+
+    Eigen::Vector3f world_position;
+    const bool bSuccess =
+        eigen_alignment_triangulate_weighted_point(
+            pinhole_matrices, eigen_screen_locations, weights, tracker_count, &world_position);
+
+    if (bSuccess)
+    {
+        out_result->x = world_position.x();
+        out_result->y = world_position.y();
+        out_result->z = world_position.z();
+    }
+
+    return bSuccess;
+}
+
 
 std::vector<CommonDeviceScreenLocation>
 ServerTrackerView::projectTrackerRelativePositions(const std::vector<CommonDevicePosition> &objectPositions) const
@@ -2629,6 +3475,58 @@ static bool computeBestFitQuadForContour(
     return true;
 }
 
+static void computeDisjointRectCover(const std::vector<cv::Rect2i> &rects, std::vector<cv::Rect2i> &out_cover)
+{
+    out_cover.clear();
+
+    // Split the rects into horizontal bands at every top and bottom edge.
+    // Within a band every rect spans all rows, so the cover is the merged x-intervals.
+    std::vector<int> band_edges;
+    for (const cv::Rect2i &rect : rects)
+    {
+        if (rect.width > 0 && rect.height > 0)
+        {
+            band_edges.push_back(rect.y);
+            band_edges.push_back(rect.y + rect.height);
+        }
+    }
+    std::sort(band_edges.begin(), band_edges.end());
+    band_edges.erase(std::unique(band_edges.begin(), band_edges.end()), band_edges.end());
+
+    std::vector<std::pair<int, int> > intervals;
+    for (size_t band_index = 1; band_index < band_edges.size(); ++band_index)
+    {
+        const int band_top = band_edges[band_index - 1];
+        const int band_bottom = band_edges[band_index];
+
+        intervals.clear();
+        for (const cv::Rect2i &rect : rects)
+        {
+            if (rect.width > 0 && rect.y <= band_top && rect.y + rect.height >= band_bottom)
+            {
+                intervals.push_back(std::make_pair(rect.x, rect.x + rect.width));
+            }
+        }
+        std::sort(intervals.begin(), intervals.end());
+
+        size_t interval_index = 0;
+        while (interval_index < intervals.size())
+        {
+            const int x0 = intervals[interval_index].first;
+            int x1 = intervals[interval_index].second;
+
+            for (++interval_index; 
+                interval_index < intervals.size() && intervals[interval_index].first <= x1; 
+                ++interval_index)
+            {
+                x1 = std::max(x1, intervals[interval_index].second);
+            }
+
+            out_cover.push_back(cv::Rect2i(x0, band_top, x1 - x0, band_bottom - band_top));
+        }
+    }
+}
+
 template<typename t_opencv_contour_type>
 cv::Point2f computeSafeCenterOfMassForContour(const t_opencv_contour_type &contour)
 {
@@ -20,9 +20,11 @@ public:
     ServerTrackerView(const int device_id);
     ~ServerTrackerView();
 
-    bool open(const class DeviceEnumerator *enumerator) override;
+    bool adopt(IDeviceInterface *opened_device) override;
     void close() override;
 
+    IDeviceInterface *allocate_device_interface(const class DeviceEnumerator *enumerator) const override;
+
     // Starts or stops streaming of the video feed to the shared memory buffer.
     // Keep a ref count of how many clients are following the stream.
     void startSharedMemoryVideoStream();
@@ -31,6 +33,11 @@ public:
     // Fetch the next video frame and copy to shared memory
     bool poll() override;
 
+    // Signals the tracker worker thread (if any) to poll the next video frame
+    // and compute projections for all tracked devices.
+    // The results are collected by the following call to poll().
+    void startVideoFrameProcessing();
+
     IDeviceInterface* getDevice() const override {return m_device;}
 
     // Returns what type of tracker this tracker view represents
@@ -71,6 +78,18 @@ public:
 		const class ServerHMDView* tracked_hmd,
 		const struct CommonDeviceTrackingShape *tracking_shape,
 		struct HMDOpticalPoseEstimation *out_pose_estimate);
+
+    // Returns the projection computed by the tracker worker thread this frame,
+    // or computes it on the calling thread if there is no worker thread.
+    bool fetchProjectionForController(
+        const class ServerControllerView* tracked_controller, 
+		const struct CommonDeviceTrackingShape *tracking_shape,
+        struct ControllerOpticalPoseEstimation *out_pose_estimate);
+    bool fetchProjectionForHMD(
+		const class ServerHMDView* tracked_hmd,
+		const struct CommonDeviceTrackingShape *tracking_shape,
+		struct HMDOpticalPoseEstimation *out_pose_estimate);
+
     bool computePoseForProjection(
 		const struct CommonDeviceTrackingProjection *projection,
 		const struct CommonDeviceTrackingShape *tracking_shape,
@@ -102,6 +121,16 @@ public:
 		const int screen_location_count,
 		CommonDevicePosition *out_result);
 
+    /// Given a screen location of the same point on any number of trackers, compute the world space location
+    /// that best fits all of them, weighting each tracker by its weight (e.g. projection area).
+    /// Returns false if the trackers don't pin down a single point.
+    static bool triangulateWorldPositionFromMultipleTrackers(
+        const ServerTrackerView * const *trackers,
+        const CommonDeviceScreenLocation *screen_locations,
+        const float *weights,
+        const int tracker_count,
+        CommonDevicePosition *out_result);
+
     /// Given screen projections on two different trackers, compute the triangulated world space location
     static CommonDevicePose triangulateWorldPose(
         const ServerTrackerView *tracker, const CommonDeviceTrackingProjection *tracker_relative_projection,
@@ -139,7 +168,7 @@ public:
 	void getHMDTrackingColorPreset(const class ServerHMDView *controller, eCommonTrackingColorID color, CommonHSVColorRange *out_preset) const;
 
 protected:
-    bool allocate_device_interface(const class DeviceEnumerator *enumerator) override;
+    bool attach_device_interface(IDeviceInterface *device) override;
     void free_device_interface() override;
     void publish_device_data_frame() override;
     static void generate_tracker_data_frame_for_stream(
@@ -147,11 +176,40 @@ protected:
         DeviceOutputDataFramePtr &data_frame);
 
 private:
+    void process_video_frame();
+    bool write_video_frame(bool bDrawOverlay);
+    void handle_dropped_video_frame();
+    void reallocate_video_frame_buffers();
+    bool get_wants_video_overlay() const;
+    void advance_video_stream_frame_counter();
+
+    // Finds the blobs of every tracked device in the current frame in a single pass.
+    // Projections then just select and fit the blobs for their tracking color.
+    void update_frame_segmentation();
+    bool get_segmentation_request(
+        const class ServerControllerView* tracked_controller,
+        const struct CommonDeviceTrackingShape *tracking_shape,
+        struct OpenCVColorSegmentationRequest *out_request) const;
+    bool get_segmentation_request(
+        const class ServerHMDView* tracked_hmd,
+        const struct CommonDeviceTrackingShape *tracking_shape,
+        struct OpenCVColorSegmentationRequest *out_request) const;
+    const struct OpenCVColorSegmentation *get_color_segmentation(
+        const struct OpenCVColorSegmentationRequest *request);
+
+    // Recomputes the cached world to screen pinhole matrix after the pose or intrinsics change
+    void update_pinhole_matrix();
+
     char m_shared_memory_name[256];
     class SharedVideoFrameReadWriteAccessor *m_shared_memory_accesor;
     int m_shared_memory_video_stream_count;
+    int m_video_stream_frame_counter; // Main thread only, the worker gets the overlay decision in TrackerWorkerResults
     class OpenCVBufferState *m_opencv_buffer_state;
+    class TrackerWorkerThread *m_worker_thread;
+    struct TrackerWorkerResults *m_worker_results;
+    bool m_worker_job_started;
     ITrackerInterface *m_device;
+    float m_pinhole_matrix[3][4]; // Row major
 };
 
 #endif // SERVER_TRACKER_VIEW_H
@@ -1,6 +1,8 @@
 //-- includes --
 #include "KalmanPoseFilter.h"
 #include "MathAlignment.h"
+#include <Eigen/Eigenvalues>
+#include <cmath>
 #include <iostream>
 
 // The kalman filter runs way to slow in a fully unoptimized build.
@@ -103,92 +105,143 @@ enum DS4MeasurementEnum {
 #define k_ukf_beta 2.0
 #define k_ukf_kappa 3 - STATE_PARAMETER_COUNT
 
+
 //-- private methods ---
 void process_3rd_order_noise(
-	const double dT, const double var, const int state_index, 
+	const double dT, const double var, const int state_index,
 	Eigen::Matrix<double, NOISE_PARAMETER_COUNT, NOISE_PARAMETER_COUNT> &Q);
 
 void process_2nd_order_noise(
-	const double dT, const double var, const int state_index, 
+	const double dT, const double var, const int state_index,
 	Eigen::Matrix<double, NOISE_PARAMETER_COUNT, NOISE_PARAMETER_COUNT> &Q);
 
+static float eigen_vector3_normalize_with_default(Eigen::Vector3f &v, const Eigen::Vector3f &default_result);
+static double eigen_vector3_normalize_with_default(Eigen::Vector3d &v, const Eigen::Vector3d &default_result);
+
+// The helpers below work on a whole block of sigma points at once, one point per row.
+// Quaternion rows are stored as [w x y z] columns.
+template <typename DerivedX, typename DerivedY, typename DerivedZ, typename DerivedOut>
+static void angle_axis_rows_to_quaternion_rows(
+	const Eigen::MatrixBase<DerivedX> &angle_axis_x,
+	const Eigen::MatrixBase<DerivedY> &angle_axis_y,
+	const Eigen::MatrixBase<DerivedZ> &angle_axis_z,
+	const typename DerivedOut::Scalar scale,
+	const Eigen::MatrixBase<DerivedOut> &out_quaternions);
+
+template <typename DerivedQuaternion, typename DerivedX, typename DerivedY, typename DerivedZ>
+static void quaternion_rows_to_angle_axis_rows(
+	const Eigen::MatrixBase<DerivedQuaternion> &quaternions,
+	const Eigen::MatrixBase<DerivedX> &out_angle_axis_x,
+	const Eigen::MatrixBase<DerivedY> &out_angle_axis_y,
+	const Eigen::MatrixBase<DerivedZ> &out_angle_axis_z);
+
+template <typename DerivedLHS, typename DerivedRHS, typename DerivedOut>
+static void multiply_quaternion_rows(
+	const Eigen::MatrixBase<DerivedLHS> &lhs,
+	const Eigen::MatrixBase<DerivedRHS> &rhs,
+	const Eigen::MatrixBase<DerivedOut> &out_quaternions);
+
+template <typename DerivedLHS, typename DerivedOut>
+static void multiply_quaternion_rows(
+	const Eigen::MatrixBase<DerivedLHS> &lhs,
+	const Eigen::Quaternion<typename DerivedOut::Scalar> &rhs,
+	const Eigen::MatrixBase<DerivedOut> &out_quaternions);
+
+template <typename DerivedState, typename DerivedNoise, typename DerivedRotation, typename DerivedScratch>
+static void add_noise_rows(
+	const Eigen::MatrixBase<DerivedState> &state_rows,
+	const Eigen::MatrixBase<DerivedNoise> &noise_rows,
+	const Eigen::MatrixBase<DerivedRotation> &noise_rotations,
+	const Eigen::MatrixBase<DerivedScratch> &scratch_quaternions);
+
+template <typename DerivedQuaternion, typename DerivedWeights>
+static Eigen::Quaternion<typename DerivedQuaternion::Scalar> compute_quaternion_rows_weighted_average(
+	const Eigen::MatrixBase<DerivedQuaternion> &quaternions,
+	const Eigen::MatrixBase<DerivedWeights> &weights);
+
 //-- private definitions --
-class PoseNoiseVector : public Eigen::Matrix<double, NOISE_PARAMETER_COUNT, 1>
+template<typename T>
+class PoseNoiseVector : public Eigen::Matrix<T, NOISE_PARAMETER_COUNT, 1>
 {
 public:
-	PoseNoiseVector(void) : Eigen::Matrix<double, NOISE_PARAMETER_COUNT, 1>()
+	typedef Eigen::Matrix<T, NOISE_PARAMETER_COUNT, 1> BaseType;
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+	typedef Eigen::AngleAxis<T> AngleAxis;
+
+	PoseNoiseVector(void) : BaseType()
 	{ }
 
 	template<typename OtherDerived>
-	PoseNoiseVector(const Eigen::MatrixBase<OtherDerived>& other) : Eigen::Matrix<double, NOISE_PARAMETER_COUNT, 1>(other)
+	PoseNoiseVector(const Eigen::MatrixBase<OtherDerived>& other) : BaseType(other)
 	{ }
 
 	template<typename OtherDerived>
 	PoseNoiseVector& operator= (const Eigen::MatrixBase<OtherDerived>& other)
 	{
-		this->Base::operator=(other);
+		this->BaseType::operator=(other);
 		return *this;
 	}
 
 	// Accessors
-	Eigen::Vector3d get_position_noise() const {
-		return Eigen::Vector3d((*this)[NOISE_POSITION_X], (*this)[NOISE_POSITION_Y], (*this)[NOISE_POSITION_Z]);
+	Vector3 get_position_noise() const {
+		return Vector3((*this)[NOISE_POSITION_X], (*this)[NOISE_POSITION_Y], (*this)[NOISE_POSITION_Z]);
 	}
-	Eigen::Vector3d get_linear_velocity_noise() const {
-		return Eigen::Vector3d((*this)[NOISE_LINEAR_VELOCITY_X], (*this)[NOISE_LINEAR_VELOCITY_Y], (*this)[NOISE_LINEAR_VELOCITY_Z]);
+	Vector3 get_linear_velocity_noise() const {
+		return Vector3((*this)[NOISE_LINEAR_VELOCITY_X], (*this)[NOISE_LINEAR_VELOCITY_Y], (*this)[NOISE_LINEAR_VELOCITY_Z]);
 	}
-	Eigen::Vector3d get_linear_acceleration_noise() const {
-		return Eigen::Vector3d((*this)[NOISE_LINEAR_ACCELERATION_X], (*this)[NOISE_LINEAR_ACCELERATION_Y], (*this)[NOISE_LINEAR_ACCELERATION_Z]);
+	Vector3 get_linear_acceleration_noise() const {
+		return Vector3((*this)[NOISE_LINEAR_ACCELERATION_X], (*this)[NOISE_LINEAR_ACCELERATION_Y], (*this)[NOISE_LINEAR_ACCELERATION_Z]);
 	}
 	template <int RowsAtCompileTime>
-	static Eigen::AngleAxisd extract_angle_axis_noise(const Eigen::Matrix<double, RowsAtCompileTime, 1> &M) {
-		Eigen::Vector3d axis = Eigen::Vector3d(M[NOISE_ANGLE_AXIS_X], M[NOISE_ANGLE_AXIS_Y], M[NOISE_ANGLE_AXIS_Z]);
-		const double angle = eigen_vector3d_normalize_with_default(axis, Eigen::Vector3d::Zero());
-		return Eigen::AngleAxisd(angle, axis);
+	static AngleAxis extract_angle_axis_noise(const Eigen::Matrix<T, RowsAtCompileTime, 1> &M) {
+		Vector3 axis = Vector3(M[NOISE_ANGLE_AXIS_X], M[NOISE_ANGLE_AXIS_Y], M[NOISE_ANGLE_AXIS_Z]);
+		const T angle = eigen_vector3_normalize_with_default(axis, Vector3::Zero());
+		return AngleAxis(angle, axis);
 	}
-	Eigen::AngleAxisd get_angle_axis_noise() const {
+	AngleAxis get_angle_axis_noise() const {
 		return extract_angle_axis_noise<NOISE_PARAMETER_COUNT>(*this);
 	}
 	template <int RowsAtCompileTime>
-	static Eigen::Quaterniond extract_quaternion_noise(const Eigen::Matrix<double, RowsAtCompileTime, 1> &M) {
-		return Eigen::Quaterniond(extract_angle_axis_noise<RowsAtCompileTime>(M));
+	static Quaternion extract_quaternion_noise(const Eigen::Matrix<T, RowsAtCompileTime, 1> &M) {
+		return Quaternion(extract_angle_axis_noise<RowsAtCompileTime>(M));
 	}
-	Eigen::Quaterniond get_quaternion_noise() const {
+	Quaternion get_quaternion_noise() const {
 		return extract_quaternion_noise<NOISE_PARAMETER_COUNT>(*this);
 	}
-	Eigen::Vector3d get_angular_velocity_noise() const {
-		return Eigen::Vector3d((*this)[NOISE_ANGULAR_VELOCITY_X], (*this)[NOISE_ANGULAR_VELOCITY_Y], (*this)[NOISE_ANGULAR_VELOCITY_Z]);
+	Vector3 get_angular_velocity_noise() const {
+		return Vector3((*this)[NOISE_ANGULAR_VELOCITY_X], (*this)[NOISE_ANGULAR_VELOCITY_Y], (*this)[NOISE_ANGULAR_VELOCITY_Z]);
 	}
 
 	// Mutators
-	void set_position_noise(const Eigen::Vector3d &p) {
+	void set_position_noise(const Vector3 &p) {
 		(*this)[NOISE_POSITION_X] = p.x(); (*this)[NOISE_POSITION_Y] = p.y(); (*this)[NOISE_POSITION_Z] = p.z();
 	}
-	void set_linear_velocity_noise(const Eigen::Vector3d &v) {
+	void set_linear_velocity_noise(const Vector3 &v) {
 		(*this)[NOISE_LINEAR_VELOCITY_X] = v.x(); (*this)[NOISE_LINEAR_VELOCITY_Y] = v.y(); (*this)[NOISE_LINEAR_VELOCITY_Z] = v.z();
 	}
-	void set_linear_acceleration_noise(const Eigen::Vector3d &a) {
+	void set_linear_acceleration_noise(const Vector3 &a) {
 		(*this)[NOISE_LINEAR_ACCELERATION_X] = a.x(); (*this)[NOISE_LINEAR_ACCELERATION_Y] = a.y(); (*this)[NOISE_LINEAR_ACCELERATION_Z] = a.z();
 	}
 	template <int RowsAtCompileTime>
-	static void apply_angle_axis_noise(const Eigen::AngleAxisd &a, Eigen::Matrix<double, RowsAtCompileTime, 1> &M) {
-		const double angle = a.angle();
+	static void apply_angle_axis_noise(const AngleAxis &a, Eigen::Matrix<T, RowsAtCompileTime, 1> &M) {
+		const T angle = a.angle();
 		M[NOISE_ANGLE_AXIS_X] = a.axis().x() * angle;
 		M[NOISE_ANGLE_AXIS_Y] = a.axis().y() * angle;
 		M[NOISE_ANGLE_AXIS_Z] = a.axis().z() * angle;
 	}
-	void set_angle_axis_noise(const Eigen::AngleAxisd &a) {
+	void set_angle_axis_noise(const AngleAxis &a) {
 		apply_angle_axis_noise<NOISE_PARAMETER_COUNT>(a, *this);
 	}
 	template <int RowsAtCompileTime>
-	static void apply_quaternion_noise(const Eigen::Quaterniond &q, Eigen::Matrix<double, RowsAtCompileTime, 1> &M) {
-		const Eigen::AngleAxisd angle_axis(q);
+	static void apply_quaternion_noise(const Quaternion &q, Eigen::Matrix<T, RowsAtCompileTime, 1> &M) {
+		const AngleAxis angle_axis(q);
 		apply_angle_axis_noise<RowsAtCompileTime>(angle_axis, M);
 	}
-	void set_quaternion_noise(const Eigen::Quaterniond &q) {
+	void set_quaternion_noise(const Quaternion &q) {
 		apply_quaternion_noise<NOISE_PARAMETER_COUNT>(q, *this);
 	}
-	void set_angular_velocity_noise(const Eigen::Vector3d &v) {
+	void set_angular_velocity_noise(const Vector3 &v) {
 		(*this)[NOISE_ANGULAR_VELOCITY_X] = v.x(); (*this)[NOISE_ANGULAR_VELOCITY_Y] = v.y(); (*this)[NOISE_ANGULAR_VELOCITY_Z] = v.z();
 	}
 
@@ -201,63 +254,70 @@ public:
 		return neg_noise;
 	}
 };
+typedef PoseNoiseVector<double> PoseNoiseVectord;
+typedef PoseNoiseVector<float> PoseNoiseVectorf;
 
-class PoseStateVector : public Eigen::Matrix<double, STATE_PARAMETER_COUNT, 1>
+template<typename T>
+class PoseStateVector : public Eigen::Matrix<T, STATE_PARAMETER_COUNT, 1>
 {
 public:
-	PoseStateVector(void) : Eigen::Matrix<double, STATE_PARAMETER_COUNT, 1>()
+	typedef Eigen::Matrix<T, STATE_PARAMETER_COUNT, 1> BaseType;
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+
+	PoseStateVector(void) : BaseType()
 	{ }
 
 	template<typename OtherDerived>
-	PoseStateVector(const Eigen::MatrixBase<OtherDerived>& other) : Eigen::Matrix<double, STATE_PARAMETER_COUNT, 1>(other)
+	PoseStateVector(const Eigen::MatrixBase<OtherDerived>& other) : BaseType(other)
 	{ }
 
 	template<typename OtherDerived>
 	PoseStateVector& operator= (const Eigen::MatrixBase<OtherDerived>& other)
 	{
-		this->Base::operator=(other);
+		this->BaseType::operator=(other);
 		return *this;
 	}
 
     // Accessors
-    Eigen::Vector3d get_position_meters() const { 
-        return Eigen::Vector3d((*this)[POSITION_X], (*this)[POSITION_Y], (*this)[POSITION_Z]); 
+    Vector3 get_position_meters() const {
+        return Vector3((*this)[POSITION_X], (*this)[POSITION_Y], (*this)[POSITION_Z]);
     }
-    Eigen::Vector3d get_linear_velocity_m_per_sec() const {
-        return Eigen::Vector3d((*this)[LINEAR_VELOCITY_X], (*this)[LINEAR_VELOCITY_Y], (*this)[LINEAR_VELOCITY_Z]);
+    Vector3 get_linear_velocity_m_per_sec() const {
+        return Vector3((*this)[LINEAR_VELOCITY_X], (*this)[LINEAR_VELOCITY_Y], (*this)[LINEAR_VELOCITY_Z]);
     }
-    Eigen::Vector3d get_linear_acceleration_m_per_sec_sqr() const {
-        return Eigen::Vector3d((*this)[LINEAR_ACCELERATION_X], (*this)[LINEAR_ACCELERATION_Y], (*this)[LINEAR_ACCELERATION_Z]);
+    Vector3 get_linear_acceleration_m_per_sec_sqr() const {
+        return Vector3((*this)[LINEAR_ACCELERATION_X], (*this)[LINEAR_ACCELERATION_Y], (*this)[LINEAR_ACCELERATION_Z]);
     }
 	template <int RowsAtCompileTime>
-	static Eigen::Quaterniond extract_quaternion(const Eigen::Matrix<double, RowsAtCompileTime, 1> &M) {
-		return Eigen::Quaterniond(M[ORIENTATION_W], M[ORIENTATION_X], M[ORIENTATION_Y], M[ORIENTATION_Z]);
+	static Quaternion extract_quaternion(const Eigen::Matrix<T, RowsAtCompileTime, 1> &M) {
+		return Quaternion(M[ORIENTATION_W], M[ORIENTATION_X], M[ORIENTATION_Y], M[ORIENTATION_Z]);
 	}
-    Eigen::Quaterniond get_quaternion() const {
+    Quaternion get_quaternion() const {
         return extract_quaternion<STATE_PARAMETER_COUNT>(*this);
     }
-    Eigen::Vector3d get_angular_velocity_rad_per_sec() const {
-        return Eigen::Vector3d((*this)[ANGULAR_VELOCITY_X], (*this)[ANGULAR_VELOCITY_Y], (*this)[ANGULAR_VELOCITY_Z]);
+    Vector3 get_angular_velocity_rad_per_sec() const {
+        return Vector3((*this)[ANGULAR_VELOCITY_X], (*this)[ANGULAR_VELOCITY_Y], (*this)[ANGULAR_VELOCITY_Z]);
     }
 
     // Mutators
-    void set_position_meters(const Eigen::Vector3d &p) {
+    void set_position_meters(const Vector3 &p) {
         (*this)[POSITION_X] = p.x(); (*this)[POSITION_Y] = p.y(); (*this)[POSITION_Z] = p.z();
     }
-    void set_linear_velocity_m_per_sec(const Eigen::Vector3d &v) {
+    void set_linear_velocity_m_per_sec(const Vector3 &v) {
         (*this)[LINEAR_VELOCITY_X] = v.x(); (*this)[LINEAR_VELOCITY_Y] = v.y(); (*this)[LINEAR_VELOCITY_Z] = v.z();
     }
-    void set_linear_acceleration_m_per_sec_sqr(const Eigen::Vector3d &a) {
+    void set_linear_acceleration_m_per_sec_sqr(const Vector3 &a) {
         (*this)[LINEAR_ACCELERATION_X] = a.x(); (*this)[LINEAR_ACCELERATION_Y] = a.y(); (*this)[LINEAR_ACCELERATION_Z] = a.z();
     }
 	template <int RowsAtCompileTime>
-	static void apply_quaternion(const Eigen::Quaterniond &q, Eigen::Matrix<double, RowsAtCompileTime, 1> &M) {
+	static void apply_quaternion(const Quaternion &q, Eigen::Matrix<T, RowsAtCompileTime, 1> &M) {
 		M[ORIENTATION_W] = q.w(); M[ORIENTATION_X] = q.x(); M[ORIENTATION_Y] = q.y(); M[ORIENTATION_Z] = q.z();
 	}
-    void set_quaternion(const Eigen::Quaterniond &q) {
+    void set_quaternion(const Quaternion &q) {
 		apply_quaternion<STATE_PARAMETER_COUNT>(q, *this);
     }
-    void set_angular_velocity_rad_per_sec(const Eigen::Vector3d &v) {
+    void set_angular_velocity_rad_per_sec(const Vector3 &v) {
         (*this)[ANGULAR_VELOCITY_X] = v.x(); (*this)[ANGULAR_VELOCITY_Y] = v.y(); (*this)[ANGULAR_VELOCITY_Z] = v.z();
     }
 
@@ -267,40 +327,40 @@ public:
 		PoseStateVector result;
 
 		// Add the first 9 rows (position, velocity, and acceleration) the usual way
-		result.head<9>() = this->head<9>() + other.head<9>();
+		result.template head<9>() = this->template head<9>() + other.template head<9>();
 		// Add the last 3 rows (angular velocity) the usual was
-		result.tail<3>() = this->tail<3>() + other.head<3>();
+		result.template tail<3>() = this->template tail<3>() + other.template tail<3>();
 
 		// Extract the orientation quaternion from A (which is stored as an angle axis vector)
-		const Eigen::Quaterniond orientation = this->get_quaternion();
+		const Quaternion orientation = this->get_quaternion();
 
 		// Extract the delta quaternion from B (which is also stored as an angle axis vector)
-		const Eigen::Quaterniond delta = other.get_quaternion();
+		const Quaternion delta = other.get_quaternion();
 
 		// Apply the delta to the orientation
-		const Eigen::Quaterniond new_rotation = (orientation*delta).normalized();
+		const Quaternion new_rotation = (orientation*delta).normalized();
 
 		// Save the net rotation rotation back in result
 		result.set_quaternion(new_rotation);
 
 		return result;
-	}	
+	}
 
-	PoseStateVector operator + (const PoseNoiseVector &other) const
+	PoseStateVector operator + (const PoseNoiseVector<T> &other) const
 	{
 		PoseStateVector result;
 
 		// Add the first 9 rows (position, velocity, and acceleration) the usual way
-		result.head<9>() = this->head<9>() + other.head<9>();
+		result.template head<9>() = this->template head<9>() + other.template head<9>();
 
 		// Extract the orientation quaternion from A (which is stored as an angle axis vector)
-		const Eigen::Quaterniond orientation = this->get_quaternion();
+		const Quaternion orientation = this->get_quaternion();
 
 		// Extract the delta noise quaternion from B (which is also stored as an angle axis vector)
-		const Eigen::Quaterniond delta = other.get_quaternion_noise();
+		const Quaternion delta = other.get_quaternion_noise();
 
 		// Apply the noise delta to the orientation
-		const Eigen::Quaterniond new_rotation = (orientation*delta).normalized();
+		const Quaternion new_rotation = (orientation*delta).normalized();
 
 		// Save the net rotation rotation back in result
 		result.set_quaternion(new_rotation);
@@ -316,35 +376,35 @@ public:
 		PoseStateVector result;
 
 		// Subtract the first 9 rows (position, velocity, and acceleration) the usual way
-		result.head<9>() = this->head<9>() - other.head<9>();
+		result.template head<9>() = this->template head<9>() - other.template head<9>();
 		// Subtract the last 3 rows (angular velocity) the usual was
-		result.tail<3>() = this->tail<3>() - other.head<3>();
+		result.template tail<3>() = this->template tail<3>() - other.template tail<3>();
 
 		// Extract the orientation quaternion from both states (which is stored as an angle axis vector)
-		const Eigen::Quaterniond q1= this->get_quaternion();
-		const Eigen::Quaterniond q2= other.get_quaternion();
+		const Quaternion q1= this->get_quaternion();
+		const Quaternion q2= other.get_quaternion();
 
 		// Compute the "quaternion difference" i.e. rotation from q1 to q2
-		const Eigen::Quaterniond q_diff= (q1*q2.conjugate()).normalized();
+		const Quaternion q_diff= (q1*q2.conjugate()).normalized();
 
 		result.set_quaternion(q_diff);
 
 		return result;
 	}
 
-	PoseStateVector operator - (const PoseNoiseVector &other) const
+	PoseStateVector operator - (const PoseNoiseVector<T> &other) const
 	{
 		PoseStateVector result;
 
 		// Subtract the first 9 rows (position, velocity, and acceleration) the usual way
-		result.head<9>() = this->head<9>() - other.head<9>();
+		result.template head<9>() = this->template head<9>() - other.template head<9>();
 
 		// Extract the orientation quaternion from both states (which is stored as an angle axis vector)
-		const Eigen::Quaterniond q1 = this->get_quaternion();
-		const Eigen::Quaterniond q2 = other.get_quaternion_noise();
+		const Quaternion q1 = this->get_quaternion();
+		const Quaternion q2 = other.get_quaternion_noise();
 
 		// Compute the "quaternion difference" i.e. rotation from q1 to q2
-		const Eigen::Quaterniond q_diff = (q1*q2.conjugate()).normalized();
+		const Quaternion q_diff = (q1*q2.conjugate()).normalized();
 
 		result.set_quaternion(q_diff);
 
@@ -355,43 +415,36 @@ public:
 		return result;
 	}
 
+	/// state_matrix holds one state per row
 	template <int PointCount>
 	static void special_state_mean(
-		const Eigen::Matrix<double, STATE_PARAMETER_COUNT, PointCount>& state_matrix,
-		const Eigen::Matrix<double, PointCount, 1> weight_vector,
+		const Eigen::Matrix<T, PointCount, STATE_PARAMETER_COUNT>& state_matrix,
+		const Eigen::Matrix<T, PointCount, 1> &weight_vector,
 		PoseStateVector &result)
 	{
-		Eigen::Quaterniond quat_0_inv = extract_quaternion<RowsAtCompileTime>(state_matrix.col(0)).conjugate();
-
-		// Extract the orientations from the states
-		Eigen::Quaterniond orientations[PointCount];
-		double weights[PointCount];
-		for (int col_index = 0; col_index < PointCount; ++col_index)
-		{
-			Eigen::Quaterniond orientation = extract_quaternion<RowsAtCompileTime>(state_matrix.col(col_index));
-
-			orientations[col_index]= orientation;
-			weights[col_index]= weight_vector[col_index];
-		}
-
 		// Compute the average of the quaternions
-		Eigen::Quaterniond average_quat;
-		eigen_quaternion_compute_weighted_average(orientations, weights, PointCount, &average_quat);
+		const Quaternion average_quat =
+			compute_quaternion_rows_weighted_average(
+				state_matrix.template middleCols<4>(ORIENTATION_W),
+				weight_vector);
 
 		// Stomp the incorrect orientation average
-		apply_quaternion<RowsAtCompileTime>(average_quat, result);
+		apply_quaternion<STATE_PARAMETER_COUNT>(average_quat, result);
 	}
 };
+typedef PoseStateVector<double> PoseStateVectord;
+typedef PoseStateVector<float> PoseStateVectorf;
 
-PoseNoiseVector convert_state_to_noise_vector(const PoseStateVector &state_vector)
+template<typename T>
+PoseNoiseVector<T> convert_state_to_noise_vector(const PoseStateVector<T> &state_vector)
 {
-	PoseNoiseVector result;
+	PoseNoiseVector<T> result;
 
 	// Copy the linear portions straight over (position, velocity, acceleration)
-	result.head<9>() = state_vector.head<9>();
+	result.template head<9>() = state_vector.template head<9>();
 
 	// Convert the quaternion in the state vector to an angle-axis vector
-	result.set_angle_axis_noise(Eigen::AngleAxisd(state_vector.get_quaternion()));
+	result.set_angle_axis_noise(Eigen::AngleAxis<T>(state_vector.get_quaternion()));
 
 	// Copy over the angular velocity vector
 	result.set_angular_velocity_noise(state_vector.get_angular_velocity_rad_per_sec());
@@ -399,15 +452,16 @@ PoseNoiseVector convert_state_to_noise_vector(const PoseStateVector &state_vecto
 	return result;
 }
 
-PoseStateVector convert_noise_to_state_vector(const PoseNoiseVector &noise_vector)
+template<typename T>
+PoseStateVector<T> convert_noise_to_state_vector(const PoseNoiseVector<T> &noise_vector)
 {
-	PoseStateVector result;
+	PoseStateVector<T> result;
 
 	// Copy the linear portions straight over (position, velocity, acceleration)
-	result.head<9>() = noise_vector.head<9>();
+	result.template head<9>() = noise_vector.template head<9>();
 
 	// Copy the angle-axis vector
-	result.set_quaternion(Eigen::Quaterniond(noise_vector.get_angle_axis_noise()));
+	result.set_quaternion(Eigen::Quaternion<T>(noise_vector.get_angle_axis_noise()));
 
 	// Copy over the angular velocity vector
 	result.set_angular_velocity_rad_per_sec(noise_vector.get_angular_velocity_noise());
@@ -415,125 +469,138 @@ PoseStateVector convert_noise_to_state_vector(const PoseNoiseVector &noise_vecto
 	return result;
 }
 
-class PSMove_MeasurementVector : public Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1>
+template<typename T>
+class PSMove_MeasurementVector : public Eigen::Matrix<T, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1>
 {
 public:
-	PSMove_MeasurementVector(void) : Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1>()
+	typedef Eigen::Matrix<T, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1> BaseType;
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+
+	PSMove_MeasurementVector(void) : BaseType()
 	{ }
 
 	template<typename OtherDerived>
-	PSMove_MeasurementVector(const Eigen::MatrixBase<OtherDerived>& other) : Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1>(other)
+	PSMove_MeasurementVector(const Eigen::MatrixBase<OtherDerived>& other) : BaseType(other)
 	{ }
 
 	template<typename OtherDerived>
 	PSMove_MeasurementVector& operator= (const Eigen::MatrixBase<OtherDerived>& other)
 	{
-		this->Base::operator=(other);
+		this->BaseType::operator=(other);
 		return *this;
 	}
 
     // Accessors
-    Eigen::Vector3d get_accelerometer() const {
-        return Eigen::Vector3d((*this)[PSMOVE_ACCELEROMETER_X], (*this)[PSMOVE_ACCELEROMETER_Y], (*this)[PSMOVE_ACCELEROMETER_Z]);
+    Vector3 get_accelerometer() const {
+        return Vector3((*this)[PSMOVE_ACCELEROMETER_X], (*this)[PSMOVE_ACCELEROMETER_Y], (*this)[PSMOVE_ACCELEROMETER_Z]);
     }
-    Eigen::Vector3d get_gyroscope() const {
-        return Eigen::Vector3d((*this)[PSMOVE_GYROSCOPE_X], (*this)[PSMOVE_GYROSCOPE_Y], (*this)[PSMOVE_GYROSCOPE_Z]);
+    Vector3 get_gyroscope() const {
+        return Vector3((*this)[PSMOVE_GYROSCOPE_X], (*this)[PSMOVE_GYROSCOPE_Y], (*this)[PSMOVE_GYROSCOPE_Z]);
     }
-    Eigen::Vector3d get_magnetometer() const {
-        return Eigen::Vector3d((*this)[PSMOVE_MAGNETOMETER_X], (*this)[PSMOVE_MAGNETOMETER_Y], (*this)[PSMOVE_MAGNETOMETER_Z]);
+    Vector3 get_magnetometer() const {
+        return Vector3((*this)[PSMOVE_MAGNETOMETER_X], (*this)[PSMOVE_MAGNETOMETER_Y], (*this)[PSMOVE_MAGNETOMETER_Z]);
     }
-    Eigen::Vector3d get_optical_position() const {
-        return Eigen::Vector3d((*this)[PSMOVE_OPTICAL_POSITION_X], (*this)[PSMOVE_OPTICAL_POSITION_Y], (*this)[PSMOVE_OPTICAL_POSITION_Z]);
+    Vector3 get_optical_position() const {
+        return Vector3((*this)[PSMOVE_OPTICAL_POSITION_X], (*this)[PSMOVE_OPTICAL_POSITION_Y], (*this)[PSMOVE_OPTICAL_POSITION_Z]);
     }
 
     // Mutators
-    void set_accelerometer(const Eigen::Vector3d &a) {
+    void set_accelerometer(const Vector3 &a) {
         (*this)[PSMOVE_ACCELEROMETER_X] = a.x(); (*this)[PSMOVE_ACCELEROMETER_Y] = a.y(); (*this)[PSMOVE_ACCELEROMETER_Z] = a.z();
     }
-    void set_gyroscope(const Eigen::Vector3d &g) {
+    void set_gyroscope(const Vector3 &g) {
         (*this)[PSMOVE_GYROSCOPE_X] = g.x(); (*this)[PSMOVE_GYROSCOPE_Y] = g.y(); (*this)[PSMOVE_GYROSCOPE_Z] = g.z();
     }
-    void set_optical_position(const Eigen::Vector3d &p) {
+    void set_optical_position(const Vector3 &p) {
         (*this)[PSMOVE_OPTICAL_POSITION_X] = p.x(); (*this)[PSMOVE_OPTICAL_POSITION_Y] = p.y(); (*this)[PSMOVE_OPTICAL_POSITION_Z] = p.z();
     }
-    void set_magnetometer(const Eigen::Vector3d &m) {
+    void set_magnetometer(const Vector3 &m) {
         (*this)[PSMOVE_MAGNETOMETER_X] = m.x(); (*this)[PSMOVE_MAGNETOMETER_Y] = m.y(); (*this)[PSMOVE_MAGNETOMETER_Z] = m.z();
     }
 
 	PSMove_MeasurementVector negate() const
 	{
-		// for the PSMove measurement the negation can be computed 
+		// for the PSMove measurement the negation can be computed
 		// with simple vector negation
-		return (*this) * -1.0;
+		return -(*this);
 	}
 
+	/// measurement_matrix holds one measurement per row
 	template <int SIGMA_POINT_COUNT>
 	static PSMove_MeasurementVector computeWeightedMeasurementAverage(
-		const Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, SIGMA_POINT_COUNT>& measurement_matrix,
-		const Eigen::Matrix<double, SIGMA_POINT_COUNT, 1> &weight_vector)
+		const Eigen::Matrix<T, SIGMA_POINT_COUNT, PSMOVE_MEASUREMENT_PARAMETER_COUNT>& measurement_matrix,
+		const Eigen::Matrix<T, SIGMA_POINT_COUNT, 1> &weight_vector)
 	{
 		// Use efficient matrix x vector computation to compute a weighted average of the sigma point samples
 		// (No orientation stored in measurement means this can be simple)
-		PSMove_MeasurementVector result= measurement_matrix * weight_vector;
+		PSMove_MeasurementVector result= measurement_matrix.transpose() * weight_vector;
 
 		return result;
 	}
 };
+typedef PSMove_MeasurementVector<double> PSMove_MeasurementVectord;
+typedef PSMove_MeasurementVector<float> PSMove_MeasurementVectorf;
 
-class DS4_MeasurementVector : public Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, 1>
+template<typename T>
+class DS4_MeasurementVector : public Eigen::Matrix<T, DS4_MEASUREMENT_PARAMETER_COUNT, 1>
 {
 public:
-	DS4_MeasurementVector(void) : Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, 1>()
+	typedef Eigen::Matrix<T, DS4_MEASUREMENT_PARAMETER_COUNT, 1> BaseType;
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+	typedef Eigen::AngleAxis<T> AngleAxis;
+
+	DS4_MeasurementVector(void) : BaseType()
 	{ }
 
 	template<typename OtherDerived>
-	DS4_MeasurementVector(const Eigen::MatrixBase<OtherDerived>& other) : Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, 1>(other)
+	DS4_MeasurementVector(const Eigen::MatrixBase<OtherDerived>& other) : BaseType(other)
 	{ }
 
 	template<typename OtherDerived>
 	DS4_MeasurementVector& operator= (const Eigen::MatrixBase<OtherDerived>& other)
 	{
-		this->Base::operator=(other);
+		this->BaseType::operator=(other);
 		return *this;
 	}
 
     // Accessors
-    Eigen::Vector3d get_accelerometer() const {
-        return Eigen::Vector3d((*this)[DS4_ACCELEROMETER_X], (*this)[DS4_ACCELEROMETER_Y], (*this)[DS4_ACCELEROMETER_Z]);
+    Vector3 get_accelerometer() const {
+        return Vector3((*this)[DS4_ACCELEROMETER_X], (*this)[DS4_ACCELEROMETER_Y], (*this)[DS4_ACCELEROMETER_Z]);
     }
-    Eigen::Vector3d get_gyroscope() const {
-        return Eigen::Vector3d((*this)[DS4_GYROSCOPE_X], (*this)[DS4_GYROSCOPE_Y], (*this)[DS4_GYROSCOPE_Z]);
+    Vector3 get_gyroscope() const {
+        return Vector3((*this)[DS4_GYROSCOPE_X], (*this)[DS4_GYROSCOPE_Y], (*this)[DS4_GYROSCOPE_Z]);
     }
-    Eigen::Vector3d get_optical_position() const {
-        return Eigen::Vector3d((*this)[DS4_OPTICAL_POSITION_X], (*this)[DS4_OPTICAL_POSITION_Y], (*this)[DS4_OPTICAL_POSITION_Z]);
+    Vector3 get_optical_position() const {
+        return Vector3((*this)[DS4_OPTICAL_POSITION_X], (*this)[DS4_OPTICAL_POSITION_Y], (*this)[DS4_OPTICAL_POSITION_Z]);
     }
-    Eigen::AngleAxisd get_optical_angle_axis() const {
-        Eigen::Vector3d axis= Eigen::Vector3d((*this)[DS4_OPTICAL_ANGLE_AXIS_X], (*this)[DS4_OPTICAL_ANGLE_AXIS_Y], (*this)[DS4_OPTICAL_ANGLE_AXIS_Z]);
-        const double angle= eigen_vector3d_normalize_with_default(axis, Eigen::Vector3d::Zero());
-        return Eigen::AngleAxisd(angle, axis);
+    AngleAxis get_optical_angle_axis() const {
+        Vector3 axis= Vector3((*this)[DS4_OPTICAL_ANGLE_AXIS_X], (*this)[DS4_OPTICAL_ANGLE_AXIS_Y], (*this)[DS4_OPTICAL_ANGLE_AXIS_Z]);
+        const T angle= eigen_vector3_normalize_with_default(axis, Vector3::Zero());
+        return AngleAxis(angle, axis);
     }
-    Eigen::Quaterniond get_optical_quaternion() const {
-        return Eigen::Quaterniond(get_optical_angle_axis());
+    Quaternion get_optical_quaternion() const {
+        return Quaternion(get_optical_angle_axis());
     }
 
     // Mutators
-    void set_accelerometer(const Eigen::Vector3d &a) {
+    void set_accelerometer(const Vector3 &a) {
         (*this)[DS4_ACCELEROMETER_X] = a.x(); (*this)[DS4_ACCELEROMETER_Y] = a.y(); (*this)[DS4_ACCELEROMETER_Z] = a.z();
     }
-    void set_gyroscope(const Eigen::Vector3d &g) {
+    void set_gyroscope(const Vector3 &g) {
         (*this)[DS4_GYROSCOPE_X] = g.x(); (*this)[DS4_GYROSCOPE_Y] = g.y(); (*this)[DS4_GYROSCOPE_Z] = g.z();
     }
-    void set_optical_position(const Eigen::Vector3d &p) {
+    void set_optical_position(const Vector3 &p) {
         (*this)[DS4_OPTICAL_POSITION_X] = p.x(); (*this)[DS4_OPTICAL_POSITION_Y] = p.y(); (*this)[DS4_OPTICAL_POSITION_Z] = p.z();
     }
-    void set_angle_axis(const Eigen::AngleAxisd &a) {        
-        const double angle= a.angle();
-        (*this)[DS4_OPTICAL_ANGLE_AXIS_X] = a.axis().x() * angle; 
+    void set_angle_axis(const AngleAxis &a) {
+        const T angle= a.angle();
+        (*this)[DS4_OPTICAL_ANGLE_AXIS_X] = a.axis().x() * angle;
         (*this)[DS4_OPTICAL_ANGLE_AXIS_Y] = a.axis().y() * angle;
         (*this)[DS4_OPTICAL_ANGLE_AXIS_Z] = a.axis().z() * angle;
     }
-    void set_optical_quaternion(const Eigen::Quaterniond &q) {
-        const Eigen::AngleAxisd angle_axis(q);
+    void set_optical_quaternion(const Quaternion &q) {
+        const AngleAxis angle_axis(q);
         set_angle_axis(angle_axis);
     }
 
@@ -541,11 +608,11 @@ public:
 	{
 		DS4_MeasurementVector measurement_diff;
 
-		measurement_diff.head<9>() = this->head<9>() - other.head<9>();
-		
-		const Eigen::Quaterniond q1= this->get_optical_quaternion();
-		const Eigen::Quaterniond q2= other.get_optical_quaternion();
-		const Eigen::Quaterniond q_diff= q2*q1.conjugate();
+		measurement_diff.template head<9>() = this->template head<9>() - other.template head<9>();
+
+		const Quaternion q1= this->get_optical_quaternion();
+		const Quaternion q2= other.get_optical_quaternion();
+		const Quaternion q_diff= q2*q1.conjugate();
 
 		// Stomp the incorrect orientation difference computed by the vector subtraction
 		measurement_diff.set_optical_quaternion(q_diff);
@@ -555,36 +622,33 @@ public:
 
 	DS4_MeasurementVector negate() const
 	{
-		// for the DS4 measurement the negation can be computed 
+		// for the DS4 measurement the negation can be computed
 		// with simple vector negation
 		// (Safe to negate the optical angle axis)
-		return (*this) * -1.0;
+		return -(*this);
 	}
 
+	/// measurement_matrix holds one measurement per row
 	template <int SIGMA_POINT_COUNT>
 	static DS4_MeasurementVector computeWeightedMeasurementAverage(
-		const Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, SIGMA_POINT_COUNT>& measurement_matrix,
-		Eigen::Matrix<double, SIGMA_POINT_COUNT, 1> weight_vector)
+		const Eigen::Matrix<T, SIGMA_POINT_COUNT, DS4_MEASUREMENT_PARAMETER_COUNT>& measurement_matrix,
+		const Eigen::Matrix<T, SIGMA_POINT_COUNT, 1> &weight_vector)
 	{
 		// Use efficient matrix x vector computation to compute a weighted average of the measurements
 		// (the orientation portion will be wrong)
-		DS4_MeasurementVector result= measurement_matrix * weight_vector;
+		DS4_MeasurementVector result= measurement_matrix.transpose() * weight_vector;
 
 		// Extract the orientations from the measurements
-		Eigen::Quaterniond orientations[SIGMA_POINT_COUNT];
-		double weights[SIGMA_POINT_COUNT];
-		for (int col_index = 0; col_index < SIGMA_POINT_COUNT; ++col_index)
-		{
-			const DS4_MeasurementVector measurement = measurement_matrix.col(col_index);
-			Eigen::Quaterniond orientation = measurement.get_optical_quaternion();
-
-			orientations[col_index]= orientation;
-			weights[col_index]= weight_vector[col_index];
-		}
+		Eigen::Matrix<T, SIGMA_POINT_COUNT, 4> orientations;
+		angle_axis_rows_to_quaternion_rows(
+			measurement_matrix.col(DS4_OPTICAL_ANGLE_AXIS_X),
+			measurement_matrix.col(DS4_OPTICAL_ANGLE_AXIS_Y),
+			measurement_matrix.col(DS4_OPTICAL_ANGLE_AXIS_Z),
+			static_cast<T>(1),
+			orientations);
 
 		// Compute the average of the quaternions
-		Eigen::Quaterniond average_quat;
-		eigen_quaternion_compute_weighted_average(orientations, weights, SIGMA_POINT_COUNT, &average_quat);
+		const Quaternion average_quat = compute_quaternion_rows_weighted_average(orientations, weight_vector);
 
 		// Stomp the incorrect orientation average
 		result.set_optical_quaternion(average_quat);
@@ -592,6 +656,8 @@ public:
 		return result;
 	}
 };
+typedef DS4_MeasurementVector<double> DS4_MeasurementVectord;
+typedef DS4_MeasurementVector<float> DS4_MeasurementVectorf;
 
 /**
 * @brief Measurement model for measuring PSMove controller
@@ -599,15 +665,19 @@ public:
 * This is the measurement model for measuring the position and magnetometer of the PSMove controller.
 * The measurement is given by the optical trackers.
 */
+template<typename T>
 class PSMove_MeasurementModel
 {
 public:
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+
     void init(const PoseFilterConstants &constants)
     {
 		update_measurement_statistics(constants, 0.f);
-        
-		identity_gravity_direction= constants.orientation_constants.gravity_calibration_direction.cast<double>();
-		identity_magnetometer_direction= constants.orientation_constants.magnetometer_calibration_direction.cast<double>();
+
+		identity_gravity_direction= constants.orientation_constants.gravity_calibration_direction.cast<T>();
+		identity_magnetometer_direction= constants.orientation_constants.magnetometer_calibration_direction.cast<T>();
     }
 
 	void update_measurement_statistics(
@@ -622,39 +692,39 @@ public:
 		const double position_variance_m_sqr = k_centimeters_to_meters*k_centimeters_to_meters*position_variance_cm_sqr;
 
 		// Update the biases
-		Eigen::Vector3d acc_drift = constants.position_constants.accelerometer_drift.cast<double>();
-		Eigen::Vector3d gyro_drift = constants.orientation_constants.gyro_drift.cast<double>();
-		Eigen::Vector3d mag_drift = constants.orientation_constants.magnetometer_drift.cast<double>();
-		R_mu(PSMOVE_ACCELEROMETER_X, 1) = acc_drift.x();
-		R_mu(PSMOVE_ACCELEROMETER_Y, 1) = acc_drift.y();
-		R_mu(PSMOVE_ACCELEROMETER_Z, 1) = acc_drift.z();
-		R_mu(PSMOVE_GYROSCOPE_X, 1) = gyro_drift.x();
-		R_mu(PSMOVE_GYROSCOPE_Y, 1) = gyro_drift.y();
-		R_mu(PSMOVE_GYROSCOPE_Z, 1) = gyro_drift.z();
-		R_mu(PSMOVE_MAGNETOMETER_X, 1) = mag_drift.x();
-		R_mu(PSMOVE_MAGNETOMETER_Y, 1) = mag_drift.y();
-		R_mu(PSMOVE_MAGNETOMETER_Z, 1) = mag_drift.z();
-		R_mu(PSMOVE_OPTICAL_POSITION_X, 1) = 0.0;
-		R_mu(PSMOVE_OPTICAL_POSITION_Y, 1) = 0.0;
-		R_mu(PSMOVE_OPTICAL_POSITION_Z, 1) = 0.0;
+		Vector3 acc_drift = constants.position_constants.accelerometer_drift.cast<T>();
+		Vector3 gyro_drift = constants.orientation_constants.gyro_drift.cast<T>();
+		Vector3 mag_drift = constants.orientation_constants.magnetometer_drift.cast<T>();
+		R_mu[PSMOVE_ACCELEROMETER_X] = acc_drift.x();
+		R_mu[PSMOVE_ACCELEROMETER_Y] = acc_drift.y();
+		R_mu[PSMOVE_ACCELEROMETER_Z] = acc_drift.z();
+		R_mu[PSMOVE_GYROSCOPE_X] = gyro_drift.x();
+		R_mu[PSMOVE_GYROSCOPE_Y] = gyro_drift.y();
+		R_mu[PSMOVE_GYROSCOPE_Z] = gyro_drift.z();
+		R_mu[PSMOVE_MAGNETOMETER_X] = mag_drift.x();
+		R_mu[PSMOVE_MAGNETOMETER_Y] = mag_drift.y();
+		R_mu[PSMOVE_MAGNETOMETER_Z] = mag_drift.z();
+		R_mu[PSMOVE_OPTICAL_POSITION_X] = 0;
+		R_mu[PSMOVE_OPTICAL_POSITION_Y] = 0;
+		R_mu[PSMOVE_OPTICAL_POSITION_Z] = 0;
 
 
         // Update the measurement covariance R
-        R_cov = Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, PSMOVE_MEASUREMENT_PARAMETER_COUNT>::Zero();
+        R_cov = Eigen::Matrix<T, PSMOVE_MEASUREMENT_PARAMETER_COUNT, PSMOVE_MEASUREMENT_PARAMETER_COUNT>::Zero();
 
 		// Only diagonals used so no need to compute Cholesky
-		R_cov(PSMOVE_ACCELEROMETER_X, PSMOVE_ACCELEROMETER_X) = sqrt(R_SCALE*constants.position_constants.accelerometer_variance.x());
-		R_cov(PSMOVE_ACCELEROMETER_Y, PSMOVE_ACCELEROMETER_Y) = sqrt(R_SCALE*constants.position_constants.accelerometer_variance.y());
-		R_cov(PSMOVE_ACCELEROMETER_Z, PSMOVE_ACCELEROMETER_Z) = sqrt(R_SCALE*constants.position_constants.accelerometer_variance.z());
-		R_cov(PSMOVE_GYROSCOPE_X, PSMOVE_GYROSCOPE_X)= sqrt(R_SCALE*constants.orientation_constants.gyro_variance.x());
-		R_cov(PSMOVE_GYROSCOPE_Y, PSMOVE_GYROSCOPE_Y)= sqrt(R_SCALE*constants.orientation_constants.gyro_variance.y());
-		R_cov(PSMOVE_GYROSCOPE_Z, PSMOVE_GYROSCOPE_Z)= sqrt(R_SCALE*constants.orientation_constants.gyro_variance.z());
-		R_cov(PSMOVE_MAGNETOMETER_X, PSMOVE_MAGNETOMETER_X) = sqrt(R_SCALE*constants.orientation_constants.magnetometer_variance.x());
-		R_cov(PSMOVE_MAGNETOMETER_Y, PSMOVE_MAGNETOMETER_Y) = sqrt(R_SCALE*constants.orientation_constants.magnetometer_variance.y());
-		R_cov(PSMOVE_MAGNETOMETER_Z, PSMOVE_MAGNETOMETER_Z) = sqrt(R_SCALE*constants.orientation_constants.magnetometer_variance.z());
-		R_cov(PSMOVE_OPTICAL_POSITION_X, PSMOVE_OPTICAL_POSITION_X) = sqrt(R_SCALE*position_variance_m_sqr);
-		R_cov(PSMOVE_OPTICAL_POSITION_Y, PSMOVE_OPTICAL_POSITION_Y) = sqrt(R_SCALE*position_variance_m_sqr);
-		R_cov(PSMOVE_OPTICAL_POSITION_Z, PSMOVE_OPTICAL_POSITION_Z) = sqrt(R_SCALE*position_variance_m_sqr);
+		R_cov(PSMOVE_ACCELEROMETER_X, PSMOVE_ACCELEROMETER_X) = static_cast<T>(sqrt(R_SCALE*constants.position_constants.accelerometer_variance.x()));
+		R_cov(PSMOVE_ACCELEROMETER_Y, PSMOVE_ACCELEROMETER_Y) = static_cast<T>(sqrt(R_SCALE*constants.position_constants.accelerometer_variance.y()));
+		R_cov(PSMOVE_ACCELEROMETER_Z, PSMOVE_ACCELEROMETER_Z) = static_cast<T>(sqrt(R_SCALE*constants.position_constants.accelerometer_variance.z()));
+		R_cov(PSMOVE_GYROSCOPE_X, PSMOVE_GYROSCOPE_X)= static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.gyro_variance.x()));
+		R_cov(PSMOVE_GYROSCOPE_Y, PSMOVE_GYROSCOPE_Y)= static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.gyro_variance.y()));
+		R_cov(PSMOVE_GYROSCOPE_Z, PSMOVE_GYROSCOPE_Z)= static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.gyro_variance.z()));
+		R_cov(PSMOVE_MAGNETOMETER_X, PSMOVE_MAGNETOMETER_X) = static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.magnetometer_variance.x()));
+		R_cov(PSMOVE_MAGNETOMETER_Y, PSMOVE_MAGNETOMETER_Y) = static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.magnetometer_variance.y()));
+		R_cov(PSMOVE_MAGNETOMETER_Z, PSMOVE_MAGNETOMETER_Z) = static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.magnetometer_variance.z()));
+		R_cov(PSMOVE_OPTICAL_POSITION_X, PSMOVE_OPTICAL_POSITION_X) = static_cast<T>(sqrt(R_SCALE*position_variance_m_sqr));
+		R_cov(PSMOVE_OPTICAL_POSITION_Y, PSMOVE_OPTICAL_POSITION_Y) = static_cast<T>(sqrt(R_SCALE*position_variance_m_sqr));
+		R_cov(PSMOVE_OPTICAL_POSITION_Z, PSMOVE_OPTICAL_POSITION_Z) = static_cast<T>(sqrt(R_SCALE*position_variance_m_sqr));
 	}
 
     /**
@@ -667,45 +737,45 @@ public:
     * @param [in] x The system state in current time-step
     * @returns The (predicted) sensor measurement for the system state
     */
-    PSMove_MeasurementVector observation_function(const PoseStateVector& state, const PSMove_MeasurementVector &observation_noise) const
+    PSMove_MeasurementVector<T> observation_function(const PoseStateVector<T>& state, const PSMove_MeasurementVector<T> &observation_noise) const
     {
-        PSMove_MeasurementVector predicted_measurement;
+        PSMove_MeasurementVector<T> predicted_measurement;
 
 		// Extract the observation bias
-		const PSMove_MeasurementVector &observation_bias = R_mu;
-		const Eigen::Vector3d accel_bias = observation_bias.get_accelerometer();
-		const Eigen::Vector3d mag_bias = observation_bias.get_magnetometer();
-		const Eigen::Vector3d gyro_bias = observation_bias.get_gyroscope();
-		const Eigen::Vector3d position_bias = observation_bias.get_optical_position();
+		const PSMove_MeasurementVector<T> &observation_bias = R_mu;
+		const Vector3 accel_bias = observation_bias.get_accelerometer();
+		const Vector3 mag_bias = observation_bias.get_magnetometer();
+		const Vector3 gyro_bias = observation_bias.get_gyroscope();
+		const Vector3 position_bias = observation_bias.get_optical_position();
 
 		// Extract the observation noise
-		const Eigen::Vector3d accel_noise = observation_noise.get_accelerometer();
-		const Eigen::Vector3d mag_noise = observation_noise.get_magnetometer();
-		const Eigen::Vector3d gyro_noise = observation_noise.get_gyroscope();
-		const Eigen::Vector3d position_noise = observation_noise.get_optical_position();
+		const Vector3 accel_noise = observation_noise.get_accelerometer();
+		const Vector3 mag_noise = observation_noise.get_magnetometer();
+		const Vector3 gyro_noise = observation_noise.get_gyroscope();
+		const Vector3 position_noise = observation_noise.get_optical_position();
 
         // Use the position and orientation from the state for predictions
-        const Eigen::Vector3d position= state.get_position_meters();
-        const Eigen::Quaterniond orientation= state.get_quaternion();
+        const Vector3 position= state.get_position_meters();
+        const Quaternion orientation= state.get_quaternion();
 
         // Use the current linear acceleration from the state to predict
         // what the accelerometer reading will be (in world space)
-        const Eigen::Vector3d gravity_accel_g_units= identity_gravity_direction;
-        const Eigen::Vector3d linear_accel_g_units= state.get_linear_acceleration_m_per_sec_sqr() * k_ms2_to_g_units;
-        const Eigen::Vector3d accel_world= linear_accel_g_units + gravity_accel_g_units;
+        const Vector3 gravity_accel_g_units= identity_gravity_direction;
+        const Vector3 linear_accel_g_units= state.get_linear_acceleration_m_per_sec_sqr() * static_cast<T>(k_ms2_to_g_units);
+        const Vector3 accel_world= linear_accel_g_units + gravity_accel_g_units;
 
         // Put the accelerometer prediction into the local space of the controller
-		const Eigen::Quaterniond accel_world_quat(0.f, accel_world.x(), accel_world.y(), accel_world.z());
-		const Eigen::Vector3d accel_local = orientation*(accel_world_quat*orientation.conjugate()).vec();
+		const Quaternion accel_world_quat(0, accel_world.x(), accel_world.y(), accel_world.z());
+		const Vector3 accel_local = orientation*(accel_world_quat*orientation.conjugate()).vec();
 
         // Use the angular velocity from the state to predict what the gyro reading will be
-        const Eigen::Vector3d gyro_local= state.get_angular_velocity_rad_per_sec(); 
+        const Vector3 gyro_local= state.get_angular_velocity_rad_per_sec();
 
         // Use the orientation from the state to predict
         // what the magnetometer reading should be
-        const Eigen::Vector3d &mag_world= identity_magnetometer_direction;
-		const Eigen::Quaterniond mag_world_quat(0.f, mag_world.x(), mag_world.y(), mag_world.z());
-        const Eigen::Vector3d mag_local= orientation*(mag_world_quat*orientation.conjugate()).vec();
+        const Vector3 &mag_world= identity_magnetometer_direction;
+		const Quaternion mag_world_quat(0, mag_world.x(), mag_world.y(), mag_world.z());
+        const Vector3 mag_local= orientation*(mag_world_quat*orientation.conjugate()).vec();
 
         // Save the predictions into the measurement vector
         predicted_measurement.set_accelerometer(accel_local + accel_bias + accel_noise);
@@ -717,14 +787,14 @@ public:
     }
 
 public:
-    Eigen::Vector3d identity_gravity_direction;
-    Eigen::Vector3d identity_magnetometer_direction;
+    Vector3 identity_gravity_direction;
+    Vector3 identity_magnetometer_direction;
 
 	//! Measurement noise mean
-	Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1> R_mu;
+	Eigen::Matrix<T, PSMOVE_MEASUREMENT_PARAMETER_COUNT, 1> R_mu;
 
 	//! Measurement noise covariance
-	Eigen::Matrix<double, PSMOVE_MEASUREMENT_PARAMETER_COUNT, PSMOVE_MEASUREMENT_PARAMETER_COUNT> R_cov;
+	Eigen::Matrix<T, PSMOVE_MEASUREMENT_PARAMETER_COUNT, PSMOVE_MEASUREMENT_PARAMETER_COUNT> R_cov;
 };
 
 /**
@@ -733,14 +803,18 @@ public:
 * This is the measurement model for measuring the position and orientation of the DS4 controller.
 * The measurement is given by the optical trackers.
 */
+template<typename T>
 class DS4_MeasurementModel
 {
 public:
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+
     void init(const PoseFilterConstants &constants)
     {
 		update_measurement_statistics(constants, 0.f);
 
-		identity_gravity_direction= constants.orientation_constants.gravity_calibration_direction.cast<double>();
+		identity_gravity_direction= constants.orientation_constants.gravity_calibration_direction.cast<T>();
     }
 
 	void update_measurement_statistics(
@@ -761,35 +835,35 @@ public:
 		const double angle_axis_drift = 0.f;
 
 		// Update the biases
-		const Eigen::Vector3d acc_drift = constants.position_constants.accelerometer_drift.cast<double>();
-		const Eigen::Vector3d gyro_drift = constants.orientation_constants.gyro_drift.cast<double>();
-		R_mu(DS4_ACCELEROMETER_X, 1) = acc_drift.x();
-		R_mu(DS4_ACCELEROMETER_Y, 1) = acc_drift.y();
-		R_mu(DS4_ACCELEROMETER_Z, 1) = acc_drift.z();
-		R_mu(DS4_GYROSCOPE_X, 1) = gyro_drift.x();
-		R_mu(DS4_GYROSCOPE_Y, 1) = gyro_drift.y();
-		R_mu(DS4_GYROSCOPE_Z, 1) = gyro_drift.z();
-		R_mu(DS4_OPTICAL_POSITION_X, 1) = position_drift;
-		R_mu(DS4_OPTICAL_POSITION_Y, 1) = position_drift;
-		R_mu(DS4_OPTICAL_POSITION_Z, 1) = position_drift;
-		R_mu(DS4_OPTICAL_ANGLE_AXIS_X, 1) = angle_axis_drift;
-		R_mu(DS4_OPTICAL_ANGLE_AXIS_Y, 1) = angle_axis_drift;
-		R_mu(DS4_OPTICAL_ANGLE_AXIS_Z, 1) = angle_axis_drift;
+		const Vector3 acc_drift = constants.position_constants.accelerometer_drift.cast<T>();
+		const Vector3 gyro_drift = constants.orientation_constants.gyro_drift.cast<T>();
+		R_mu[DS4_ACCELEROMETER_X] = acc_drift.x();
+		R_mu[DS4_ACCELEROMETER_Y] = acc_drift.y();
+		R_mu[DS4_ACCELEROMETER_Z] = acc_drift.z();
+		R_mu[DS4_GYROSCOPE_X] = gyro_drift.x();
+		R_mu[DS4_GYROSCOPE_Y] = gyro_drift.y();
+		R_mu[DS4_GYROSCOPE_Z] = gyro_drift.z();
+		R_mu[DS4_OPTICAL_POSITION_X] = static_cast<T>(position_drift);
+		R_mu[DS4_OPTICAL_POSITION_Y] = static_cast<T>(position_drift);
+		R_mu[DS4_OPTICAL_POSITION_Z] = static_cast<T>(position_drift);
+		R_mu[DS4_OPTICAL_ANGLE_AXIS_X] = static_cast<T>(angle_axis_drift);
+		R_mu[DS4_OPTICAL_ANGLE_AXIS_Y] = static_cast<T>(angle_axis_drift);
+		R_mu[DS4_OPTICAL_ANGLE_AXIS_Z] = static_cast<T>(angle_axis_drift);
 
         // Update the measurement covariance R
-        R_cov = Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, DS4_MEASUREMENT_PARAMETER_COUNT>::Zero();
-		R_cov(DS4_ACCELEROMETER_X, DS4_ACCELEROMETER_X) = sqrt(R_SCALE*constants.position_constants.accelerometer_variance.x());
-		R_cov(DS4_ACCELEROMETER_Y, DS4_ACCELEROMETER_Y) = sqrt(R_SCALE*constants.position_constants.accelerometer_variance.y());
-		R_cov(DS4_ACCELEROMETER_Z, DS4_ACCELEROMETER_Z) = sqrt(R_SCALE*constants.position_constants.accelerometer_variance.z());
-		R_cov(DS4_GYROSCOPE_X, DS4_GYROSCOPE_X)= sqrt(R_SCALE*constants.orientation_constants.gyro_variance.x());
-		R_cov(DS4_GYROSCOPE_Y, DS4_GYROSCOPE_Y)= sqrt(R_SCALE*constants.orientation_constants.gyro_variance.y());
-		R_cov(DS4_GYROSCOPE_Z, DS4_GYROSCOPE_Z)= sqrt(R_SCALE*constants.orientation_constants.gyro_variance.z());
-		R_cov(DS4_OPTICAL_POSITION_X, DS4_OPTICAL_POSITION_X) = sqrt(R_SCALE*position_variance_m_sqr);
-		R_cov(DS4_OPTICAL_POSITION_Y, DS4_OPTICAL_POSITION_Y) = sqrt(R_SCALE*position_variance_m_sqr);
-		R_cov(DS4_OPTICAL_POSITION_Z, DS4_OPTICAL_POSITION_Z) = sqrt(R_SCALE*position_variance_m_sqr);
-        R_cov(DS4_OPTICAL_ANGLE_AXIS_X, DS4_OPTICAL_ANGLE_AXIS_X) = angle_axis_std_dev; 
-        R_cov(DS4_OPTICAL_ANGLE_AXIS_Y, DS4_OPTICAL_ANGLE_AXIS_Y) = angle_axis_std_dev;
-        R_cov(DS4_OPTICAL_ANGLE_AXIS_Z, DS4_OPTICAL_ANGLE_AXIS_Z) = angle_axis_std_dev;
+        R_cov = Eigen::Matrix<T, DS4_MEASUREMENT_PARAMETER_COUNT, DS4_MEASUREMENT_PARAMETER_COUNT>::Zero();
+		R_cov(DS4_ACCELEROMETER_X, DS4_ACCELEROMETER_X) = static_cast<T>(sqrt(R_SCALE*constants.position_constants.accelerometer_variance.x()));
+		R_cov(DS4_ACCELEROMETER_Y, DS4_ACCELEROMETER_Y) = static_cast<T>(sqrt(R_SCALE*constants.position_constants.accelerometer_variance.y()));
+		R_cov(DS4_ACCELEROMETER_Z, DS4_ACCELEROMETER_Z) = static_cast<T>(sqrt(R_SCALE*constants.position_constants.accelerometer_variance.z()));
+		R_cov(DS4_GYROSCOPE_X, DS4_GYROSCOPE_X)= static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.gyro_variance.x()));
+		R_cov(DS4_GYROSCOPE_Y, DS4_GYROSCOPE_Y)= static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.gyro_variance.y()));
+		R_cov(DS4_GYROSCOPE_Z, DS4_GYROSCOPE_Z)= static_cast<T>(sqrt(R_SCALE*constants.orientation_constants.gyro_variance.z()));
+		R_cov(DS4_OPTICAL_POSITION_X, DS4_OPTICAL_POSITION_X) = static_cast<T>(sqrt(R_SCALE*position_variance_m_sqr));
+		R_cov(DS4_OPTICAL_POSITION_Y, DS4_OPTICAL_POSITION_Y) = static_cast<T>(sqrt(R_SCALE*position_variance_m_sqr));
+		R_cov(DS4_OPTICAL_POSITION_Z, DS4_OPTICAL_POSITION_Z) = static_cast<T>(sqrt(R_SCALE*position_variance_m_sqr));
+        R_cov(DS4_OPTICAL_ANGLE_AXIS_X, DS4_OPTICAL_ANGLE_AXIS_X) = static_cast<T>(angle_axis_std_dev);
+        R_cov(DS4_OPTICAL_ANGLE_AXIS_Y, DS4_OPTICAL_ANGLE_AXIS_Y) = static_cast<T>(angle_axis_std_dev);
+        R_cov(DS4_OPTICAL_ANGLE_AXIS_Z, DS4_OPTICAL_ANGLE_AXIS_Z) = static_cast<T>(angle_axis_std_dev);
 	}
 
     /**
@@ -802,38 +876,38 @@ public:
     * @param [in] x The system state in current time-step
     * @returns The (predicted) sensor measurement for the system state
     */
-    DS4_MeasurementVector observation_function(const PoseStateVector& state, const DS4_MeasurementVector &observation_noise) const
+    DS4_MeasurementVector<T> observation_function(const PoseStateVector<T>& state, const DS4_MeasurementVector<T> &observation_noise) const
     {
-        DS4_MeasurementVector predicted_measurement;
+        DS4_MeasurementVector<T> predicted_measurement;
 
 		// Extract the observation bias
-		const DS4_MeasurementVector &observation_bias = R_mu;
-		const Eigen::Vector3d accel_bias = observation_bias.get_accelerometer();
-		const Eigen::Vector3d gyro_bias = observation_bias.get_gyroscope();
-		const Eigen::Vector3d position_bias = observation_bias.get_optical_position();
-		const Eigen::Quaterniond orientation_bias = observation_bias.get_optical_quaternion();
+		const DS4_MeasurementVector<T> &observation_bias = R_mu;
+		const Vector3 accel_bias = observation_bias.get_accelerometer();
+		const Vector3 gyro_bias = observation_bias.get_gyroscope();
+		const Vector3 position_bias = observation_bias.get_optical_position();
+		const Quaternion orientation_bias = observation_bias.get_optical_quaternion();
 
 		// Extract the observations noise
-		const Eigen::Vector3d accel_noise= observation_noise.get_accelerometer();
-		const Eigen::Vector3d gyro_noise= observation_noise.get_gyroscope();
-		const Eigen::Vector3d position_noise= observation_noise.get_optical_position();
-		const Eigen::Quaterniond orientation_noise= observation_noise.get_optical_quaternion();
+		const Vector3 accel_noise= observation_noise.get_accelerometer();
+		const Vector3 gyro_noise= observation_noise.get_gyroscope();
+		const Vector3 position_noise= observation_noise.get_optical_position();
+		const Quaternion orientation_noise= observation_noise.get_optical_quaternion();
 
         // Use the position and orientation from the state for predictions
-        const Eigen::Vector3d position= state.get_position_meters();
-        const Eigen::Quaterniond orientation= state.get_quaternion();
+        const Vector3 position= state.get_position_meters();
+        const Quaternion orientation= state.get_quaternion();
 
 		// Accelerometer = (linear acceleration + gravity) transformed to controller frame.
-        const Eigen::Vector3d gravity_accel_g_units= -identity_gravity_direction;
-        const Eigen::Vector3d linear_accel_g_units= state.get_linear_acceleration_m_per_sec_sqr() * k_ms2_to_g_units;
-        const Eigen::Vector3d accel_world= linear_accel_g_units + gravity_accel_g_units;
-        const Eigen::Quaterniond accel_world_quat(0.f, accel_world.x(), accel_world.y(), accel_world.z());
+        const Vector3 gravity_accel_g_units= -identity_gravity_direction;
+        const Vector3 linear_accel_g_units= state.get_linear_acceleration_m_per_sec_sqr() * static_cast<T>(k_ms2_to_g_units);
+        const Vector3 accel_world= linear_accel_g_units + gravity_accel_g_units;
+        const Quaternion accel_world_quat(0, accel_world.x(), accel_world.y(), accel_world.z());
 
         // Put the accelerometer prediction into the local space of the controller
-        const Eigen::Vector3d accel_local= orientation*(accel_world_quat*orientation.conjugate()).vec();
+        const Vector3 accel_local= orientation*(accel_world_quat*orientation.conjugate()).vec();
 
         // Gyroscope = angular velocity (both rad/sec)
-        const Eigen::Vector3d gyro_local= state.get_angular_velocity_rad_per_sec(); 
+        const Vector3 gyro_local= state.get_angular_velocity_rad_per_sec();
 
         // Save the predictions into the measurement vector
         predicted_measurement.set_accelerometer(accel_local + accel_bias + accel_noise);
@@ -846,40 +920,40 @@ public:
     }
 
 public:
-    Eigen::Vector3d identity_gravity_direction;
+    Vector3 identity_gravity_direction;
 
 	//! Measurement noise mean
-	Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, 1> R_mu;
+	Eigen::Matrix<T, DS4_MEASUREMENT_PARAMETER_COUNT, 1> R_mu;
 
 	//! Measurement noise covariance
-	Eigen::Matrix<double, DS4_MEASUREMENT_PARAMETER_COUNT, DS4_MEASUREMENT_PARAMETER_COUNT> R_cov;
+	Eigen::Matrix<T, DS4_MEASUREMENT_PARAMETER_COUNT, DS4_MEASUREMENT_PARAMETER_COUNT> R_cov;
 };
 
-template <int S_DIM, int Q_DIM, int R_DIM>
+template <typename T, int S_DIM, int Q_DIM, int R_DIM>
 class SigmaPointWeights
 {
 public:
 	static const int L_DIM = 1 + 2*S_DIM + 2*Q_DIM + 2*R_DIM;
 
 	/// Scaling factor for the sigma points
-	double zeta;
+	T zeta;
 
 	/// Sigma weights (m)
-	Eigen::Matrix<double, L_DIM, 1> wm;
+	Eigen::Matrix<T, L_DIM, 1> wm;
 
 	/// Sigma weights (c)
-	Eigen::Matrix<double, L_DIM, 1> wc;
+	Eigen::Matrix<T, L_DIM, 1> wc;
 
-	double w_qr;
-	double w_cholup;
+	T w_qr;
+	T w_cholup;
 
 	SigmaPointWeights()
 	{
-		zeta = 0.0;
-		wm = Eigen::Matrix<double, L_DIM, 1>::Zero();
-		wc = Eigen::Matrix<double, L_DIM, 1>::Zero();
-		w_qr = 0.0;
-		w_cholup = 0.0;
+		zeta = 0;
+		wm = Eigen::Matrix<T, L_DIM, 1>::Zero();
+		wc = Eigen::Matrix<T, L_DIM, 1>::Zero();
+		w_qr = 0;
+		w_cholup = 0;
 	}
 
 	/**
@@ -888,7 +962,7 @@ public:
 	* @param [in] kappa Secondary scaling parameter (usually 0)
 	*/
 	void init(double alpha, double beta, double kappa)
-	{	
+	{
 		// Compute the augmented state size
 		// TODO: this isn't the state size
 		const double L = static_cast<double>(S_DIM + Q_DIM + R_DIM);
@@ -899,7 +973,7 @@ public:
 		double lambda = alpha * alpha * (L + kappa) - L;
 
 		// Scaling factor for sigma points.
-		zeta = sqrt(L + lambda);
+		zeta = static_cast<T>(sqrt(L + lambda));
 
 		// Make sure L != -lambda to avoid division by zero
 		assert(fabs(L + lambda) > 1e-6);
@@ -910,15 +984,15 @@ public:
 		// Fill in the mean-weights
 		double wm_0 = lambda / (L + lambda);
 		double wm_rest = 0.5 / (L + lambda);
-			
+
 		// Make sure wm_rest > 0 to avoid square-root of negative number
 		assert(wm_rest > 0.0);
 
 		// wm = weights for calculating mean(both process and observation)
-		wm[0] = wm_0;
+		wm[0] = static_cast<T>(wm_0);
 		for (int point_index = 1; point_index < L_DIM; ++point_index)
 		{
-			wm[point_index] = wm_rest;
+			wm[point_index] = static_cast<T>(wm_rest);
 		}
 
 		// Fill in the covariance-weights
@@ -926,23 +1000,28 @@ public:
 		double wc_rest = wm_rest;
 
 		// wc = weights for calculating covariance(proc., obs., proc - obs)
-		wc[0] = wc_0;
+		wc[0] = static_cast<T>(wc_0);
 		for (int point_index = 1; point_index < L_DIM; ++point_index)
 		{
-			wc[point_index] = wc_rest;
+			wc[point_index] = static_cast<T>(wc_rest);
 		}
 
 		// For SRUKF, we also need sqrt of wc_rest for chol update.
-		w_qr = sqrt(wc[1]);
-		w_cholup = sqrt(fabs(wc(0)));
+		w_qr = static_cast<T>(sqrt(wc_rest));
+		w_cholup = static_cast<T>(sqrt(fabs(wc_0)));
 	}
 };
 
 // Specialized Square Root Unscented Kalman Filter (SR-UKF)
+// Runs in the scalar type of the measurement (float or double).
+// Sigma points are stored one per row so that the process model runs over every point
+// with one vectorized operation per state column, and all working storage is fixed size.
 template<class MeasurementModelType, class Measurement>
 class PoseSRUFK
 {
 public:
+	typedef typename Measurement::Scalar T;
+
 	// State vector: posx, velx, accx, posy, vely, accy, posz, velz, accz, qw, qx, qy, qz, avelx, avely, avelz
 	// Units: pos: m, vel: m/s, acc: m/s^2, orient. in quat, avel: rad/s
 	static const int X_DIM = STATE_PARAMETER_COUNT;
@@ -959,40 +1038,55 @@ public:
 	static const int L_DIM = SIGMA_POINT_COUNT + 2*Q_DIM + 2*R_DIM;
 
 	//! Type of the state vector
-	typedef PoseStateVector State;
-        
+	typedef PoseStateVector<T> State;
+
+	//! Type of the process noise vector
+	typedef PoseNoiseVector<T> Noise;
+
 	//! Estimated state
 	State x;
 
 	//! Lower-triangular Cholesky factor of state covariance
-	Eigen::Matrix<double, S_DIM, S_DIM> S;
+	Eigen::Matrix<T, S_DIM, S_DIM> S;
 
 	//! Process noise mean
-	PoseNoiseVector Q_mu;
+	Noise Q_mu;
 
 	//! The "square root" of the process noise covariance a.k.a. the lower part of the Choleskly
-	Eigen::Matrix<double, Q_DIM, Q_DIM> Q_cov;
+	Eigen::Matrix<T, Q_DIM, Q_DIM> Q_cov;
 
 	MeasurementModelType measurement_model;
 
-	SigmaPointWeights<S_DIM, Q_DIM, R_DIM> W;
-
-	// Sigma points at time t = k - 1
-	Eigen::Matrix<double, X_DIM, SIGMA_POINT_COUNT> X_t;
+	SigmaPointWeights<T, S_DIM, Q_DIM, R_DIM> W;
 
-	// Augmented Sigma points propagated through process function to time k
-	Eigen::Matrix<double, X_DIM, L_DIM> X_k;
+	// Augmented Sigma points propagated through process function to time k (one point per row)
+	Eigen::Matrix<T, L_DIM, X_DIM> X_k;
 
 	// State estimate = weighted sum of sigma points
-	PoseStateVector x_k;
+	State x_k;
 
-	// Propagated sigma point residuals = (sp - x_k)
-	Eigen::Matrix<double, S_DIM, L_DIM> X_k_r;
+	// Propagated sigma point residuals = (sp - x_k) (one point per row)
+	Eigen::Matrix<T, L_DIM, S_DIM> X_k_r;
 
 	// Upper - triangular of propagated sp covariance
-	Eigen::Matrix<double, S_DIM, S_DIM > Sx_k;
-                    
+	Eigen::Matrix<T, S_DIM, S_DIM > Sx_k;
+
+	// +/- zeta*S offsets of the sigma points after the first one, and their angle-axis part as quaternions
+	Eigen::Matrix<T, 2 * S_DIM, S_DIM> sigma_point_offsets;
+	Eigen::Matrix<T, 2 * S_DIM, 4> sigma_point_rotations;
+
+	// Process noise of every sigma point (Q_mu plus +/- zeta*Q_cov on the process noise block).
+	// Only depends on the filter constants so it's computed once in init().
+	Eigen::Matrix<T, L_DIM, Q_DIM> process_noise_offsets;
+	Eigen::Matrix<T, L_DIM, 4> process_noise_rotations;
+
+	// Scratch space for the per-point orientation updates
+	Eigen::Matrix<T, L_DIM, 4> rotation_deltas;
+	Eigen::Matrix<T, L_DIM, 4> rotation_products;
+
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
 	PoseSRUFK()
 	{
 		// Setup state and covariance
@@ -1003,8 +1097,8 @@ public:
 	}
 
 	void init(
-		const PoseFilterConstants &constants, 
-		const Eigen::Vector3f &position, 
+		const PoseFilterConstants &constants,
+		const Eigen::Vector3f &position,
 		const Eigen::Quaternionf &orientation)
 	{
 		const double mean_position_dT = constants.position_constants.mean_update_time_delta;
@@ -1019,12 +1113,13 @@ public:
 			//	constants.orientation_constants.max_orientation_variance) * 0.5f* Q_SCALE;
 
 		// TODO: Initial guess at state covariance square root from filter constants?
-		S = Eigen::Matrix<double, S_DIM, S_DIM>::Identity() * 0.01;
+		S = Eigen::Matrix<T, S_DIM, S_DIM>::Identity() * static_cast<T>(0.01);
 
 		// Process noise should be mean-zero, I think.
-		Q_mu = Eigen::Matrix<double, Q_DIM, 1>::Zero();
+		Q_mu = Eigen::Matrix<T, Q_DIM, 1>::Zero();
 
 		// Initialize the process covariance matrix Q
+		// (always in double precision, the tiny dT^7 terms underflow a float Cholesky)
 		Eigen::Matrix<double, Q_DIM, Q_DIM> Q_cov_init=
 			Eigen::Matrix<double, Q_DIM, Q_DIM>::Zero();
 		process_3rd_order_noise(mean_position_dT, Q_SCALE, POSITION_X, Q_cov_init);
@@ -1037,99 +1132,43 @@ public:
 //		Q_cov_init.block<6, 6>(9, 9) = Eigen::Matrix<double, 6, 6>::Identity()*0.1;
 
 		// Compute the std-deviation Q matrix a.k.a. the sqrt of Q_cov_init a.k.a the Cholesky
-		Q_cov= Q_cov_init.llt().matrixL();
+		const Eigen::Matrix<double, Q_DIM, Q_DIM> Q_cov_sqrt= Q_cov_init.llt().matrixL();
+		Q_cov= Q_cov_sqrt.template cast<T>();
 
 		// Initialize the measurement noise
 		measurement_model.init(constants);
 
 		// Set the initial state
 		x.setZero();
-		x.set_position_meters(position.cast<double>());
-		x.set_quaternion(orientation.cast<double>());
+		x.set_position_meters(position.template cast<T>());
+		x.set_quaternion(orientation.template cast<T>());
 
 		//%% 1. Initialize the sigma point weights
 		W.init(k_ukf_alpha, k_ukf_beta, k_ukf_kappa);
-	}
 
-	/**
-	* @brief Definition of (non-linear) state transition function
-	*
-	* This function defines how the system state is propagated through time,
-	* i.e. it defines in which state \f$\hat{x}_{k+1}\f$ is system is expected to
-	* be in time-step \f$k+1\f$ given the current state \f$x_k\f$ in step \f$k\f$ and
-	* the system control input \f$u\f$.
-	*
-	* @param [in] old_state The system state in current time-step
-	* @param [in] process_noise The control vector input
-	* @returns The (predicted) system state in the next time-step
-	*/
-	PoseStateVector process_function(
-		const PoseStateVector& old_state,  
-		const PoseNoiseVector& zQ_cov,
-		const float deltaTime) const
-	{
-		//! Predicted state vector after transition
-		PoseStateVector new_state;
-
-		// Extract parameters from the old state
-		const Eigen::Vector3d old_position = old_state.get_position_meters();
-		const Eigen::Vector3d old_linear_velocity = old_state.get_linear_velocity_m_per_sec();
-		const Eigen::Vector3d old_linear_acceleration = old_state.get_linear_acceleration_m_per_sec_sqr();
-		const Eigen::Quaterniond old_orientation = old_state.get_quaternion();
-		const Eigen::Vector3d old_angular_velocity = old_state.get_angular_velocity_rad_per_sec();
-
-		// Extract parameters from process noise mean
-		const Eigen::Vector3d position_bias = Q_mu.get_position_noise();
-		const Eigen::Vector3d linear_velocity_bias = Q_mu.get_linear_velocity_noise();
-		const Eigen::Vector3d linear_acceleration_bias = Q_mu.get_linear_acceleration_noise();
-		const Eigen::Quaterniond orientation_bias = Q_mu.get_quaternion_noise();
-		const Eigen::Vector3d angular_velocity_bias = Q_mu.get_angular_velocity_noise();
-
-		// Extract parameters from process noise variance
-		const Eigen::Vector3d position_noise = zQ_cov.get_position_noise();
-		const Eigen::Vector3d linear_velocity_noise = zQ_cov.get_linear_velocity_noise();
-		const Eigen::Vector3d linear_acceleration_noise = zQ_cov.get_linear_acceleration_noise();
-		const Eigen::Quaterniond orientation_noise = zQ_cov.get_quaternion_noise();
-		const Eigen::Vector3d angular_velocity_noise = zQ_cov.get_angular_velocity_noise();
-
-		// Compute the position state update
-		const Eigen::Vector3d new_position =
-			old_position
-			+ old_linear_velocity*deltaTime
-			+ old_linear_acceleration*deltaTime*deltaTime*0.5f
-			+ position_bias
-			+ position_noise;
-		const Eigen::Vector3d new_linear_velocity = 
-			old_linear_velocity 
-			+ old_linear_acceleration*deltaTime
-			+ linear_velocity_bias
-			+ linear_velocity_noise;
-		const Eigen::Vector3d new_linear_acceleration = 
-			old_linear_acceleration
-			+ linear_acceleration_bias
-			+ linear_acceleration_noise;
-		const Eigen::Vector3d new_angular_velocity =
-			old_angular_velocity
-			+ angular_velocity_bias
-			+ angular_velocity_noise;
-
-		// Compute the orientation update
-		// From Kraft or Enayati:
-		const Eigen::Quaterniond q_delta = eigen_angle_axis_to_quaterniond(old_angular_velocity * deltaTime);
-		const Eigen::Quaterniond new_orientation = 
-			(old_orientation 
-			* q_delta
-			* orientation_bias
-			* orientation_noise).normalized();
-
-		// Save results to the new state
-		new_state.set_position_meters(new_position);
-		new_state.set_linear_velocity_m_per_sec(new_linear_velocity);
-		new_state.set_linear_acceleration_m_per_sec_sqr(new_linear_acceleration);
-		new_state.set_quaternion(new_orientation);
-		new_state.set_angular_velocity_rad_per_sec(new_angular_velocity);
-
-		return new_state;
+		// Every sigma point gets the process noise mean.
+		// The process noise block gets +/- the scaled process noise on top of that:
+		// [Q_mu | Q_mu | Q_mu | Q_mu + z*Q.cov | Q_mu - z*Q_cov | Q_mu]
+		process_noise_offsets.setZero();
+		process_noise_offsets.template middleRows<Q_DIM>(SIGMA_POINT_COUNT) = Q_cov.transpose() * W.zeta;
+		process_noise_offsets.template middleRows<Q_DIM>(SIGMA_POINT_COUNT + Q_DIM) = -Q_cov.transpose() * W.zeta;
+
+		// The noise orientation is applied after the bias orientation
+		const Eigen::Quaternion<T> orientation_bias = Q_mu.get_quaternion_noise();
+		angle_axis_rows_to_quaternion_rows(
+			process_noise_offsets.col(NOISE_ANGLE_AXIS_X),
+			process_noise_offsets.col(NOISE_ANGLE_AXIS_Y),
+			process_noise_offsets.col(NOISE_ANGLE_AXIS_Z),
+			static_cast<T>(1),
+			rotation_deltas);
+		process_noise_rotations.col(0).setConstant(orientation_bias.w());
+		process_noise_rotations.col(1).setConstant(orientation_bias.x());
+		process_noise_rotations.col(2).setConstant(orientation_bias.y());
+		process_noise_rotations.col(3).setConstant(orientation_bias.z());
+		multiply_quaternion_rows(process_noise_rotations, rotation_deltas, rotation_products);
+		process_noise_rotations = rotation_products;
+
+		process_noise_offsets.rowwise() += Q_mu.transpose();
 	}
 
 	/**
@@ -1139,7 +1178,7 @@ public:
 	*/
 	void predict(const float deltaTime)
 	{
-		const int nsp = SIGMA_POINT_COUNT;
+		const T dT = static_cast<T>(deltaTime);
 
 		// In the below variables, the subscripts are as follows
 		// k is the next / predicted time point
@@ -1170,73 +1209,90 @@ public:
 		// are really the only sigma points we need to create right now.
 
 		// The 1st sigma - point is just the state vector.
-		// Each remaining sigma - point is the state + / -the scaled sqrt covariance.
-/*
-		X_t.leftCols<1>() = x;
-		for (int col_offset = 0; col_offset < S_DIM; ++col_offset)
-		{
-			// zS is scaled sqrt cov.
-			const PoseNoiseVector zS = S.block<S_DIM, 1>(0, col_offset) * W.zeta;
+		X_k.template topRows<SIGMA_POINT_COUNT>().rowwise() = x.transpose();
+
+		// Each of the next 2 * S_DIM sigma points is the state + / -the scaled sqrt covariance.
+		// zS is scaled sqrt cov.
+		sigma_point_offsets.template topRows<S_DIM>() = S.transpose() * W.zeta;
+		sigma_point_offsets.template bottomRows<S_DIM>() = -sigma_point_offsets.template topRows<S_DIM>();
+		angle_axis_rows_to_quaternion_rows(
+			sigma_point_offsets.col(NOISE_ANGLE_AXIS_X),
+			sigma_point_offsets.col(NOISE_ANGLE_AXIS_Y),
+			sigma_point_offsets.col(NOISE_ANGLE_AXIS_Z),
+			static_cast<T>(1),
+			sigma_point_rotations);
+		add_noise_rows(
+			X_k.template middleRows<2 * S_DIM>(1),
+			sigma_point_offsets,
+			sigma_point_rotations,
+			rotation_products.template topRows<2 * S_DIM>());
 
-			X_t.block<X_DIM, 1>(0, 1 + col_offset) = x + zS;
-			X_t.block<X_DIM, 1>(0, 1 + S_DIM + col_offset) = x - zS;
-		}
-*/
 		// We now have our minimal sigma points : [x x + zS x - zS]
 		// Note : We could add Q(not sqrt) to P(= SS^T) before calculating S, and
 		// before calculating the sigma points.This would eliminate the need to add
 		// Q in the process function.
 
 		// 3. Propagate sigma points through process function
-		// Note that X_k is larger than X_t because the process noise added more state vectors.
-		// [p(x_t) + Q_mu | p(x_t + zS) + Q_mu | p(x_t - zS) + Q_mu | p(x_t) + Q_mu + z*Q.cov | p(x_t) + Q_mu - z*Q_cov]
-		for (int point_index = 0; point_index < nsp; ++point_index)
+		// [p(x_t) + Q_mu | p(x_t + zS) + Q_mu | p(x_t - zS) + Q_mu | p(x_t) + Q_mu + z*Q.cov | p(x_t) + Q_mu - z*Q_cov | p(x_t) + Q_mu]
 		{
-			X_k.col(point_index) = 
-				process_function(
-					X_t.col(point_index), 
-					PoseNoiseVector::Zero(),
-					deltaTime);
-		}
-		for (int Q_col = 0; Q_col < Q_DIM; ++Q_col)
-		{
-			const PoseNoiseVector zQ = Q_cov.col(Q_col) * W.zeta;
-
-			X_k.col(nsp + Q_col) =
-				process_function(
-					x,
-					zQ,
-					deltaTime);
-			X_k.col(nsp + Q_DIM + Q_col) =
-				process_function(
-					x,
-					zQ.negate(),
-					deltaTime);
+			typename Eigen::Matrix<T, L_DIM, X_DIM>::template NRowsBlockXpr<SIGMA_POINT_COUNT>::Type X_t =
+				X_k.template topRows<SIGMA_POINT_COUNT>();
+
+			// Compute the orientation update
+			// From Kraft or Enayati: q_k = q_t * q_delta(w_t * dT)
+			angle_axis_rows_to_quaternion_rows(
+				X_t.col(ANGULAR_VELOCITY_X),
+				X_t.col(ANGULAR_VELOCITY_Y),
+				X_t.col(ANGULAR_VELOCITY_Z),
+				dT,
+				rotation_deltas.template topRows<SIGMA_POINT_COUNT>());
+			multiply_quaternion_rows(
+				X_t.template middleCols<4>(ORIENTATION_W),
+				rotation_deltas.template topRows<SIGMA_POINT_COUNT>(),
+				rotation_products.template topRows<SIGMA_POINT_COUNT>());
+			X_t.template middleCols<4>(ORIENTATION_W) = rotation_products.template topRows<SIGMA_POINT_COUNT>();
+
+			// Compute the position state update (each axis is stored as [pos, vel, acc])
+			const T half_dT_sqr = static_cast<T>(0.5)*dT*dT;
+			for (int position_index = POSITION_X; position_index <= POSITION_Z; position_index += 3)
+			{
+				X_t.col(position_index) +=
+					X_t.col(position_index + 1)*dT
+					+ X_t.col(position_index + 2)*half_dT_sqr;
+				X_t.col(position_index + 1) += X_t.col(position_index + 2)*dT;
+			}
 		}
 
-		// Extend X_k with 2 * filt_struct.R.dim repeats of the first column
-		// This emulates the rest of the augmented matrix. It's necessary to extend
-		// it here because the weights only work with the correct number of columns.
-		PoseStateVector X_k_0 = X_k.col(0);
-//		X_k.rightCols<2 * R_DIM>() = X_k_0.replicate<1, 2*R_DIM>();
+		// The rest of the points only differ from p(x_t) by their process noise.
+		// Extend X_k with repeats of the first row (the weights only work with the full augmented set of points).
+		X_k.template bottomRows<L_DIM - SIGMA_POINT_COUNT>().rowwise() = X_k.row(0);
+
+		// Apply the process noise
+		add_noise_rows(X_k, process_noise_offsets, process_noise_rotations, rotation_products);
 
 		// 4. Estimate mean state from weighted sum of propagated sigma points
-		x_k = X_k * W.wm;
-		PoseStateVector::special_state_mean<L_DIM>(X_k, W.wm, x_k);
+		x_k.noalias() = X_k.transpose() * W.wm;
+		State::template special_state_mean<L_DIM>(X_k, W.wm, x_k);
 
 		// 5. Get residuals in S - format
-		for (int col_offset = 0; col_offset < L_DIM; ++col_offset)
-		{
-			// Subtract the states (with quaternion orientation) 
-			// and then convert to a noise vector (with an angle axis orientation)
-			X_k_r.col(col_offset) = convert_state_to_noise_vector(X_k.col(col_offset) - x_k);
-		}
+		// Subtract the states (with quaternion orientation)
+		// and then convert to a noise vector (with an angle axis orientation)
+		X_k_r.template leftCols<9>() = X_k.template leftCols<9>().rowwise() - x_k.template head<9>().transpose();
+		X_k_r.col(NOISE_ANGULAR_VELOCITY_X).array() = X_k.col(ANGULAR_VELOCITY_X).array() - x_k[ANGULAR_VELOCITY_X];
+		X_k_r.col(NOISE_ANGULAR_VELOCITY_Y).array() = X_k.col(ANGULAR_VELOCITY_Y).array() - x_k[ANGULAR_VELOCITY_Y];
+		X_k_r.col(NOISE_ANGULAR_VELOCITY_Z).array() = X_k.col(ANGULAR_VELOCITY_Z).array() - x_k[ANGULAR_VELOCITY_Z];
+		multiply_quaternion_rows(X_k.template middleCols<4>(ORIENTATION_W), x_k.get_quaternion().conjugate(), rotation_products);
+		quaternion_rows_to_angle_axis_rows(
+			rotation_products,
+			X_k_r.col(NOISE_ANGLE_AXIS_X),
+			X_k_r.col(NOISE_ANGLE_AXIS_Y),
+			X_k_r.col(NOISE_ANGLE_AXIS_Z));
 
 		// 6. Estimate state covariance(sqrt)
 		// w_qr is scalar
 		// QR update of state Cholesky factor.
 		// w_qr and w_cholup cannot be negative
-//		Eigen::Matrix<double, L_DIM - 1, S_DIM > qr_input = (W.w_qr*X_k_r.rightCols<L_DIM - 1>()).transpose();
+//		Eigen::Matrix<T, L_DIM - 1, S_DIM > qr_input = W.w_qr*X_k_r.template bottomRows<L_DIM - 1>();
 
 		// TODO: Use ColPivHouseholderQR
 //		Eigen::HouseholderQR<decltype(qr_input)> qr(qr_input);
@@ -1244,11 +1300,11 @@ public:
 		// Set R matrix as upper triangular square root
 		// NOTE: R matrix is stored in upper triangular half
 		// See: http://math.stackexchange.com/questions/1396308/qr-decomposition-results-in-eigen-library-differs-from-matlab
-//		Sx_k = qr.matrixQR().topLeftCorner<S_DIM, S_DIM>().triangularView<Eigen::Upper>();
+//		Sx_k = qr.matrixQR().template topLeftCorner<S_DIM, S_DIM>().template triangularView<Eigen::Upper>();
 
 		// Perform additional rank 1 update
-		float wc0_sign = static_cast<float>(sgn(W.wc(0)));
-//		Sx_k.selfadjointView<Eigen::Upper>().rankUpdate(X_k_r.leftCols<1>(), W.w_cholup*wc0_sign);
+//		T wc0_sign = static_cast<T>(sgn(W.wc(0)));
+//		Sx_k.template selfadjointView<Eigen::Upper>().rankUpdate(X_k_r.template topRows<1>().transpose(), W.w_cholup*wc0_sign);
 	}
 
 	/**
@@ -1262,17 +1318,17 @@ public:
 		// 1. Propagate sigma points through observation function.
 		const int nsp = SIGMA_POINT_COUNT;
 		const int R_inds = (nsp - 2 * R_DIM);
-		Eigen::Matrix<double, O_DIM, L_DIM> Y_k;
+		Eigen::Matrix<T, L_DIM, O_DIM> Y_k;
 
 		// Pass the first 5 blocks of the sigma points through the observation function
 		// with zero measurement covariance applied
 		// obs([p(x_t) + Q_mu | p(x_t + zS) + Q_mu | p(x_t - zS) + Q_mu | p(x_t) + Q_mu + z*Q.cov | p(x_t) + Q_mu - z*Q_cov], 0)
 		for (int point_index = 0; point_index < R_inds; ++point_index)
 		{
-			Y_k.col(point_index) =
+			Y_k.row(point_index) =
 				measurement_model.observation_function(
-					X_k.col(point_index),
-					Measurement::Zero()); // zero measurement covariance
+					X_k.row(point_index).transpose(),
+					Measurement::Zero()).transpose(); // zero measurement covariance
 		}
 		// Pass the last two blocks of the sigma points through the observation function
 		// with the scaled measurement covariance applied
@@ -1282,33 +1338,33 @@ public:
 		{
 			const Measurement zR = measurement_model.R_cov.col(R_col) * W.zeta;
 
-			Y_k.col(R_inds + R_col) =
+			Y_k.row(R_inds + R_col) =
 				measurement_model.observation_function(
-					X_k.col(R_inds + R_col),
-					zR);
-			Y_k.col(R_inds + R_DIM + R_col) =
+					X_k.row(R_inds + R_col).transpose(),
+					zR).transpose();
+			Y_k.row(R_inds + R_DIM + R_col) =
 				measurement_model.observation_function(
-					X_k.col(R_inds + R_DIM + R_col),
-					zR.negate());
+					X_k.row(R_inds + R_DIM + R_col).transpose(),
+					zR.negate()).transpose();
 		}
 
 		// 2. Calculate observation mean.
-		Measurement y_k = Measurement::computeWeightedMeasurementAverage<L_DIM>(Y_k, W.wm);
+		Measurement y_k = Measurement::template computeWeightedMeasurementAverage<L_DIM>(Y_k, W.wm);
 
 		// 3. Calculate y - residuals.
 		// Used in observation covariance and state - observation cross - covariance for Kalman gain.
 
-		Eigen::Matrix<double, O_DIM, L_DIM>  Y_k_r;
-		for (int col_offset = 0; col_offset < L_DIM; ++col_offset)
+		Eigen::Matrix<T, L_DIM, O_DIM>  Y_k_r;
+		for (int row_offset = 0; row_offset < L_DIM; ++row_offset)
 		{
-			Y_k_r.col(col_offset)= Measurement(Y_k.col(col_offset)) - y_k;
+			Y_k_r.row(row_offset)= (Measurement(Y_k.row(row_offset).transpose()) - y_k).transpose();
 		}
-        
+
 		// 4. Calculate observation sqrt covariance
 		// w_qr is scalar
 		// QR update of state Cholesky factor.
 		// w_qr and w_cholup cannot be negative
-		Eigen::Matrix<double, L_DIM - 1, O_DIM> qr_input = (W.w_qr*Y_k_r.rightCols<L_DIM - 1>()).transpose();
+		Eigen::Matrix<T, L_DIM - 1, O_DIM> qr_input = W.w_qr*Y_k_r.template bottomRows<L_DIM - 1>();
 
 		// TODO: Use ColPivHouseholderQR
 		Eigen::HouseholderQR<decltype(qr_input)> qr(qr_input);
@@ -1316,43 +1372,41 @@ public:
 		// Set R matrix as upper triangular square root
 		// NOTE: R matrix is stored in upper triangular half
 		// See: http://math.stackexchange.com/questions/1396308/qr-decomposition-results-in-eigen-library-differs-from-matlab
-		Eigen::Matrix<double, O_DIM, O_DIM > Sy_k = qr.matrixQR().topLeftCorner<O_DIM, O_DIM>().triangularView<Eigen::Upper>();
+		Eigen::Matrix<T, O_DIM, O_DIM > Sy_k = qr.matrixQR().template topLeftCorner<O_DIM, O_DIM>().template triangularView<Eigen::Upper>();
 
 		// Perform additional rank 1 update
-		float wc0_sign = (W.wc(0) > 0.f) ? 1.f : -1.f;
-		Sy_k.selfadjointView<Eigen::Upper>().rankUpdate(Y_k_r.leftCols<1>(), W.w_cholup*wc0_sign);
+		T wc0_sign = (W.wc(0) > 0) ? 1 : -1;
+		Sy_k.template selfadjointView<Eigen::Upper>().rankUpdate(Y_k_r.template topRows<1>().transpose(), W.w_cholup*wc0_sign);
 
 		// 5. Calculate Kalman Gain
 		//First calculate state - observation cross(sqrt) covariance
-		const Eigen::Matrix<double, 1, L_DIM> wc = W.wc.transpose();
-		const Eigen::Matrix<double, S_DIM, L_DIM> wc_repl = wc.replicate<S_DIM, 1>();
-		const Eigen::Matrix<double, S_DIM, O_DIM> Pxy=
-			X_k_r.cwiseProduct(wc_repl).eval() * Y_k_r.transpose();
+		const Eigen::Matrix<T, S_DIM, O_DIM> Pxy=
+			X_k_r.transpose() * W.wc.asDiagonal() * Y_k_r;
 
 		// In the Matlab code: KG = (Pxy / Sy_k')/Sy_k
-		// where "/" is the "mrdivide" operator, 
-		// x = B/A solves the system of linear equations A*x = B for x. 
+		// where "/" is the "mrdivide" operator,
+		// x = B/A solves the system of linear equations A*x = B for x.
 		// I arrived at the following through trial and error
-		Eigen::Matrix<double, O_DIM, S_DIM> numerator = Sy_k.transpose().colPivHouseholderQr().solve(Pxy.transpose());
-		Eigen::Matrix<double, S_DIM, O_DIM> KG = Sy_k.colPivHouseholderQr().solve(numerator).transpose();
+		Eigen::Matrix<T, O_DIM, S_DIM> numerator = Sy_k.transpose().colPivHouseholderQr().solve(Pxy.transpose());
+		Eigen::Matrix<T, S_DIM, O_DIM> KG = Sy_k.colPivHouseholderQr().solve(numerator).transpose();
 
-		//Eigen::Matrix<double, X_DIM, O_DIM> KG = Pxy * Sy_k.inverse();
+		//Eigen::Matrix<T, X_DIM, O_DIM> KG = Pxy * Sy_k.inverse();
 
 		// 6. Calculate innovation
 		Measurement innov = observation - y_k;
 
 		// 7. State update / correct
 		// ReBeL srukf doesn't do anything special for angles to get upd.
-		PoseStateVector upd= convert_noise_to_state_vector(KG*innov);
+		State upd= convert_noise_to_state_vector<T>(KG*innov);
 		x = x_k + upd;
 
 		// 8. Covariance update / correct
 		// This is equivalent to : Px = Px_ - KG*Py*KG';
-		Eigen::Matrix<double, S_DIM, O_DIM> cov_update_vectors = KG * Sy_k;
+		Eigen::Matrix<T, S_DIM, O_DIM> cov_update_vectors = KG * Sy_k;
 		for (int j = 0; j < O_DIM; ++j)
 		{
 			// Still UPPER
-			Sx_k.selfadjointView<Eigen::Upper>().rankUpdate(cov_update_vectors.col(j), -1.0);
+			Sx_k.template selfadjointView<Eigen::Upper>().rankUpdate(cov_update_vectors.col(j), -1);
 		}
 
 		S = Sx_k.transpose(); // LOWER sqrt-covariance saved for next predict.
@@ -1363,6 +1417,8 @@ public:
 class KalmanPoseFilterImpl
 {
 public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
     /// Is the current fusion state valid
     bool bIsValid;
 
@@ -1372,19 +1428,26 @@ public:
 	/// True if we have seen a valid orientation measurement (>0 orientation quality)
 	bool bSeenOrientationMeasurement;
 
-    /// Quaternion measured when controller points towards camera 
+    /// Quaternion measured when controller points towards camera
     Eigen::Quaternionf reset_orientation;
 
-    /// Position that's considered the origin position 
+    /// Position that's considered the origin position
     Eigen::Vector3f origin_position; // meters
 
-    /// The last published state from the filter
-	PoseStateVector state;
+    /// The last published state from the filter (always double, whatever precision the filter runs at)
+	PoseStateVectord state;
+
+	/// The mean predicted by the last update, before measurement correction (always double too)
+	PoseStateVectord predicted_state;
 
 	KalmanPoseFilterImpl()
     {
     }
 
+	virtual ~KalmanPoseFilterImpl()
+	{
+	}
+
 	virtual void init(
 		const PoseFilterConstants &constants)
 	{
@@ -1394,7 +1457,8 @@ public:
 
 		reset_orientation = Eigen::Quaternionf::Identity();
 		origin_position = Eigen::Vector3f::Zero();
-		state = PoseStateVector::Zero();
+		state = PoseStateVectord::Zero();
+		predicted_state = state;
 	}
 
 	virtual void init(
@@ -1408,16 +1472,18 @@ public:
 
         reset_orientation = Eigen::Quaternionf::Identity();
         origin_position = Eigen::Vector3f::Zero();
-		state = PoseStateVector::Zero();
+		state = PoseStateVectord::Zero();
 		state.set_position_meters(position.cast<double>());
 		state.set_quaternion(orientation.cast<double>());
+		predicted_state = state;
     }
 };
 
+template<typename T>
 class DS4KalmanPoseFilterImpl : public KalmanPoseFilterImpl
 {
 public:
-	PoseSRUFK<DS4_MeasurementModel, DS4_MeasurementVector> srukf;
+	PoseSRUFK<DS4_MeasurementModel<T>, DS4_MeasurementVector<T> > srukf;
 
 	void init(
 		const PoseFilterConstants &constants) override
@@ -1436,10 +1502,11 @@ public:
 	}
 };
 
+template<typename T>
 class PSMoveKalmanPoseFilterImpl : public KalmanPoseFilterImpl
 {
 public:
-	PoseSRUFK<PSMove_MeasurementModel, PSMove_MeasurementVector> srukf;
+	PoseSRUFK<PSMove_MeasurementModel<T>, PSMove_MeasurementVector<T> > srukf;
 
 	void init(
 		const PoseFilterConstants &constants) override
@@ -1449,7 +1516,7 @@ public:
 	}
 
 	void init(
-		const PoseFilterConstants &constants, 
+		const PoseFilterConstants &constants,
 		const Eigen::Vector3f &position,
 		const Eigen::Quaternionf &orientation) override
 	{
@@ -1458,14 +1525,210 @@ public:
 	}
 };
 
+static KalmanPoseFilterImpl *allocate_ds4_filter_impl(const KalmanPoseFilterPrecision precision)
+{
+	if (precision == KalmanPoseFilterPrecisionFloat)
+	{
+		return new DS4KalmanPoseFilterImpl<float>();
+	}
+
+	return new DS4KalmanPoseFilterImpl<double>();
+}
+
+static KalmanPoseFilterImpl *allocate_psmove_filter_impl(const KalmanPoseFilterPrecision precision)
+{
+	if (precision == KalmanPoseFilterPrecisionFloat)
+	{
+		return new PSMoveKalmanPoseFilterImpl<float>();
+	}
+
+	return new PSMoveKalmanPoseFilterImpl<double>();
+}
+
+template<typename T>
+static void update_ds4_filter_impl(
+	const PoseFilterConstants &constants,
+	const float delta_time,
+	const PoseFilterPacket &packet,
+	DS4KalmanPoseFilterImpl<T> *filter)
+{
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+
+	// Get the DS4 implementation specific sigma point weights and measurement model
+	PoseSRUFK<DS4_MeasurementModel<T>, DS4_MeasurementVector<T> > &srukf = filter->srukf;
+	DS4_MeasurementModel<T> &measurement_model = srukf.measurement_model;
+
+	if (filter->bIsValid)
+    {
+		// Predict state for current time-step using the filters
+        srukf.predict(delta_time);
+        filter->predicted_state = srukf.x_k.template cast<double>();
+
+        // Project the current state onto a predicted measurement as a default
+        // in case no observation is available
+        DS4_MeasurementVector<T> measurement = measurement_model.observation_function(srukf.x, DS4_MeasurementVector<T>::Zero());
+
+        // Accelerometer and gyroscope measurements are always available
+        measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+        measurement.set_gyroscope(packet.imu_gyroscope_rad_per_sec.cast<T>());
+
+		// Adjust the amount we trust the optical measurements based on the quality parameters
+		measurement_model.update_measurement_statistics(
+			constants,
+			packet.tracking_projection_area_px_sqr);
+
+        if (packet.tracking_projection_area_px_sqr > 0.f)
+        {
+			Eigen::Vector3f optical_position_meters = packet.get_optical_position_in_meters();
+
+            // Use the optical orientation measurement
+            measurement.set_optical_quaternion(packet.optical_orientation.cast<T>());
+
+			// If this is the first time we have seen the orientation, snap the orientation state
+			if (!filter->bSeenOrientationMeasurement)
+			{
+				srukf.x.set_quaternion(packet.optical_orientation.cast<T>());
+				filter->bSeenOrientationMeasurement= true;
+			}
+
+            // Use the optical position
+            // State internally stores position in meters
+            measurement.set_optical_position(optical_position_meters.cast<T>());
+
+			// If this is the first time we have seen the position, snap the position state
+			if (!filter->bSeenPositionMeasurement)
+			{
+				srukf.x.set_position_meters(optical_position_meters.cast<T>());
+				filter->bSeenPositionMeasurement= true;
+			}
+        }
+
+        // Update UKF
+        srukf.update(measurement);
+    }
+    else
+    {
+        srukf.x.setZero();
+
+		if (packet.tracking_projection_area_px_sqr > 0.f)
+		{
+			Eigen::Vector3f optical_position_meters= packet.get_optical_position_in_meters();
+
+			srukf.x.set_position_meters(optical_position_meters.cast<T>());
+			filter->bSeenPositionMeasurement= true;
+
+			srukf.x.set_quaternion(packet.optical_orientation.cast<T>());
+			filter->bSeenOrientationMeasurement = true;
+		}
+		else
+		{
+			srukf.x.set_position_meters(Vector3::Zero());
+			srukf.x.set_quaternion(Quaternion::Identity());
+		}
+
+        filter->bIsValid= true;
+    }
+
+	// Publish the state from the filter
+	filter->state = srukf.x.template cast<double>();
+}
+
+template<typename T>
+static void update_psmove_filter_impl(
+	const float delta_time,
+	const PoseFilterPacket &packet,
+	PSMoveKalmanPoseFilterImpl<T> *filter)
+{
+	typedef Eigen::Matrix<T, 3, 1> Vector3;
+	typedef Eigen::Quaternion<T> Quaternion;
+
+	PoseSRUFK<PSMove_MeasurementModel<T>, PSMove_MeasurementVector<T> > &srukf = filter->srukf;
+	PSMove_MeasurementModel<T> &measurement_model = srukf.measurement_model;
+
+    if (filter->bIsValid)
+    {
+		// Predict state for current time-step using the filters
+        srukf.predict(delta_time);
+        filter->predicted_state = srukf.x_k.template cast<double>();
+
+        // Project the current state onto a predicted measurement as a default
+        // in case no observation is available
+        PSMove_MeasurementVector<T> measurement = measurement_model.observation_function(srukf.x, PSMove_MeasurementVector<T>::Zero());
+
+        // Accelerometer, magnetometer and gyroscope measurements are always available
+        measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<T>());
+        measurement.set_gyroscope(packet.imu_gyroscope_rad_per_sec.cast<T>());
+        measurement.set_magnetometer(packet.imu_magnetometer_unit.cast<T>());
+
+        // If available, use the optical position
+        if (packet.tracking_projection_area_px_sqr > 0.f)
+        {
+			Eigen::Vector3f optical_position= packet.get_optical_position_in_meters();
+
+			//TODO: Update measurement statistics once we get the filter working
+			//// Adjust the amount we trust the optical measurements based on the quality parameters
+			//measurement_model.update_measurement_statistics(constants, packet.tracking_projection_area);
+
+			// Assign the latest optical measurement from the packet
+            measurement.set_optical_position(optical_position.cast<T>());
+
+			// If this is the first time we have seen the position, snap the position state
+			//if (!filter->bSeenPositionMeasurement)
+			//{
+			//	srukf.x.set_position(optical_position.cast<T>());
+			//	filter->bSeenPositionMeasurement= true;
+			//}
+        }
+
+        // Update UKF
+        srukf.update(measurement);
+    }
+    else
+    {
+        srukf.x.setZero();
+        srukf.x.set_quaternion(Quaternion::Identity());
+
+		// We always "see" the orientation measurements for the PSMove (MARG state)
+		filter->bSeenOrientationMeasurement= true;
+
+		if (packet.tracking_projection_area_px_sqr > 0.f)
+		{
+			Eigen::Vector3f optical_position_meters= packet.get_optical_position_in_meters();
+
+			srukf.x.set_position_meters(optical_position_meters.cast<T>());
+			filter->bSeenPositionMeasurement= true;
+		}
+		else
+		{
+			srukf.x.set_position_meters(Vector3::Zero());
+		}
+
+        filter->bIsValid= true;
+    }
+
+	// Publish the state from the filter
+	filter->state = srukf.x.template cast<double>();
+}
+
 //-- public interface --
 //-- KalmanFilterOpticalPoseARG --
-KalmanPoseFilter::KalmanPoseFilter() 
-    : m_filter(nullptr)
+KalmanPoseFilter::KalmanPoseFilter(KalmanPoseFilterPrecision precision)
+    : m_precision(precision)
+    , m_filter(nullptr)
 {
 	m_constants.clear();
 }
 
+KalmanPoseFilter::~KalmanPoseFilter()
+{
+	if (m_filter != nullptr)
+	{
+		delete m_filter;
+		m_filter = nullptr;
+	}
+}
+
 bool KalmanPoseFilter::init(
 	const PoseFilterConstants &constants)
 {
@@ -1475,7 +1738,7 @@ bool KalmanPoseFilter::init(
 	if (m_filter != nullptr)
 	{
 		delete m_filter;
-		m_filter;
+		m_filter = nullptr;
 	}
 
 	return true;
@@ -1483,7 +1746,7 @@ bool KalmanPoseFilter::init(
 
 bool KalmanPoseFilter::init(
 	const PoseFilterConstants &constants,
-	const Eigen::Vector3f &position, 
+	const Eigen::Vector3f &position,
 	const Eigen::Quaternionf &orientation)
 {
     m_constants = constants;
@@ -1492,7 +1755,7 @@ bool KalmanPoseFilter::init(
     if (m_filter != nullptr)
     {
         delete m_filter;
-        m_filter;
+        m_filter = nullptr;
     }
 
     return true;
@@ -1596,13 +1859,19 @@ Eigen::Vector3f KalmanPoseFilter::getAccelerationCmPerSecSqr() const
 	return accel.cast<float>();
 }
 
+void KalmanPoseFilter::getPredictedPose(Eigen::Vector3d &out_position_meters, Eigen::Quaterniond &out_orientation) const
+{
+	out_position_meters = m_filter->predicted_state.get_position_meters();
+	out_orientation = m_filter->predicted_state.get_quaternion();
+}
+
 //-- KalmanPoseFilterDS4 --
 bool KalmanPoseFilterDS4::init(
 	const PoseFilterConstants &constants)
 {
 	KalmanPoseFilter::init(constants);
 
-	DS4KalmanPoseFilterImpl *filter = new DS4KalmanPoseFilterImpl();
+	KalmanPoseFilterImpl *filter = allocate_ds4_filter_impl(m_precision);
 	filter->init(constants);
 	m_filter = filter;
 
@@ -1611,12 +1880,12 @@ bool KalmanPoseFilterDS4::init(
 
 bool KalmanPoseFilterDS4::init(
 	const PoseFilterConstants &constants,
-	const Eigen::Vector3f &position, 
+	const Eigen::Vector3f &position,
 	const Eigen::Quaternionf &orientation)
 {
     KalmanPoseFilter::init(constants, position, orientation);
 
-    DS4KalmanPoseFilterImpl *filter = new DS4KalmanPoseFilterImpl();
+    KalmanPoseFilterImpl *filter = allocate_ds4_filter_impl(m_precision);
     filter->init(constants, position, orientation);
     m_filter = filter;
 
@@ -1625,83 +1894,14 @@ bool KalmanPoseFilterDS4::init(
 
 void KalmanPoseFilterDS4::update(const float delta_time, const PoseFilterPacket &packet)
 {
-	// Get the DS4 implementation specific sigma point weights and measurement model
-	DS4KalmanPoseFilterImpl *ds4FilterImpl = static_cast<DS4KalmanPoseFilterImpl *>(m_filter);
-	PoseSRUFK<DS4_MeasurementModel, DS4_MeasurementVector> &srukf = ds4FilterImpl->srukf;
-	DS4_MeasurementModel &measurement_model = srukf.measurement_model;
-
-	if (m_filter->bIsValid)
-    {
-		// Predict state for current time-step using the filters
-        srukf.predict(delta_time);
-
-        // Project the current state onto a predicted measurement as a default
-        // in case no observation is available
-        DS4_MeasurementVector measurement = measurement_model.observation_function(srukf.x, DS4_MeasurementVector::Zero());
-
-        // Accelerometer and gyroscope measurements are always available
-        measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-        measurement.set_gyroscope(packet.imu_gyroscope_rad_per_sec.cast<double>());
-
-		// Adjust the amount we trust the optical measurements based on the quality parameters
-		measurement_model.update_measurement_statistics(
-			m_constants,
-			packet.tracking_projection_area_px_sqr);
-
-        if (packet.tracking_projection_area_px_sqr > 0.f)
-        {
-			Eigen::Vector3f optical_position_meters = packet.get_optical_position_in_meters();
-
-            // Use the optical orientation measurement
-            measurement.set_optical_quaternion(packet.optical_orientation.cast<double>());
-
-			// If this is the first time we have seen the orientation, snap the orientation state
-			if (!m_filter->bSeenOrientationMeasurement)
-			{
-				srukf.x.set_quaternion(packet.optical_orientation.cast<double>());
-				m_filter->bSeenOrientationMeasurement= true;
-			}
-
-            // Use the optical position
-            // State internally stores position in meters
-            measurement.set_optical_position(optical_position_meters.cast<double>());
-
-			// If this is the first time we have seen the position, snap the position state
-			if (!m_filter->bSeenPositionMeasurement)
-			{
-				srukf.x.set_position_meters(optical_position_meters.cast<double>());
-				m_filter->bSeenPositionMeasurement= true;
-			}
-        }
-
-        // Update UKF
-        srukf.update(measurement);
-    }
-    else
-    {
-        srukf.x.setZero();
-
-		if (packet.tracking_projection_area_px_sqr > 0.f)
-		{
-			Eigen::Vector3f optical_position_meters= packet.get_optical_position_in_meters();
-
-			srukf.x.set_position_meters(optical_position_meters.cast<double>());
-			m_filter->bSeenPositionMeasurement= true;
-
-			srukf.x.set_quaternion(packet.optical_orientation.cast<double>());
-			m_filter->bSeenOrientationMeasurement = true;
-		}
-		else
-		{
-			srukf.x.set_position_meters(Eigen::Vector3d::Zero());
-			srukf.x.set_quaternion(Eigen::Quaterniond::Identity());
-		}
-
-        m_filter->bIsValid= true;
-    }
-
-	// Publish the state from the filter
-	m_filter->state = srukf.x;
+	if (m_precision == KalmanPoseFilterPrecisionFloat)
+	{
+		update_ds4_filter_impl(m_constants, delta_time, packet, static_cast<DS4KalmanPoseFilterImpl<float> *>(m_filter));
+	}
+	else
+	{
+		update_ds4_filter_impl(m_constants, delta_time, packet, static_cast<DS4KalmanPoseFilterImpl<double> *>(m_filter));
+	}
 }
 
 //-- PSMovePoseKalmanFilter --
@@ -1710,7 +1910,7 @@ bool KalmanPoseFilterPSMove::init(
 {
 	KalmanPoseFilter::init(constants);
 
-	PSMoveKalmanPoseFilterImpl *filter = new PSMoveKalmanPoseFilterImpl();
+	KalmanPoseFilterImpl *filter = allocate_psmove_filter_impl(m_precision);
 	filter->init(constants);
 	m_filter = filter;
 
@@ -1724,7 +1924,7 @@ bool KalmanPoseFilterPSMove::init(
 {
     KalmanPoseFilter::init(constants, position, orientation);
 
-    PSMoveKalmanPoseFilterImpl *filter = new PSMoveKalmanPoseFilterImpl();
+    KalmanPoseFilterImpl *filter = allocate_psmove_filter_impl(m_precision);
     filter->init(constants, position, orientation);
     m_filter = filter;
 
@@ -1733,72 +1933,14 @@ bool KalmanPoseFilterPSMove::init(
 
 void KalmanPoseFilterPSMove::update(const float delta_time, const PoseFilterPacket &packet)
 {
-	PSMoveKalmanPoseFilterImpl *psmoveFilterImpl = static_cast<PSMoveKalmanPoseFilterImpl *>(m_filter);
-	PoseSRUFK<PSMove_MeasurementModel, PSMove_MeasurementVector> &srukf = psmoveFilterImpl->srukf;
-	PSMove_MeasurementModel &measurement_model = srukf.measurement_model;
-
-    if (m_filter->bIsValid)
-    {
-		// Predict state for current time-step using the filters
-        srukf.predict(delta_time);
-
-        // Project the current state onto a predicted measurement as a default
-        // in case no observation is available
-        PSMove_MeasurementVector measurement = measurement_model.observation_function(srukf.x, PSMove_MeasurementVector::Zero());
-
-        // Accelerometer, magnetometer and gyroscope measurements are always available
-        measurement.set_accelerometer(packet.imu_accelerometer_g_units.cast<double>());
-        measurement.set_gyroscope(packet.imu_gyroscope_rad_per_sec.cast<double>());
-        measurement.set_magnetometer(packet.imu_magnetometer_unit.cast<double>());
-
-        // If available, use the optical position
-        if (packet.tracking_projection_area_px_sqr > 0.f)
-        {
-			Eigen::Vector3f optical_position= packet.get_optical_position_in_meters();
-
-			//TODO: Update measurement statistics once we get the filter working
-			//// Adjust the amount we trust the optical measurements based on the quality parameters
-			//measurement_model.update_measurement_statistics(m_constants, packet.tracking_projection_area);
-
-			// Assign the latest optical measurement from the packet
-            measurement.set_optical_position(optical_position.cast<double>());
-
-			// If this is the first time we have seen the position, snap the position state
-			//if (!m_filter->bSeenPositionMeasurement)
-			//{
-			//	srukf.x.set_position(optical_position.cast<double>());
-			//	m_filter->bSeenPositionMeasurement= true;
-			//}
-        }
-
-        // Update UKF
-        srukf.update(measurement);
-    }
-    else
-    {
-        srukf.x.setZero();
-        srukf.x.set_quaternion(Eigen::Quaterniond::Identity());
-
-		// We always "see" the orientation measurements for the PSMove (MARG state)
-		m_filter->bSeenOrientationMeasurement= true;
-
-		if (packet.tracking_projection_area_px_sqr > 0.f)
-		{
-			Eigen::Vector3f optical_position_meters= packet.get_optical_position_in_meters();
-
-			srukf.x.set_position_meters(optical_position_meters.cast<double>());
-			m_filter->bSeenPositionMeasurement= true;
-		}
-		else
-		{
-			srukf.x.set_position_meters(Eigen::Vector3d::Zero());
-		}
-
-        m_filter->bIsValid= true;
-    }
-
-	// Publish the state from the filter
-	m_filter->state = srukf.x;
+	if (m_precision == KalmanPoseFilterPrecisionFloat)
+	{
+		update_psmove_filter_impl(delta_time, packet, static_cast<PSMoveKalmanPoseFilterImpl<float> *>(m_filter));
+	}
+	else
+	{
+		update_psmove_filter_impl(delta_time, packet, static_cast<PSMoveKalmanPoseFilterImpl<double> *>(m_filter));
+	}
 }
 
 //-- Private functions --
@@ -1847,3 +1989,211 @@ void process_2nd_order_noise(
     Q(i+0,i+0) = q5/20.0; Q(i+0,i+1) = q4/8.0;
     Q(i+1,i+0) = q4/8.0;  Q(i+1,i+1) = q3/3.0;
 }
+
+static float eigen_vector3_normalize_with_default(Eigen::Vector3f &v, const Eigen::Vector3f &default_result)
+{
+	return eigen_vector3f_normalize_with_default(v, default_result);
+}
+
+static double eigen_vector3_normalize_with_default(Eigen::Vector3d &v, const Eigen::Vector3d &default_result)
+{
+	return eigen_vector3d_normalize_with_default(v, default_result);
+}
+
+// Same as eigen_angle_axis_to_quaternion() on every row of (x, y, z)*scale
+template <typename DerivedX, typename DerivedY, typename DerivedZ, typename DerivedOut>
+static void angle_axis_rows_to_quaternion_rows(
+	const Eigen::MatrixBase<DerivedX> &angle_axis_x,
+	const Eigen::MatrixBase<DerivedY> &angle_axis_y,
+	const Eigen::MatrixBase<DerivedZ> &angle_axis_z,
+	const typename DerivedOut::Scalar scale,
+	const Eigen::MatrixBase<DerivedOut> &out_quaternions)
+{
+	typedef typename DerivedOut::Scalar T;
+	typedef Eigen::Array<T, DerivedOut::RowsAtCompileTime, 1> ArrayRows;
+
+	// Eigen's way of writing into a block passed in as a temporary
+	Eigen::MatrixBase<DerivedOut> &out = const_cast<Eigen::MatrixBase<DerivedOut> &>(out_quaternions);
+
+	const ArrayRows x = angle_axis_x.array() * scale;
+	const ArrayRows y = angle_axis_y.array() * scale;
+	const ArrayRows z = angle_axis_z.array() * scale;
+	const ArrayRows angle = (x.square() + y.square() + z.square()).sqrt();
+	const ArrayRows half_angle = angle * static_cast<T>(0.5);
+
+	// sin(angle/2) * unit axis, with no axis for tiny angles
+	const ArrayRows axis_scale =
+		(angle > static_cast<T>(k_normal_epsilon)).select(half_angle.sin() / angle, static_cast<T>(0));
+
+	out.col(0).array() = half_angle.cos();
+	out.col(1).array() = x * axis_scale;
+	out.col(2).array() = y * axis_scale;
+	out.col(3).array() = z * axis_scale;
+}
+
+// Same as Eigen::AngleAxis(q) on every row, stored as axis * angle
+template <typename DerivedQuaternion, typename DerivedX, typename DerivedY, typename DerivedZ>
+static void quaternion_rows_to_angle_axis_rows(
+	const Eigen::MatrixBase<DerivedQuaternion> &quaternions,
+	const Eigen::MatrixBase<DerivedX> &out_angle_axis_x,
+	const Eigen::MatrixBase<DerivedY> &out_angle_axis_y,
+	const Eigen::MatrixBase<DerivedZ> &out_angle_axis_z)
+{
+	typedef typename DerivedQuaternion::Scalar T;
+
+	Eigen::MatrixBase<DerivedX> &out_x = const_cast<Eigen::MatrixBase<DerivedX> &>(out_angle_axis_x);
+	Eigen::MatrixBase<DerivedY> &out_y = const_cast<Eigen::MatrixBase<DerivedY> &>(out_angle_axis_y);
+	Eigen::MatrixBase<DerivedZ> &out_z = const_cast<Eigen::MatrixBase<DerivedZ> &>(out_angle_axis_z);
+
+	for (int row = 0; row < quaternions.rows(); ++row)
+	{
+		const T w = quaternions(row, 0);
+		const T vec_norm =
+			std::sqrt(
+				quaternions(row, 1)*quaternions(row, 1)
+				+ quaternions(row, 2)*quaternions(row, 2)
+				+ quaternions(row, 3)*quaternions(row, 3));
+
+		// Take the short way around when w < 0
+		const T scale =
+			(vec_norm > static_cast<T>(0))
+			? (w < 0 ? -2 : 2) * std::atan2(vec_norm, std::abs(w)) / vec_norm
+			: static_cast<T>(0);
+
+		out_x(row) = quaternions(row, 1) * scale;
+		out_y(row) = quaternions(row, 2) * scale;
+		out_z(row) = quaternions(row, 3) * scale;
+	}
+}
+
+// (lhs*rhs).normalized() on every row. The output can't alias either input.
+template <typename DerivedLHS, typename DerivedRHS, typename DerivedOut>
+static void multiply_quaternion_rows(
+	const Eigen::MatrixBase<DerivedLHS> &lhs,
+	const Eigen::MatrixBase<DerivedRHS> &rhs,
+	const Eigen::MatrixBase<DerivedOut> &out_quaternions)
+{
+	typedef typename DerivedOut::Scalar T;
+
+	Eigen::MatrixBase<DerivedOut> &out = const_cast<Eigen::MatrixBase<DerivedOut> &>(out_quaternions);
+
+	out.col(0).array() =
+		lhs.col(0).array()*rhs.col(0).array() - lhs.col(1).array()*rhs.col(1).array()
+		- lhs.col(2).array()*rhs.col(2).array() - lhs.col(3).array()*rhs.col(3).array();
+	out.col(1).array() =
+		lhs.col(0).array()*rhs.col(1).array() + lhs.col(1).array()*rhs.col(0).array()
+		+ lhs.col(2).array()*rhs.col(3).array() - lhs.col(3).array()*rhs.col(2).array();
+	out.col(2).array() =
+		lhs.col(0).array()*rhs.col(2).array() - lhs.col(1).array()*rhs.col(3).array()
+		+ lhs.col(2).array()*rhs.col(0).array() + lhs.col(3).array()*rhs.col(1).array();
+	out.col(3).array() =
+		lhs.col(0).array()*rhs.col(3).array() + lhs.col(1).array()*rhs.col(2).array()
+		- lhs.col(2).array()*rhs.col(1).array() + lhs.col(3).array()*rhs.col(0).array();
+
+	// Renormalize one column at a time so it vectorizes across the rows
+	const Eigen::Array<T, DerivedOut::RowsAtCompileTime, 1> inv_norm =
+		(out.col(0).array().square() + out.col(1).array().square()
+		 + out.col(2).array().square() + out.col(3).array().square()).sqrt().inverse();
+	for (int col = 0; col < 4; ++col)
+	{
+		out.col(col).array() *= inv_norm;
+	}
+}
+
+// (lhs*rhs).normalized() on every row, with the same rhs for all of them
+template <typename DerivedLHS, typename DerivedOut>
+static void multiply_quaternion_rows(
+	const Eigen::MatrixBase<DerivedLHS> &lhs,
+	const Eigen::Quaternion<typename DerivedOut::Scalar> &rhs,
+	const Eigen::MatrixBase<DerivedOut> &out_quaternions)
+{
+	typedef typename DerivedOut::Scalar T;
+
+	Eigen::MatrixBase<DerivedOut> &out = const_cast<Eigen::MatrixBase<DerivedOut> &>(out_quaternions);
+
+	out.col(0).array() =
+		lhs.col(0).array()*rhs.w() - lhs.col(1).array()*rhs.x()
+		- lhs.col(2).array()*rhs.y() - lhs.col(3).array()*rhs.z();
+	out.col(1).array() =
+		lhs.col(0).array()*rhs.x() + lhs.col(1).array()*rhs.w()
+		+ lhs.col(2).array()*rhs.z() - lhs.col(3).array()*rhs.y();
+	out.col(2).array() =
+		lhs.col(0).array()*rhs.y() - lhs.col(1).array()*rhs.z()
+		+ lhs.col(2).array()*rhs.w() + lhs.col(3).array()*rhs.x();
+	out.col(3).array() =
+		lhs.col(0).array()*rhs.z() + lhs.col(1).array()*rhs.y()
+		- lhs.col(2).array()*rhs.x() + lhs.col(3).array()*rhs.w();
+
+	// Renormalize one column at a time so it vectorizes across the rows
+	const Eigen::Array<T, DerivedOut::RowsAtCompileTime, 1> inv_norm =
+		(out.col(0).array().square() + out.col(1).array().square()
+		 + out.col(2).array().square() + out.col(3).array().square()).sqrt().inverse();
+	for (int col = 0; col < 4; ++col)
+	{
+		out.col(col).array() *= inv_norm;
+	}
+}
+
+// PoseStateVector + PoseNoiseVector on every row.
+// noise_rotations holds the angle-axis part of the noise already converted to quaternions.
+template <typename DerivedState, typename DerivedNoise, typename DerivedRotation, typename DerivedScratch>
+static void add_noise_rows(
+	const Eigen::MatrixBase<DerivedState> &state_rows,
+	const Eigen::MatrixBase<DerivedNoise> &noise_rows,
+	const Eigen::MatrixBase<DerivedRotation> &noise_rotations,
+	const Eigen::MatrixBase<DerivedScratch> &scratch_quaternions)
+{
+	Eigen::MatrixBase<DerivedState> &state = const_cast<Eigen::MatrixBase<DerivedState> &>(state_rows);
+	Eigen::MatrixBase<DerivedScratch> &scratch = const_cast<Eigen::MatrixBase<DerivedScratch> &>(scratch_quaternions);
+
+	// Add the first 9 columns (position, velocity, and acceleration) the usual way
+	state.template leftCols<9>() += noise_rows.template leftCols<9>();
+
+	// Add the noise angular velocity to the angular velocity
+	state.col(ANGULAR_VELOCITY_X) += noise_rows.col(NOISE_ANGULAR_VELOCITY_X);
+	state.col(ANGULAR_VELOCITY_Y) += noise_rows.col(NOISE_ANGULAR_VELOCITY_Y);
+	state.col(ANGULAR_VELOCITY_Z) += noise_rows.col(NOISE_ANGULAR_VELOCITY_Z);
+
+	// Apply the noise delta to the orientation
+	multiply_quaternion_rows(state.template middleCols<4>(ORIENTATION_W), noise_rotations, scratch);
+	state.template middleCols<4>(ORIENTATION_W) = scratch;
+}
+
+// Same method as eigen_quaternion_compute_weighted_average() (largest eigenvector of sum(q*q^T)),
+// but with fixed size storage and a symmetric eigen solver.
+// http://stackoverflow.com/questions/12374087/average-of-multiple-quaternions
+template <typename DerivedQuaternion, typename DerivedWeights>
+static Eigen::Quaternion<typename DerivedQuaternion::Scalar> compute_quaternion_rows_weighted_average(
+	const Eigen::MatrixBase<DerivedQuaternion> &quaternions,
+	const Eigen::MatrixBase<DerivedWeights> &weights)
+{
+	typedef typename DerivedQuaternion::Scalar T;
+	typedef Eigen::Matrix<T, 4, 4> Matrix4;
+
+	Eigen::Matrix<T, DerivedQuaternion::RowsAtCompileTime, 4> weighted_quaternions;
+
+	// For negative weights, use the conjugate of the quaternion
+	// (i.e. flip the rotation axis)
+	weighted_quaternions.col(0) = quaternions.col(0).cwiseProduct(weights.cwiseAbs());
+	weighted_quaternions.col(1) = quaternions.col(1).cwiseProduct(weights);
+	weighted_quaternions.col(2) = quaternions.col(2).cwiseProduct(weights);
+	weighted_quaternions.col(3) = quaternions.col(3).cwiseProduct(weights);
+
+	Matrix4 M;
+	M.noalias() = weighted_quaternions.transpose() * weighted_quaternions;
+
+	// Eigenvalues are sorted in increasing order
+	Eigen::SelfAdjointEigenSolver<Matrix4> eigen_solver(M);
+	Eigen::Quaternion<T> result = Eigen::Quaternion<T>::Identity();
+
+	if (eigen_solver.info() == Eigen::Success)
+	{
+		const Eigen::Matrix<T, 4, 1> largest_eigenvector = eigen_solver.eigenvectors().col(3);
+
+		result = Eigen::Quaternion<T>(
+			largest_eigenvector(0), largest_eigenvector(1), largest_eigenvector(2), largest_eigenvector(3));
+		result.normalize();
+	}
+
+	return result;
+}
\ No newline at end of file
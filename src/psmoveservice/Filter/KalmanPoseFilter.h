@@ -3,11 +3,19 @@
 
 #include "PoseFilterInterface.h"
 
+/// Scalar type the Kalman pose filter runs its sigma points in
+enum KalmanPoseFilterPrecision
+{
+	KalmanPoseFilterPrecisionDouble,
+	KalmanPoseFilterPrecisionFloat
+};
+
 /// Abstract Kalman Pose filter for controllers
 class KalmanPoseFilter : public IPoseFilter
 {
 public:
-	KalmanPoseFilter();
+	KalmanPoseFilter(KalmanPoseFilterPrecision precision = KalmanPoseFilterPrecisionDouble);
+	virtual ~KalmanPoseFilter();
 
 	virtual bool init(const PoseFilterConstants &constant);
 	virtual bool init(const PoseFilterConstants &constant, const Eigen::Vector3f &position, const Eigen::Quaternionf &orientation);
@@ -27,8 +35,13 @@ public:
 	Eigen::Vector3f getVelocityCmPerSec() const override;
 	Eigen::Vector3f getAccelerationCmPerSecSqr() const override;
 
+	/// The mean predicted by the last update, before any measurement correction.
+	/// Always double, whatever precision the filter runs at, so tests can compare precisions.
+	void getPredictedPose(Eigen::Vector3d &out_position_meters, Eigen::Quaterniond &out_orientation) const;
+
 protected:
 	PoseFilterConstants m_constants;
+	KalmanPoseFilterPrecision m_precision;
 	class KalmanPoseFilterImpl *m_filter;
 };
 
@@ -36,6 +49,10 @@ protected:
 class KalmanPoseFilterDS4 : public KalmanPoseFilter
 {
 public:
+	KalmanPoseFilterDS4(KalmanPoseFilterPrecision precision = KalmanPoseFilterPrecisionDouble)
+		: KalmanPoseFilter(precision)
+	{}
+
 	bool init(const PoseFilterConstants &constant) override;
 	bool init(const PoseFilterConstants &constant, const Eigen::Vector3f &position, const Eigen::Quaternionf &orientation) override;
 	void update(const float delta_time, const PoseFilterPacket &packet) override;
@@ -45,6 +62,10 @@ public:
 class KalmanPoseFilterPSMove : public KalmanPoseFilter
 {
 public:
+	KalmanPoseFilterPSMove(KalmanPoseFilterPrecision precision = KalmanPoseFilterPrecisionDouble)
+		: KalmanPoseFilter(precision)
+	{}
+
 	bool init(const PoseFilterConstants &constant) override;
 	bool init(const PoseFilterConstants &constant, const Eigen::Vector3f &position, const Eigen::Quaternionf &orientation) override;
 	void update(const float delta_time, const PoseFilterPacket &packet) override;
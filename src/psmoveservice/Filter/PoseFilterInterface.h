@@ -234,6 +234,8 @@ struct PoseFilterConstants
 class IStateFilter
 {
 public:
+    virtual ~IStateFilter() {}
+
     /// Not true until the filter has updated at least once
     virtual bool getIsStateValid() const = 0;
 
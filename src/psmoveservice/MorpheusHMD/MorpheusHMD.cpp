@@ -3,7 +3,9 @@
 #include "DeviceInterface.h"
 #include "DeviceManager.h"
 #include "HMDDeviceEnumerator.h"
+#include "HidApiMutex.h"
 #include "HidHMDDeviceEnumerator.h"
+#include "HidInputReportReader.h"
 #include "MathUtility.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
@@ -33,7 +35,6 @@
 #define MORPHEUS_COMMAND_MAGIC 0xAA
 #define MORPHEUS_COMMAND_MAX_PAYLOAD_LEN 60
 
-#define MORPHEUS_HMD_STATE_BUFFER_MAX 4
 #define METERS_TO_CENTIMETERS 100
 
 enum eMorpheusRequestType
@@ -238,6 +239,7 @@ MorpheusHMDConfig::config2ptree()
 
 	pt.put("prediction_time", prediction_time);
 	pt.put("max_poll_failure_count", max_poll_failure_count);
+	pt.put("use_threaded_hid_input", use_threaded_hid_input);
 
 	writeTrackingColor(pt, tracking_color_id);
 
@@ -257,6 +259,7 @@ MorpheusHMDConfig::ptree2config(const boost::property_tree::ptree &pt)
 
 		prediction_time = pt.get<float>("prediction_time", 0.f);
 		max_poll_failure_count = pt.get<long>("max_poll_failure_count", 100);
+		use_threaded_hid_input = pt.get<bool>("use_threaded_hid_input", false);
 
 		// Use the current accelerometer values (constructor defaults) as the default values
 		accelerometer_gain.i = pt.get<float>("Calibration.Accel.X.k", accelerometer_gain.i);
@@ -365,11 +368,13 @@ MorpheusHMD::MorpheusHMD()
     , USBContext(nullptr)
     , NextPollSequenceNumber(0)
     , InData(nullptr)
+    , InputReader(nullptr)
     , HMDStates()
 	, bIsTracking(false)
 {
     USBContext = new MorpheusUSBContext;
     InData = new MorpheusSensorData;
+    InputReader = new HidInputReportReader;
 
     HMDStates.clear();
 }
@@ -381,6 +386,7 @@ MorpheusHMD::~MorpheusHMD()
         SERVER_LOG_ERROR("~MorpheusHMD") << "HMD deleted without calling close() first!";
     }
 
+    delete InputReader;
     delete InData;
     delete USBContext;
 }
@@ -419,10 +425,13 @@ bool MorpheusHMD::open(
 
 		// Open the sensor interface using HIDAPI
 		USBContext->sensor_device_path = pEnum->get_hid_hmd_enumerator()->get_interface_path(MORPHEUS_SENSOR_INTERFACE);
-		USBContext->sensor_device_handle = hid_open_path(USBContext->sensor_device_path.c_str());
-		if (USBContext->sensor_device_handle != nullptr)
 		{
-			hid_set_nonblocking(USBContext->sensor_device_handle, 1);
+			std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
+			USBContext->sensor_device_handle = hid_open_path(USBContext->sensor_device_path.c_str());
+			if (USBContext->sensor_device_handle != nullptr)
+			{
+				hid_set_nonblocking(USBContext->sensor_device_handle, 1);
+			}
 		}
 
 		// Open the command interface using libusb.
@@ -461,6 +470,12 @@ bool MorpheusHMD::open(
             // Reset the polling sequence counter
             NextPollSequenceNumber = 0;
 
+			// Read sensor reports as soon as they arrive rather than when the main loop gets around to it
+			if (cfg.use_threaded_hid_input)
+			{
+				InputReader->start(USBContext->sensor_device_handle, sizeof(MorpheusSensorData), "Morpheus HID Reader");
+			}
+
 			success = true;
         }
         else
@@ -480,6 +495,11 @@ void MorpheusHMD::close()
 		if (USBContext->sensor_device_handle != nullptr)
 		{
 			SERVER_LOG_INFO("MorpheusHMD::close") << "Closing MorpheusHMD sensor interface(" << USBContext->sensor_device_path << ")";
+
+			// The reader thread must be done with the handle before it gets closed
+			InputReader->stop();
+
+			std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
 			hid_close(USBContext->sensor_device_handle);
 		}
 
@@ -553,7 +573,18 @@ MorpheusHMD::poll()
 		for (int iteration = 0; iteration < k_max_iterations; ++iteration)
 		{
 			// Attempt to read the next update packet from the controller
-			int res = hid_read(USBContext->sensor_device_handle, (unsigned char*)InData, sizeof(MorpheusSensorData));
+			// (or the next one the reader thread already read)
+			double host_receive_seconds = 0.0;
+			int res;
+
+			if (InputReader->getIsRunning())
+			{
+				res = InputReader->popReport((unsigned char*)InData, sizeof(MorpheusSensorData), host_receive_seconds);
+			}
+			else
+			{
+				res = hid_read(USBContext->sensor_device_handle, (unsigned char*)InData, sizeof(MorpheusSensorData));
+			}
 
 			if (res == 0)
 			{
@@ -597,12 +628,6 @@ MorpheusHMD::poll()
 			// Processes the IMU data
 			newState.parse_data_input(&cfg, InData);
 
-			// Make room for new entry if at the max queue size
-			if (HMDStates.size() >= MORPHEUS_HMD_STATE_BUFFER_MAX)
-			{
-				HMDStates.erase(HMDStates.begin(), HMDStates.begin() + HMDStates.size() - MORPHEUS_HMD_STATE_BUFFER_MAX);
-			}
-
 			HMDStates.push_back(newState);
 		}
 	}
@@ -651,9 +676,7 @@ const CommonDeviceState *
 MorpheusHMD::getState(
     int lookBack) const
 {
-    const int queueSize = static_cast<int>(HMDStates.size());
-    const CommonDeviceState * result =
-        (lookBack < queueSize) ? &HMDStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = HMDStates.getState(lookBack);
 
     return result;
 }
@@ -4,12 +4,14 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
 #include "MathUtility.h"
 #include <string>
 #include <vector>
-#include <deque>
 #include <array>
 
+#define MORPHEUS_HMD_STATE_BUFFER_MAX 4
+
 // The angle the accelerometer reading will be pitched by
 // if the Morpheus is held such that the face plate is perpendicular to the ground
 // i.e. where what we consider the "identity" pose
@@ -36,6 +38,7 @@ public:
 		, position_variance_exp_fit_b(-0.000567041978f)
 		, orientation_variance(0.005f)
         , max_poll_failure_count(100)
+        , use_threaded_hid_input(false)
         , prediction_time(0.f)
 		, tracking_color_id(eCommonTrackingColorID::Blue)
     {
@@ -157,6 +160,9 @@ public:
 	}
 
     long max_poll_failure_count;
+
+	// Read HID sensor reports on a dedicated thread instead of from the main loop
+	bool use_threaded_hid_input;
 	float prediction_time;
 
 	eCommonTrackingColorID tracking_color_id;
@@ -260,7 +266,8 @@ private:
     // Read HMD State
     int NextPollSequenceNumber;
     struct MorpheusSensorData *InData;                        // Buffer to hold most recent MorpheusAPI tracking state
-    std::deque<MorpheusHMDState> HMDStates;
+    class HidInputReportReader *InputReader;                  // Reads sensor reports on its own thread if cfg.use_threaded_hid_input
+    DeviceStateBuffer<MorpheusHMDState, MORPHEUS_HMD_STATE_BUFFER_MAX> HMDStates;
 
 	bool bIsTracking;
 };
@@ -1,6 +1,9 @@
 //-- includes -----
 #include "PSDualShock4Controller.h"
 #include "ControllerDeviceEnumerator.h"
+#include "HidApiMutex.h"
+#include "HidInputReportReader.h"
+#include "HidOutputReportWriter.h"
 #include "MathUtility.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
@@ -29,7 +32,7 @@
 #define PSDS4_BTADDR_GET_SIZE 16
 #define PSDS4_BTADDR_SET_SIZE 23
 #define PSDS4_BTADDR_SIZE 6
-#define PSDS4_STATE_BUFFER_MAX 16
+#define PSDS4_TIMESTAMP_TICK_SECONDS (16.0/3.0/1000000.0) /* Nominal period of the 16-bit sample clock (5.33us), refined at runtime */
 
 #define PSDS4_TRACKING_TRIANGLE_WIDTH  .9386f // The width of a triangle enclosed in the DS4 tracking bar in cm
 #define PSDS4_TRACKING_TRIANGLE_HEIGHT  .6548f // The height of a triangle enclosed in the DS4 tracking bar in cm
@@ -48,6 +51,9 @@
 /* Minimum time (in milliseconds) psmove write updates */
 #define PSDS4_WRITE_DATA_INTERVAL_MS 120
 
+/* Minimum time (in milliseconds) between two LED/rumble writes, so a flurry of changes doesn't flood bluetooth */
+#define PSDS4_MIN_WRITE_INTERVAL_MS 10
+
 enum ePSDualShock4_RequestType {
     PSDualShock4_BTReport_Input = 0x00,
     PSDualShock4_BTReport_Output = 0x11,
@@ -299,6 +305,8 @@ PSDualShock4ControllerConfig::config2ptree()
 
     pt.put("prediction_time", prediction_time);
     pt.put("max_poll_failure_count", max_poll_failure_count);
+    pt.put("use_threaded_hid_input", use_threaded_hid_input);
+    pt.put("use_async_hid_output", use_async_hid_output);
 
 	writeTrackingColor(pt, tracking_color_id);
 
@@ -315,6 +323,8 @@ PSDualShock4ControllerConfig::ptree2config(const boost::property_tree::ptree &pt
         is_valid = pt.get<bool>("is_valid", false);
         prediction_time = pt.get<float>("prediction_time", 0.f);
         max_poll_failure_count = pt.get<long>("max_poll_failure_count", 100);
+        use_threaded_hid_input = pt.get<bool>("use_threaded_hid_input", false);
+        use_async_hid_output = pt.get<bool>("use_async_hid_output", true);
 
         // Use the current accelerometer values (constructor defaults) as the default values
         accelerometer_gain.i = pt.get<float>("Calibration.Accel.X.k", accelerometer_gain.i);
@@ -373,6 +383,7 @@ PSDualShock4Controller::PSDualShock4Controller()
     , RumbleLeft(0)
     , bWriteStateDirty(false)
     , NextPollSequenceNumber(0)
+    , SampleTimestamp(16, PSDS4_TIMESTAMP_TICK_SECONDS)
 {
 	HIDDetails.vendor_id = -1;
 	HIDDetails.product_id = -1;
@@ -388,6 +399,9 @@ PSDualShock4Controller::PSDualShock4Controller()
     OutData->_unknown1[1] = 0x00;
     OutData->rumbleFlags = PSDS4_RUMBLE_ENABLED;
 
+    InputReader = new HidInputReportReader;
+    OutputWriter = new HidOutputReportWriter;
+
     // Make sure there is an initial empty state in the tracker queue
     {
         PSDualShock4ControllerState empty_state;
@@ -404,6 +418,8 @@ PSDualShock4Controller::~PSDualShock4Controller()
         SERVER_LOG_ERROR("~PSDualShock4Controller") << "Controller deleted without calling close() first!";
     }
 
+    delete OutputWriter;
+    delete InputReader;
     delete InData;
 }
 
@@ -453,7 +469,10 @@ bool PSDualShock4Controller::open(
 		HIDDetails.vendor_id = pEnum->get_vendor_id();
 		HIDDetails.product_id = pEnum->get_product_id();
         HIDDetails.Device_path = cur_dev_path;
-        HIDDetails.Handle = hid_open_path(HIDDetails.Device_path.c_str());
+        {
+            std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
+            HIDDetails.Handle = hid_open_path(HIDDetails.Device_path.c_str());
+        }
 
         if (HIDDetails.Handle != nullptr)  // Controller was opened and has an index
         {             
@@ -534,8 +553,24 @@ bool PSDualShock4Controller::open(
 				cfg.save();
             }
 
-            // Reset the polling sequence counter
+            // Reset the polling sequence counter and sample clock
             NextPollSequenceNumber = 0;
+            SampleTimestamp.reset();
+
+            // Keep slow bluetooth LED/rumble writes off the main loop.
+            // The writer also takes over re-sending the LED state every PSDS4_WRITE_DATA_INTERVAL_MS.
+            if (success && IsBluetooth && cfg.use_async_hid_output)
+            {
+            #ifdef _WIN32
+                OutputWriter->start(
+                    HIDDetails.Handle, hid_set_output_report, "DS4 HID Writer",
+                    PSDS4_MIN_WRITE_INTERVAL_MS, PSDS4_WRITE_DATA_INTERVAL_MS);
+            #else
+                OutputWriter->start(
+                    HIDDetails.Handle, hid_write, "DS4 HID Writer",
+                    PSDS4_MIN_WRITE_INTERVAL_MS, PSDS4_WRITE_DATA_INTERVAL_MS);
+            #endif
+            }
 
             // Write out the initial controller state
             if (success && IsBluetooth)
@@ -543,6 +578,12 @@ bool PSDualShock4Controller::open(
                 bWriteStateDirty= true;
                 writeDataOut();
             }
+
+            // Read input reports as soon as they arrive rather than when the main loop gets around to it
+            if (success && IsBluetooth && cfg.use_threaded_hid_input)
+            {
+                InputReader->start(HIDDetails.Handle, sizeof(PSDualShock4DataInput), "DS4 HID Reader");
+            }
         }
         else
         {
@@ -560,6 +601,9 @@ void PSDualShock4Controller::close()
     {
         SERVER_LOG_INFO("PSDualShock4Controller::close") << "Closing PSDualShock4Controller(" << HIDDetails.Device_path << ")";
 
+        // The reader thread must be done with the handle before it gets closed
+        InputReader->stop();
+
         if (HIDDetails.Handle != nullptr)
         {
             if (IsBluetooth)
@@ -567,6 +611,10 @@ void PSDualShock4Controller::close()
                 clearAndWriteDataOut();
             }
 
+            // Stopping the writer flushes the cleared state out before the handle is closed
+            OutputWriter->stop();
+
+            std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
             hid_close(HIDDetails.Handle);
             HIDDetails.Handle = nullptr;
         }
@@ -779,7 +827,19 @@ PSDualShock4Controller::poll()
         for (int iteration = 0; iteration < k_max_iterations; ++iteration)
         {
             // Attempt to read the next update packet from the controller
-            int res = hid_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSDualShock4DataInput));
+            // (or the next one the reader thread already read)
+            double host_receive_seconds = 0.0;
+            int res;
+
+            if (InputReader->getIsRunning())
+            {
+                res = InputReader->popReport((unsigned char*)InData, sizeof(PSDualShock4DataInput), host_receive_seconds);
+            }
+            else
+            {
+                res = hid_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSDualShock4DataInput));
+                host_receive_seconds = DeviceTimestampReconstructor::getHostSeconds();
+            }
 
             if (res == 0)
             {
@@ -949,6 +1009,9 @@ PSDualShock4Controller::poll()
             // Sequence and timestamp
             newState.RawSequence = InData->buttons3.state.counter;
             newState.RawTimeStamp = InData->timestamp;
+            newState.DeviceTimestampSeconds = 
+                SampleTimestamp.update(newState.RawTimeStamp, host_receive_seconds);
+            newState.bIsDeviceTimestampValid = true;
 
             // Convert the 0-10 battery level into the batter level
             switch (InData->batteryLevel)
@@ -981,17 +1044,11 @@ PSDualShock4Controller::poll()
                 break;
             }            
 
-            // Make room for new entry if at the max queue size
-            if (ControllerStates.size() >= PSDS4_STATE_BUFFER_MAX)
-            {
-                ControllerStates.erase(ControllerStates.begin(),
-                    ControllerStates.begin() + ControllerStates.size() - PSDS4_STATE_BUFFER_MAX);
-            }
-
             ControllerStates.push_back(newState);
         }
 
-        // Update recurrent writes on a regular interval
+        // Update recurrent writes on a regular interval (the output writer thread does this itself)
+        if (!OutputWriter->getIsRunning())
         {
             std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
 
@@ -1012,9 +1069,7 @@ const CommonDeviceState *
 PSDualShock4Controller::getState(
 int lookBack) const
 {
-    const int queueSize = static_cast<int>(ControllerStates.size());
-    const CommonDeviceState * result =
-        (lookBack < queueSize) ? &ControllerStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = ControllerStates.getState(lookBack);
 
     return result;
 }
@@ -1143,24 +1198,32 @@ PSDualShock4Controller::writeDataOut()
         // Keep writing state out until the desired LED and Rumble are 0 
         bWriteStateDirty = bLedIsOn || bIsRumbleOn;
 
-        // Unfortunately in windows simply writing to the HID device, via WriteFile() internally, 
-        // doesn't appear to actually set the data on the controller (despite returning successfully).
-        // In the DS4 implementation they use the HidD_SetOutputReport() Win32 API call instead. 
-        // Unfortunately HIDAPI doesn't have any equivalent call, so we have to make our own.
-        #ifdef _WIN32
-        int res = hid_set_output_report(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
-        #else
-        int res = hid_write(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
-        #endif
-        bSuccess = res > 0;
-
-        if (!bSuccess)
+        if (OutputWriter->getIsRunning())
         {
-            char szErrorMessage[256];
-
-            if (hid_error_mbs(HIDDetails.Handle, szErrorMessage, sizeof(szErrorMessage)))
+            // Hand it off to the writer thread, which keeps re-sending it while dirty
+            bSuccess = OutputWriter->postReport((unsigned char*)OutData, sizeof(PSDualShock4DataOutput), bWriteStateDirty);
+        }
+        else
+        {
+            // Unfortunately in windows simply writing to the HID device, via WriteFile() internally, 
+            // doesn't appear to actually set the data on the controller (despite returning successfully).
+            // In the DS4 implementation they use the HidD_SetOutputReport() Win32 API call instead. 
+            // Unfortunately HIDAPI doesn't have any equivalent call, so we have to make our own.
+            #ifdef _WIN32
+            int res = hid_set_output_report(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
+            #else
+            int res = hid_write(HIDDetails.Handle, (unsigned char*)OutData, sizeof(PSDualShock4DataOutput));
+            #endif
+            bSuccess = res > 0;
+
+            if (!bSuccess)
             {
-                SERVER_LOG_ERROR("PSDualShock4Controller::writeDataOut") << "HID ERROR: " << szErrorMessage;
+                char szErrorMessage[256];
+
+                if (hid_error_mbs(HIDDetails.Handle, szErrorMessage, sizeof(szErrorMessage)))
+                {
+                    SERVER_LOG_ERROR("PSDualShock4Controller::writeDataOut") << "HID ERROR: " << szErrorMessage;
+                }
             }
         }
     }
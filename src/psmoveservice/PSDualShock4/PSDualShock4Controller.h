@@ -4,13 +4,16 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
+#include "DeviceTimestamp.h"
 #include "MathUtility.h"
 #include "hidapi.h"
 #include <string>
 #include <vector>
-#include <deque>
 #include <chrono>
 
+#define PSDS4_STATE_BUFFER_MAX 16
+
 // The angle the accelerometer reading is pitched forward when the DS4 is on a flat surface
 // The value comes from the accelerometer calibration utility
 #define FLAT_SURFACE_ACCELEROMETER_PITCH_DEGREES 12.661f
@@ -34,6 +37,8 @@ struct PSDualShock4HIDDetails {
 
 struct PSDualShock4DataInput;   // See .cpp for declaration
 struct PSDualShock4DataOutput;  // See .cpp for declaration
+class HidInputReportReader;
+class HidOutputReportWriter;
 
 class PSDualShock4ControllerConfig : public PSMoveConfig
 {
@@ -47,6 +52,8 @@ public:
 		, position_filter_type("ComplimentaryOpticalIMU")
 		, orientation_filter_type("ComplementaryOpticalARG")
         , max_poll_failure_count(100)
+        , use_threaded_hid_input(false)
+        , use_async_hid_output(true)
         , prediction_time(0.f)
         , accelerometer_noise_radius(0.015f) // rounded value from config tool measurement (g-units)
 		, accelerometer_variance(1.45e-05f) // rounded value from config tool measurement (g-units^2)
@@ -118,6 +125,12 @@ public:
 
 	// The max number of polling failures before we consider the controller disconnected
     long max_poll_failure_count;
+
+	// Read HID input reports on a dedicated thread instead of from the main loop
+	bool use_threaded_hid_input;
+
+	// Write LED/rumble reports on a dedicated thread instead of from the main loop
+	bool use_async_hid_output;
 	// The amount of prediction to apply to the controller pose after filtering
     float prediction_time;
 
@@ -179,7 +192,7 @@ struct PSDualShock4ControllerState : public CommonControllerState
 {
     int RawSequence;                               // 6-bit  (counts up by 1 per report)
 
-    unsigned int RawTimeStamp;                     // 16-bit (time since ?, units?)
+    unsigned int RawTimeStamp;                     // 16-bit sample clock, ~5.33us per tick
 
     float LeftAnalogX;  // [-1.f, 1.f]
     float LeftAnalogY;  // [-1.f, 1.f]
@@ -342,8 +355,11 @@ private:
 
     // Read Controller State
     int NextPollSequenceNumber;
-    std::deque<PSDualShock4ControllerState> ControllerStates;
+    DeviceTimestampReconstructor SampleTimestamp;   // Unwraps RawTimeStamp into DeviceTimestampSeconds
+    DeviceStateBuffer<PSDualShock4ControllerState, PSDS4_STATE_BUFFER_MAX> ControllerStates;
     PSDualShock4DataInput* InData;                        // Buffer to read hidapi reports into
     PSDualShock4DataOutput* OutData;                      // Buffer to write hidapi reports out from
+    HidInputReportReader* InputReader;                    // Reads hidapi reports on its own thread if cfg.use_threaded_hid_input
+    HidOutputReportWriter* OutputWriter;                  // Writes LED/rumble reports on its own thread if cfg.use_async_hid_output
 };
 #endif // PSDUALSHOCK4_CONTROLLER_H
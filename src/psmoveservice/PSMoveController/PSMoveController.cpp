@@ -36,6 +36,9 @@ POSSIBILITY OF SUCH DAMAGE.
 //-- includes -----
 #include "PSMoveController.h"
 #include "ControllerDeviceEnumerator.h"
+#include "HidApiMutex.h"
+#include "HidInputReportReader.h"
+#include "HidOutputReportWriter.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
 #include "BluetoothQueries.h"
@@ -62,13 +65,16 @@ POSSIBILITY OF SUCH DAMAGE.
 #define PSMOVE_FW_GET_SIZE 13
 #define PSMOVE_CALIBRATION_SIZE 49 /* Buffer size for calibration data */
 #define PSMOVE_CALIBRATION_BLOB_SIZE (PSMOVE_CALIBRATION_SIZE*3 - 2*2) /* Three blocks, minus header (2 bytes) for blocks 2,3 */
-#define PSMOVE_STATE_BUFFER_MAX 16
+#define PSMOVE_TIMESTAMP_TICK_SECONDS 0.00001 /* Nominal period of the 16-bit sample clock, refined at runtime */
 
 #define PSMOVE_TRACKING_BULB_RADIUS  2.25f // The radius of the psmove tracking bulb in cm
 
 /* Minimum time (in milliseconds) psmove write updates */
 #define PSMOVE_WRITE_DATA_INTERVAL_MS 120
 
+/* Minimum time (in milliseconds) between two LED/rumble writes, so a flurry of changes doesn't flood bluetooth */
+#define PSMOVE_MIN_WRITE_INTERVAL_MS 10
+
 /* Decode 12-bit signed value (assuming two's complement) */
 #define TWELVE_BIT_SIGNED(x) (((x) & 0x800)?(-(((~(x)) & 0xFFF) + 1)):(x))
 
@@ -206,6 +212,8 @@ PSMoveControllerConfig::config2ptree()
 
     pt.put("prediction_time", prediction_time);
     pt.put("max_poll_failure_count", max_poll_failure_count);
+    pt.put("use_threaded_hid_input", use_threaded_hid_input);
+    pt.put("use_async_hid_output", use_async_hid_output);
     
     pt.put("Calibration.Accel.X.k", cal_ag_xyz_kb[0][0][0]);
     pt.put("Calibration.Accel.X.b", cal_ag_xyz_kb[0][0][1]);
@@ -284,6 +292,8 @@ PSMoveControllerConfig::ptree2config(const boost::property_tree::ptree &pt)
 
         prediction_time = pt.get<float>("prediction_time", 0.f);
         max_poll_failure_count = pt.get<long>("max_poll_failure_count", 100);
+        use_threaded_hid_input = pt.get<bool>("use_threaded_hid_input", false);
+        use_async_hid_output = pt.get<bool>("use_async_hid_output", true);
 
         cal_ag_xyz_kb[0][0][0] = pt.get<float>("Calibration.Accel.X.k", 1.0f);
         cal_ag_xyz_kb[0][0][1] = pt.get<float>("Calibration.Accel.X.b", 0.0f);
@@ -379,6 +389,7 @@ PSMoveController::PSMoveController()
     , Rumble(0)
     , bWriteStateDirty(false)
     , NextPollSequenceNumber(0)
+    , SampleTimestamp(16, PSMOVE_TIMESTAMP_TICK_SECONDS)
 {
 	HIDDetails.vendor_id = -1;
 	HIDDetails.product_id = -1;
@@ -388,6 +399,9 @@ PSMoveController::PSMoveController()
     InData = new PSMoveDataInput;
     InData->type = PSMove_Req_GetInput;
 
+    InputReader = new HidInputReportReader;
+    OutputWriter = new HidOutputReportWriter;
+
     // Make sure there is an initial empty state in the tracker queue
     {     
         PSMoveControllerState empty_state;
@@ -404,6 +418,8 @@ PSMoveController::~PSMoveController()
         SERVER_LOG_ERROR("~PSMoveController") << "Controller deleted without calling close() first!";
     }
 
+    delete OutputWriter;
+    delete InputReader;
     delete InData;
 }
 
@@ -452,6 +468,7 @@ bool PSMoveController::open(
 		HIDDetails.vendor_id = pEnum->get_vendor_id();
 		HIDDetails.product_id = pEnum->get_product_id();
         HIDDetails.Device_path = cur_dev_path;
+        std::unique_lock<std::mutex> hidapi_lock(getHidApiMutex());
     #ifdef _WIN32
         HIDDetails.Device_path_addr = HIDDetails.Device_path;
         HIDDetails.Device_path_addr.replace(HIDDetails.Device_path_addr.find("&col01#"), 7, "&col02#");
@@ -461,6 +478,7 @@ bool PSMoveController::open(
     #endif
         HIDDetails.Handle = hid_open_path(HIDDetails.Device_path.c_str());
         hid_set_nonblocking(HIDDetails.Handle, 1);
+        hidapi_lock.unlock();
                 
         // On my Mac, using bluetooth,
         // cur_dev->path = Bluetooth_054c_03d5_779732e8
@@ -569,8 +587,24 @@ bool PSMoveController::open(
 				cfg.save();
 			}
 
-            // Reset the polling sequence counter
+            // Reset the polling sequence counter and sample clock
             NextPollSequenceNumber= 0;
+            SampleTimestamp.reset();
+
+            // Read input reports as soon as they arrive rather than when the main loop gets around to it
+            if (success && IsBluetooth && cfg.use_threaded_hid_input)
+            {
+                InputReader->start(HIDDetails.Handle, sizeof(PSMoveDataInput), "PSMove HID Reader");
+            }
+
+            // Keep slow bluetooth LED/rumble writes off the main loop.
+            // The writer also takes over re-sending the LED state every PSMOVE_WRITE_DATA_INTERVAL_MS.
+            if (success && IsBluetooth && cfg.use_async_hid_output)
+            {
+                OutputWriter->start(
+                    HIDDetails.Handle, hid_write, "PSMove HID Writer", 
+                    PSMOVE_MIN_WRITE_INTERVAL_MS, PSMOVE_WRITE_DATA_INTERVAL_MS);
+            }
         }
         else
         {
@@ -588,6 +622,12 @@ void PSMoveController::close()
     {
         SERVER_LOG_INFO("PSMoveController::close") << "Closing PSMoveController(" << HIDDetails.Device_path << ")";
 
+        // The reader and writer threads must be done with the handle before it gets closed
+        OutputWriter->stop();
+        InputReader->stop();
+
+        std::lock_guard<std::mutex> hidapi_lock(getHidApiMutex());
+
         if (HIDDetails.Handle != nullptr)
         {
             hid_close(HIDDetails.Handle);
@@ -1043,7 +1083,19 @@ PSMoveController::poll()
         for (int iteration= 0; iteration < k_max_iterations; ++iteration)
         {
             // Attempt to read the next update packet from the controller
-            int res = hid_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSMoveDataInput));
+            // (or the next one the reader thread already read)
+            double host_receive_seconds= 0.0;
+            int res;
+
+            if (InputReader->getIsRunning())
+            {
+                res = InputReader->popReport((unsigned char*)InData, sizeof(PSMoveDataInput), host_receive_seconds);
+            }
+            else
+            {
+                res = hid_read(HIDDetails.Handle, (unsigned char*)InData, sizeof(PSMoveDataInput));
+                host_receive_seconds = DeviceTimestampReconstructor::getHostSeconds();
+            }
 
             if (res == 0)
             {
@@ -1188,19 +1240,16 @@ PSMoveController::poll()
             newState.RawSequence = (InData->buttons4 & 0x0F);
             newState.Battery = static_cast<CommonControllerState::BatteryLevel>(InData->battery);
             newState.RawTimeStamp = InData->timelow | (InData->timehigh << 8);
+            newState.DeviceTimestampSeconds = 
+                SampleTimestamp.update(newState.RawTimeStamp, host_receive_seconds);
+            newState.bIsDeviceTimestampValid = true;
             newState.TempRaw = (InData->temphigh << 4) | ((InData->templow_mXhigh & 0xF0) >> 4);
 
-            // Make room for new entry if at the max queue size
-            if (ControllerStates.size() >= PSMOVE_STATE_BUFFER_MAX)
-            {
-                ControllerStates.erase(ControllerStates.begin(),
-                    ControllerStates.begin() + ControllerStates.size() - PSMOVE_STATE_BUFFER_MAX);
-            }
-
             ControllerStates.push_back(newState);
         }
 
-        // Update recurrent writes on a regular interval
+        // Update recurrent writes on a regular interval (the output writer thread does this itself)
+        if (!OutputWriter->getIsRunning())
         {
             std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
 
@@ -1221,9 +1270,7 @@ const CommonDeviceState *
 PSMoveController::getState(
     int lookBack) const
 {
-    const int queueSize= static_cast<int>(ControllerStates.size());
-    const CommonDeviceState * result=
-        (lookBack < queueSize) ? &ControllerStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = ControllerStates.getState(lookBack);
 
     return result;
 }
@@ -1341,9 +1388,17 @@ PSMoveController::writeDataOut()
         // Keep writing state out until the desired LED and Rumble are 0 
         bWriteStateDirty = LedR != 0 || LedG != 0 || LedB != 0 || Rumble != 0;
 
-        int res = hid_write(HIDDetails.Handle, (unsigned char*)(&data_out),
-            sizeof(data_out));
-        bSuccess= (res == sizeof(data_out));
+        if (OutputWriter->getIsRunning())
+        {
+            // Hand it off to the writer thread, which keeps re-sending it while dirty
+            bSuccess= OutputWriter->postReport((unsigned char*)(&data_out), sizeof(data_out), bWriteStateDirty);
+        }
+        else
+        {
+            int res = hid_write(HIDDetails.Handle, (unsigned char*)(&data_out),
+                sizeof(data_out));
+            bSuccess= (res == sizeof(data_out));
+        }
     }
 
     return bSuccess;
@@ -4,13 +4,16 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
+#include "DeviceTimestamp.h"
 #include "MathUtility.h"
 #include "hidapi.h"
 #include <string>
 #include <array>
-#include <deque>
 #include <chrono>
 
+#define PSMOVE_STATE_BUFFER_MAX 16
+
 struct PSMoveHIDDetails {
 	int vendor_id;
 	int product_id;
@@ -23,6 +26,8 @@ struct PSMoveHIDDetails {
 };
 
 struct PSMoveDataInput;  // See .cpp for full declaration
+class HidInputReportReader;
+class HidOutputReportWriter;
 
 class PSMoveControllerConfig : public PSMoveConfig
 {
@@ -37,6 +42,8 @@ public:
 		, bt_firmware_version(0)
 		, firmware_revision(0)
         , max_poll_failure_count(100) 
+        , use_threaded_hid_input(false)
+        , use_async_hid_output(true)
         , prediction_time(0.f)
 		, position_filter_type("LowPassExponential")
 		, orientation_filter_type("ComplementaryMARG")
@@ -87,6 +94,12 @@ public:
 	// The max number of polling failures before we consider the controller disconnected
     long max_poll_failure_count;
 
+	// Read HID input reports on a dedicated thread instead of from the main loop
+	bool use_threaded_hid_input;
+
+	// Write LED/rumble reports on a dedicated thread instead of from the main loop
+	bool use_async_hid_output;
+
 	// The amount of prediction to apply to the controller pose after filtering
     float prediction_time;
 
@@ -156,7 +169,7 @@ struct PSMoveControllerState : public CommonControllerState
     int RawSequence;                               // 4-bit (1..16).
                                                 // Sometimes frames are dropped.
     
-    unsigned int RawTimeStamp;                     // 16-bit (time since ?, units?)
+    unsigned int RawTimeStamp;                     // 16-bit sample clock, ~10us per tick
                                                 // About 1150 between in-order frames.
 
     ButtonState Triangle;
@@ -181,8 +194,6 @@ struct PSMoveControllerState : public CommonControllerState
     std::array<float, 3> CalibratedMag;                       // One frame of 3 dimensions
 
     int TempRaw;
-
-    //TODO: high-precision timestamp. Need to do in hidapi?
     
     PSMoveControllerState()
     {
@@ -300,7 +311,10 @@ private:
 
     // Read Controller State
     int NextPollSequenceNumber;
-    std::deque<PSMoveControllerState> ControllerStates;
+    DeviceTimestampReconstructor SampleTimestamp;   // Unwraps RawTimeStamp into DeviceTimestampSeconds
+    DeviceStateBuffer<PSMoveControllerState, PSMOVE_STATE_BUFFER_MAX> ControllerStates;
     PSMoveDataInput* InData;                        // Buffer to copy hidapi reports into
+    HidInputReportReader* InputReader;              // Reads hidapi reports on its own thread if cfg.use_threaded_hid_input
+    HidOutputReportWriter* OutputWriter;            // Writes LED/rumble reports on its own thread if cfg.use_async_hid_output
 };
 #endif // PSMOVE_CONTROLLER_H
\ No newline at end of file
@@ -2,30 +2,254 @@
 #include "PS3EyeTracker.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
+#include "ServerWakeupSignal.h"
 #include "PSEyeVideoCapture.h"
 #include "PSMoveProtocol.pb.h"
 #include "TrackerDeviceEnumerator.h"
 #include "TrackerManager.h"
 #include "opencv2/opencv.hpp"
 
-// -- constants -----
-#define PS3EYE_STATE_BUFFER_MAX 16
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
+// -- constants -----
 static const char *OPTION_FOV_SETTING = "FOV Setting";
 static const char *OPTION_FOV_RED_DOT = "Red Dot";
 static const char *OPTION_FOV_BLUE_DOT = "Blue Dot";
 
 // -- private definitions -----
+// Three video frames handed from the camera to the tracker view without copying or locking.
+// The camera always has a free frame to capture into, the reader always takes the newest
+// complete frame, and the frame the reader holds is never written to until it takes another.
+class VideoFrameTripleBuffer
+{
+public:
+    VideoFrameTripleBuffer()
+        : m_write_index(0)
+        , m_read_index(1)
+        , m_shared_state(2)
+    {
+    }
+
+    cv::Mat &getWriteFrame()
+    {
+        return m_frames[m_write_index];
+    }
+
+    // Hands the frame just written to the reader and takes back the frame it replaces
+    void publishWriteFrame()
+    {
+        const int prev_state = m_shared_state.exchange(m_write_index | k_new_frame_flag, std::memory_order_acq_rel);
+
+        m_write_index = prev_state & k_frame_index_mask;
+    }
+
+    // Swaps in the newest published frame. Returns false if nothing was published since the last call.
+    bool acquireReadFrame()
+    {
+        if ((m_shared_state.load(std::memory_order_relaxed) & k_new_frame_flag) == 0)
+        {
+            return false;
+        }
+
+        const int prev_state = m_shared_state.exchange(m_read_index, std::memory_order_acq_rel);
+
+        m_read_index = prev_state & k_frame_index_mask;
+
+        return true;
+    }
+
+    const cv::Mat &getReadFrame() const
+    {
+        return m_frames[m_read_index];
+    }
+
+private:
+    static const int k_frame_index_mask = 0x3;
+    static const int k_new_frame_flag = 0x4;
+
+    cv::Mat m_frames[3];
+    int m_write_index; // Only touched by the writer
+    int m_read_index; // Only touched by the reader
+    std::atomic<int> m_shared_state; // Index of the frame in between, plus the new frame flag
+};
+
+// Captures frames on its own thread so that a new frame wakes up the main loop the moment it arrives.
+// The capture blocks in retrieve() until the camera delivers the next frame, so once the thread
+// is running it is the only one that touches the camera. Property changes are posted to it and
+// applied between frames, and property reads come from a cache of the requested values.
 class PSEyeCaptureData
 {
 public:
     PSEyeCaptureData()
-        : frame()
+        : frames()
+        , property_mutex()
+        , pending_property_changes()
+        , property_values()
+        , published_frame_count(0)
+        , polled_frame_count(0)
+        , video_capture(nullptr)
+        , capture_thread()
+        , bExitRequested(false)
+    {
+    }
+
+    ~PSEyeCaptureData()
+    {
+        stop();
+    }
+
+    void start(PSEyeVideoCapture *capture)
+    {
+        video_capture = capture;
+
+        // The capture thread isn't running yet, so the camera can be read directly
+        for (int property_id : k_cached_property_ids)
+        {
+            property_values[property_id] = video_capture->get(property_id);
+        }
+
+        bExitRequested = false;
+        capture_thread = std::thread(&PSEyeCaptureData::captureThreadFunc, this);
+    }
+
+    void stop()
+    {
+        if (capture_thread.joinable())
+        {
+            bExitRequested = true;
+            capture_thread.join();
+        }
+    }
+
+    // Poll thread only: true if the capture thread published a frame since the last call
+    bool consumeNewFrameFlag()
+    {
+        const int frame_count = published_frame_count.load(std::memory_order_acquire);
+        const bool bHasNewFrame = (frame_count != polled_frame_count);
+
+        polled_frame_count = frame_count;
+
+        return bHasNewFrame;
+    }
+
+    // Queues a camera property change for the capture thread. Never waits on a frame.
+    void setProperty(int property_id, double value)
+    {
+        std::lock_guard<std::mutex> lock(property_mutex);
+
+        pending_property_changes.push_back(std::make_pair(property_id, value));
+        property_values[property_id] = value;
+    }
+
+    // The last requested value, or the value the camera settled on once the change was applied
+    double getProperty(int property_id) const
     {
+        std::lock_guard<std::mutex> lock(property_mutex);
+        auto iter = property_values.find(property_id);
 
+        return (iter != property_values.end()) ? iter->second : 0.0;
     }
 
-    cv::Mat frame;
+    VideoFrameTripleBuffer frames;
+
+private:
+    void applyPendingPropertyChanges()
+    {
+        std::vector<std::pair<int, double>> property_changes;
+
+        {
+            std::lock_guard<std::mutex> lock(property_mutex);
+
+            property_changes.swap(pending_property_changes);
+        }
+
+        if (property_changes.empty())
+        {
+            return;
+        }
+
+        for (const auto &property_change : property_changes)
+        {
+            video_capture->set(property_change.first, property_change.second);
+        }
+
+        // The camera can round a setting (e.g. a frame width it doesn't support),
+        // so cache what it actually ended up with unless newer changes are already queued
+        double camera_values[k_cached_property_count];
+        for (int index = 0; index < k_cached_property_count; ++index)
+        {
+            camera_values[index] = video_capture->get(k_cached_property_ids[index]);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(property_mutex);
+
+            if (pending_property_changes.empty())
+            {
+                for (int index = 0; index < k_cached_property_count; ++index)
+                {
+                    property_values[k_cached_property_ids[index]] = camera_values[index];
+                }
+            }
+        }
+    }
+
+    void captureThreadFunc()
+    {
+        ServerUtility::set_current_thread_name("PS3EyeCapture");
+
+        while (!bExitRequested)
+        {
+            // Reconfigure the camera between frames
+            applyPendingPropertyChanges();
+
+            // Capture straight into the free frame of the triple buffer
+            const bool bCaptured =
+                video_capture->grab() &&
+                video_capture->retrieve(frames.getWriteFrame(), cv::CAP_OPENNI_BGR_IMAGE);
+
+            if (bCaptured)
+            {
+                frames.publishWriteFrame();
+                published_frame_count.fetch_add(1, std::memory_order_release);
+
+                // Let the main loop pick up the new frame right away
+                ServerWakeupSignal::get_instance()->notify();
+            }
+            else
+            {
+                // Camera not streaming (i.e. mid reconfigure). Don't spin on it.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+
+    static const int k_cached_property_count = 6;
+    static const int k_cached_property_ids[k_cached_property_count];
+
+    mutable std::mutex property_mutex;
+    std::vector<std::pair<int, double>> pending_property_changes;
+    std::map<int, double> property_values;
+    std::atomic_int published_frame_count;
+    int polled_frame_count; // Only touched by the poll thread
+    PSEyeVideoCapture *video_capture;
+    std::thread capture_thread;
+    std::atomic_bool bExitRequested;
+};
+
+const int PSEyeCaptureData::k_cached_property_ids[PSEyeCaptureData::k_cached_property_count] = {
+    cv::CAP_PROP_FRAME_WIDTH,
+    cv::CAP_PROP_FRAME_HEIGHT,
+    cv::CAP_PROP_FORMAT,
+    cv::CAP_PROP_FPS,
+    cv::CAP_PROP_EXPOSURE,
+    cv::CAP_PROP_GAIN
 };
 
 // -- public methods
@@ -335,6 +559,7 @@ bool PS3EyeTracker::open(const DeviceEnumerator *enumerator)
         if (VideoCapture->isOpened())
         {
             CaptureData = new PSEyeCaptureData;
+            CaptureData->start(VideoCapture);
             USBDevicePath = enumerator->get_path();
             bSuccess = true;
         }
@@ -359,10 +584,11 @@ bool PS3EyeTracker::open(const DeviceEnumerator *enumerator)
 		// Save the config back out again in case defaults changed
 		cfg.save();
 
-		VideoCapture->set(cv::CAP_PROP_FRAME_WIDTH, cfg.frame_width);
-		VideoCapture->set(cv::CAP_PROP_EXPOSURE, cfg.exposure);
-		VideoCapture->set(cv::CAP_PROP_GAIN, cfg.gain);
-		VideoCapture->set(cv::CAP_PROP_FPS, cfg.frame_rate);
+		// The capture thread applies these before its next frame
+		CaptureData->setProperty(cv::CAP_PROP_FRAME_WIDTH, cfg.frame_width);
+		CaptureData->setProperty(cv::CAP_PROP_EXPOSURE, cfg.exposure);
+		CaptureData->setProperty(cv::CAP_PROP_GAIN, cfg.gain);
+		CaptureData->setProperty(cv::CAP_PROP_FPS, cfg.frame_rate);
     }
 
     return bSuccess;
@@ -384,8 +610,8 @@ IDeviceInterface::ePollResult PS3EyeTracker::poll()
 
     if (getIsOpen())
     {
-        if (!VideoCapture->grab() || 
-            !VideoCapture->retrieve(CaptureData->frame, cv::CAP_OPENNI_BGR_IMAGE))
+        // The capture thread publishes frames as they arrive
+        if (!CaptureData->consumeNewFrameFlag())
         {
             // Device still in valid state
             result = IControllerInterface::_PollResultSuccessNoData;
@@ -405,13 +631,6 @@ IDeviceInterface::ePollResult PS3EyeTracker::poll()
             newState.PollSequenceNumber = NextPollSequenceNumber;
             ++NextPollSequenceNumber;
 
-            // Make room for new entry if at the max queue size
-            //###bwalker $TODO Make this a fixed size circular buffer
-            if (TrackerStates.size() >= PS3EYE_STATE_BUFFER_MAX)
-            {
-                TrackerStates.erase(TrackerStates.begin(), TrackerStates.begin() + TrackerStates.size() - PS3EYE_STATE_BUFFER_MAX);
-            }
-
             TrackerStates.push_back(newState);
         }
     }
@@ -446,9 +665,7 @@ CommonDeviceState::eDeviceType PS3EyeTracker::getDeviceType() const
 
 const CommonDeviceState *PS3EyeTracker::getState(int lookBack) const
 {
-    const int queueSize = static_cast<int>(TrackerStates.size());
-    const CommonDeviceState * result =
-        (lookBack < queueSize) ? &TrackerStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = TrackerStates.getState(lookBack);
 
     return result;
 }
@@ -473,11 +690,11 @@ bool PS3EyeTracker::getVideoFrameDimensions(
 
     if (out_width != nullptr)
     {
-        int width = static_cast<int>(VideoCapture->get(cv::CAP_PROP_FRAME_WIDTH));
+        int width = static_cast<int>(CaptureData->getProperty(cv::CAP_PROP_FRAME_WIDTH));
 
         if (out_stride != nullptr)
         {
-            int format = static_cast<int>(VideoCapture->get(cv::CAP_PROP_FORMAT));
+            int format = static_cast<int>(CaptureData->getProperty(cv::CAP_PROP_FORMAT));
             int bytes_per_pixel;
 
             if (format != -1)
@@ -514,7 +731,7 @@ bool PS3EyeTracker::getVideoFrameDimensions(
 
     if (out_height != nullptr)
     {
-        int height = static_cast<int>(VideoCapture->get(cv::CAP_PROP_FRAME_HEIGHT));
+        int height = static_cast<int>(CaptureData->getProperty(cv::CAP_PROP_FRAME_HEIGHT));
 
         *out_height = height;
     }
@@ -528,7 +745,24 @@ const unsigned char *PS3EyeTracker::getVideoFrameBuffer() const
 
     if (CaptureData != nullptr)
     {
-        return static_cast<const unsigned char *>(CaptureData->frame.data);
+        return static_cast<const unsigned char *>(CaptureData->frames.getReadFrame().data);
+    }
+
+    return result;
+}
+
+const unsigned char *PS3EyeTracker::acquireVideoFrameBuffer(int *out_width, int *out_height, int *out_stride)
+{
+    const unsigned char *result = nullptr;
+
+    if (CaptureData != nullptr && CaptureData->frames.acquireReadFrame())
+    {
+        const cv::Mat &frame = CaptureData->frames.getReadFrame();
+
+        result = static_cast<const unsigned char *>(frame.data);
+        *out_width = frame.cols;
+        *out_height = frame.rows;
+        *out_stride = static_cast<int>(frame.step);
     }
 
     return result;
@@ -536,31 +770,32 @@ const unsigned char *PS3EyeTracker::getVideoFrameBuffer() const
 
 void PS3EyeTracker::loadSettings()
 {
-	const double currentFrameWidth = VideoCapture->get(cv::CAP_PROP_FRAME_WIDTH);
-	const double currentFrameRate = VideoCapture->get(cv::CAP_PROP_FPS);
-    const double currentExposure= VideoCapture->get(cv::CAP_PROP_EXPOSURE);
-    const double currentGain= VideoCapture->get(cv::CAP_PROP_GAIN);
+    // The capture thread applies the changes between frames
+	const double currentFrameWidth = CaptureData->getProperty(cv::CAP_PROP_FRAME_WIDTH);
+	const double currentFrameRate = CaptureData->getProperty(cv::CAP_PROP_FPS);
+    const double currentExposure= CaptureData->getProperty(cv::CAP_PROP_EXPOSURE);
+    const double currentGain= CaptureData->getProperty(cv::CAP_PROP_GAIN);
 
     cfg.load();
 
 	if (currentFrameWidth != cfg.frame_width)
 	{
-		VideoCapture->set(cv::CAP_PROP_FRAME_WIDTH, cfg.frame_width);
+		CaptureData->setProperty(cv::CAP_PROP_FRAME_WIDTH, cfg.frame_width);
 	}
 
     if (currentExposure != cfg.exposure)
     {
-        VideoCapture->set(cv::CAP_PROP_EXPOSURE, cfg.exposure);
+        CaptureData->setProperty(cv::CAP_PROP_EXPOSURE, cfg.exposure);
     }
 
     if (currentGain != cfg.gain)
     {
-        VideoCapture->set(cv::CAP_PROP_GAIN, cfg.gain);
+        CaptureData->setProperty(cv::CAP_PROP_GAIN, cfg.gain);
     }
 
 	if (currentFrameRate != cfg.frame_rate)
 	{
-		VideoCapture->set(cv::CAP_PROP_FPS, cfg.frame_rate);
+		CaptureData->setProperty(cv::CAP_PROP_FPS, cfg.frame_rate);
 	}
 }
 
@@ -571,7 +806,7 @@ void PS3EyeTracker::saveSettings()
 
 void PS3EyeTracker::setFrameWidth(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_FRAME_WIDTH, value);
+	CaptureData->setProperty(cv::CAP_PROP_FRAME_WIDTH, value);
 
 	if (bUpdateConfig)
 	{
@@ -581,12 +816,12 @@ void PS3EyeTracker::setFrameWidth(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getFrameWidth() const
 {
-	return VideoCapture->get(cv::CAP_PROP_FRAME_WIDTH);
+	return CaptureData->getProperty(cv::CAP_PROP_FRAME_WIDTH);
 }
 
 void PS3EyeTracker::setFrameHeight(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_FRAME_HEIGHT, value);
+	CaptureData->setProperty(cv::CAP_PROP_FRAME_HEIGHT, value);
 
 	if (bUpdateConfig)
 	{
@@ -596,12 +831,12 @@ void PS3EyeTracker::setFrameHeight(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getFrameHeight() const
 {
-	return VideoCapture->get(cv::CAP_PROP_FRAME_HEIGHT);
+	return CaptureData->getProperty(cv::CAP_PROP_FRAME_HEIGHT);
 }
 
 void PS3EyeTracker::setFrameRate(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_FPS, value);
+	CaptureData->setProperty(cv::CAP_PROP_FPS, value);
 
 	if (bUpdateConfig)
 	{
@@ -611,12 +846,12 @@ void PS3EyeTracker::setFrameRate(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getFrameRate() const
 {
-	return VideoCapture->get(cv::CAP_PROP_FPS);
+	return CaptureData->getProperty(cv::CAP_PROP_FPS);
 }
 
 void PS3EyeTracker::setExposure(double value, bool bUpdateConfig)
 {
-    VideoCapture->set(cv::CAP_PROP_EXPOSURE, value);
+    CaptureData->setProperty(cv::CAP_PROP_EXPOSURE, value);
 
 	if (bUpdateConfig)
 	{
@@ -626,12 +861,12 @@ void PS3EyeTracker::setExposure(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getExposure() const
 {
-    return VideoCapture->get(cv::CAP_PROP_EXPOSURE);
+    return CaptureData->getProperty(cv::CAP_PROP_EXPOSURE);
 }
 
 void PS3EyeTracker::setGain(double value, bool bUpdateConfig)
 {
-	VideoCapture->set(cv::CAP_PROP_GAIN, value);
+	CaptureData->setProperty(cv::CAP_PROP_GAIN, value);
 
 	if (bUpdateConfig)
 	{
@@ -641,7 +876,7 @@ void PS3EyeTracker::setGain(double value, bool bUpdateConfig)
 
 double PS3EyeTracker::getGain() const
 {
-	return VideoCapture->get(cv::CAP_PROP_GAIN);
+	return CaptureData->getProperty(cv::CAP_PROP_GAIN);
 }
 
 void PS3EyeTracker::getCameraIntrinsics(
@@ -5,9 +5,11 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
 #include <string>
 #include <vector>
-#include <deque>
+
+#define PS3EYE_STATE_BUFFER_MAX 16
 
 // -- pre-declarations -----
 namespace PSMoveProtocol
@@ -105,6 +107,7 @@ public:
     std::string getUSBDevicePath() const override;
     bool getVideoFrameDimensions(int *out_width, int *out_height, int *out_stride) const override;
     const unsigned char *getVideoFrameBuffer() const override;
+    const unsigned char *acquireVideoFrameBuffer(int *out_width, int *out_height, int *out_stride) override;
     void loadSettings() override;
     void saveSettings() override;
 	void setFrameWidth(double value, bool bUpdateConfig) override;
@@ -151,6 +154,6 @@ private:
     
     // Read Controller State
     int NextPollSequenceNumber;
-    std::deque<PS3EyeTrackerState> TrackerStates;
+    DeviceStateBuffer<PS3EyeTrackerState, PS3EYE_STATE_BUFFER_MAX> TrackerStates;
 };
 #endif // PS3EYE_TRACKER_H
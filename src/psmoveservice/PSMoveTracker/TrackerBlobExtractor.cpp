@@ -0,0 +1,279 @@
+// -- includes -----
+#include "TrackerBlobExtractor.h"
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <climits>
+
+// -- private methods -----
+// Sum of x^2 for x in [0, n)
+static inline double sumOfSquaresBelow(double n)
+{
+    return (n - 1.0) * n * (2.0 * n - 1.0) / 6.0;
+}
+
+// Orders blobs so that the heap front is the smallest blob
+static inline bool isBiggerBlob(const TrackerBlob &a, const TrackerBlob &b)
+{
+    return a.area > b.area;
+}
+
+// -- public interface -----
+TrackerBlobExtractor::TrackerBlobExtractor()
+    : m_x_offset(0)
+    , m_y_offset(0)
+{
+}
+
+int TrackerBlobExtractor::extractBlobs(const cv::Mat &mask, int x_offset, int y_offset, int max_blob_count)
+{
+    assert(mask.type() == CV_8UC1);
+
+    m_runs.clear();
+    m_parent_labels.clear();
+    m_accumulators.clear();
+    m_blobs.clear();
+    m_x_offset = x_offset;
+    m_y_offset = y_offset;
+
+    if (max_blob_count <= 0)
+    {
+        return 0;
+    }
+
+    // Label every run of set pixels, merging it with the runs it touches on the row above
+    size_t prev_row_begin = 0;
+    size_t prev_row_end = 0;
+    for (int row = 0; row < mask.rows; ++row)
+    {
+        const unsigned char *pixels = mask.ptr<unsigned char>(row);
+        const size_t row_begin = m_runs.size();
+        size_t prev_run_index = prev_row_begin;
+        int col = 0;
+
+        while (col < mask.cols)
+        {
+            while (col < mask.cols && pixels[col] == 0)
+            {
+                ++col;
+            }
+
+            if (col == mask.cols)
+            {
+                break;
+            }
+
+            PixelRun run;
+            run.y = row;
+            run.x_begin = col;
+            while (col < mask.cols && pixels[col] != 0)
+            {
+                ++col;
+            }
+            run.x_end = col;
+            run.label = -1;
+
+            // Skip runs above that end left of this run's 8-neighborhood.
+            // They can't touch any run further right on this row either.
+            while (prev_run_index < prev_row_end && m_runs[prev_run_index].x_end < run.x_begin)
+            {
+                ++prev_run_index;
+            }
+
+            for (size_t run_index = prev_run_index;
+                run_index < prev_row_end && m_runs[run_index].x_begin <= run.x_end;
+                ++run_index)
+            {
+                const int root_label = findRootLabel(m_runs[run_index].label);
+
+                if (run.label == -1)
+                {
+                    run.label = root_label;
+                }
+                else if (root_label != run.label)
+                {
+                    // Keep the lower label as the root so roots never point forward
+                    const int low_label = std::min(root_label, run.label);
+                    const int high_label = std::max(root_label, run.label);
+
+                    m_parent_labels[high_label] = low_label;
+                    run.label = low_label;
+                }
+            }
+
+            if (run.label == -1)
+            {
+                BlobAccumulator accumulator;
+                accumulator.area = 0.0;
+                accumulator.sum_x = accumulator.sum_y = 0.0;
+                accumulator.sum_xx = accumulator.sum_xy = accumulator.sum_yy = 0.0;
+                accumulator.min_x = accumulator.min_y = INT_MAX;
+                accumulator.max_x = accumulator.max_y = INT_MIN;
+
+                run.label = static_cast<int>(m_parent_labels.size());
+                m_parent_labels.push_back(run.label);
+                m_accumulators.push_back(accumulator);
+            }
+
+            m_runs.push_back(run);
+            accumulateRun(run);
+        }
+
+        prev_row_begin = row_begin;
+        prev_row_end = m_runs.size();
+    }
+
+    // Fold the statistics of merged labels into their roots.
+    // Roots always have a lower label than the labels merged into them.
+    for (int label = 0; label < static_cast<int>(m_parent_labels.size()); ++label)
+    {
+        const int root_label = findRootLabel(label);
+
+        if (root_label != label)
+        {
+            const BlobAccumulator &source = m_accumulators[label];
+            BlobAccumulator &target = m_accumulators[root_label];
+
+            target.area += source.area;
+            target.sum_x += source.sum_x;
+            target.sum_y += source.sum_y;
+            target.sum_xx += source.sum_xx;
+            target.sum_xy += source.sum_xy;
+            target.sum_yy += source.sum_yy;
+            target.min_x = std::min(target.min_x, source.min_x);
+            target.min_y = std::min(target.min_y, source.min_y);
+            target.max_x = std::max(target.max_x, source.max_x);
+            target.max_y = std::max(target.max_y, source.max_y);
+        }
+    }
+
+    // Keep the biggest blobs in a bounded min-heap
+    for (int label = 0; label < static_cast<int>(m_parent_labels.size()); ++label)
+    {
+        if (m_parent_labels[label] != label)
+        {
+            continue;
+        }
+
+        const BlobAccumulator &accumulator = m_accumulators[label];
+        const int area = static_cast<int>(accumulator.area);
+
+        if (static_cast<int>(m_blobs.size()) == max_blob_count)
+        {
+            if (area <= m_blobs.front().area)
+            {
+                continue;
+            }
+
+            std::pop_heap(m_blobs.begin(), m_blobs.end(), isBiggerBlob);
+            m_blobs.pop_back();
+        }
+
+        const double center_x = accumulator.sum_x / accumulator.area;
+        const double center_y = accumulator.sum_y / accumulator.area;
+
+        TrackerBlob blob;
+        blob.label = label;
+        blob.area = area;
+        blob.center_x = static_cast<float>(center_x + x_offset);
+        blob.center_y = static_cast<float>(center_y + y_offset);
+        blob.min_x = accumulator.min_x + x_offset;
+        blob.min_y = accumulator.min_y + y_offset;
+        blob.max_x = accumulator.max_x + x_offset;
+        blob.max_y = accumulator.max_y + y_offset;
+        blob.mu20 = static_cast<float>(accumulator.sum_xx / accumulator.area - center_x * center_x);
+        blob.mu11 = static_cast<float>(accumulator.sum_xy / accumulator.area - center_x * center_y);
+        blob.mu02 = static_cast<float>(accumulator.sum_yy / accumulator.area - center_y * center_y);
+
+        m_blobs.push_back(blob);
+        std::push_heap(m_blobs.begin(), m_blobs.end(), isBiggerBlob);
+    }
+
+    std::sort_heap(m_blobs.begin(), m_blobs.end(), isBiggerBlob);
+
+    return static_cast<int>(m_blobs.size());
+}
+
+void TrackerBlobExtractor::computeBlobContour(const TrackerBlob &blob, std::vector<cv::Point> &out_contour)
+{
+    out_contour.clear();
+
+    // Paint just this blob into its bounding box, with a one pixel empty border
+    // so the tracer never has to deal with the edge of the buffer
+    const int local_min_x = blob.min_x - m_x_offset;
+    const int local_min_y = blob.min_y - m_y_offset;
+    const int width = blob.max_x - blob.min_x + 3;
+    const int height = blob.max_y - blob.min_y + 3;
+
+    m_contour_mask.assign(static_cast<size_t>(width) * height, 0);
+    for (const PixelRun &run : m_runs)
+    {
+        if (run.y >= local_min_y && run.y <= local_min_y + height - 3 && findRootLabel(run.label) == blob.label)
+        {
+            unsigned char *row_pixels = &m_contour_mask[static_cast<size_t>(run.y - local_min_y + 1) * width];
+
+            std::fill(
+                row_pixels + (run.x_begin - local_min_x + 1), 
+                row_pixels + (run.x_end - local_min_x + 1), 
+                static_cast<unsigned char>(255));
+        }
+    }
+
+    cv::Mat contour_mask(height, width, CV_8UC1, m_contour_mask.data());
+    std::vector<std::vector<cv::Point> > contours;
+    cv::findContours(
+        contour_mask,
+        contours,
+        CV_RETR_EXTERNAL,
+        CV_CHAIN_APPROX_SIMPLE,
+        cv::Point(blob.min_x - 1, blob.min_y - 1));
+
+    // A single 8-connected blob has a single outer contour
+    if (contours.size() > 0)
+    {
+        out_contour.swap(contours[0]);
+    }
+}
+
+// -- private methods -----
+int TrackerBlobExtractor::findRootLabel(int label)
+{
+    int root_label = label;
+    while (m_parent_labels[root_label] != root_label)
+    {
+        root_label = m_parent_labels[root_label];
+    }
+
+    // Path compression
+    while (m_parent_labels[label] != root_label)
+    {
+        const int parent_label = m_parent_labels[label];
+
+        m_parent_labels[label] = root_label;
+        label = parent_label;
+    }
+
+    return root_label;
+}
+
+void TrackerBlobExtractor::accumulateRun(const PixelRun &run)
+{
+    BlobAccumulator &accumulator = m_accumulators[run.label];
+    const double length = run.x_end - run.x_begin;
+    const double sum_x = length * (run.x_begin + run.x_end - 1) * 0.5;
+    const double y = run.y;
+
+    accumulator.area += length;
+    accumulator.sum_x += sum_x;
+    accumulator.sum_y += length * y;
+    accumulator.sum_xx += sumOfSquaresBelow(run.x_end) - sumOfSquaresBelow(run.x_begin);
+    accumulator.sum_xy += sum_x * y;
+    accumulator.sum_yy += length * y * y;
+    accumulator.min_x = std::min(accumulator.min_x, run.x_begin);
+    accumulator.min_y = std::min(accumulator.min_y, run.y);
+    accumulator.max_x = std::max(accumulator.max_x, run.x_end - 1);
+    accumulator.max_y = std::max(accumulator.max_y, run.y);
+}
@@ -0,0 +1,76 @@
+#ifndef TRACKER_BLOB_EXTRACTOR_H
+#define TRACKER_BLOB_EXTRACTOR_H
+
+// -- includes -----
+#include <vector>
+
+// -- pre-declarations -----
+namespace cv
+{
+    class Mat;
+    template<typename _Tp> class Point_;
+};
+
+// -- definitions -----
+/// Size, position and shape of one 8-connected blob of a binary mask, in image space
+struct TrackerBlob
+{
+    int label; // Which blob this is in the extractor that found it
+    int area; // Pixel count
+    float center_x, center_y; // Centroid
+    int min_x, min_y, max_x, max_y; // Inclusive bounding box
+    float mu20, mu11, mu02; // Central second moments divided by the area
+};
+
+/// Labels the 8-connected blobs of a binary mask in a single pass over its runs of set pixels,
+/// merging run labels with union-find. Blob statistics are accumulated per run as the mask is
+/// scanned, so no label image is written and contours are only traced for the blobs that are kept.
+class TrackerBlobExtractor
+{
+public:
+    TrackerBlobExtractor();
+
+    /// Finds the blobs of the nonzero pixels of a CV_8UC1 mask (or ROI of a mask) and keeps up to
+    /// max_blob_count of the biggest ones, biggest first. (x_offset, y_offset) is where the mask
+    /// sits in image space. Returns the number of blobs kept.
+    int extractBlobs(const cv::Mat &mask, int x_offset, int y_offset, int max_blob_count);
+
+    inline const std::vector<TrackerBlob> &getBlobs() const
+    {
+        return m_blobs;
+    }
+
+    /// Traces the outer contour of a blob returned by the last extractBlobs() call, in image space.
+    /// The points are laid out like cv::findContours(CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE).
+    void computeBlobContour(const TrackerBlob &blob, std::vector<cv::Point_<int> > &out_contour);
+
+private:
+    struct PixelRun
+    {
+        int y;
+        int x_begin;
+        int x_end; // exclusive
+        int label;
+    };
+
+    struct BlobAccumulator
+    {
+        double area;
+        double sum_x, sum_y;
+        double sum_xx, sum_xy, sum_yy;
+        int min_x, min_y, max_x, max_y;
+    };
+
+    int findRootLabel(int label);
+    void accumulateRun(const PixelRun &run);
+
+    std::vector<PixelRun> m_runs;
+    std::vector<int> m_parent_labels;
+    std::vector<BlobAccumulator> m_accumulators;
+    std::vector<TrackerBlob> m_blobs;
+    std::vector<unsigned char> m_contour_mask; // One blob painted into its bounding box for tracing
+    int m_x_offset;
+    int m_y_offset;
+};
+
+#endif // TRACKER_BLOB_EXTRACTOR_H
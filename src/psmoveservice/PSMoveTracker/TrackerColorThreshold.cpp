@@ -0,0 +1,280 @@
+// -- includes -----
+#include "TrackerColorThreshold.h"
+
+#include "opencv2/core/core.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+// -- constants -----
+// Fixed point shift cv::cvtColor uses for 8-bit HSV conversion
+static const int k_hsv_shift = 12;
+static const int k_hsv_round = 1 << (k_hsv_shift - 1);
+static const int k_hue_range = 180;
+
+// -- private definitions -----
+// Reciprocal tables matching the ones in OpenCV's RGB2HSV_b
+struct HSVDivisionTables
+{
+    int sdiv[256];
+    int hdiv[256];
+
+    HSVDivisionTables()
+    {
+        sdiv[0] = hdiv[0] = 0;
+        for (int i = 1; i < 256; ++i)
+        {
+            sdiv[i] = cvRound((255 << k_hsv_shift) / (1.*i));
+            hdiv[i] = cvRound((k_hue_range << k_hsv_shift) / (6.*i));
+        }
+    }
+};
+
+// -- private methods -----
+static const HSVDivisionTables &getHSVDivisionTables()
+{
+    static HSVDivisionTables s_tables;
+
+    return s_tables;
+}
+
+static void setRangeTable(unsigned char *table, int range_min, int range_max)
+{
+    // Mirrors cv::inRange: inclusive bounds, empty when min > max
+    for (int i = 0; i < 256; ++i)
+    {
+        table[i] = (i >= range_min && i <= range_max) ? 255 : 0;
+    }
+}
+
+static inline float clampRange(float value, float low, float high)
+{
+    return std::min(std::max(value, low), high);
+}
+
+// Saturation and hue steps of OpenCV's RGB2HSV_b, given v = max(b,g,r) and diff = v - min(b,g,r)
+static inline int computeSaturation(const HSVDivisionTables &tables, int v, int diff)
+{
+    return (diff * tables.sdiv[v] + k_hsv_round) >> k_hsv_shift;
+}
+
+static inline int computeHue(const HSVDivisionTables &tables, int b, int g, int r, int v, int diff)
+{
+    const int vr = v == r ? -1 : 0;
+    const int vg = v == g ? -1 : 0;
+    int h = (vr & (g - b)) + (~vr & ((vg & (b - r + 2 * diff)) + ((~vg) & (r - g + 4 * diff))));
+
+    h = (h * tables.hdiv[diff] + k_hsv_round) >> k_hsv_shift;
+    h += h < 0 ? k_hue_range : 0;
+
+    return h;
+}
+
+// -- public interface -----
+void HSVColorThreshold::setColorRange(const CommonHSVColorRange &hsvColorRange)
+{
+    const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
+    const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
+    const float saturation_min = clampRange(hsvColorRange.saturation_range.center - hsvColorRange.saturation_range.range, 0, 255);
+    const float saturation_max = clampRange(hsvColorRange.saturation_range.center + hsvColorRange.saturation_range.range, 0, 255);
+    const float value_min = clampRange(hsvColorRange.value_range.center - hsvColorRange.value_range.range, 0, 255);
+    const float value_max = clampRange(hsvColorRange.value_range.center + hsvColorRange.value_range.range, 0, 255);
+
+    // Same hue wrap-around split as OpenCVBufferState::computeBiggestNContours
+    if (hue_min < 0)
+    {
+        unsigned char upper_hues[256];
+
+        setRangeTable(hue_in_range, 0, cvRound(clampRange(hue_max, 0, k_hue_range)));
+        setRangeTable(upper_hues, cvRound(clampRange(k_hue_range + hue_min, 0, k_hue_range)), k_hue_range);
+        for (int i = 0; i < 256; ++i)
+        {
+            hue_in_range[i] |= upper_hues[i];
+        }
+    }
+    else if (hue_max > k_hue_range)
+    {
+        unsigned char upper_hues[256];
+
+        setRangeTable(hue_in_range, 0, cvRound(clampRange(hue_max - k_hue_range, 0, k_hue_range)));
+        setRangeTable(upper_hues, cvRound(clampRange(hue_min, 0, k_hue_range)), k_hue_range);
+        for (int i = 0; i < 256; ++i)
+        {
+            hue_in_range[i] |= upper_hues[i];
+        }
+    }
+    else
+    {
+        setRangeTable(hue_in_range, cvRound(hue_min), cvRound(hue_max));
+    }
+
+    setRangeTable(saturation_in_range, cvRound(saturation_min), cvRound(saturation_max));
+    setRangeTable(value_in_range, cvRound(value_min), cvRound(value_max));
+}
+
+void computeHSVThresholdMask(const cv::Mat &bgr, const HSVColorThreshold &threshold, cv::Mat &out_mask)
+{
+    assert(bgr.type() == CV_8UC3);
+    assert(out_mask.type() == CV_8UC1);
+    assert(bgr.rows == out_mask.rows && bgr.cols == out_mask.cols);
+
+    const HSVDivisionTables &tables = getHSVDivisionTables();
+
+    for (int row = 0; row < bgr.rows; ++row)
+    {
+        const unsigned char *src = bgr.ptr<unsigned char>(row);
+        unsigned char *dst = out_mask.ptr<unsigned char>(row);
+
+        for (int col = 0; col < bgr.cols; ++col, src += 3)
+        {
+            const int b = src[0];
+            const int g = src[1];
+            const int r = src[2];
+            const int v = std::max(b, std::max(g, r));
+
+            // Test value first, then saturation, then hue so that the
+            // (common) out of range pixels skip most of the conversion
+            unsigned char in_range = threshold.value_in_range[v];
+
+            if (in_range != 0)
+            {
+                const int diff = v - std::min(b, std::min(g, r));
+
+                in_range = threshold.saturation_in_range[computeSaturation(tables, v, diff)];
+
+                if (in_range != 0)
+                {
+                    in_range = threshold.hue_in_range[computeHue(tables, b, g, r, v, diff)];
+                }
+            }
+
+            dst[col] = in_range;
+        }
+    }
+}
+
+void convertBGRToHSV(const cv::Mat &bgr, cv::Mat &out_hsv)
+{
+    assert(bgr.type() == CV_8UC3);
+    assert(out_hsv.type() == CV_8UC3);
+    assert(bgr.rows == out_hsv.rows && bgr.cols == out_hsv.cols);
+
+    const HSVDivisionTables &tables = getHSVDivisionTables();
+
+    for (int row = 0; row < bgr.rows; ++row)
+    {
+        const unsigned char *src = bgr.ptr<unsigned char>(row);
+        unsigned char *dst = out_hsv.ptr<unsigned char>(row);
+
+        for (int col = 0; col < bgr.cols; ++col, src += 3, dst += 3)
+        {
+            const int b = src[0];
+            const int g = src[1];
+            const int r = src[2];
+            const int v = std::max(b, std::max(g, r));
+            const int diff = v - std::min(b, std::min(g, r));
+
+            dst[0] = static_cast<unsigned char>(computeHue(tables, b, g, r, v, diff));
+            dst[1] = static_cast<unsigned char>(computeSaturation(tables, v, diff));
+            dst[2] = static_cast<unsigned char>(v);
+        }
+    }
+}
+
+HSVColorClassificationTable::HSVColorClassificationTable()
+    : m_color_bits(1 << (3 * k_bits_per_channel), 0)
+{
+}
+
+void HSVColorClassificationTable::build(
+    const CommonHSVColorRange color_ranges[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES],
+    const bool color_used[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES])
+{
+    const HSVDivisionTables &tables = getHSVDivisionTables();
+    const int cell_count = 1 << k_bits_per_channel;
+    const int shift = 8 - k_bits_per_channel;
+    const int cell_center = (1 << shift) >> 1;
+
+    HSVColorThreshold thresholds[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+    for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+    {
+        if (color_used[color_id])
+        {
+            thresholds[color_id].setColorRange(color_ranges[color_id]);
+        }
+    }
+
+    int table_index = 0;
+    for (int r_cell = 0; r_cell < cell_count; ++r_cell)
+    {
+        for (int g_cell = 0; g_cell < cell_count; ++g_cell)
+        {
+            for (int b_cell = 0; b_cell < cell_count; ++b_cell)
+            {
+                const int b = (b_cell << shift) | cell_center;
+                const int g = (g_cell << shift) | cell_center;
+                const int r = (r_cell << shift) | cell_center;
+                const int v = std::max(b, std::max(g, r));
+                const int diff = v - std::min(b, std::min(g, r));
+                const int s = computeSaturation(tables, v, diff);
+                const int h = computeHue(tables, b, g, r, v, diff);
+
+                unsigned char color_bits = 0;
+                for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+                {
+                    const HSVColorThreshold &threshold = thresholds[color_id];
+
+                    if (color_used[color_id] &&
+                        threshold.value_in_range[v] != 0 &&
+                        threshold.saturation_in_range[s] != 0 &&
+                        threshold.hue_in_range[h] != 0)
+                    {
+                        color_bits |= 1 << color_id;
+                    }
+                }
+
+                m_color_bits[table_index] = color_bits;
+                ++table_index;
+            }
+        }
+    }
+}
+
+void HSVColorClassificationTable::classifyImage(const cv::Mat &bgr, cv::Mat &out_color_bits) const
+{
+    assert(bgr.type() == CV_8UC3);
+    assert(out_color_bits.type() == CV_8UC1);
+    assert(bgr.rows == out_color_bits.rows && bgr.cols == out_color_bits.cols);
+
+    for (int row = 0; row < bgr.rows; ++row)
+    {
+        const unsigned char *src = bgr.ptr<unsigned char>(row);
+        unsigned char *dst = out_color_bits.ptr<unsigned char>(row);
+
+        for (int col = 0; col < bgr.cols; ++col, src += 3)
+        {
+            dst[col] = classify(src[0], src[1], src[2]);
+        }
+    }
+}
+
+void computeColorMaskFromClassification(const cv::Mat &color_bits, eCommonTrackingColorID color_id, cv::Mat &out_mask)
+{
+    assert(color_bits.type() == CV_8UC1);
+    assert(out_mask.type() == CV_8UC1);
+    assert(color_bits.rows == out_mask.rows && color_bits.cols == out_mask.cols);
+    assert(color_id >= 0 && color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES);
+
+    const unsigned char color_bit = static_cast<unsigned char>(1 << color_id);
+
+    for (int row = 0; row < color_bits.rows; ++row)
+    {
+        const unsigned char *src = color_bits.ptr<unsigned char>(row);
+        unsigned char *dst = out_mask.ptr<unsigned char>(row);
+
+        for (int col = 0; col < color_bits.cols; ++col)
+        {
+            dst[col] = (src[col] & color_bit) != 0 ? 255 : 0;
+        }
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef TRACKER_COLOR_THRESHOLD_H
+#define TRACKER_COLOR_THRESHOLD_H
+
+// -- includes -----
+#include "DeviceInterface.h"
+#include <vector>
+
+// -- pre-declarations -----
+namespace cv
+{
+    class Mat;
+};
+
+// -- definitions -----
+/// Per-channel membership tables for one tracking color preset.
+/// Built with the same bounds (including the hue wrap-around) that
+/// cv::inRange is given for the preset on the OpenCV HSV path.
+struct HSVColorThreshold
+{
+    unsigned char hue_in_range[256];
+    unsigned char saturation_in_range[256];
+    unsigned char value_in_range[256];
+
+    void setColorRange(const CommonHSVColorRange &hsvColorRange);
+};
+
+/// Maps a quantized BGR color straight to a bitmask of the tracking colors whose HSV range contains it,
+/// so one lookup per pixel classifies the pixel against every tracked color at once.
+/// Each quantization cell is classified by the HSV of its center color.
+class HSVColorClassificationTable
+{
+public:
+    static const int k_bits_per_channel = 6;
+
+    HSVColorClassificationTable();
+
+    /// Rebuilds the table from the given presets, indexed by eCommonTrackingColorID.
+    /// Colors whose color_used entry is false never match.
+    void build(
+        const CommonHSVColorRange color_ranges[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES],
+        const bool color_used[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES]);
+
+    inline unsigned char classify(int b, int g, int r) const
+    {
+        const int shift = 8 - k_bits_per_channel;
+
+        return m_color_bits[((r >> shift) << (2 * k_bits_per_channel)) | ((g >> shift) << k_bits_per_channel) | (b >> shift)];
+    }
+
+    /// Writes the tracking color bitmask of every pixel of the 8-bit BGR image into out_color_bits (CV_8UC1, same size)
+    void classifyImage(const cv::Mat &bgr, cv::Mat &out_color_bits) const;
+
+private:
+    std::vector<unsigned char> m_color_bits;
+};
+
+// -- interface -----
+/// Writes 255 into out_mask for every pixel of the 8-bit BGR image that falls inside the threshold, 0 otherwise.
+/// Does the HSV conversion and range test in one pass over the image. Each pixel is converted
+/// exactly like cv::cvtColor(COLOR_BGR2HSV), so the mask is identical to cvtColor + inRange + bitwise_or.
+/// out_mask must be an allocated CV_8UC1 image (or ROI) with the same size as bgr.
+void computeHSVThresholdMask(const cv::Mat &bgr, const HSVColorThreshold &threshold, cv::Mat &out_mask);
+
+/// Converts an 8-bit BGR image to HSV with output identical to cv::cvtColor(COLOR_BGR2HSV).
+/// Only needs two 1KB reciprocal tables, unlike the 48MB BGR->HSV lookup table.
+/// out_hsv must be an allocated CV_8UC3 image (or ROI) with the same size as bgr.
+void convertBGRToHSV(const cv::Mat &bgr, cv::Mat &out_hsv);
+
+/// Writes 255 into out_mask wherever the classified color bitmask has the given tracking color set, 0 otherwise.
+/// color_bits is the output of HSVColorClassificationTable::classifyImage (or an ROI of it).
+void computeColorMaskFromClassification(const cv::Mat &color_bits, eCommonTrackingColorID color_id, cv::Mat &out_mask);
+
+#endif // TRACKER_COLOR_THRESHOLD_H
@@ -5,10 +5,15 @@
 #include "ControllerGamepadEnumerator.h"
 #include "ServerLog.h"
 #include "ServerUtility.h"
+#include "ServerWakeupSignal.h"
 #include "USBDeviceManager.h"
 
 #include "gamepad/Gamepad.h"
 
+#include <boost/lockfree/spsc_queue.hpp>
+
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <iomanip>
@@ -38,6 +43,7 @@
 
 #define PSNAVI_CONFIGURATION_VALUE  1
 #define PSNAVI_ENDPOINT_IN 0x80
+#define PSNAVI_INPUT_REPORT_ENDPOINT 0x81
 
 #define PSNAVI_HID_INTERFACE 0
 
@@ -48,7 +54,9 @@
 #define PSNAVI_CNTLR_BTADDR_BUF_SIZE 17
 #define PSNAVI_HOST_BTADDR_BUF_SIZE 9
 #define PSNAVI_BTADDR_SIZE 6
-#define PSNAVI_STATE_BUFFER_MAX 16
+#define PSNAVI_INPUT_REPORT_SIZE 64
+#define PSNAVI_INPUT_REPORT_QUEUE_SIZE 16
+#define PSNAVI_INPUT_REPORT_TRANSFER_COUNT 2 // interrupt transfers kept in flight
 
 // https://github.com/nitsch/moveonpc/wiki/HID-reports
 enum PSNaviRequestType {
@@ -81,6 +89,12 @@ enum PSNaviButton {
 };
 
 // -- private definitions -----
+struct PSNaviInputReport
+{
+	unsigned char data[PSNAVI_INPUT_REPORT_SIZE];
+	int length;
+};
+
 class PSNaviAPIContext
 {
 public:
@@ -94,6 +108,11 @@ public:
 	std::string usb_device_path;
 	t_usb_device_handle usb_device_handle;
 
+	// Input reports pushed by the USB worker thread and drained by poll()
+	boost::lockfree::spsc_queue<PSNaviInputReport, boost::lockfree::capacity<PSNAVI_INPUT_REPORT_QUEUE_SIZE> > usb_input_report_queue;
+	std::chrono::time_point<std::chrono::high_resolution_clock> last_usb_input_report_time;
+	bool bIsUSBInputStreamActive;
+
 	// Gamepad state
 	std::string gamepad_device_path;
 	int gamepad_index;
@@ -112,6 +131,8 @@ public:
 		controller_bluetooth_address = "";
 		usb_device_path = "";
 		usb_device_handle = k_invalid_usb_device_handle;
+		while (usb_input_report_queue.pop());
+		bIsUSBInputStreamActive = false;
 		gamepad_device_path = "";
 		gamepad_index = -1;
 	}
@@ -147,9 +168,12 @@ static bool stringToNaviBTAddrUchar(const std::string &addr, unsigned char *addr
 inline void setButtonBit(unsigned int &buttons, unsigned int button_mask, bool is_pressed);
 inline enum CommonControllerState::ButtonState getButtonState(unsigned int buttons, unsigned int lastButtons, int buttonMask);
 
-static int psnavi_get_usb_feature_report(t_usb_device_handle device_handle, unsigned char *report_bytes, size_t report_size);
+static void psnavi_build_get_usb_feature_report_request(t_usb_device_handle device_handle, unsigned char report_id, size_t report_size, USBTransferRequest &out_request);
+static int psnavi_parse_get_usb_feature_report_result(const USBTransferResult &transfer_result, unsigned char *report_bytes, size_t report_size);
 static int psnavi_send_usb_feature_report(t_usb_device_handle device_handle, unsigned char *report_bytes, size_t report_size);
-static int psnavi_read_usb_interrupt_pipe(t_usb_device_handle device_handle, unsigned char *buffer, size_t max_buffer_size);
+static bool psnavi_start_usb_input_stream(t_usb_device_handle device_handle, PSNaviAPIContext *context);
+static void psnavi_stop_usb_input_stream(t_usb_device_handle device_handle);
+static void psnavi_on_usb_input_report(unsigned char *packet_data, int packet_length, void *userdata);
 
 // -- public methods
 
@@ -287,8 +311,7 @@ bool PSNaviController::open(
 			if (pEnum->get_api_type() == ControllerDeviceEnumerator::CommunicationType_USB)
 			{
 				// Get the bluetooth address
-				if (getHostBTAddressOverUSB(APIContext->host_bluetooth_address) &&
-					getControllerBTAddressOverUSB(APIContext->controller_bluetooth_address))
+				if (getBTAddressesOverUSB(APIContext->host_bluetooth_address, APIContext->controller_bluetooth_address))
 				{
 					// Build a unique name for the config file using bluetooth address of the controller
 					char szConfigSuffix[18];
@@ -309,7 +332,10 @@ bool PSNaviController::open(
 					// Tell the controller to start sending input data packets
 					setInputStreamEnabledOverUSB();
 
-					success = true;
+					// Keep interrupt transfers in flight on the usb worker thread from now on
+					APIContext->bIsUSBInputStreamActive =
+						psnavi_start_usb_input_stream(APIContext->usb_device_handle, APIContext);
+					success = APIContext->bIsUSBInputStreamActive;
 				}
 				else
 				{
@@ -356,6 +382,11 @@ void PSNaviController::close()
 			USBDeviceManager *usbMgr = USBDeviceManager::getInstance();
 
 			SERVER_LOG_INFO("PSNaviController::close") << "Closing PSNaviController(" << APIContext->usb_device_path << ")";
+			if (APIContext->bIsUSBInputStreamActive)
+			{
+				psnavi_stop_usb_input_stream(APIContext->usb_device_handle);
+				APIContext->bIsUSBInputStreamActive = false;
+			}
 			usb_device_close(APIContext->usb_device_handle);
 			APIContext->usb_device_handle = k_invalid_usb_device_handle;
 		}
@@ -534,51 +565,38 @@ PSNaviController::setInputStreamEnabledOverUSB()
 }
 
 bool
-PSNaviController::getHostBTAddressOverUSB(std::string& host)
-{
-    bool bSuccess = false;
-        
-    unsigned char btg[64];
-    unsigned char ctrl_char_buff[PSNAVI_BTADDR_SIZE];
-
-    memset(btg, 0, sizeof(btg));
-    btg[0] = PSNavi_Req_GetHostBTAddr;
-
-	int res = psnavi_get_usb_feature_report(APIContext->usb_device_handle, btg, sizeof(btg));
-	if (res == sizeof(btg))
-	{
-		bSuccess = true;
-	}
-
-	if (bSuccess)
-	{
-		memcpy(ctrl_char_buff, btg + 2, PSNAVI_BTADDR_SIZE);
-		host = NaviBTAddrUcharToString(ctrl_char_buff);
-	}
-	
-    return bSuccess;
-}
-
-bool
-PSNaviController::getControllerBTAddressOverUSB(std::string& controller)
+PSNaviController::getBTAddressesOverUSB(std::string& host, std::string& controller)
 {
 	bool bSuccess = false;
 
-	unsigned char btg[64];
+	unsigned char host_btg[64];
+	unsigned char controller_btg[64];
 	unsigned char ctrl_char_buff[PSNAVI_BTADDR_SIZE];
 
-	memset(btg, 0, sizeof(btg));
-	btg[0] = PSNavi_Req_GetControllerBTAddr;
+	// Read both feature reports with a single wait on the usb worker thread
+	USBTransferRequest transfer_requests[2];
+	USBTransferResult transfer_results[2];
+	psnavi_build_get_usb_feature_report_request(
+		APIContext->usb_device_handle, PSNavi_Req_GetHostBTAddr, sizeof(host_btg), transfer_requests[0]);
+	psnavi_build_get_usb_feature_report_request(
+		APIContext->usb_device_handle, PSNavi_Req_GetControllerBTAddr, sizeof(controller_btg), transfer_requests[1]);
+	usb_device_submit_transfer_requests_blocking(transfer_requests, transfer_results, 2);
 
-	int res = psnavi_get_usb_feature_report(APIContext->usb_device_handle, btg, sizeof(btg));
-	if (res == sizeof(btg))
+	memset(host_btg, 0, sizeof(host_btg));
+	memset(controller_btg, 0, sizeof(controller_btg));
+
+	if (psnavi_parse_get_usb_feature_report_result(transfer_results[0], host_btg, sizeof(host_btg)) == sizeof(host_btg) &&
+		psnavi_parse_get_usb_feature_report_result(transfer_results[1], controller_btg, sizeof(controller_btg)) == sizeof(controller_btg))
 	{
 		bSuccess = true;
 	}
 
 	if (bSuccess)
 	{
-		memcpy(ctrl_char_buff, btg + 4, PSNAVI_BTADDR_SIZE);
+		memcpy(ctrl_char_buff, host_btg + 2, PSNAVI_BTADDR_SIZE);
+		host = NaviBTAddrUcharToString(ctrl_char_buff);
+
+		memcpy(ctrl_char_buff, controller_btg + 4, PSNAVI_BTADDR_SIZE);
 		controller = NaviBTAddrUcharToString(ctrl_char_buff);
 	}
 
@@ -667,13 +685,6 @@ PSNaviController::pollGamepad()
 		// Can't report the true battery state
 		newState.Battery = CommonControllerState::Batt_MAX;
 
-		// Make room for new entry if at the max queue size
-		if (ControllerStates.size() >= PSNAVI_STATE_BUFFER_MAX)
-		{
-			ControllerStates.erase(ControllerStates.begin(),
-				ControllerStates.begin() + ControllerStates.size() - PSNAVI_STATE_BUFFER_MAX);
-		}
-
 		ControllerStates.push_back(newState);
 	}
 	else
@@ -690,23 +701,29 @@ PSNaviController::pollUSB()
 	assert(getIsOpen());
 	assert(!getIsBluetooth());
 
-	IControllerInterface::ePollResult poll_result;
-	int res = psnavi_read_usb_interrupt_pipe(APIContext->usb_device_handle, InBuffer, sizeof(InBuffer));
+	IControllerInterface::ePollResult poll_result = IControllerInterface::_PollResultSuccessNoData;
+	const std::chrono::time_point<std::chrono::high_resolution_clock> now = std::chrono::high_resolution_clock::now();
 
-	if (res < 0)
-	{
-		poll_result = IControllerInterface::_PollResultFailure;
-	}
-	else if (res == 0)
-	{
-		poll_result = IControllerInterface::_PollResultSuccessNoData;
-	}
-	else
+	// Drain every report that arrived since the last poll so no button transitions get dropped
+	PSNaviInputReport report;
+	while (APIContext->usb_input_report_queue.pop(report))
 	{
+		memcpy(InBuffer, report.data, sizeof(InBuffer));
 		parseInputData();
+
+		APIContext->last_usb_input_report_time = now;
 		poll_result = IControllerInterface::_PollResultSuccessNewData;
 	}
 
+	// The stream stops delivering reports when the device goes away.
+	// Treat that the same way the old blocking read treated a timed out transfer.
+	if (poll_result == IControllerInterface::_PollResultSuccessNoData &&
+		now - APIContext->last_usb_input_report_time > std::chrono::milliseconds(INTERRUPT_TRANSFER_TIMEOUT))
+	{
+		SERVER_LOG_ERROR("PSNaviController::pollUSB") << "No input report received in " << INTERRUPT_TRANSFER_TIMEOUT << "ms";
+		poll_result = IControllerInterface::_PollResultFailure;
+	}
+
 	return poll_result;
 }
 
@@ -747,13 +764,6 @@ PSNaviController::parseInputData()
 	// Other
 	newState.Battery = static_cast<CommonControllerState::BatteryLevel>(InData->battery);
 
-	// Make room for new entry if at the max queue size
-	if (ControllerStates.size() >= PSNAVI_STATE_BUFFER_MAX)
-	{
-		ControllerStates.erase(ControllerStates.begin(),
-			ControllerStates.begin() + ControllerStates.size() - PSNAVI_STATE_BUFFER_MAX);
-	}
-
 	ControllerStates.push_back(newState);
 }
 
@@ -761,9 +771,7 @@ const CommonDeviceState *
 PSNaviController::getState(
     int lookBack) const
 {
-    const int queueSize= static_cast<int>(ControllerStates.size());
-    const CommonDeviceState * result=
-        (lookBack < queueSize) ? &ControllerStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = ControllerStates.getState(lookBack);
 
     return result;
 }
@@ -892,28 +900,33 @@ getButtonState(unsigned int buttons, unsigned int lastButtons, int buttonMask)
     return (enum CommonControllerState::ButtonState)((((lastButtons & buttonMask) > 0) << 1) + ((buttons & buttonMask)>0));
 }
 
-static int 
-psnavi_get_usb_feature_report(
+static void
+psnavi_build_get_usb_feature_report_request(
 	t_usb_device_handle device_handle,
-	unsigned char *report_bytes,
-	size_t report_size)
+	unsigned char report_id,
+	size_t report_size,
+	USBTransferRequest &out_request)
 {
-	USBDeviceManager *usbMgr= USBDeviceManager::getInstance();
-	int result = 0;
-	
-	USBTransferRequest transfer_request;
-	transfer_request.request_type = _USBRequestType_ControlTransfer;
+	out_request.request_type = _USBRequestType_ControlTransfer;
 
-	USBRequestPayload_ControlTransfer &control_transfer= transfer_request.payload.control_transfer;
+	USBRequestPayload_ControlTransfer &control_transfer= out_request.payload.control_transfer;
 	control_transfer.usb_device_handle = device_handle;
 	control_transfer.bmRequestType = USB_CTRL_IN;
 	control_transfer.bRequest = HID_GET_REPORT;
-	control_transfer.wValue = (HID_REPORT_TYPE_FEATURE << 8) | report_bytes[0];
+	control_transfer.wValue = (HID_REPORT_TYPE_FEATURE << 8) | report_id;
 	control_transfer.wIndex = 0;
 	control_transfer.wLength = static_cast<uint16_t>(report_size);
 	control_transfer.timeout = CONTROL_TRANSFER_TIMEOUT;
+}
+
+static int 
+psnavi_parse_get_usb_feature_report_result(
+	const USBTransferResult &transfer_result,
+	unsigned char *report_bytes,
+	size_t report_size)
+{
+	int result = 0;
 
-	USBTransferResult transfer_result= usb_device_submit_transfer_request_blocking(transfer_request);
 	assert(transfer_result.result_type == _USBResultType_ControlTransfer);
 
 	if (transfer_result.payload.control_transfer.result_code == _USBResultCode_Completed)
@@ -930,7 +943,7 @@ psnavi_get_usb_feature_report(
 	else
 	{
 		const char * error_text = usb_device_get_error_string(transfer_result.payload.control_transfer.result_code);
-		SERVER_LOG_ERROR("psnavi_get_usb_feature_report") << "Control transfer failed with error: " << error_text;
+		SERVER_LOG_ERROR("psnavi_parse_get_usb_feature_report_result") << "Control transfer failed with error: " << error_text;
 		result= -static_cast<int>(transfer_result.payload.control_transfer.result_code);
 	}
 
@@ -976,44 +989,80 @@ psnavi_send_usb_feature_report(
 	return result;
 }
 
-static int
-psnavi_read_usb_interrupt_pipe(
+static bool
+psnavi_start_usb_input_stream(
 	t_usb_device_handle device_handle,
-	unsigned char *buffer,
-	size_t max_buffer_size)
+	PSNaviAPIContext *context)
 {
-	USBDeviceManager *usbMgr = USBDeviceManager::getInstance();
-	int result = 0;
-
 	USBTransferRequest transfer_request;
-	transfer_request.request_type = _USBRequestType_InterruptTransfer;
+	transfer_request.request_type = _USBRequestType_StartBulkTransfer;
+
+	USBRequestPayload_BulkTransfer &bulk_transfer = transfer_request.payload.start_bulk_transfer;
+	bulk_transfer.usb_device_handle = device_handle;
+	bulk_transfer.transfer_packet_size = PSNAVI_INPUT_REPORT_SIZE;
+	bulk_transfer.in_flight_transfer_packet_count = PSNAVI_INPUT_REPORT_TRANSFER_COUNT;
+	bulk_transfer.on_data_callback = psnavi_on_usb_input_report;
+	bulk_transfer.transfer_callback_userdata = context;
+	bulk_transfer.endpoint = PSNAVI_INPUT_REPORT_ENDPOINT;
+	bulk_transfer.bIsInterruptTransfer = true;
+	bulk_transfer.bAutoResubmit = true;
 
-	USBRequestPayload_InterruptTransfer &interrupt_transfer = transfer_request.payload.interrupt_transfer;
-	interrupt_transfer.usb_device_handle = device_handle;
-	interrupt_transfer.endpoint = 0x81;
-	interrupt_transfer.length = static_cast<unsigned int>(max_buffer_size);
-	interrupt_transfer.timeout = INTERRUPT_TRANSFER_TIMEOUT;
+	// Give the first report the full timeout to show up
+	context->last_usb_input_report_time = std::chrono::high_resolution_clock::now();
 
 	USBTransferResult transfer_result = usb_device_submit_transfer_request_blocking(transfer_request);
-	assert(transfer_result.result_type == _USBResultType_InterrupTransfer);
+	assert(transfer_result.result_type == _USBResultType_BulkTransfer);
 
-	if (transfer_result.payload.interrupt_transfer.result_code == _USBResultCode_Completed)
+	const bool bSuccess = transfer_result.payload.bulk_transfer.result_code == _USBResultCode_Started;
+	if (!bSuccess)
 	{
-		size_t byte_count = std::min(static_cast<size_t>(transfer_result.payload.interrupt_transfer.dataLength), max_buffer_size);
+		const char * error_text = usb_device_get_error_string(transfer_result.payload.bulk_transfer.result_code);
+		SERVER_LOG_ERROR("psnavi_start_usb_input_stream") << "Failed to start interrupt transfers with error: " << error_text;
+	}
 
-		if (byte_count > 0)
-		{
-			memcpy(buffer, transfer_result.payload.interrupt_transfer.data, byte_count);
-		}
+	return bSuccess;
+}
 
-		result = transfer_result.payload.interrupt_transfer.dataLength;
-	}
-	else
+static void
+psnavi_stop_usb_input_stream(
+	t_usb_device_handle device_handle)
+{
+	USBTransferRequest transfer_request;
+	transfer_request.request_type = _USBRequestType_CancelBulkTransfer;
+	transfer_request.payload.cancel_bulk_transfer.usb_device_handle = device_handle;
+
+	// Once the cancel result comes back the worker thread won't call psnavi_on_usb_input_report anymore
+	USBTransferResult transfer_result = usb_device_submit_transfer_request_blocking(transfer_request);
+	assert(transfer_result.result_type == _USBResultType_BulkTransfer);
+
+	if (transfer_result.payload.bulk_transfer.result_code != _USBResultCode_Canceled)
 	{
-		const char * error_text = usb_device_get_error_string(transfer_result.payload.interrupt_transfer.result_code);
-		SERVER_LOG_ERROR("psnavi_read_usb_interrupt_pipe") << "interrupt transfer failed with error: " << error_text;
-		result = -static_cast<int>(transfer_result.payload.interrupt_transfer.result_code);
+		const char * error_text = usb_device_get_error_string(transfer_result.payload.bulk_transfer.result_code);
+		SERVER_LOG_WARNING("psnavi_stop_usb_input_stream") << "Failed to cancel interrupt transfers with error: " << error_text;
 	}
+}
 
-	return result;
+// NOTE: Called on the USB worker thread
+static void
+psnavi_on_usb_input_report(
+	unsigned char *packet_data,
+	int packet_length,
+	void *userdata)
+{
+	PSNaviAPIContext *context = reinterpret_cast<PSNaviAPIContext *>(userdata);
+
+	if (packet_length > 0)
+	{
+		PSNaviInputReport report;
+
+		report.length = std::min(packet_length, PSNAVI_INPUT_REPORT_SIZE);
+		memset(report.data, 0, sizeof(report.data));
+		memcpy(report.data, packet_data, report.length);
+
+		// If the main thread has fallen behind, drop the report rather than stall the worker thread
+		if (context->usb_input_report_queue.push(report))
+		{
+			ServerWakeupSignal::get_instance()->notify();
+		}
+	}
 }
\ No newline at end of file
@@ -4,9 +4,11 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
 #include <string>
 #include <vector>
-#include <deque>
+
+#define PSNAVI_STATE_BUFFER_MAX 16
 
 class PSNaviControllerConfig : public PSMoveConfig
 {
@@ -116,8 +118,7 @@ public:
         
 private:    
 	bool setInputStreamEnabledOverUSB();
-    bool getHostBTAddressOverUSB(std::string& out_host);
-	bool getControllerBTAddressOverUSB(std::string& out_controller);
+	bool getBTAddressesOverUSB(std::string& out_host, std::string& out_controller);
 
 	IControllerInterface::ePollResult pollUSB();
 	IControllerInterface::ePollResult pollGamepad();
@@ -130,7 +131,7 @@ private:
 
     // Read Controller State
     int NextPollSequenceNumber;
-    std::deque<PSNaviControllerState> ControllerStates;
+    DeviceStateBuffer<PSNaviControllerState, PSNAVI_STATE_BUFFER_MAX> ControllerStates;
     unsigned char InBuffer[64];                        // Buffer to copy hidapi reports into
 };
 #endif // PSMOVE_CONTROLLER_H
\ No newline at end of file
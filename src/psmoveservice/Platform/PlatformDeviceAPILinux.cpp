@@ -0,0 +1,315 @@
+// -- include -----
+#include "PlatformDeviceAPILinux.h"
+#include "ServerLog.h"
+
+#include <libudev.h>
+#include <poll.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+//-- constants -----
+// USB devices that show up as cameras but aren't handled through video4linux
+struct CameraUSBDeviceId
+{
+	int vendor_id;
+	int product_id;
+};
+
+static const CameraUSBDeviceId k_camera_usb_device_ids[] = {
+	{ 0x1415, 0x2000 }, // PS3Eye
+};
+static const int k_camera_usb_device_id_count = sizeof(k_camera_usb_device_ids) / sizeof(CameraUSBDeviceId);
+
+//-- private definitions -----
+class UdevHotplugEventSource : public IPlatformHotplugEventSource
+{
+public:
+	UdevHotplugEventSource()
+		: m_udev(nullptr)
+		, m_monitor(nullptr)
+		, m_monitor_fd(-1)
+	{
+	}
+
+	virtual ~UdevHotplugEventSource()
+	{
+		shutdown();
+	}
+
+	bool startup() override
+	{
+		bool bSuccess = true;
+
+		m_udev = udev_new();
+		if (m_udev == nullptr)
+		{
+			SERVER_LOG_ERROR("UdevHotplugEventSource::startup") << "Unable to create udev context";
+			bSuccess = false;
+		}
+
+		if (bSuccess)
+		{
+			m_monitor = udev_monitor_new_from_netlink(m_udev, "udev");
+			if (m_monitor == nullptr)
+			{
+				SERVER_LOG_ERROR("UdevHotplugEventSource::startup") << "Unable to create udev monitor";
+				bSuccess = false;
+			}
+		}
+
+		if (bSuccess)
+		{
+			bSuccess =
+				udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "hidraw", nullptr) >= 0 &&
+				udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "usb", "usb_device") >= 0 &&
+				udev_monitor_filter_add_match_subsystem_devtype(m_monitor, "video4linux", nullptr) >= 0 &&
+				udev_monitor_enable_receiving(m_monitor) >= 0;
+
+			if (!bSuccess)
+			{
+				SERVER_LOG_ERROR("UdevHotplugEventSource::startup") << "Unable to start receiving udev events";
+			}
+		}
+
+		if (bSuccess)
+		{
+			m_monitor_fd = udev_monitor_get_fd(m_monitor);
+		}
+		else
+		{
+			shutdown();
+		}
+
+		return bSuccess;
+	}
+
+	void shutdown() override
+	{
+		if (m_monitor != nullptr)
+		{
+			udev_monitor_unref(m_monitor);
+			m_monitor = nullptr;
+		}
+
+		if (m_udev != nullptr)
+		{
+			udev_unref(m_udev);
+			m_udev = nullptr;
+		}
+
+		m_monitor_fd = -1;
+	}
+
+	bool poll_event(PlatformHotplugEvent &out_event) override
+	{
+		bool bGotEvent = false;
+
+		// Skip over anything that isn't a plain add or remove (bind, change, ...)
+		while (!bGotEvent && has_pending_event())
+		{
+			struct udev_device *dev = udev_monitor_receive_device(m_monitor);
+
+			if (dev == nullptr)
+			{
+				break;
+			}
+
+			bGotEvent = parse_device_event(dev, out_event);
+			udev_device_unref(dev);
+		}
+
+		return bGotEvent;
+	}
+
+private:
+	bool has_pending_event() const
+	{
+		struct pollfd fds;
+
+		fds.fd = m_monitor_fd;
+		fds.events = POLLIN;
+		fds.revents = 0;
+
+		return m_monitor_fd >= 0 && ::poll(&fds, 1, 0) > 0 && (fds.revents & POLLIN) != 0;
+	}
+
+	static bool parse_device_event(struct udev_device *dev, PlatformHotplugEvent &out_event)
+	{
+		const char *action = udev_device_get_action(dev);
+		const char *subsystem = udev_device_get_subsystem(dev);
+
+		if (action == nullptr || subsystem == nullptr)
+		{
+			return false;
+		}
+
+		if (strcmp(action, "add") == 0)
+		{
+			out_event.action = PlatformHotplugEvent::Added;
+		}
+		else if (strcmp(action, "remove") == 0)
+		{
+			out_event.action = PlatformHotplugEvent::Removed;
+		}
+		else
+		{
+			return false;
+		}
+
+		const char *devnode = udev_device_get_devnode(dev);
+
+		out_event.subsystem = subsystem;
+		out_event.device_path = (devnode != nullptr) ? devnode : udev_device_get_syspath(dev);
+		out_event.vendor_id = -1;
+		out_event.product_id = -1;
+
+		if (out_event.subsystem == "usb")
+		{
+			// PRODUCT=<vid>/<pid>/<bcdDevice>, all in hex
+			const char *product = udev_device_get_property_value(dev, "PRODUCT");
+			unsigned int vendor_id, product_id;
+
+			if (product != nullptr && sscanf(product, "%x/%x", &vendor_id, &product_id) == 2)
+			{
+				out_event.vendor_id = static_cast<int>(vendor_id);
+				out_event.product_id = static_cast<int>(product_id);
+			}
+		}
+		else if (out_event.subsystem == "hidraw")
+		{
+			// HID_ID=<bus>:<vid>:<pid> lives on the parent hid device
+			struct udev_device *hid_dev = udev_device_get_parent_with_subsystem_devtype(dev, "hid", nullptr);
+			const char *hid_id = (hid_dev != nullptr) ? udev_device_get_property_value(hid_dev, "HID_ID") : nullptr;
+			unsigned int bus_type, vendor_id, product_id;
+
+			if (hid_id != nullptr && sscanf(hid_id, "%x:%x:%x", &bus_type, &vendor_id, &product_id) == 3)
+			{
+				out_event.vendor_id = static_cast<int>(vendor_id);
+				out_event.product_id = static_cast<int>(product_id);
+			}
+		}
+
+		return true;
+	}
+
+	struct udev *m_udev;
+	struct udev_monitor *m_monitor;
+	int m_monitor_fd;
+};
+
+// -- public methods -----
+PlatformDeviceAPILinux::PlatformDeviceAPILinux(IPlatformHotplugEventSource *event_source)
+	: m_event_source(event_source != nullptr ? event_source : new UdevHotplugEventSource)
+	, m_hotplug_broadcaster(nullptr)
+{
+}
+
+PlatformDeviceAPILinux::~PlatformDeviceAPILinux()
+{
+	shutdown();
+	delete m_event_source;
+}
+
+// System
+bool PlatformDeviceAPILinux::startup(IDeviceHotplugListener *broadcaster)
+{
+	bool bSuccess = m_event_source->startup();
+
+	if (bSuccess)
+	{
+		m_hotplug_broadcaster = broadcaster;
+	}
+	else
+	{
+		SERVER_LOG_ERROR("PlatformDeviceAPILinux::startup") << "Failed to start listening for device hotplug events";
+	}
+
+	return bSuccess;
+}
+
+void PlatformDeviceAPILinux::poll()
+{
+	if (m_hotplug_broadcaster == nullptr)
+	{
+		return;
+	}
+
+	PlatformHotplugEvent event;
+	while (m_event_source->poll_event(event))
+	{
+		const DeviceClass device_class = get_event_device_class(event);
+
+		if (device_class == DeviceClass::DeviceClass_INVALID)
+		{
+			continue;
+		}
+
+		SERVER_LOG_DEBUG("PlatformDeviceAPILinux::poll")
+			<< (event.action == PlatformHotplugEvent::Added ? "Added " : "Removed ")
+			<< event.subsystem << " device " << event.device_path;
+
+		if (event.action == PlatformHotplugEvent::Added)
+		{
+			m_hotplug_broadcaster->handle_device_connected(device_class, event.device_path);
+		}
+		else
+		{
+			m_hotplug_broadcaster->handle_device_disconnected(device_class, event.device_path);
+		}
+	}
+}
+
+void PlatformDeviceAPILinux::shutdown()
+{
+	if (m_hotplug_broadcaster != nullptr)
+	{
+		m_event_source->shutdown();
+		m_hotplug_broadcaster = nullptr;
+	}
+}
+
+// Queries
+bool PlatformDeviceAPILinux::get_device_property(
+	const DeviceClass deviceClass,
+	const int vendor_id,
+	const int product_id,
+	const char *property_name,
+	char *buffer,
+	const int buffer_size)
+{
+	// No driver registry to query on Linux
+	return false;
+}
+
+DeviceClass PlatformDeviceAPILinux::get_event_device_class(const PlatformHotplugEvent &event)
+{
+	DeviceClass device_class = DeviceClass::DeviceClass_INVALID;
+
+	if (event.subsystem == "hidraw")
+	{
+		// Controllers and HMDs over USB or Bluetooth
+		device_class = DeviceClass::DeviceClass_HID;
+	}
+	else if (event.subsystem == "video4linux")
+	{
+		device_class = DeviceClass::DeviceClass_Camera;
+	}
+	else if (event.subsystem == "usb")
+	{
+		// Raw usb devices only matter for cameras driven through libusb.
+		// Everything HID also raises a hidraw event.
+		for (int index = 0; index < k_camera_usb_device_id_count; ++index)
+		{
+			if (k_camera_usb_device_ids[index].vendor_id == event.vendor_id &&
+				k_camera_usb_device_ids[index].product_id == event.product_id)
+			{
+				device_class = DeviceClass::DeviceClass_Camera;
+				break;
+			}
+		}
+	}
+
+	return device_class;
+}
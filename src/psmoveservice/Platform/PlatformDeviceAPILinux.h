@@ -0,0 +1,70 @@
+#ifndef PLATFORM_DEVICE_API_LINUX_H
+#define PLATFORM_DEVICE_API_LINUX_H
+
+// -- include -----
+#include "DevicePlatformInterface.h"
+
+#include <string>
+
+// -- definitions -----
+struct PlatformHotplugEvent
+{
+	enum eAction
+	{
+		Added,
+		Removed
+	};
+
+	eAction action;
+	std::string subsystem;   // "hidraw", "usb" or "video4linux"
+	std::string device_path; // ex: "/dev/hidraw3" or "/dev/bus/usb/001/004"
+	int vendor_id;           // -1 when the event doesn't carry it
+	int product_id;
+};
+
+/// Where the Linux platform API gets its device add/remove events from.
+/// udev in the service, synthetic events in tests.
+class IPlatformHotplugEventSource
+{
+public:
+	virtual ~IPlatformHotplugEventSource() {}
+
+	virtual bool startup() = 0;
+	virtual void shutdown() = 0;
+
+	// Never blocks. Returns false once there are no more pending events.
+	virtual bool poll_event(PlatformHotplugEvent &out_event) = 0;
+};
+
+/// Turns udev hotplug events into device connected/disconnected notifications,
+/// so the device managers only re-enumerate when a device actually came or went.
+class PlatformDeviceAPILinux : public IPlatformDeviceAPI
+{
+public:
+	// Takes ownership of the event source. Listens to the udev monitor when none is given.
+	PlatformDeviceAPILinux(IPlatformHotplugEventSource *event_source = nullptr);
+	virtual ~PlatformDeviceAPILinux();
+
+	// System
+	bool startup(IDeviceHotplugListener *broadcaster) override;
+	void poll() override;
+	void shutdown() override;
+
+	// Queries
+	bool get_device_property(
+		const DeviceClass deviceClass,
+		const int vendor_id,
+		const int product_id,
+		const char *property_name,
+		char *buffer,
+		const int buffer_size) override;
+
+	// Which device managers care about the event, DeviceClass_INVALID if none
+	static DeviceClass get_event_device_class(const PlatformHotplugEvent &event);
+
+private:
+	IPlatformHotplugEventSource *m_event_source;
+	IDeviceHotplugListener *m_hotplug_broadcaster;
+};
+
+#endif // PLATFORM_DEVICE_API_LINUX_H
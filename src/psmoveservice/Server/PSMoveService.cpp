@@ -4,6 +4,7 @@
 #include "PSMoveService.h"
 #include "ServerNetworkManager.h"
 #include "ServerRequestHandler.h"
+#include "ServerWakeupSignal.h"
 #include "DeviceManager.h"
 #include "ProtocolVersion.h"
 #include "ServerLog.h"
@@ -32,6 +33,8 @@
 #define DAEMON_LOCK_FILE	"psmoveserviced.lock"
 #endif // defined(BOOST_POSIX_API)
 
+static const int k_wakeup_latency_log_interval_seconds = 60;
+
 //-- definitions -----
 class PSMoveServiceImpl
 {
@@ -67,6 +70,11 @@ public:
                 m_status = context.find<boost::application::status>();
 
 				const TrackerManagerConfig &cfg = DeviceManager::getInstance()->m_tracker_manager->getConfig();
+                ServerWakeupSignal *wakeup_signal = ServerWakeupSignal::get_instance();
+                std::chrono::time_point<std::chrono::high_resolution_clock> last_latency_log_time = 
+                    std::chrono::high_resolution_clock::now();
+
+                wakeup_signal->set_latency_logging_enabled(cfg.log_wakeup_latency);
 
                 while (m_status->state() != boost::application::status::stoped)
                 {
@@ -75,7 +83,28 @@ public:
                         update();
                     }
 
-					std::this_thread::sleep_for(std::chrono::milliseconds(cfg.tracker_sleep_ms));
+                    if (cfg.use_wakeup_signal)
+                    {
+                        // Block until a worker thread or socket signals new work,
+                        // or until a device manager is due to poll or reconnect
+                        const int max_wait_ms = m_device_manager.getMillisecondsUntilNextUpdate(cfg.wakeup_max_wait_ms);
+
+                        wakeup_signal->wait_for_work(max_wait_ms);
+                    }
+                    else
+                    {
+                        // Old fixed sleep, still timed so the latency histograms can be compared
+                        wakeup_signal->sleep_for_work(cfg.tracker_sleep_ms);
+                    }
+
+                    const std::chrono::time_point<std::chrono::high_resolution_clock> now = 
+                        std::chrono::high_resolution_clock::now();
+                    if (cfg.log_wakeup_latency &&
+                        now - last_latency_log_time >= std::chrono::seconds(k_wakeup_latency_log_interval_seconds))
+                    {
+                        wakeup_signal->log_latency_histogram();
+                        last_latency_log_time = now;
+                    }
                 }
             }
             else
@@ -107,6 +136,7 @@ public:
         {
             SERVER_LOG_WARNING("PSMoveService") << "Received stop request. Stopping Service.";
             m_status->state(boost::application::status::stoped);
+            ServerWakeupSignal::get_instance()->notify();
         }
 
         return true;
@@ -154,6 +184,12 @@ private:
 		}
 		#endif // BOOST_INTERPROCESS_SHARED_DIR_PATH
         
+        /** Let the main loop run socket handlers while it waits for work */
+        if (success)
+        {
+            ServerWakeupSignal::get_instance()->set_io_service(&m_io_service);
+        }
+
         /** Start listening for client connections */
         if (success)
         {
@@ -231,6 +267,9 @@ private:
         // Shutdown the usb async request thread
         // Must be after device manager since devices can have an active usb connection
         m_usb_device_manager.shutdown();
+
+        // Every thread that could notify the main loop has stopped
+        ServerWakeupSignal::get_instance()->set_io_service(nullptr);
     }
 
     void handle_termination_signal()
@@ -569,7 +608,7 @@ int PSMoveService::exec(int argc, char *argv[])
 	}
 
     // initialize logging system
-    log_init(this->getProgramSettings()->log_level, "PSMoveService.log");
+    log_init(this->getProgramSettings()->log_level, "PSMoveService.log", true);
 
     // Start the service app
     SERVER_LOG_INFO("main") << "Starting PSMoveService v" << PSM_RELEASE_VERSION_STRING << " (protocol v" << PSM_PROTOCOL_VERSION_STRING << ")";
@@ -629,11 +668,13 @@ int PSMoveService::exec(int argc, char *argv[])
     catch (std::exception &e)
     {
         SERVER_LOG_FATAL("main") << "Failed to start PSMoveService: " <<  e.what();
+        log_dispose();
         return 1;
     }
     catch (...)
     {
         SERVER_LOG_FATAL("main") << "Failed to start PSMoveService: Unknown error.";
+        log_dispose();
         return 1;
     }
 
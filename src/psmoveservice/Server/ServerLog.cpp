@@ -1,25 +1,90 @@
 //-- includes -----
 #include "ServerLog.h"
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <ostream>
+#include <stdint.h>
+#include <thread>
 
-#ifdef _MSC_VER
-#pragma warning (disable: 4996) // 'This function or variable may be unsafe': localtime
-#endif
+//-- constants -----
+static const size_t k_async_log_queue_capacity = 4096; // lines, must be a power of two
+static const int k_async_log_writer_idle_ms = 10;
+
+//-- private definitions -----
+// Queues log lines in a bounded lock-free ring buffer (Dmitry Vyukov's MPMC queue, with a single consumer)
+// and writes them to the log streams from a background thread.
+// Producers never wait on the writer: when the queue is full the line is dropped and counted instead.
+class AsyncLogSink
+{
+public:
+	AsyncLogSink();
+	~AsyncLogSink();
+
+	// Takes the contents of the line if it could be queued
+	void enqueueLine(std::string &line);
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		std::string line;
+	};
+
+	bool tryDequeueLine(std::string &out_line);
+	void writerThreadFunc();
+
+	Slot m_slots[k_async_log_queue_capacity];
+	std::atomic<size_t> m_enqueue_position;
+	size_t m_dequeue_position; // Only touched by the writer thread
+	std::atomic<size_t> m_dropped_line_count;
+	std::atomic<bool> m_exit_signaled;
+	std::mutex m_wakeup_mutex;
+	std::condition_variable m_wakeup_condition;
+	std::thread m_writer_thread;
+};
 
 //-- globals -----
 e_log_severity_level g_min_log_level= _log_severity_level_info;
 std::ostream *g_console_stream= nullptr;
 std::ostream *g_file_stream = nullptr;
 std::mutex *g_logger_mutex = nullptr;
+AsyncLogSink *g_async_log_sink = nullptr;
+
+//-- private methods -----
+static void write_log_line(const std::string &line)
+{
+	if (g_console_stream != nullptr)
+	{
+		*g_console_stream << line << '\n';
+	}
+
+	if (g_file_stream != nullptr)
+	{
+		*g_file_stream << line << '\n';
+	}
+}
+
+static void flush_log_streams()
+{
+	if (g_console_stream != nullptr)
+	{
+		g_console_stream->flush();
+	}
+
+	if (g_file_stream != nullptr)
+	{
+		g_file_stream->flush();
+	}
+}
 
 //-- public implementation -----
-void log_init(const std::string &log_level, const std::string &log_filename)
+void log_init(const std::string &log_level, const std::string &log_filename, const bool bUseAsyncSink)
 {
 	log_dispose();
 
@@ -56,10 +121,22 @@ void log_init(const std::string &log_level, const std::string &log_filename)
 		g_file_stream = new std::ofstream(log_filename, std::ofstream::out);
 	}
 	g_logger_mutex = new std::mutex();
+
+	if (bUseAsyncSink)
+	{
+		g_async_log_sink = new AsyncLogSink();
+	}
 }
 
 void log_dispose()
 {
+	// Writes out any queued lines before the streams go away
+	if (g_async_log_sink != nullptr)
+	{
+		delete g_async_log_sink;
+		g_async_log_sink = nullptr;
+	}
+
 	if (g_console_stream != nullptr)
 	{
 		g_console_stream->flush();
@@ -69,7 +146,7 @@ void log_dispose()
 
 	if (g_file_stream != nullptr)
 	{
-		g_console_stream->flush();
+		g_file_stream->flush();
 		delete g_file_stream;
 		g_file_stream = nullptr;
 	}
@@ -81,11 +158,6 @@ void log_dispose()
 	}
 }
 
-bool log_can_emit_level(e_log_severity_level level)
-{
-    return (level >= g_min_log_level);
-}
-
 std::string log_get_timestamp_prefix()
 {
     auto now = std::chrono::system_clock::now();
@@ -93,49 +165,176 @@ std::string log_get_timestamp_prefix()
     auto milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(now - seconds);
     time_t in_time_t = std::chrono::system_clock::to_time_t(now);
 
+    // std::localtime() shares its result between threads
+    struct tm local_time;
+#ifdef _MSC_VER
+    localtime_s(&local_time, &in_time_t);
+#else
+    localtime_r(&in_time_t, &local_time);
+#endif
+
     std::stringstream ss;
-    ss << "[" << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %H:%M:%S") << "." << milliseconds.count() << "]: ";
+    ss << "[" << std::put_time(&local_time, "%Y-%m-%d %H:%M:%S") << "." << milliseconds.count() << "]: ";
 
     return ss.str();
 }
 
 //-- member functions -----
-LoggerStream::LoggerStream(bool bEmit) :
-	m_bEmitLine(bEmit)
+LoggerStream::LoggerStream(bool bThreadSafe) :
+	m_bThreadSafe(bThreadSafe)
 {
 }
 
 LoggerStream::~LoggerStream()
 {
-	write_line();
+	std::string line = m_lineBuffer.str();
+
+	if (g_async_log_sink != nullptr)
+	{
+		g_async_log_sink->enqueueLine(line);
+	}
+	else if (m_bThreadSafe && g_logger_mutex != nullptr)
+	{
+		std::lock_guard<std::mutex> lock(*g_logger_mutex);
+
+		write_log_line(line);
+		flush_log_streams();
+	}
+	else
+	{
+		write_log_line(line);
+		flush_log_streams();
+	}
+}
+
+AsyncLogSink::AsyncLogSink()
+	: m_enqueue_position(0)
+	, m_dequeue_position(0)
+	, m_dropped_line_count(0)
+	, m_exit_signaled(false)
+{
+	for (size_t slot_index = 0; slot_index < k_async_log_queue_capacity; ++slot_index)
+	{
+		m_slots[slot_index].sequence.store(slot_index, std::memory_order_relaxed);
+	}
+
+	m_writer_thread = std::thread(&AsyncLogSink::writerThreadFunc, this);
+}
+
+AsyncLogSink::~AsyncLogSink()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+		m_exit_signaled.store(true, std::memory_order_release);
+	}
+	m_wakeup_condition.notify_one();
+
+	m_writer_thread.join();
 }
 
-void LoggerStream::write_line()
+void AsyncLogSink::enqueueLine(std::string &line)
 {
-	if (m_bEmitLine)
+	size_t position = m_enqueue_position.load(std::memory_order_relaxed);
+	Slot *slot = nullptr;
+
+	// Claim the next free slot
+	for (;;)
 	{
-		const std::string line = m_lineBuffer.str();
+		slot = &m_slots[position & (k_async_log_queue_capacity - 1)];
+
+		const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		const intptr_t sequence_delta = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
 
-		if (g_console_stream != nullptr)
+		if (sequence_delta == 0)
 		{
-			*g_console_stream << line << std::endl;
+			if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
 		}
-
-		if (g_file_stream != nullptr)
+		else if (sequence_delta < 0)
 		{
-			*g_file_stream << line << std::endl;
+			// The writer hasn't caught up with this slot yet
+			m_dropped_line_count.fetch_add(1, std::memory_order_relaxed);
+			return;
 		}
+		else
+		{
+			position = m_enqueue_position.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->line.swap(line);
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	// Don't let a burst of lines fill the queue while the writer naps
+	if ((position & (k_async_log_queue_capacity / 4 - 1)) == 0)
+	{
+		m_wakeup_condition.notify_one();
 	}
 }
 
-ThreadSafeLoggerStream::ThreadSafeLoggerStream(bool bEmit) :
-	LoggerStream(bEmit)
+bool AsyncLogSink::tryDequeueLine(std::string &out_line)
 {
+	Slot &slot = m_slots[m_dequeue_position & (k_async_log_queue_capacity - 1)];
+	const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+	if (sequence != m_dequeue_position + 1)
+	{
+		return false;
+	}
+
+	out_line.swap(slot.line);
+	slot.line.clear();
+	slot.sequence.store(m_dequeue_position + k_async_log_queue_capacity, std::memory_order_release);
+	++m_dequeue_position;
+
+	return true;
 }
 
-void ThreadSafeLoggerStream::write_line()
+void AsyncLogSink::writerThreadFunc()
 {
-	std::lock_guard<std::mutex> lock(*g_logger_mutex);
+	std::string line;
+
+	for (;;)
+	{
+		// Check before draining so every line queued before the exit signal gets written
+		const bool bExitSignaled = m_exit_signaled.load(std::memory_order_acquire);
+		bool bWroteLines = false;
+
+		while (tryDequeueLine(line))
+		{
+			write_log_line(line);
+			bWroteLines = true;
+		}
+
+		const size_t dropped_line_count = m_dropped_line_count.exchange(0, std::memory_order_relaxed);
+		if (dropped_line_count > 0)
+		{
+			write_log_line(log_get_timestamp_prefix() + "AsyncLogSink - Dropped " + std::to_string(dropped_line_count) + " log lines");
+			bWroteLines = true;
+		}
+
+		if (bWroteLines)
+		{
+			flush_log_streams();
+		}
+
+		if (bExitSignaled)
+		{
+			break;
+		}
+
+		// Producers only signal every quarter of the queue so they never have to touch the mutex;
+		// otherwise just poll the queue again after a short nap.
+		if (!bWroteLines)
+		{
+			std::unique_lock<std::mutex> lock(m_wakeup_mutex);
 
-	LoggerStream::write_line();
-}
\ No newline at end of file
+			if (!m_exit_signaled.load(std::memory_order_acquire))
+			{
+				m_wakeup_condition.wait_for(lock, std::chrono::milliseconds(k_async_log_writer_idle_ms));
+			}
+		}
+	}
+}
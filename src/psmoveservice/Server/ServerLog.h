@@ -21,46 +21,53 @@ class LoggerStream
 {
 protected:
 	std::ostringstream m_lineBuffer;
-	bool m_bEmitLine;
+	bool m_bThreadSafe;
 
 public:
-	LoggerStream(bool bEmit);
-	virtual ~LoggerStream();
+	LoggerStream(bool bThreadSafe= false);
+	~LoggerStream();
 
 	// accepts just about anything
 	template<class T>
 	LoggerStream &operator<<(const T &x)
 	{
-		if (m_bEmitLine)
-		{
-			m_lineBuffer << x;
-		}
+		m_lineBuffer << x;
 
 		return *this;
 	}
-
-protected:
-	virtual void write_line();
 };
 
 class ThreadSafeLoggerStream : public LoggerStream
 {
 public:
-	ThreadSafeLoggerStream(bool bEmit);
+	ThreadSafeLoggerStream() : LoggerStream(true) {}
+};
 
-protected:
-	void write_line() override;
+// Turns a whole logging statement into a void expression so it can sit in the ?: of the log macros
+struct LoggerStreamVoidify
+{
+	void operator&(const LoggerStream &) {}
 };
 
+//-- globals -----
+extern e_log_severity_level g_min_log_level;
+
 //-- interface -----
-void log_init(const std::string &log_level, const std::string &log_filename="");
+// When bUseAsyncSink is set, log lines are queued and written to the console and log file
+// by a background thread, so logging never blocks on I/O.
+void log_init(const std::string &log_level, const std::string &log_filename="", const bool bUseAsyncSink=false);
 void log_dispose();
-bool log_can_emit_level(e_log_severity_level level);
 std::string log_get_timestamp_prefix();
 
+inline bool log_can_emit_level(e_log_severity_level level)
+{
+    return (level >= g_min_log_level);
+}
+
 //-- macros -----
-#define SELECT_LOG_STREAM(level) LoggerStream(log_can_emit_level(level))
-#define SELECT_MT_LOG_STREAM(level) ThreadSafeLoggerStream(log_can_emit_level(level))
+// The stream (and every << operand after it) is only evaluated if the level is enabled
+#define SELECT_LOG_STREAM(level) !log_can_emit_level(level) ? (void)0 : LoggerStreamVoidify() & LoggerStream()
+#define SELECT_MT_LOG_STREAM(level) !log_can_emit_level(level) ? (void)0 : LoggerStreamVoidify() & ThreadSafeLoggerStream()
 
 // Non Thread Safe Logger Macros
 // Almost everything is on the main thread, so you almost always want to use these
@@ -73,6 +80,7 @@ std::string log_get_timestamp_prefix();
 
 // Thread Safe Logger Macros
 // Uses thread safe locking before appending data to the logging stream
+// (the async sink queue is already safe to use from any thread)
 // Only use this when logging from other threads
 #define SERVER_MT_LOG_TRACE(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_trace) << log_get_timestamp_prefix() << function_name << " - "
 #define SERVER_MT_LOG_DEBUG(function_name) SELECT_MT_LOG_STREAM(_log_severity_level_debug) << log_get_timestamp_prefix() << function_name << " - "
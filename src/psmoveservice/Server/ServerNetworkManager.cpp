@@ -2,6 +2,8 @@
 #include "ServerNetworkManager.h"
 #include "ServerRequestHandler.h"
 #include "ServerLog.h"
+#include "ServerWakeupSignal.h"
+#include "CompactDataFrame.h"
 #include "PackedMessage.h"
 #include "PSMoveProtocolInterface.h"
 #include "PSMoveProtocol.pb.h"
@@ -41,6 +43,15 @@ public:
 	virtual void handle_client_connection_stopped(int connection_id) = 0;
 };
 
+// A data frame waiting to go out in the next datagram.
+// Compact controller frames are queued as raw bytes rather than as a DeviceOutputDataFrame.
+struct PendingDataFrame
+{
+    DeviceOutputDataFramePtr data_frame;
+    int compact_frame_size;
+    uint8_t compact_frame[MAX_COMPACT_CONTROLLER_FRAME_SIZE];
+};
+
 //-- Network Manager Config -----
 const int NetworkManagerConfig::CONFIG_VERSION = 1;
 
@@ -48,6 +59,7 @@ NetworkManagerConfig::NetworkManagerConfig(const std::string &fnamebase)
     : PSMoveConfig(fnamebase)
 {
 	server_port= PSMOVE_SERVER_PORT;
+    batch_device_data_frames= true;
 };
 
 const boost::property_tree::ptree
@@ -57,6 +69,7 @@ NetworkManagerConfig::config2ptree()
 
     pt.put("version", NetworkManagerConfig::CONFIG_VERSION);
 	pt.put("server_port", server_port);
+    pt.put("batch_device_data_frames", batch_device_data_frames);
 
     return pt;
 }
@@ -69,6 +82,7 @@ NetworkManagerConfig::ptree2config(const boost::property_tree::ptree &pt)
     if (version == NetworkManagerConfig::CONFIG_VERSION)
     {
 		server_port = pt.get<int>("server_port", server_port);
+        batch_device_data_frames = pt.get<bool>("batch_device_data_frames", batch_device_data_frames);
     }
     else
     {
@@ -171,15 +185,17 @@ public:
         }
     }
 
-    void bind_udp_remote_endpoint(const udp::endpoint &connecting_remote_endpoint)
+    void bind_udp_remote_endpoint(const udp::endpoint &connecting_remote_endpoint, bool bBatchDataFrames)
     {
         SERVER_LOG_DEBUG("ClientConnection::bind_udp_remote_endpoint") << "Binding connection_id " 
             << m_connection_id << " to UDP remote endpoint " 
             << connecting_remote_endpoint.address().to_string() << ":"
-            << connecting_remote_endpoint.port();
+            << connecting_remote_endpoint.port()
+            << (bBatchDataFrames ? " (batched data frames)" : "");
 
         m_udp_remote_endpoint= connecting_remote_endpoint;
         m_is_udp_remote_endpoint_bound = true;
+        m_batch_device_data_frames = bBatchDataFrames;
     }
 
     bool is_udp_remote_endpoint_bound() const
@@ -187,6 +203,11 @@ public:
         return m_is_udp_remote_endpoint_bound;
     }
 
+    bool get_batch_device_data_frames() const
+    {
+        return m_batch_device_data_frames;
+    }
+
     bool can_send_data_to_client() const
     {
         return m_connection_started && !m_connection_stopped;
@@ -250,7 +271,17 @@ public:
     
     void add_device_data_frame_to_write_queue(DeviceOutputDataFramePtr data_frame)
     {
-        m_pending_dataframes.push_back(data_frame);
+        m_pending_dataframes.push_back(PendingDataFrame());
+        m_pending_dataframes.back().data_frame= data_frame;
+        m_pending_dataframes.back().compact_frame_size= 0;
+    }
+
+    void add_compact_controller_data_frame_to_write_queue(const uint8_t *compact_frame, int compact_frame_size)
+    {
+        assert(compact_frame_size > 0 && compact_frame_size <= MAX_COMPACT_CONTROLLER_FRAME_SIZE);
+        m_pending_dataframes.push_back(PendingDataFrame());
+        m_pending_dataframes.back().compact_frame_size= compact_frame_size;
+        memcpy(m_pending_dataframes.back().compact_frame, compact_frame, compact_frame_size);
     }
 
     bool start_udp_write_queued_device_data_frame()
@@ -261,37 +292,79 @@ public:
         {
             if (!m_has_pending_udp_write)
             {
-                if (m_pending_dataframes.size() > 0)
+                // A datagram is a run of length prefixed data frames and is only as long as the frames in it.
+                // Unbatched data frames keep the old per frame size limit.
+                const int packet_size=
+                    m_batch_device_data_frames
+                    ? sizeof(m_output_dataframe_buffer)
+                    : HEADER_SIZE+MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE;
+                int packed_size= 0;
+                int packed_frame_count= 0;
+
+                // Data frames are dequeued as soon as they are packed since the buffer holds a copy
+                while (m_pending_dataframes.size() > 0 && (m_batch_device_data_frames || packed_frame_count == 0))
                 {
-                    DeviceOutputDataFramePtr dataframe= m_pending_dataframes.front();
+                    const PendingDataFrame &pending_frame= m_pending_dataframes.front();
+                    uint8_t *packed_frame= &m_output_dataframe_buffer[packed_size];
+                    int packed_frame_size= 0;
 
-                    m_packed_output_dataframe.set_msg(dataframe);
-                    if (m_packed_output_dataframe.pack(m_output_dataframe_buffer, sizeof(m_output_dataframe_buffer)))
+                    if (pending_frame.compact_frame_size > 0)
                     {
-                        int msg_size= m_packed_output_dataframe.get_msg()->ByteSize();
-
-                        SERVER_LOG_DEBUG("ClientConnection::start_udp_write_queued_device_data_frame") << "Sending UDP DataFrame";
-                        SERVER_LOG_DEBUG("   ") << show_hex(m_output_dataframe_buffer, HEADER_SIZE+msg_size);
-                        SERVER_LOG_DEBUG("   ") << msg_size << " bytes";
-
-                        // The queue should prevent us from writing more than one data frame at once
-                        assert(!m_has_pending_udp_write);
-                        m_has_pending_udp_write= true;
-                        write_in_progress= true;
-
-                        // Start an asynchronous operation to send the data frame
-                        // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
-                        m_udp_socket_ref.async_send_to(
-                            boost::asio::buffer(m_output_dataframe_buffer, sizeof(m_output_dataframe_buffer)),
-                            m_udp_remote_endpoint,
-                            boost::bind(&ClientConnection::handle_udp_write_device_data_frame_complete, this, _1));
+                        if (pack_compact_controller_data_frame(pending_frame, packed_frame, packet_size-packed_size))
+                        {
+                            packed_frame_size= HEADER_SIZE + pending_frame.compact_frame_size;
+                        }
                     }
                     else
                     {
-                        SERVER_LOG_ERROR("ClientConnection::start_udp_write_queued_device_data_frame") 
+                        m_packed_output_dataframe.set_msg(pending_frame.data_frame);
+
+                        if (m_packed_output_dataframe.pack(packed_frame, packet_size-packed_size))
+                        {
+                            packed_frame_size= HEADER_SIZE + m_packed_output_dataframe.get_msg()->GetCachedSize();
+                        }
+                    }
+
+                    if (packed_frame_size > 0)
+                    {
+                        packed_size+= packed_frame_size;
+                        ++packed_frame_count;
+                        m_pending_dataframes.pop_front();
+                    }
+                    else if (packed_frame_count == 0)
+                    {
+                        SERVER_LOG_ERROR("ClientConnection::start_udp_write_queued_device_data_frame")
                             << "DataFrame too big to fit in packet!";
+
+                        // Drop it rather than let it block the rest of the queue
+                        m_pending_dataframes.pop_front();
+                    }
+                    else
+                    {
+                        // The rest go out in the next datagram
+                        break;
                     }
                 }
+
+                if (packed_frame_count > 0)
+                {
+                    SERVER_LOG_DEBUG("ClientConnection::start_udp_write_queued_device_data_frame")
+                        << "Sending UDP DataFrame batch of " << packed_frame_count;
+                    SERVER_LOG_DEBUG("   ") << show_hex(m_output_dataframe_buffer, packed_size);
+                    SERVER_LOG_DEBUG("   ") << packed_size << " bytes";
+
+                    // The queue should prevent us from writing more than one datagram at once
+                    assert(!m_has_pending_udp_write);
+                    m_has_pending_udp_write= true;
+                    write_in_progress= true;
+
+                    // Start an asynchronous operation to send the data frames
+                    // NOTE: Even if the write completes immediate, the callback will only be called from io_service::poll()
+                    m_udp_socket_ref.async_send_to(
+                        boost::asio::buffer(m_output_dataframe_buffer, packed_size),
+                        m_udp_remote_endpoint,
+                        boost::bind(&ClientConnection::handle_udp_write_device_data_frame_complete, this, _1));
+                }
             }
             else
             {
@@ -305,6 +378,25 @@ public:
 private:
     static int next_connection_id;
 
+    // Compact frames are written raw behind the usual length header, with COMPACT_CONTROLLER_RECORD_FLAG set in it
+    static bool pack_compact_controller_data_frame(const PendingDataFrame &pending_frame, uint8_t *buf, int buf_size)
+    {
+        if ((int)HEADER_SIZE + pending_frame.compact_frame_size <= buf_size)
+        {
+            const unsigned header= COMPACT_CONTROLLER_RECORD_FLAG | static_cast<unsigned>(pending_frame.compact_frame_size);
+
+            buf[0] = static_cast<uint8_t>((header >> 24) & 0xFF);
+            buf[1] = static_cast<uint8_t>((header >> 16) & 0xFF);
+            buf[2] = static_cast<uint8_t>((header >> 8) & 0xFF);
+            buf[3] = static_cast<uint8_t>(header & 0xFF);
+            memcpy(&buf[HEADER_SIZE], pending_frame.compact_frame, pending_frame.compact_frame_size);
+
+            return true;
+        }
+
+        return false;
+    }
+
     IServerNetworkEventListener* m_network_event_listener;
 
     int m_connection_id;
@@ -315,17 +407,20 @@ private:
     udp::endpoint m_udp_remote_endpoint;
     bool m_is_udp_remote_endpoint_bound;
 
+    // Only clients that opted in when binding their UDP endpoint get several data frames per datagram
+    bool m_batch_device_data_frames;
+
     vector<uint8_t> m_request_read_buffer;
     PackedMessage<PSMoveProtocol::Request> m_packed_request;
 
     vector<uint8_t> m_response_write_buffer;
     PackedMessage<PSMoveProtocol::Response> m_packed_response;
 
-    uint8_t m_output_dataframe_buffer[HEADER_SIZE+MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE];
+    uint8_t m_output_dataframe_buffer[MAX_OUTPUT_DATA_FRAME_BATCH_SIZE];
     PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> m_packed_output_dataframe;
 
     deque<ResponsePtr> m_pending_responses;
-    deque<DeviceOutputDataFramePtr> m_pending_dataframes;
+    deque<PendingDataFrame> m_pending_dataframes;
     
     bool m_connection_started;
     bool m_connection_stopped;
@@ -344,6 +439,7 @@ private:
         , m_udp_socket_ref(udp_socket_ref)
         , m_udp_remote_endpoint()
         , m_is_udp_remote_endpoint_bound(false)
+        , m_batch_device_data_frames(false)
         , m_request_read_buffer()
         , m_packed_request(std::shared_ptr<PSMoveProtocol::Request>(new PSMoveProtocol::Request()))
         , m_response_write_buffer()
@@ -465,6 +561,9 @@ private:
     //
     void handle_tcp_request()
     {
+        // The response and any device state the request changed go out on the next update
+        ServerWakeupSignal::get_instance()->notify();
+
         if (m_packed_request.unpack(m_request_read_buffer))
         {
             RequestPtr request = m_packed_request.get_msg();
@@ -528,9 +627,6 @@ private:
 
             // no longer is there a pending write
             m_has_pending_udp_write= false;
-
-            // Remove the dataframe from the pending send queue now that it's sent
-            m_pending_dataframes.pop_front();
         }
         else
         {
@@ -557,6 +653,7 @@ public:
         , m_packed_input_dataframe(std::shared_ptr<PSMoveProtocol::DeviceInputDataFrame>(new PSMoveProtocol::DeviceInputDataFrame()))
         , m_udp_connection_result_write_buffer(false)
         , m_has_pending_udp_read(false)
+        , m_batch_device_data_frames(cfg.batch_device_data_frames)
         , m_connections()
     {
         memset(m_input_dataframe_buffer, 0, sizeof(m_input_dataframe_buffer));
@@ -723,7 +820,12 @@ public:
 
             connection->add_device_data_frame_to_write_queue(data_frame);
 
-            start_udp_queued_data_frame_write();
+            // Batched data frames wait for poll() at the end of the update
+            // so that every device published this update shares the datagram
+            if (!connection->get_batch_device_data_frames())
+            {
+                start_udp_queued_data_frame_write();
+            }
         }
         else
         {
@@ -732,6 +834,31 @@ public:
         }
     }
 
+    void send_compact_controller_data_frame(int connection_id, const uint8_t *compact_frame, int compact_frame_size)
+    {
+        t_client_connection_map_iter entry = m_connections.find(connection_id);
+
+        if (entry != m_connections.end())
+        {
+            ClientConnectionPtr connection= entry->second;
+
+            SERVER_LOG_TRACE("ServerNetworkManager::send_compact_controller_data_frame") 
+                << "Sending compact data_frame to connection " << connection_id;
+
+            connection->add_compact_controller_data_frame_to_write_queue(compact_frame, compact_frame_size);
+
+            if (!connection->get_batch_device_data_frames())
+            {
+                start_udp_queued_data_frame_write();
+            }
+        }
+        else
+        {
+            SERVER_LOG_ERROR("ServerNetworkManager::send_compact_controller_data_frame") 
+                << "Can't send compact data_frame to unknown connection " << connection_id;
+        }
+    }
+
     // -- IServerNetworkEventListener ----
 	virtual void handle_client_connection_stopped(int connection_id) override
     {
@@ -772,12 +899,17 @@ private:
     // If true, we are already waiting for a client to send the connection id
     bool m_has_pending_udp_read;
 
+    // If true, connections whose client accepts it pack their queued data frames into shared datagrams
+    bool m_batch_device_data_frames;
+
     // A mapping from connection_id -> ClientConnectionPtr
     t_client_connection_map m_connections;
 
 protected:
     void handle_tcp_accept(ClientConnectionPtr connection, const boost::system::error_code& error)
     {        
+        ServerWakeupSignal::get_instance()->notify();
+
         // A new client has connected
         //
         if (!error)
@@ -813,18 +945,21 @@ protected:
                 boost::bind(
                     &ServerNetworkManagerImpl::handle_udp_read_data_frame,
                     this,
-                    asio::placeholders::error));
+                    asio::placeholders::error,
+                    asio::placeholders::bytes_transferred));
         }
     }
 
-    void handle_udp_read_data_frame(const boost::system::error_code& error)
+    void handle_udp_read_data_frame(const boost::system::error_code& error, std::size_t bytes_transferred)
     {
         m_has_pending_udp_read= false;
 
+        ServerWakeupSignal::get_instance()->notify();
+
         if (!error) 
         {
             // Parse the incoming data frame
-            handle_udp_data_frame_received();
+            handle_udp_data_frame_received(static_cast<unsigned>(bytes_transferred));
         }
         else
         {
@@ -836,9 +971,10 @@ protected:
         start_udp_read_input_data_frame();
     }
 
-    // Called when enough data was read into m_data_frame_read_buffer for a complete data frame message. 
+    // Called when a datagram was read into m_input_dataframe_buffer.
+    // Clients only send the packed size of the data frame, older clients the whole zero padded buffer.
     // Parse the data_frame and forward it on to the response handler.
-    void handle_udp_data_frame_received()
+    void handle_udp_data_frame_received(unsigned datagram_size)
     {
         // No longer is there a pending read
         m_has_pending_udp_read = false;
@@ -846,8 +982,17 @@ protected:
         SERVER_LOG_DEBUG("ClientNetworkManager::handle_udp_data_frame_received") << "Parsing DataFrame";
 
         // TODO: Switch on data frame type to choose which m_packed_data_frame_X to use.
-        unsigned msg_len = m_packed_input_dataframe.decode_header(m_input_dataframe_buffer, sizeof(m_input_dataframe_buffer));
+        unsigned msg_len = m_packed_input_dataframe.decode_header(m_input_dataframe_buffer, datagram_size);
         unsigned total_len = HEADER_SIZE + msg_len;
+
+        // Anything past the end of the datagram is left over from an earlier read
+        if (datagram_size < HEADER_SIZE || total_len > datagram_size)
+        {
+            SERVER_LOG_ERROR("ServerNetworkManager::handle_udp_data_frame_received")
+                << "Truncated UDP data frame: " << datagram_size << " bytes";
+            return;
+        }
+
         SERVER_LOG_DEBUG("    ") << show_hex(m_input_dataframe_buffer, total_len);
         SERVER_LOG_DEBUG("    ") << msg_len << " bytes";
 
@@ -869,8 +1014,11 @@ protected:
                 // Bind the udp endpoint if this is the first UDP packet received from the client
                 if (!connection->is_udp_remote_endpoint_bound())
                 {
-                    // Associate this udp remote endpoint with the given connection id
-                    connection->bind_udp_remote_endpoint(m_udp_connecting_remote_endpoint);
+                    // Associate this udp remote endpoint with the given connection id.
+                    // Older clients size their receive buffer for a single data frame, so only batch if asked to.
+                    connection->bind_udp_remote_endpoint(
+                        m_udp_connecting_remote_endpoint,
+                        m_batch_device_data_frames && data_frame->accepts_batched_output_data_frames());
 
                     // Tell the client that this was a valid connection id
                     start_udp_send_connection_result(true);
@@ -929,8 +1077,12 @@ protected:
                 SERVER_LOG_TRACE("ServerNetworkManager::start_udp_queued_data_frame_write") 
                     << "Send queued UDP data on connection id: " << iter->first;
 
-                // Don't start a write on any other connection until this one is finished 
-                break;
+                // A batch is a single datagram per connection, so every connection can have one in flight.
+                // Otherwise don't start a write on any other connection until this one is finished 
+                if (!connection->get_batch_device_data_frames())
+                {
+                    break;
+                }
             }
         }        
     }
@@ -946,6 +1098,12 @@ protected:
 
             if (connection->has_pending_udp_write())
             {
+                if (connection->get_batch_device_data_frames())
+                {
+                    // Only blocks this connection's next batch
+                    continue;
+                }
+
                 // Can't start any new udp write until any current udp write is done
                 udp_socket_available= false;
                 break;
@@ -1028,3 +1186,8 @@ void ServerNetworkManager::send_device_data_frame(int connection_id, DeviceOutpu
 {
     implementation_ptr->send_device_data_frame(connection_id, data_frame);
 }
+
+void ServerNetworkManager::send_compact_controller_data_frame(int connection_id, const unsigned char *compact_frame, int compact_frame_size)
+{
+    implementation_ptr->send_compact_controller_data_frame(connection_id, compact_frame, compact_frame_size);
+}
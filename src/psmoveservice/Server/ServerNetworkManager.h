@@ -27,6 +27,10 @@ public:
 
     long version;
 	int server_port;
+
+    // Pack all of a client's device data frames from one update into as few UDP datagrams as possible.
+    // Only applies to clients that ask for it when binding their UDP endpoint.
+    bool batch_device_data_frames;
 };
 
 // -Server Network Manager-
@@ -69,6 +73,9 @@ public:
     
     void send_device_data_frame(int connection_id, DeviceOutputDataFramePtr data_frame);
 
+    /// Queues a raw compact controller frame (see CompactDataFrame.h) for the connection
+    void send_compact_controller_data_frame(int connection_id, const unsigned char *compact_frame, int compact_frame_size);
+
 private:
     /// Must use the overloaded constructor
     ServerNetworkManager();
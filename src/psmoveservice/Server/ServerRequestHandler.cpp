@@ -29,10 +29,16 @@
 #include "VirtualController.h"
 
 #include <cassert>
+#include <cstring>
 #include <bitset>
 #include <map>
 #include <boost/shared_ptr.hpp>
 
+//-- constants -----
+// Compact controller frames are deltas against the last keyframe rather than the last frame,
+// so a dropped datagram only costs the frames until the next keyframe
+static const int k_compact_controller_keyframe_interval = 60;
+
 //-- pre-declarations -----
 class ServerRequestHandlerImpl;
 typedef boost::shared_ptr<ServerRequestHandlerImpl> ServerRequestHandlerImplPtr;
@@ -84,6 +90,122 @@ struct RequestContext
     RequestPtr request;
 };
 
+//-- private methods -----
+static void copy_float_vector(const PSMoveProtocol::FloatVector &vector, float *out_xyz)
+{
+    out_xyz[0] = vector.i();
+    out_xyz[1] = vector.j();
+    out_xyz[2] = vector.k();
+}
+
+static void copy_int_vector(const PSMoveProtocol::IntVector &vector, int *out_xyz)
+{
+    out_xyz[0] = vector.i();
+    out_xyz[1] = vector.j();
+    out_xyz[2] = vector.k();
+}
+
+static unsigned int get_compact_controller_section_mask(const ControllerStreamInfo &stream_info)
+{
+    unsigned int section_mask =
+        COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Status) |
+        COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Orientation);
+
+    if (stream_info.include_position_data)
+        section_mask |= COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Position);
+    if (stream_info.include_raw_sensor_data)
+        section_mask |= COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_RawSensor);
+    if (stream_info.include_calibrated_sensor_data)
+        section_mask |= COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_CalibratedSensor);
+    if (stream_info.include_physics_data)
+        section_mask |= COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Physics);
+
+    return section_mask;
+}
+
+static void psmove_data_packet_to_compact_state(
+    const PSMoveProtocol::DeviceOutputDataFrame_ControllerDataPacket &controller_packet,
+    CompactControllerState *out_state)
+{
+    const auto &psmove_state = controller_packet.psmove_state();
+
+    memset(out_state, 0, sizeof(CompactControllerState));
+    out_state->controller_id = controller_packet.controller_id();
+    out_state->sequence_num = controller_packet.sequence_num();
+    out_state->bIsConnected = controller_packet.isconnected();
+    out_state->button_bitmask = controller_packet.button_down_bitmask();
+
+    out_state->bHasValidHardwareCalibration = psmove_state.validhardwarecalibration();
+    out_state->bIsTrackingEnabled = psmove_state.istrackingenabled();
+    out_state->bIsCurrentlyTracking = psmove_state.iscurrentlytracking();
+    out_state->bIsOrientationValid = psmove_state.isorientationvalid();
+    out_state->bIsPositionValid = psmove_state.ispositionvalid();
+    out_state->trigger_value = psmove_state.trigger_value();
+    out_state->battery_value = psmove_state.battery_value();
+
+    out_state->orientation_wxyz[0] = psmove_state.orientation().w();
+    out_state->orientation_wxyz[1] = psmove_state.orientation().x();
+    out_state->orientation_wxyz[2] = psmove_state.orientation().y();
+    out_state->orientation_wxyz[3] = psmove_state.orientation().z();
+    out_state->position_cm[0] = psmove_state.position_cm().x();
+    out_state->position_cm[1] = psmove_state.position_cm().y();
+    out_state->position_cm[2] = psmove_state.position_cm().z();
+
+    copy_int_vector(psmove_state.raw_sensor_data().magnetometer(), out_state->raw_magnetometer);
+    copy_int_vector(psmove_state.raw_sensor_data().accelerometer(), out_state->raw_accelerometer);
+    copy_int_vector(psmove_state.raw_sensor_data().gyroscope(), out_state->raw_gyroscope);
+
+    copy_float_vector(psmove_state.calibrated_sensor_data().magnetometer(), out_state->calibrated_magnetometer);
+    copy_float_vector(psmove_state.calibrated_sensor_data().accelerometer(), out_state->calibrated_accelerometer_g);
+    copy_float_vector(psmove_state.calibrated_sensor_data().gyroscope(), out_state->calibrated_gyroscope_rad_per_sec);
+
+    copy_float_vector(psmove_state.physics_data().velocity_cm_per_sec(), out_state->velocity_cm_per_sec);
+    copy_float_vector(psmove_state.physics_data().acceleration_cm_per_sec_sqr(), out_state->acceleration_cm_per_sec_sqr);
+    copy_float_vector(psmove_state.physics_data().angular_velocity_rad_per_sec(), out_state->angular_velocity_rad_per_sec);
+    copy_float_vector(psmove_state.physics_data().angular_acceleration_rad_per_sec_sqr(), out_state->angular_acceleration_rad_per_sec_sqr);
+}
+
+// Writes the controller packet of a PSMove data frame as a compact frame.
+// Returns the number of bytes written, or 0 if the frame didn't fit.
+static int write_compact_psmove_data_frame(
+    ControllerStreamInfo &stream_info,
+    const PSMoveProtocol::DeviceOutputDataFrame *data_frame,
+    unsigned char *buffer,
+    const int buffer_size)
+{
+    CompactControllerState compact_state;
+    CompactControllerFrame compact_frame;
+    bool bWroteKeyframe = false;
+
+    psmove_data_packet_to_compact_state(data_frame->controller_data_packet(), &compact_state);
+    compact_controller_frame_quantize(&compact_state, get_compact_controller_section_mask(stream_info), &compact_frame);
+
+    const bool bCanWriteDelta =
+        stream_info.compact_frames_since_keyframe >= 0 &&
+        stream_info.compact_frames_since_keyframe < k_compact_controller_keyframe_interval;
+    const int write_size =
+        compact_controller_frame_write(
+            &compact_frame,
+            bCanWriteDelta ? &stream_info.compact_keyframe : nullptr,
+            buffer, buffer_size,
+            &bWroteKeyframe);
+
+    if (write_size > 0)
+    {
+        if (bWroteKeyframe)
+        {
+            stream_info.compact_keyframe = compact_frame;
+            stream_info.compact_frames_since_keyframe = 0;
+        }
+        else
+        {
+            ++stream_info.compact_frames_since_keyframe;
+        }
+    }
+
+    return write_size;
+}
+
 //-- private implementation -----
 class ServerRequestHandlerImpl
 {
@@ -508,15 +630,33 @@ public:
 
             if (connection_state->active_controller_streams.test(controller_id))
             {
-                const ControllerStreamInfo &streamInfo=
+                ControllerStreamInfo &streamInfo=
                     connection_state->active_controller_stream_info[controller_id];
 
                 // Fill out a data frame specific to this stream using the given callback
                 DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
                 callback(controller_view, &streamInfo, data_frame.get());
 
+                // Raw tracker data has no compact form, so those streams stay on the full data frame
+                unsigned char compact_frame[MAX_COMPACT_CONTROLLER_FRAME_SIZE];
+                int compact_frame_size = 0;
+                if (streamInfo.use_compact_data_frames && 
+                    !streamInfo.include_raw_tracker_data &&
+                    data_frame->controller_data_packet().controller_type() == PSMoveProtocol::PSMOVE)
+                {
+                    compact_frame_size = 
+                        write_compact_psmove_data_frame(streamInfo, data_frame.get(), compact_frame, sizeof(compact_frame));
+                }
+
                 // Send the controller data frame over the network
-                ServerNetworkManager::get_instance()->send_device_data_frame(connection_id, data_frame);
+                if (compact_frame_size > 0)
+                {
+                    ServerNetworkManager::get_instance()->send_compact_controller_data_frame(connection_id, compact_frame, compact_frame_size);
+                }
+                else
+                {
+                    ServerNetworkManager::get_instance()->send_device_data_frame(connection_id, data_frame);
+                }
             }
         }
     }
@@ -794,6 +934,18 @@ protected:
                 streamInfo.include_calibrated_sensor_data = request.include_calibrated_sensor_data();
                 streamInfo.include_raw_tracker_data = request.include_raw_tracker_data();
                 streamInfo.disable_roi = request.disable_roi();
+                streamInfo.use_compact_data_frames = request.use_compact_data_frames();
+
+                // Only PSMove state has a compact form, and raw tracker data has none at all.
+                // Tell the client rather than silently falling back to full data frames.
+                if (streamInfo.use_compact_data_frames &&
+                    (controller_view->getControllerDeviceType() != CommonDeviceState::PSMove ||
+                     streamInfo.include_raw_tracker_data))
+                {
+                    SERVER_LOG_WARNING("ServerRequestHandler") << "Controller(" << controller_id
+                        << ") stream can't use compact data frames. Sending full data frames instead.";
+                    streamInfo.use_compact_data_frames = false;
+                }
 
                 SERVER_LOG_INFO("ServerRequestHandler") << "Start controller(" << controller_id << ") stream ("
                     << "pos=" << streamInfo.include_position_data
@@ -802,6 +954,7 @@ protected:
                     << ",cal_sens=" << streamInfo.include_calibrated_sensor_data
                     << ",trkr=" << streamInfo.include_raw_tracker_data
                     << ",roi=" << streamInfo.disable_roi
+                    << ",compact=" << streamInfo.use_compact_data_frames
                     << ")";
 
                 if (streamInfo.include_position_data)
@@ -812,6 +965,7 @@ protected:
                 // Attach the initial state of the controller
                 {
                     auto *stream_started_response= response->mutable_result_controller_stream_started();
+                    stream_started_response->set_using_compact_data_frames(streamInfo.use_compact_data_frames);
                     PSMoveProtocol::DeviceOutputDataFrame* data_frame= stream_started_response->mutable_initial_data_frame();
                     
                     ServerControllerView::generate_controller_data_frame_for_stream(controller_view.get(), &streamInfo, data_frame);
@@ -3,6 +3,7 @@
 
 // -- includes -----
 #include "PSMoveProtocolInterface.h"
+#include "CompactDataFrame.h"
 
 // -- pre-declarations -----
 class DeviceManager;
@@ -21,8 +22,11 @@ struct ControllerStreamInfo
     bool include_raw_tracker_data;
     bool led_override_active;
 	bool disable_roi;
+    bool use_compact_data_frames;
     int last_data_input_sequence_number;
     int selected_tracker_index;
+    int compact_frames_since_keyframe; ///< -1 until the first compact keyframe is sent
+    CompactControllerFrame compact_keyframe;
 
     inline void Clear()
     {
@@ -33,8 +37,10 @@ struct ControllerStreamInfo
         include_raw_tracker_data = false;
         led_override_active = false;
 		disable_roi = false;
+        use_compact_data_frames = false;
 		last_data_input_sequence_number = -1;
         selected_tracker_index = 0;
+        compact_frames_since_keyframe = -1;
     }
 };
 
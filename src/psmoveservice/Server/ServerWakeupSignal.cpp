@@ -0,0 +1,218 @@
+// -- includes -----
+#include "ServerWakeupSignal.h"
+#include "ServerLog.h"
+
+#include <boost/asio.hpp>
+
+#include <sstream>
+#include <thread>
+
+// -- constants -----
+// Upper bound (in microseconds) of each latency histogram bucket. The last bucket is unbounded.
+static const int k_latency_bucket_upper_bound_us[ServerWakeupSignal::k_latency_bucket_count - 1] = {
+    50, 100, 250, 500, 1000, 2000, 5000, 10000, 20000
+};
+
+// -- public methods -----
+ServerWakeupSignal *ServerWakeupSignal::get_instance()
+{
+    static ServerWakeupSignal s_instance;
+
+    return &s_instance;
+}
+
+ServerWakeupSignal::ServerWakeupSignal()
+    : m_bWorkPending(false)
+    , m_io_service(nullptr)
+    , m_wait_generation(0)
+    , m_timed_out_generation(0)
+    , m_bLatencyLoggingEnabled(false)
+    , m_timeout_count(0)
+    , m_wait_mode_name("wait")
+{
+    for (int bucket_index = 0; bucket_index < k_latency_bucket_count; ++bucket_index)
+    {
+        m_latency_histogram[bucket_index] = 0;
+    }
+}
+
+void ServerWakeupSignal::set_io_service(boost::asio::io_service *io_service)
+{
+    m_io_service = io_service;
+}
+
+void ServerWakeupSignal::set_latency_logging_enabled(bool bEnabled)
+{
+    m_bLatencyLoggingEnabled = bEnabled;
+}
+
+void ServerWakeupSignal::notify()
+{
+    bool bFirstNotify = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Only the oldest pending notification matters for measuring latency
+        if (!m_bWorkPending)
+        {
+            m_bWorkPending = true;
+            m_first_notify_time = std::chrono::high_resolution_clock::now();
+            bFirstNotify = true;
+        }
+    }
+
+    // Unblock run_one() in wait_in_io_service().
+    // Later notifies before the next wait have nothing new to unblock.
+    if (m_io_service != nullptr && bFirstNotify)
+    {
+        m_io_service->post([] {});
+    }
+
+    m_work_cv.notify_one();
+}
+
+bool ServerWakeupSignal::wait_for_work(int max_wait_ms)
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> notify_time;
+    bool bWokenByNotify = false;
+
+    const bool bWaitInIoService = m_io_service != nullptr && !m_io_service->stopped();
+
+    if (bWaitInIoService)
+    {
+        wait_in_io_service(max_wait_ms);
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        // After an io_service wait this just picks up the pending flag
+        bWokenByNotify = 
+            m_work_cv.wait_for(
+                lock, 
+                std::chrono::milliseconds(bWaitInIoService ? 0 : max_wait_ms), 
+                [this] { return m_bWorkPending; });
+
+        notify_time = m_first_notify_time;
+        m_bWorkPending = false;
+    }
+
+    m_wait_mode_name = "wait";
+    record_wakeup(bWokenByNotify, notify_time);
+
+    return bWokenByNotify;
+}
+
+bool ServerWakeupSignal::sleep_for_work(int sleep_ms)
+{
+    std::chrono::time_point<std::chrono::high_resolution_clock> notify_time;
+    bool bHadWork = false;
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        bHadWork = m_bWorkPending;
+        notify_time = m_first_notify_time;
+        m_bWorkPending = false;
+    }
+
+    m_wait_mode_name = "sleep";
+    record_wakeup(bHadWork, notify_time);
+
+    return bHadWork;
+}
+
+// -- private methods -----
+void ServerWakeupSignal::wait_in_io_service(int max_wait_ms)
+{
+    // A timer from an earlier wait can still fire (or report its cancellation) during this one,
+    // so each wait only listens for the timer it started itself
+    const int wait_generation = ++m_wait_generation;
+    boost::asio::deadline_timer timeout_timer(*m_io_service, boost::posix_time::milliseconds(max_wait_ms));
+
+    timeout_timer.async_wait(
+        [this, wait_generation](const boost::system::error_code &error)
+        {
+            if (!error)
+            {
+                m_timed_out_generation = wait_generation;
+            }
+        });
+
+    bool bHasWork = false;
+    while (!bHasWork && m_timed_out_generation != wait_generation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            bHasWork = m_bWorkPending;
+        }
+
+        // Runs the next completed socket handler, a notify() or the timeout
+        if (!bHasWork && m_io_service->run_one() == 0)
+        {
+            // The io_service was stopped, nothing will run until it's reset
+            break;
+        }
+    }
+
+    // The cancelled handler runs on a later poll and only looks at the generation
+    timeout_timer.cancel();
+}
+
+void ServerWakeupSignal::record_wakeup(
+    bool bHadWork,
+    const std::chrono::time_point<std::chrono::high_resolution_clock> &notify_time)
+{
+    if (!m_bLatencyLoggingEnabled)
+    {
+        return;
+    }
+
+    if (bHadWork)
+    {
+        const std::chrono::duration<float, std::micro> latency = 
+            std::chrono::high_resolution_clock::now() - notify_time;
+
+        int bucket_index = 0;
+        while (bucket_index < k_latency_bucket_count - 1 &&
+               latency.count() > static_cast<float>(k_latency_bucket_upper_bound_us[bucket_index]))
+        {
+            ++bucket_index;
+        }
+
+        ++m_latency_histogram[bucket_index];
+    }
+    else
+    {
+        ++m_timeout_count;
+    }
+}
+
+void ServerWakeupSignal::log_latency_histogram()
+{
+    std::ostringstream histogram;
+
+    for (int bucket_index = 0; bucket_index < k_latency_bucket_count; ++bucket_index)
+    {
+        if (bucket_index < k_latency_bucket_count - 1)
+        {
+            histogram << "<=" << k_latency_bucket_upper_bound_us[bucket_index] << "us: ";
+        }
+        else
+        {
+            histogram << ">" << k_latency_bucket_upper_bound_us[bucket_index - 1] << "us: ";
+        }
+
+        histogram << m_latency_histogram[bucket_index] << ", ";
+        m_latency_histogram[bucket_index] = 0;
+    }
+
+    histogram << "timeouts: " << m_timeout_count;
+    m_timeout_count = 0;
+
+    SERVER_LOG_INFO("ServerWakeupSignal") 
+        << "Wakeup latency histogram (" << m_wait_mode_name << " loop) - " << histogram.str();
+}
@@ -0,0 +1,74 @@
+#ifndef SERVER_WAKEUP_SIGNAL_H
+#define SERVER_WAKEUP_SIGNAL_H
+
+//-- includes -----
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+//-- pre-declarations -----
+namespace boost {
+    namespace asio {
+        class io_service;
+    }
+}
+
+//-- definitions -----
+/// Lets producer threads (usb, hid, camera, ...) wake up the main service loop
+/// as soon as they have new data for it, rather than the loop sleeping a fixed interval.
+/// Once bound to the service's io_service the wait also runs socket handlers as they complete,
+/// so network traffic wakes the loop too.
+class ServerWakeupSignal
+{
+public:
+    static const int k_latency_bucket_count = 10;
+
+    static ServerWakeupSignal *get_instance();
+
+    /// Main thread only: wait inside the given io_service instead of on a plain condition.
+    /// Pass nullptr to unbind before the io_service goes away.
+    void set_io_service(boost::asio::io_service *io_service);
+
+    /// Only count wakeups for the latency histogram while enabled
+    void set_latency_logging_enabled(bool bEnabled);
+
+    /// Called from any thread when there is new work for the main loop
+    void notify();
+
+    /// Blocks the calling thread until notify() is called or max_wait_ms has elapsed.
+    /// When bound to an io_service, any socket handlers that complete meanwhile run on the calling thread.
+    /// \return true if woken up by a notify(), false on timeout
+    bool wait_for_work(int max_wait_ms);
+
+    /// Sleeps the full sleep_ms like the old fixed sleep loop, ignoring notify().
+    /// Records the same latency histogram so the two loops can be compared.
+    /// \return true if work was signaled while sleeping
+    bool sleep_for_work(int sleep_ms);
+
+    /// Writes the histogram of notify-to-wakeup latencies to the info log and resets it
+    void log_latency_histogram();
+
+private:
+    ServerWakeupSignal();
+
+    void wait_in_io_service(int max_wait_ms);
+    void record_wakeup(bool bHadWork, const std::chrono::time_point<std::chrono::high_resolution_clock> &notify_time);
+
+    std::mutex m_mutex;
+    std::condition_variable m_work_cv;
+    bool m_bWorkPending;
+    std::chrono::time_point<std::chrono::high_resolution_clock> m_first_notify_time;
+
+    // Set on the main thread before any producer thread starts
+    boost::asio::io_service *m_io_service;
+
+    // Only touched by the thread calling wait_for_work() or sleep_for_work()
+    int m_wait_generation;
+    int m_timed_out_generation;
+    bool m_bLatencyLoggingEnabled;
+    int m_latency_histogram[k_latency_bucket_count];
+    int m_timeout_count;
+    const char *m_wait_mode_name;
+};
+
+#endif // SERVER_WAKEUP_SIGNAL_H
@@ -7,9 +7,6 @@
 
 #include "gamepad/Gamepad.h"
 
-//-- constants -----
-#define VIRTUAL_CONTROLLER_STATE_BUFFER_MAX 16
-
 // -- public methods
 
 // -- Virtual Controller Config
@@ -300,13 +297,6 @@ VirtualController::poll()
         newState.PollSequenceNumber= NextPollSequenceNumber;
         ++NextPollSequenceNumber;
 
-        // Make room for new entry if at the max queue size
-        if (ControllerStates.size() >= VIRTUAL_CONTROLLER_STATE_BUFFER_MAX)
-        {
-            ControllerStates.erase(ControllerStates.begin(),
-                ControllerStates.begin() + ControllerStates.size() - VIRTUAL_CONTROLLER_STATE_BUFFER_MAX);
-        }
-
         ControllerStates.push_back(newState);
     }
 
@@ -360,9 +350,7 @@ const CommonDeviceState *
 VirtualController::getState(
     int lookBack) const
 {
-    const int queueSize= static_cast<int>(ControllerStates.size());
-    const CommonDeviceState * result=
-        (lookBack < queueSize) ? &ControllerStates.at(queueSize - lookBack - 1) : nullptr;
+    const CommonDeviceState * result = ControllerStates.getState(lookBack);
 
     return result;
 }
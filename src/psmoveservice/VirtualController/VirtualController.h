@@ -4,13 +4,15 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
 #include "MathUtility.h"
 #include "hidapi.h"
 #include <string>
 #include <array>
-#include <deque>
 #include <chrono>
 
+#define VIRTUAL_CONTROLLER_STATE_BUFFER_MAX 16
+
 #define MAX_VIRTUAL_CONTROLLER_BUTTONS 32
 #define MAX_VIRTUAL_CONTROLLER_AXES 32
 
@@ -170,7 +172,7 @@ private:
 
     // Read HMD State
     int NextPollSequenceNumber;
-    std::deque<VirtualControllerState> ControllerStates;
+    DeviceStateBuffer<VirtualControllerState, VIRTUAL_CONTROLLER_STATE_BUFFER_MAX> ControllerStates;
 
 	bool bIsTracking;
 };
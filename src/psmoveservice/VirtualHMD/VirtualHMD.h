@@ -4,12 +4,13 @@
 #include "PSMoveConfig.h"
 #include "DeviceEnumerator.h"
 #include "DeviceInterface.h"
+#include "DeviceStateBuffer.h"
 #include "MathUtility.h"
 #include <string>
 #include <vector>
-#include <deque>
 #include <array>
 
+#define VIRTUAL_HMD_STATE_BUFFER_MAX 4
 
 class VirtualHMDConfig : public PSMoveConfig
 {
@@ -129,7 +130,7 @@ private:
 
     // Read HMD State
     int NextPollSequenceNumber;
-    std::deque<VirtualHMDState> HMDStates;
+    DeviceStateBuffer<VirtualHMDState, VIRTUAL_HMD_STATE_BUFFER_MAX> HMDStates;
 
 	bool bIsTracking;
 };
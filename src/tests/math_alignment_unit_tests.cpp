@@ -7,15 +7,61 @@
 #include "MathUtility.h"
 #include "unit_test.h"
 
+#include <chrono>
+
 //-- public interface -----
 bool run_math_alignment_unit_tests()
 {
 	UNIT_TEST_MODULE_BEGIN("math_alignment")
 		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_best_fit_exponential);
+		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_triangulate_weighted_point);
+		UNIT_TEST_MODULE_CALL_TEST(math_alignment_test_triangulate_vs_pairwise);
 	UNIT_TEST_MODULE_END()
 }
 
 //-- private functions -----
+// Pinhole matrix K*[R|t] of a PS3Eye sized camera at the given position looking at the origin
+static Eigen::Matrix<float, 3, 4>
+make_test_pinhole_matrix(const Eigen::Vector3f &camera_position)
+{
+	const Eigen::Vector3f forward = (-camera_position).normalized();
+	const Eigen::Vector3f right = forward.cross(Eigen::Vector3f::UnitY()).normalized();
+	const Eigen::Vector3f down = forward.cross(right);
+
+	Eigen::Matrix3f R;
+	R.row(0) = right;
+	R.row(1) = down;
+	R.row(2) = forward;
+
+	Eigen::Matrix<float, 3, 4> extrinsic;
+	extrinsic.block<3, 3>(0, 0) = R;
+	extrinsic.col(3) = -R * camera_position;
+
+	Eigen::Matrix3f K;
+	K << 554.2563f, 0.f, 320.f,
+		0.f, 554.2563f, 240.f,
+		0.f, 0.f, 1.f;
+
+	return K * extrinsic;
+}
+
+static Eigen::Vector2f
+project_test_point(const Eigen::Matrix<float, 3, 4> &pinhole_matrix, const Eigen::Vector3f &point)
+{
+	const Eigen::Vector3f p = pinhole_matrix * point.homogeneous();
+
+	return Eigen::Vector2f(p.x() / p.z(), p.y() / p.z());
+}
+
+// Deterministic noise in [-1, 1] so failures are reproducible
+static float
+next_test_noise(unsigned int &state)
+{
+	state = state * 1664525u + 1013904223u;
+
+	return static_cast<float>(state >> 8) / static_cast<float>(1 << 23) - 1.f;
+}
+
 bool
 math_alignment_test_best_fit_exponential()
 {
@@ -46,4 +92,132 @@ math_alignment_test_best_fit_exponential()
 	assert(success);	
 	
 	UNIT_TEST_COMPLETE()
-}
\ No newline at end of file
+}
+
+bool
+math_alignment_test_triangulate_weighted_point()
+{
+	UNIT_TEST_BEGIN("triangulate_weighted_point")
+
+	const int k_camera_count = 4;
+	const Eigen::Vector3f point(12.f, -8.f, 25.f);
+	Eigen::Matrix<float, 3, 4> pinhole_matrices[k_camera_count];
+	Eigen::Vector2f screen_locations[k_camera_count];
+	float weights[k_camera_count];
+
+	for (int camera_index = 0; camera_index < k_camera_count; ++camera_index)
+	{
+		const float angle = k_real_two_pi * static_cast<float>(camera_index) / static_cast<float>(k_camera_count);
+		const Eigen::Vector3f camera_position(200.f * cosf(angle), 50.f, 200.f * sinf(angle));
+
+		pinhole_matrices[camera_index] = make_test_pinhole_matrix(camera_position);
+		screen_locations[camera_index] = project_test_point(pinhole_matrices[camera_index], point);
+		weights[camera_index] = 1.f + static_cast<float>(camera_index);
+	}
+
+	// Exact projections triangulate back to the point for any weighting
+	Eigen::Vector3f result;
+	success = eigen_alignment_triangulate_weighted_point(pinhole_matrices, screen_locations, weights, k_camera_count, &result);
+	assert(success);
+	success = (result - point).norm() < 0.01f;
+	assert(success);
+
+	// One camera alone, or a zero weight on all but one, can't locate the point
+	success = !eigen_alignment_triangulate_weighted_point(pinhole_matrices, screen_locations, weights, 1, &result);
+	assert(success);
+	const float single_weight[k_camera_count] = { 1.f, 0.f, 0.f, 0.f };
+	success = !eigen_alignment_triangulate_weighted_point(pinhole_matrices, screen_locations, single_weight, k_camera_count, &result);
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
+
+bool
+math_alignment_test_triangulate_vs_pairwise()
+{
+	UNIT_TEST_BEGIN("triangulate_vs_pairwise")
+
+	const int k_camera_count = 8;
+	const int k_trial_count = 2000;
+	const float k_pixel_noise = 1.f;
+	Eigen::Matrix<float, 3, 4> pinhole_matrices[k_camera_count];
+	Eigen::Vector3f camera_positions[k_camera_count];
+	unsigned int noise_state = 1234;
+
+	// Cameras on a ring at different distances from the tracking volume
+	for (int camera_index = 0; camera_index < k_camera_count; ++camera_index)
+	{
+		const float angle = k_real_two_pi * static_cast<float>(camera_index) / static_cast<float>(k_camera_count);
+		const float radius = 150.f + 50.f * static_cast<float>(camera_index % 3);
+
+		camera_positions[camera_index] = Eigen::Vector3f(radius * cosf(angle), 40.f, radius * sinf(angle));
+		pinhole_matrices[camera_index] = make_test_pinhole_matrix(camera_positions[camera_index]);
+	}
+
+	double nview_error_sum = 0.0;
+	double pairwise_error_sum = 0.0;
+	std::chrono::duration<double, std::micro> nview_duration(0);
+	std::chrono::duration<double, std::micro> pairwise_duration(0);
+
+	for (int trial = 0; trial < k_trial_count && success; ++trial)
+	{
+		const Eigen::Vector3f point(
+			50.f * next_test_noise(noise_state), 
+			30.f * next_test_noise(noise_state), 
+			50.f * next_test_noise(noise_state));
+		Eigen::Vector2f screen_locations[k_camera_count];
+		float weights[k_camera_count];
+
+		// Noisy screen locations, weighted like projection areas (~1/depth^2)
+		for (int camera_index = 0; camera_index < k_camera_count; ++camera_index)
+		{
+			const Eigen::Vector2f noise(next_test_noise(noise_state), next_test_noise(noise_state));
+
+			screen_locations[camera_index] = project_test_point(pinhole_matrices[camera_index], point) + k_pixel_noise*noise;
+			weights[camera_index] = 1.f / (camera_positions[camera_index] - point).squaredNorm();
+		}
+
+		// Single weighted solve over every camera
+		std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+		Eigen::Vector3f nview_point;
+		success &= eigen_alignment_triangulate_weighted_point(pinhole_matrices, screen_locations, weights, k_camera_count, &nview_point);
+		nview_duration += std::chrono::high_resolution_clock::now() - start_time;
+		assert(success);
+
+		// Average of the two camera triangulation of every pair
+		start_time = std::chrono::high_resolution_clock::now();
+		Eigen::Vector3f pairwise_point = Eigen::Vector3f::Zero();
+		int pair_count = 0;
+		for (int camera_index = 0; camera_index < k_camera_count; ++camera_index)
+		{
+			for (int other_camera_index = camera_index + 1; other_camera_index < k_camera_count; ++other_camera_index)
+			{
+				const Eigen::Matrix<float, 3, 4> pair_matrices[2] = { pinhole_matrices[camera_index], pinhole_matrices[other_camera_index] };
+				const Eigen::Vector2f pair_locations[2] = { screen_locations[camera_index], screen_locations[other_camera_index] };
+				const float pair_weights[2] = { 1.f, 1.f };
+				Eigen::Vector3f pair_point;
+
+				success &= eigen_alignment_triangulate_weighted_point(pair_matrices, pair_locations, pair_weights, 2, &pair_point);
+				pairwise_point += pair_point;
+				++pair_count;
+			}
+		}
+		pairwise_point /= static_cast<float>(pair_count);
+		pairwise_duration += std::chrono::high_resolution_clock::now() - start_time;
+		assert(success);
+
+		nview_error_sum += (nview_point - point).norm();
+		pairwise_error_sum += (pairwise_point - point).norm();
+	}
+
+	fprintf(stdout, "      %d cameras: n-view %.4fcm mean error %.3fus, pairwise %.4fcm mean error %.3fus\n",
+		k_camera_count,
+		nview_error_sum / k_trial_count, nview_duration.count() / k_trial_count,
+		pairwise_error_sum / k_trial_count, pairwise_duration.count() / k_trial_count);
+
+	// The joint solve should be at least as accurate as averaging pairs
+	success &= nview_error_sum <= pairwise_error_sum;
+	assert(success);
+
+	UNIT_TEST_COMPLETE()
+}
@@ -0,0 +1,235 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "CompactDataFrame.h"
+#include "unit_test.h"
+
+//-- constants -----
+static const unsigned int k_all_sections = COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_COUNT) - 1;
+
+//-- private methods -----
+static void build_test_state(int controller_id, int sequence_num, float t, CompactControllerState *out_state)
+{
+    const float half_angle = 0.5f * t;
+    const float axis[3] = { 0.267261f, 0.534522f, -0.801784f };
+
+    memset(out_state, 0, sizeof(CompactControllerState));
+    out_state->controller_id = controller_id;
+    out_state->sequence_num = sequence_num;
+    out_state->bIsConnected = true;
+    out_state->bHasValidHardwareCalibration = true;
+    out_state->bIsTrackingEnabled = true;
+    out_state->bIsCurrentlyTracking = true;
+    out_state->bIsOrientationValid = true;
+    out_state->bIsPositionValid = true;
+    out_state->button_bitmask = 0x105;
+    out_state->trigger_value = 200;
+    out_state->battery_value = 0xEE;
+
+    out_state->orientation_wxyz[0] = cosf(half_angle);
+    out_state->orientation_wxyz[1] = axis[0] * sinf(half_angle);
+    out_state->orientation_wxyz[2] = axis[1] * sinf(half_angle);
+    out_state->orientation_wxyz[3] = axis[2] * sinf(half_angle);
+    out_state->position_cm[0] = 12.34f + t;
+    out_state->position_cm[1] = -56.78f;
+    out_state->position_cm[2] = 210.05f;
+
+    for (int axis_index = 0; axis_index < 3; ++axis_index)
+    {
+        out_state->raw_magnetometer[axis_index] = -300 + 100 * axis_index;
+        out_state->raw_accelerometer[axis_index] = 4000 - 1000 * axis_index;
+        out_state->raw_gyroscope[axis_index] = 7 * axis_index;
+        out_state->calibrated_magnetometer[axis_index] = 0.5f - 0.25f * axis_index;
+        out_state->calibrated_accelerometer_g[axis_index] = -1.f + 0.9f * axis_index;
+        out_state->calibrated_gyroscope_rad_per_sec[axis_index] = 3.f * t - axis_index;
+        out_state->velocity_cm_per_sec[axis_index] = 150.f * axis_index;
+        out_state->acceleration_cm_per_sec_sqr[axis_index] = -981.f + axis_index;
+        out_state->angular_velocity_rad_per_sec[axis_index] = 6.28f - axis_index;
+        out_state->angular_acceleration_rad_per_sec_sqr[axis_index] = 100.f * axis_index;
+    }
+}
+
+static bool is_vector_nearly_equal(const float *a, const float *b, int count, float tolerance)
+{
+    for (int index = 0; index < count; ++index)
+    {
+        if (fabsf(a[index] - b[index]) > tolerance)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//-- public interface -----
+bool run_protocol_compact_data_frame_unit_tests()
+{
+    UNIT_TEST_MODULE_BEGIN("protocol_compact_data_frame")
+        UNIT_TEST_MODULE_CALL_TEST(protocol_compact_data_frame_test_quantize);
+        UNIT_TEST_MODULE_CALL_TEST(protocol_compact_data_frame_test_delta);
+        UNIT_TEST_MODULE_CALL_TEST(protocol_compact_data_frame_test_missing_keyframe);
+    UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+protocol_compact_data_frame_test_quantize()
+{
+    UNIT_TEST_BEGIN("quantize")
+
+    CompactControllerState state;
+    CompactControllerState result;
+    CompactControllerFrame frame;
+
+    for (float t = -6.f; success && t <= 6.f; t += 0.37f)
+    {
+        build_test_state(3, 100, t, &state);
+        compact_controller_frame_quantize(&state, k_all_sections, &frame);
+        compact_controller_frame_dequantize(&frame, &result);
+
+        // q and -q are the same rotation
+        const float q_dot =
+            state.orientation_wxyz[0] * result.orientation_wxyz[0] + state.orientation_wxyz[1] * result.orientation_wxyz[1] +
+            state.orientation_wxyz[2] * result.orientation_wxyz[2] + state.orientation_wxyz[3] * result.orientation_wxyz[3];
+
+        success =
+            result.controller_id == 3 && result.sequence_num == 100 &&
+            result.bIsConnected && result.bIsPositionValid &&
+            result.button_bitmask == state.button_bitmask &&
+            result.trigger_value == state.trigger_value &&
+            result.battery_value == state.battery_value &&
+            fabsf(fabsf(q_dot) - 1.f) < 1e-6f &&
+            is_vector_nearly_equal(state.position_cm, result.position_cm, 3, 0.005f) &&
+            memcmp(state.raw_accelerometer, result.raw_accelerometer, sizeof(state.raw_accelerometer)) == 0 &&
+            is_vector_nearly_equal(state.calibrated_accelerometer_g, result.calibrated_accelerometer_g, 3, 1.f / 4096.f) &&
+            is_vector_nearly_equal(state.calibrated_gyroscope_rad_per_sec, result.calibrated_gyroscope_rad_per_sec, 3, 1.f / 1024.f) &&
+            is_vector_nearly_equal(state.velocity_cm_per_sec, result.velocity_cm_per_sec, 3, 0.1f) &&
+            is_vector_nearly_equal(state.angular_velocity_rad_per_sec, result.angular_velocity_rad_per_sec, 3, 1.f / 512.f);
+        assert(success);
+    }
+
+    // Sections that aren't streamed come out zeroed
+    if (success)
+    {
+        const unsigned int pose_sections =
+            COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Status) |
+            COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Orientation);
+
+        compact_controller_frame_quantize(&state, pose_sections, &frame);
+        compact_controller_frame_dequantize(&frame, &result);
+
+        success = result.position_cm[0] == 0.f && result.velocity_cm_per_sec[1] == 0.f && result.raw_gyroscope[2] == 0;
+        assert(success);
+    }
+
+    UNIT_TEST_COMPLETE()
+}
+
+bool
+protocol_compact_data_frame_test_delta()
+{
+    UNIT_TEST_BEGIN("delta")
+
+    CompactControllerState state;
+    CompactControllerFrame keyframe;
+    CompactControllerFrame frame;
+    CompactControllerFrame read_keyframe;
+    CompactControllerFrame read_frame;
+    unsigned char keyframe_buffer[MAX_COMPACT_CONTROLLER_FRAME_SIZE];
+    unsigned char buffer[MAX_COMPACT_CONTROLLER_FRAME_SIZE];
+    bool bIsKeyframe = false;
+
+    build_test_state(1, 500, 0.5f, &state);
+    compact_controller_frame_quantize(&state, k_all_sections, &keyframe);
+    const int keyframe_size = compact_controller_frame_write(&keyframe, nullptr, keyframe_buffer, sizeof(keyframe_buffer), &bIsKeyframe);
+    success = keyframe_size > 0 && bIsKeyframe;
+    assert(success);
+
+    if (success)
+    {
+        success =
+            compact_controller_frame_get_controller_id(keyframe_buffer, keyframe_size) == 1 &&
+            compact_controller_frame_read(keyframe_buffer, keyframe_size, nullptr, &read_keyframe, &bIsKeyframe) &&
+            bIsKeyframe &&
+            memcmp(&read_keyframe, &keyframe, sizeof(keyframe)) == 0;
+        assert(success);
+    }
+
+    // Only the orientation, position and calibrated gyro moved, so only those sections are written
+    if (success)
+    {
+        build_test_state(1, 510, 0.6f, &state);
+        compact_controller_frame_quantize(&state, k_all_sections, &frame);
+
+        const int delta_size = compact_controller_frame_write(&frame, &keyframe, buffer, sizeof(buffer), &bIsKeyframe);
+        success = !bIsKeyframe && delta_size == COMPACT_CONTROLLER_FRAME_HEADER_SIZE + 6 + 9 + 18;
+        assert(success);
+
+        if (success)
+        {
+            success =
+                compact_controller_frame_read(buffer, delta_size, &read_keyframe, &read_frame, &bIsKeyframe) &&
+                !bIsKeyframe &&
+                memcmp(&read_frame, &frame, sizeof(frame)) == 0;
+            assert(success);
+        }
+    }
+
+    // A different set of streamed sections can't be written against the keyframe
+    if (success)
+    {
+        compact_controller_frame_quantize(&state, COMPACT_CONTROLLER_SECTION_BIT(CompactControllerSection_Status), &frame);
+        success = compact_controller_frame_write(&frame, &keyframe, buffer, sizeof(buffer), &bIsKeyframe) > 0 && bIsKeyframe;
+        assert(success);
+    }
+
+    UNIT_TEST_COMPLETE()
+}
+
+bool
+protocol_compact_data_frame_test_missing_keyframe()
+{
+    UNIT_TEST_BEGIN("missing keyframe")
+
+    CompactControllerState state;
+    CompactControllerFrame keyframe;
+    CompactControllerFrame other_keyframe;
+    CompactControllerFrame frame;
+    CompactControllerFrame read_frame;
+    unsigned char buffer[MAX_COMPACT_CONTROLLER_FRAME_SIZE];
+    bool bIsKeyframe = false;
+
+    build_test_state(2, 1000, 1.f, &state);
+    compact_controller_frame_quantize(&state, k_all_sections, &keyframe);
+    build_test_state(2, 990, 1.f, &state);
+    compact_controller_frame_quantize(&state, k_all_sections, &other_keyframe);
+    build_test_state(2, 1001, 1.1f, &state);
+    compact_controller_frame_quantize(&state, k_all_sections, &frame);
+
+    const int delta_size = compact_controller_frame_write(&frame, &keyframe, buffer, sizeof(buffer), &bIsKeyframe);
+    success = delta_size > 0 && !bIsKeyframe;
+    assert(success);
+
+    // A delta against a keyframe the reader never got (or an older one) is dropped
+    if (success)
+    {
+        success =
+            !compact_controller_frame_read(buffer, delta_size, nullptr, &read_frame, &bIsKeyframe) &&
+            !compact_controller_frame_read(buffer, delta_size, &other_keyframe, &read_frame, &bIsKeyframe);
+        assert(success);
+    }
+
+    // So is a truncated one
+    if (success)
+    {
+        success = !compact_controller_frame_read(buffer, delta_size - 1, &keyframe, &read_frame, &bIsKeyframe);
+        assert(success);
+    }
+
+    UNIT_TEST_COMPLETE()
+}
@@ -0,0 +1,181 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <atomic>
+#include <thread>
+
+#include "DeviceStateBuffer.h"
+#include "unit_test.h"
+
+//-- private definitions -----
+struct TestState
+{
+    int sequence;
+    int payload[32];
+
+    void set(int new_sequence)
+    {
+        sequence = new_sequence;
+        for (int index = 0; index < 32; ++index)
+        {
+            payload[index] = new_sequence;
+        }
+    }
+
+    bool is_consistent() const
+    {
+        for (int index = 0; index < 32; ++index)
+        {
+            if (payload[index] != sequence)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+typedef DeviceStateBuffer<TestState, 8> TestStateBuffer;
+
+//-- public interface -----
+bool run_service_device_state_buffer_unit_tests()
+{
+    UNIT_TEST_MODULE_BEGIN("service_device_state_buffer")
+        UNIT_TEST_MODULE_CALL_TEST(service_device_state_buffer_test_lookback);
+        UNIT_TEST_MODULE_CALL_TEST(service_device_state_buffer_test_wrap_around);
+        UNIT_TEST_MODULE_CALL_TEST(service_device_state_buffer_test_concurrent_copy);
+    UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+service_device_state_buffer_test_lookback()
+{
+    UNIT_TEST_BEGIN("lookback")
+
+    TestStateBuffer *buffer = new TestStateBuffer;
+    TestState state;
+
+    success = buffer->empty() && buffer->size() == 0 && buffer->getState(0) == nullptr;
+    assert(success);
+
+    for (int sequence = 0; success && sequence < 3; ++sequence)
+    {
+        state.set(sequence);
+        buffer->push_back(state);
+    }
+
+    // Same indexing as the old deque: lookBack 0 is the newest state
+    if (success)
+    {
+        success =
+            buffer->size() == 3 &&
+            buffer->back().sequence == 2 &&
+            buffer->getState(0)->sequence == 2 &&
+            buffer->getState(2)->sequence == 0 &&
+            buffer->getState(3) == nullptr &&
+            buffer->getState(-1) == nullptr;
+        assert(success);
+    }
+
+    if (success)
+    {
+        buffer->clear();
+        success = buffer->empty() && buffer->getState(0) == nullptr;
+        assert(success);
+    }
+
+    delete buffer;
+
+    UNIT_TEST_COMPLETE()
+}
+
+bool
+service_device_state_buffer_test_wrap_around()
+{
+    UNIT_TEST_BEGIN("wrap around")
+
+    TestStateBuffer *buffer = new TestStateBuffer;
+    TestState state;
+
+    for (int sequence = 0; sequence < 21; ++sequence)
+    {
+        state.set(sequence);
+        buffer->push_back(state);
+    }
+
+    // Only the last capacity states survive, oldest overwritten first
+    success = buffer->size() == buffer->capacity();
+    assert(success);
+
+    for (int lookBack = 0; success && lookBack < 8; ++lookBack)
+    {
+        success = buffer->getState(lookBack)->sequence == 20 - lookBack;
+        assert(success);
+    }
+
+    if (success)
+    {
+        TestState copy;
+
+        // The oldest slot is the next one to be overwritten, so it can't be copied safely
+        success =
+            buffer->getState(8) == nullptr &&
+            buffer->copyState(6, copy) && copy.sequence == 14 &&
+            !buffer->copyState(7, copy);
+        assert(success);
+    }
+
+    delete buffer;
+
+    UNIT_TEST_COMPLETE()
+}
+
+bool
+service_device_state_buffer_test_concurrent_copy()
+{
+    UNIT_TEST_BEGIN("concurrent copy")
+
+    TestStateBuffer *buffer = new TestStateBuffer;
+    std::atomic_bool bProducerDone(false);
+    const int k_push_count = 200000;
+
+    std::thread producer([buffer, &bProducerDone, k_push_count]() {
+        TestState state;
+
+        for (int sequence = 0; sequence < k_push_count; ++sequence)
+        {
+            state.set(sequence);
+            buffer->push_back(state);
+        }
+
+        bProducerDone = true;
+    });
+
+    // Every copy that reports success must be a whole state, and newer lookbacks must be newer states
+    int last_sequence = -1;
+    while (success && !bProducerDone)
+    {
+        TestState copy;
+
+        if (buffer->copyState(0, copy))
+        {
+            success = copy.is_consistent() && copy.sequence >= last_sequence;
+            last_sequence = copy.sequence;
+        }
+
+        if (success && buffer->copyState(6, copy))
+        {
+            success = copy.is_consistent();
+        }
+    }
+
+    producer.join();
+    assert(success);
+
+    delete buffer;
+
+    UNIT_TEST_COMPLETE()
+}
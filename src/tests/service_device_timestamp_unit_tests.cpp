@@ -0,0 +1,115 @@
+//-- includes -----
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <assert.h>
+
+#include "DeviceTimestamp.h"
+#include "unit_test.h"
+
+//-- constants -----
+static const double k_nominal_tick_seconds = 0.00001;
+
+//-- public interface -----
+bool run_service_device_timestamp_unit_tests()
+{
+    UNIT_TEST_MODULE_BEGIN("service_device_timestamp")
+        UNIT_TEST_MODULE_CALL_TEST(service_device_timestamp_test_unwrap);
+        UNIT_TEST_MODULE_CALL_TEST(service_device_timestamp_test_drift);
+        UNIT_TEST_MODULE_CALL_TEST(service_device_timestamp_test_gap);
+    UNIT_TEST_MODULE_END()
+}
+
+//-- private functions -----
+bool
+service_device_timestamp_test_unwrap()
+{
+    UNIT_TEST_BEGIN("unwrap")
+
+    DeviceTimestampReconstructor reconstructor(16, k_nominal_tick_seconds);
+    const double start_seconds = 100.0;
+    const unsigned int ticks_per_report = 1150;
+    double last_timestamp = 0.0;
+
+    // Reports arrive 2ms after they were sampled, with the counter wrapping every ~57 reports.
+    // Stay under the offset correction window so the spacing is never adjusted.
+    for (int report_index = 0; success && report_index < 150; ++report_index)
+    {
+        const unsigned int raw_counter = (0xFF00 + report_index * ticks_per_report) & 0xFFFF;
+        const double sample_seconds = start_seconds + report_index * ticks_per_report * k_nominal_tick_seconds;
+        const double timestamp = reconstructor.update(raw_counter, sample_seconds + 0.002);
+
+        if (report_index > 0)
+        {
+            // Consecutive timestamps are spaced by the true sample period, even across counter wraps
+            success = fabs((timestamp - last_timestamp) - ticks_per_report * k_nominal_tick_seconds) < 1e-9;
+            assert(success);
+        }
+
+        last_timestamp = timestamp;
+    }
+
+    UNIT_TEST_COMPLETE()
+}
+
+bool
+service_device_timestamp_test_drift()
+{
+    UNIT_TEST_BEGIN("drift")
+
+    // The device clock actually runs 2% slower than the nominal period says
+    const double true_tick_seconds = k_nominal_tick_seconds * 1.02;
+    DeviceTimestampReconstructor reconstructor(16, k_nominal_tick_seconds);
+    const unsigned int ticks_per_report = 1150;
+    double timestamp = 0.0;
+    double sample_seconds = 0.0;
+
+    for (int report_index = 0; report_index < 2000; ++report_index)
+    {
+        // Alternate the receive latency between 1ms and 4ms to simulate jitter
+        const unsigned int raw_counter = (report_index * ticks_per_report) & 0xFFFF;
+        const double latency_seconds = (report_index % 2 == 0) ? 0.001 : 0.004;
+
+        sample_seconds = 50.0 + report_index * ticks_per_report * true_tick_seconds;
+        timestamp = reconstructor.update(raw_counter, sample_seconds + latency_seconds);
+
+        // Timestamps never run ahead of the time the report was received
+        success = timestamp <= sample_seconds + latency_seconds;
+        assert(success);
+    }
+
+    // After a few seconds the tick period is measured against the host clock
+    // and the reconstructed timestamp tracks the true sample time
+    if (success)
+    {
+        success =
+            fabs(reconstructor.getTickSeconds() - true_tick_seconds) < true_tick_seconds * 0.001 &&
+            fabs(timestamp - sample_seconds) < 0.005;
+        assert(success);
+    }
+
+    UNIT_TEST_COMPLETE()
+}
+
+bool
+service_device_timestamp_test_gap()
+{
+    UNIT_TEST_BEGIN("gap")
+
+    DeviceTimestampReconstructor reconstructor(16, k_nominal_tick_seconds);
+
+    const double first = reconstructor.update(1000, 10.0);
+    const double second = reconstructor.update(2150, 10.0115);
+
+    // A gap longer than the counter can represent resyncs to the host clock instead of guessing the wrap count
+    const double after_gap = reconstructor.update(500, 12.0);
+    const double after_gap_next = reconstructor.update(1650, 12.0115);
+
+    success =
+        fabs(second - first - 0.0115) < 1e-9 &&
+        after_gap == 12.0 &&
+        fabs(after_gap_next - after_gap - 0.0115) < 1e-9;
+    assert(success);
+
+    UNIT_TEST_COMPLETE()
+}
@@ -0,0 +1,287 @@
+#include "DeviceEnumerator.h"
+#include "DeviceOpenWorker.h"
+#include "ServerLog.h"
+#include "ServerWakeupSignal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-- constants -----
+// Roughly what a PSMoveController::open() takes with its feature report reads, retries and config save
+static const int k_device_open_ms = 150;
+static const int k_device_count = 4;
+static const int k_tick_count = 1000;
+static const int k_poll_interval_ms = 2;
+static const int k_hotplug_tick = 100;
+
+// A tick taking longer than this would be a visible hitch in tracking
+static const double k_max_allowed_tick_ms = 20.0;
+
+//-- private definitions -----
+class SlowDeviceEnumerator : public DeviceEnumerator
+{
+public:
+    SlowDeviceEnumerator()
+        : DeviceEnumerator()
+        , m_index(0)
+    {
+        for (int device_index = 0; device_index < k_device_count; ++device_index)
+        {
+            m_paths.push_back("slow_device_" + std::to_string(device_index));
+        }
+        m_deviceType = CommonDeviceState::PSMove;
+    }
+
+    bool is_valid() const override { return m_index < static_cast<int>(m_paths.size()); }
+    bool next() override { ++m_index; return is_valid(); }
+    int get_vendor_id() const override { return 0; }
+    int get_product_id() const override { return 0; }
+    const char *get_path() const override { return is_valid() ? m_paths[m_index].c_str() : nullptr; }
+
+private:
+    std::vector<std::string> m_paths;
+    int m_index;
+};
+
+class SlowOpeningDevice : public IDeviceInterface
+{
+public:
+    SlowOpeningDevice() : m_bIsOpen(false) {}
+
+    bool matchesDeviceEnumerator(const DeviceEnumerator *enumerator) const override
+    {
+        return m_path == enumerator->get_path();
+    }
+
+    bool open(const DeviceEnumerator *enumerator) override
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(k_device_open_ms));
+        m_path = enumerator->get_path();
+        m_bIsOpen = true;
+        return true;
+    }
+
+    bool getIsOpen() const override { return m_bIsOpen; }
+    bool getIsReadyToPoll() const override { return m_bIsOpen; }
+    ePollResult poll() override { return _PollResultSuccessNoData; }
+    void close() override { m_bIsOpen = false; }
+    long getMaxPollFailureCount() const override { return 100; }
+    CommonDeviceState::eDeviceType getDeviceType() const override { return CommonDeviceState::PSMove; }
+    const CommonDeviceState *getState(int lookBack) const override { return nullptr; }
+
+    inline const std::string &getPath() const { return m_path; }
+
+private:
+    std::string m_path;
+    bool m_bIsOpen;
+};
+
+// Stands in for the DeviceTypeManager: keeps the list of open devices on the main thread
+class TestDeviceOpenClient : public IDeviceOpenWorkerClient
+{
+public:
+    TestDeviceOpenClient() : m_finished_count(0), m_reopen_count(0) {}
+    ~TestDeviceOpenClient()
+    {
+        close_all();
+    }
+
+    // Synchronous version of a device list update, the way the main loop used to do it
+    void update_connected_devices()
+    {
+        DeviceEnumerator *enumerator = allocate_background_device_enumerator();
+
+        while (enumerator->is_valid())
+        {
+            if (!handle_background_device_enumerated(enumerator))
+            {
+                IDeviceInterface *device = allocate_background_device_interface(enumerator);
+
+                device->open(enumerator);
+                handle_background_device_opened(device);
+            }
+
+            enumerator->next();
+        }
+
+        free_device_enumerator(enumerator);
+        handle_background_enumeration_finished();
+    }
+
+    void close_all()
+    {
+        for (IDeviceInterface *device : m_open_devices)
+        {
+            device->close();
+            delete device;
+        }
+        m_open_devices.clear();
+    }
+
+    DeviceEnumerator *allocate_background_device_enumerator() override
+    {
+        return new SlowDeviceEnumerator;
+    }
+
+    void free_device_enumerator(DeviceEnumerator *enumerator) override
+    {
+        delete enumerator;
+    }
+
+    IDeviceInterface *allocate_background_device_interface(const DeviceEnumerator *enumerator) override
+    {
+        return new SlowOpeningDevice;
+    }
+
+    bool handle_background_device_enumerated(const DeviceEnumerator *enumerator) override
+    {
+        for (IDeviceInterface *device : m_open_devices)
+        {
+            if (device->matchesDeviceEnumerator(enumerator))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void handle_background_device_opened(IDeviceInterface *opened_device) override
+    {
+        const std::string &path = static_cast<SlowOpeningDevice *>(opened_device)->getPath();
+
+        if (m_opened_paths.count(path) > 0)
+        {
+            ++m_reopen_count;
+        }
+
+        m_opened_paths.insert(path);
+        m_open_devices.push_back(opened_device);
+    }
+
+    void handle_background_enumeration_finished() override
+    {
+        ++m_finished_count;
+    }
+
+    inline int getOpenDeviceCount() const { return static_cast<int>(m_open_devices.size()); }
+    inline int getFinishedCount() const { return m_finished_count; }
+    inline int getReopenCount() const { return m_reopen_count; }
+
+private:
+    std::vector<IDeviceInterface *> m_open_devices;
+    std::set<std::string> m_opened_paths;
+    int m_finished_count;
+    int m_reopen_count;
+};
+
+struct TickStats
+{
+    double median_ms;
+    double p99_ms;
+    double max_ms;
+};
+
+//-- private methods -----
+static TickStats compute_tick_stats(std::vector<double> &tick_ms)
+{
+    TickStats stats;
+
+    std::sort(tick_ms.begin(), tick_ms.end());
+    stats.median_ms = tick_ms[tick_ms.size() / 2];
+    stats.p99_ms = tick_ms[(tick_ms.size() * 99) / 100];
+    stats.max_ms = tick_ms.back();
+
+    return stats;
+}
+
+// Runs a main loop that polls every k_poll_interval_ms, with the devices showing up at k_hotplug_tick.
+// A second device list update halfway through should find every device already open.
+static TickStats run_main_loop(bool bUseWorker, TestDeviceOpenClient &client)
+{
+    DeviceOpenWorker worker;
+    std::vector<double> tick_ms;
+
+    if (bUseWorker)
+    {
+        worker.start(&client, "Device Open Worker");
+    }
+
+    for (int tick = 0; tick < k_tick_count; ++tick)
+    {
+        ServerWakeupSignal::get_instance()->wait_for_work(k_poll_interval_ms);
+
+        const auto tick_start = std::chrono::high_resolution_clock::now();
+
+        if (tick == k_hotplug_tick || tick == k_tick_count / 2)
+        {
+            if (bUseWorker)
+            {
+                worker.requestEnumeration();
+            }
+            else
+            {
+                client.update_connected_devices();
+            }
+        }
+
+        if (bUseWorker)
+        {
+            worker.poll(true);
+        }
+
+        const auto tick_end = std::chrono::high_resolution_clock::now();
+        tick_ms.push_back(std::chrono::duration<double, std::milli>(tick_end - tick_start).count());
+    }
+
+    worker.stop();
+
+    return compute_tick_stats(tick_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    log_init("info");
+
+    TestDeviceOpenClient sync_client;
+    TestDeviceOpenClient worker_client;
+
+    const TickStats sync_stats = run_main_loop(false, sync_client);
+    const TickStats worker_stats = run_main_loop(true, worker_client);
+
+    printf("Main loop ticks while %d devices take %d ms each to open:\n", k_device_count, k_device_open_ms);
+    printf("  main thread open:  median %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        sync_stats.median_ms, sync_stats.p99_ms, sync_stats.max_ms);
+    printf("  open worker:       median %.3f ms, p99 %.3f ms, max %.3f ms\n",
+        worker_stats.median_ms, worker_stats.p99_ms, worker_stats.max_ms);
+
+    bool bSuccess = true;
+
+    if (worker_client.getOpenDeviceCount() != k_device_count || worker_client.getFinishedCount() != 2)
+    {
+        printf("Open worker handed over %d/%d devices in %d/2 passes!\n",
+            worker_client.getOpenDeviceCount(), k_device_count, worker_client.getFinishedCount());
+        bSuccess = false;
+    }
+
+    if (worker_client.getReopenCount() != 0)
+    {
+        printf("Open worker reopened %d already open devices!\n", worker_client.getReopenCount());
+        bSuccess = false;
+    }
+
+    if (worker_stats.max_ms > k_max_allowed_tick_ms)
+    {
+        printf("Main loop stalled for %.3f ms with the open worker!\n", worker_stats.max_ms);
+        bSuccess = false;
+    }
+
+    log_dispose();
+
+    return bSuccess ? 0 : -1;
+}
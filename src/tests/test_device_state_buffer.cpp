@@ -0,0 +1,92 @@
+#include "DeviceStateBuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+
+//-- constants -----
+static const int k_push_count = 2000000;
+static const int k_state_buffer_max = 16;
+
+//-- private definitions -----
+// Roughly the size of a PSMoveControllerState
+struct BenchmarkState
+{
+    int sequence;
+    float data[64];
+};
+
+//-- private methods -----
+// What the devices did before: trim a deque back to the max size, then append
+static double run_deque_benchmark(int &out_checksum)
+{
+    std::deque<BenchmarkState> states;
+    BenchmarkState state = BenchmarkState();
+    int checksum = 0;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int sequence = 0; sequence < k_push_count; ++sequence)
+    {
+        state.sequence = sequence;
+
+        if (states.size() >= k_state_buffer_max)
+        {
+            states.erase(states.begin(), states.begin() + states.size() - k_state_buffer_max);
+        }
+        states.push_back(state);
+
+        const int queueSize = static_cast<int>(states.size());
+        const int lookBack = sequence & 3;
+        const BenchmarkState *lookback_state = (lookBack < queueSize) ? &states.at(queueSize - lookBack - 1) : nullptr;
+        checksum += (lookback_state != nullptr) ? lookback_state->sequence : 0;
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    out_checksum = checksum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / k_push_count;
+}
+
+static double run_state_buffer_benchmark(int &out_checksum)
+{
+    DeviceStateBuffer<BenchmarkState, k_state_buffer_max> *states = new DeviceStateBuffer<BenchmarkState, k_state_buffer_max>;
+    BenchmarkState state = BenchmarkState();
+    int checksum = 0;
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    for (int sequence = 0; sequence < k_push_count; ++sequence)
+    {
+        state.sequence = sequence;
+        states->push_back(state);
+
+        const BenchmarkState *lookback_state = states->getState(sequence & 3);
+        checksum += (lookback_state != nullptr) ? lookback_state->sequence : 0;
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    delete states;
+
+    out_checksum = checksum;
+    return std::chrono::duration<double, std::nano>(end - start).count() / k_push_count;
+}
+
+int main(int, char**)
+{
+    int deque_checksum = 0;
+    int buffer_checksum = 0;
+
+    const double deque_ns = run_deque_benchmark(deque_checksum);
+    const double buffer_ns = run_state_buffer_benchmark(buffer_checksum);
+
+    printf("Pushing %d states (%d bytes each) with a %d state history:\n",
+        k_push_count, static_cast<int>(sizeof(BenchmarkState)), k_state_buffer_max);
+    printf("  std::deque:        %.1f ns/push\n", deque_ns);
+    printf("  DeviceStateBuffer: %.1f ns/push\n", buffer_ns);
+
+    if (deque_checksum != buffer_checksum)
+    {
+        printf("Lookback mismatch between std::deque and DeviceStateBuffer!\n");
+        return -1;
+    }
+
+    return 0;
+}
@@ -7,6 +7,8 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <chrono>
 #include <stdio.h>
 #include <vector>
 
@@ -374,20 +376,46 @@ private:
 	FILE* m_fp;
 };
 
+struct PoseFilterReplayResult
+{
+	// The predicted mean of every update, since the published state doesn't move while the measurement update is disabled
+	std::vector<Eigen::Vector3d> predicted_positions; // meters
+	std::vector<Eigen::Quaterniond> predicted_orientations;
+	double total_update_ns;
+	int update_count;
+};
+
 static void apply_filter(
 	const bool bUseCompoundFilter,
 	ControllerInputStream &stationary_stream,
 	ControllerInputStream &movement_stream,
 	FilterOutputStream &output_stream);
+static void replay_pose_filter(
+	const KalmanPoseFilterPrecision precision,
+	ControllerInputStream &stationary_stream,
+	ControllerInputStream &movement_stream,
+	PoseFilterReplayResult &out_result);
+static bool benchmark_pose_filter_precision(
+	ControllerInputStream &stationary_stream,
+	ControllerInputStream &movement_stream);
+static void create_filter(
+	const bool bUseCompoundFilter,
+	const KalmanPoseFilterPrecision precision,
+	const ControllerInputStream &stationary_stream,
+	const ControllerInputStream &movement_stream,
+	PoseFilterSpace **out_pose_filter_space, IPoseFilter **out_pose_filter);
+static PoseSensorPacket make_sensor_packet(const ControllerSample &sample);
 static void init_filter_for_psdualshock4(
 	const ControllerInputStream &stationary_stream,
 	const Eigen::Vector3f &initial_position, const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanPoseFilterPrecision precision,
 	PoseFilterSpace **out_pose_filter_space, IPoseFilter **out_pose_filter);
 static void init_filter_for_psmove(
 	const ControllerInputStream &stationary_stream,
 	const Eigen::Vector3f &initial_position, const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanPoseFilterPrecision precision,
 	PoseFilterSpace **out_pose_filter_space, IPoseFilter **out_pose_filter);
 
 int main(int argc, char *argv[])
@@ -427,6 +455,12 @@ int main(int argc, char *argv[])
 	//	movement_stream,
 	//	posefilter_output_stream);
 
+	// Compare the single and double precision pose filters on the same replay
+	if (!benchmark_pose_filter_precision(stationary_stream, movement_stream))
+	{
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -440,29 +474,10 @@ apply_filter(
 	PoseFilterSpace *pose_filter_space = nullptr;
 	IPoseFilter *pose_filter = nullptr;
 
-	const ControllerSample &initialSample = movement_stream.getSample(0);
-	Eigen::Vector3f initial_pos(initialSample.pos[0], initialSample.pos[1], initialSample.pos[2]);
-	Eigen::Quaternionf initial_ori(initialSample.ori[0], initialSample.ori[1], initialSample.ori[2], initialSample.ori[3]);
-
-	switch (movement_stream.getControllerType())
-	{
-	case CommonDeviceState::PSMove:
-		init_filter_for_psmove(
-			stationary_stream,
-			initial_pos, initial_ori,
-			bUseCompoundFilter,
-			&pose_filter_space, &pose_filter);
-		break;
-	case CommonDeviceState::PSDualShock4:
-		init_filter_for_psdualshock4(
-			stationary_stream,
-			initial_pos, initial_ori,
-			bUseCompoundFilter,
-			&pose_filter_space, &pose_filter);
-		break;
-	default:
-		break;
-	}
+	create_filter(
+		bUseCompoundFilter, KalmanPoseFilterPrecisionDouble,
+		stationary_stream, movement_stream,
+		&pose_filter_space, &pose_filter);
 
 	float lastTime = movement_stream.getSample(0).time - stationary_stream.computeMeanTimeDelta();
 
@@ -472,13 +487,7 @@ apply_filter(
 		ControllerSample sample = movement_stream.next();
 		float dT = sample.time - lastTime;
 
-		PoseSensorPacket sensorPacket;
-		sensorPacket.imu_accelerometer_g_units = Eigen::Vector3f(sample.acc[0], sample.acc[1], sample.acc[2]);
-		sensorPacket.imu_gyroscope_rad_per_sec = Eigen::Vector3f(sample.gyro[0], sample.gyro[1], sample.gyro[2]);
-		sensorPacket.imu_magnetometer_unit = Eigen::Vector3f(sample.mag[0], sample.mag[1], sample.mag[2]);
-		sensorPacket.optical_orientation = Eigen::Quaternionf(sample.ori[0], sample.ori[1], sample.ori[2], sample.ori[3]);
-		sensorPacket.tracking_projection_area_px_sqr = sample.area;
-		sensorPacket.optical_position_cm = Eigen::Vector3f(sample.pos[0], sample.pos[1], sample.pos[2]);
+		PoseSensorPacket sensorPacket = make_sensor_packet(sample);
 
 		PoseFilterPacket filterPacket;
 		pose_filter_space->createFilterPacket(sensorPacket, pose_filter, filterPacket);
@@ -498,12 +507,177 @@ apply_filter(
 	}
 }
 
+static void
+replay_pose_filter(
+	const KalmanPoseFilterPrecision precision,
+	ControllerInputStream &stationary_stream,
+	ControllerInputStream &movement_stream,
+	PoseFilterReplayResult &out_result)
+{
+	PoseFilterSpace *pose_filter_space = nullptr;
+	IPoseFilter *pose_filter = nullptr;
+
+	create_filter(
+		false, precision,
+		stationary_stream, movement_stream,
+		&pose_filter_space, &pose_filter);
+
+	// The full pose filter is always a kalman pose filter
+	const KalmanPoseFilter *kalman_pose_filter = static_cast<const KalmanPoseFilter *>(pose_filter);
+
+	out_result.predicted_positions.clear();
+	out_result.predicted_orientations.clear();
+	out_result.total_update_ns = 0.0;
+	out_result.update_count = 0;
+
+	float lastTime = movement_stream.getSample(0).time - stationary_stream.computeMeanTimeDelta();
+
+	movement_stream.reset();
+	while (movement_stream.hasNext())
+	{
+		ControllerSample sample = movement_stream.next();
+		float dT = sample.time - lastTime;
+		lastTime = sample.time;
+
+		PoseSensorPacket sensorPacket = make_sensor_packet(sample);
+
+		PoseFilterPacket filterPacket;
+		pose_filter_space->createFilterPacket(sensorPacket, pose_filter, filterPacket);
+
+		// Only time the filter itself
+		const auto update_start = std::chrono::high_resolution_clock::now();
+		pose_filter->update(dT, filterPacket);
+		const auto update_end = std::chrono::high_resolution_clock::now();
+
+		out_result.total_update_ns += std::chrono::duration<double, std::nano>(update_end - update_start).count();
+		++out_result.update_count;
+
+		Eigen::Vector3d predicted_position;
+		Eigen::Quaterniond predicted_orientation;
+		kalman_pose_filter->getPredictedPose(predicted_position, predicted_orientation);
+
+		out_result.predicted_positions.push_back(predicted_position);
+		out_result.predicted_orientations.push_back(predicted_orientation);
+	}
+
+	delete pose_filter_space;
+	delete pose_filter;
+}
+
+// Runs the full pose filter over the movement stream at both precisions
+// and reports the time per update and how far the float filter's predictions stray from the double one's.
+// Fails if they stray further than the tolerance.
+static bool
+benchmark_pose_filter_precision(
+	ControllerInputStream &stationary_stream,
+	ControllerInputStream &movement_stream)
+{
+	const int k_benchmark_pass_count = 10;
+	const double k_max_position_error_cm = 0.01;
+	const double k_max_angle_error_deg = 0.01;
+
+	PoseFilterReplayResult double_result;
+	PoseFilterReplayResult float_result;
+	double best_double_ns = -1.0;
+	double best_float_ns = -1.0;
+
+	// Take the fastest pass to keep scheduling noise out of the comparison
+	for (int pass = 0; pass < k_benchmark_pass_count; ++pass)
+	{
+		replay_pose_filter(KalmanPoseFilterPrecisionDouble, stationary_stream, movement_stream, double_result);
+		replay_pose_filter(KalmanPoseFilterPrecisionFloat, stationary_stream, movement_stream, float_result);
+
+		const double double_ns = double_result.total_update_ns / static_cast<double>(double_result.update_count);
+		const double float_ns = float_result.total_update_ns / static_cast<double>(float_result.update_count);
+
+		best_double_ns = (best_double_ns < 0.0) ? double_ns : std::min(best_double_ns, double_ns);
+		best_float_ns = (best_float_ns < 0.0) ? float_ns : std::min(best_float_ns, float_ns);
+	}
+
+	double max_position_error_cm = 0.0;
+	double max_angle_error_deg = 0.0;
+	for (size_t index = 0; index < double_result.predicted_positions.size(); ++index)
+	{
+		const double position_error_cm =
+			(float_result.predicted_positions[index] - double_result.predicted_positions[index]).norm() * k_meters_to_centimeters;
+		const double angle_error_deg =
+			float_result.predicted_orientations[index].angularDistance(double_result.predicted_orientations[index]) * k_radians_to_degreees;
+
+		max_position_error_cm = std::max(max_position_error_cm, position_error_cm);
+		max_angle_error_deg = std::max(max_angle_error_deg, angle_error_deg);
+	}
+
+	const bool bWithinTolerance =
+		max_position_error_cm <= k_max_position_error_cm &&
+		max_angle_error_deg <= k_max_angle_error_deg;
+
+	printf("Pose kalman filter, %d updates:\n", double_result.update_count);
+	printf("  double: %.0f ns/update\n", best_double_ns);
+	printf("  float:  %.0f ns/update (%.2fx)\n", best_float_ns, best_double_ns / best_float_ns);
+	printf("  float vs double max predicted error: %f cm, %f deg (%s)\n",
+		max_position_error_cm, max_angle_error_deg, bWithinTolerance ? "ok" : "FAILED");
+
+	return bWithinTolerance;
+}
+
+static void
+create_filter(
+	const bool bUseCompoundFilter,
+	const KalmanPoseFilterPrecision precision,
+	const ControllerInputStream &stationary_stream,
+	const ControllerInputStream &movement_stream,
+	PoseFilterSpace **out_pose_filter_space,
+	IPoseFilter **out_pose_filter)
+{
+	const ControllerSample &initialSample = movement_stream.getSample(0);
+	Eigen::Vector3f initial_pos(initialSample.pos[0], initialSample.pos[1], initialSample.pos[2]);
+	Eigen::Quaternionf initial_ori(initialSample.ori[0], initialSample.ori[1], initialSample.ori[2], initialSample.ori[3]);
+
+	switch (movement_stream.getControllerType())
+	{
+	case CommonDeviceState::PSMove:
+		init_filter_for_psmove(
+			stationary_stream,
+			initial_pos, initial_ori,
+			bUseCompoundFilter,
+			precision,
+			out_pose_filter_space, out_pose_filter);
+		break;
+	case CommonDeviceState::PSDualShock4:
+		init_filter_for_psdualshock4(
+			stationary_stream,
+			initial_pos, initial_ori,
+			bUseCompoundFilter,
+			precision,
+			out_pose_filter_space, out_pose_filter);
+		break;
+	default:
+		break;
+	}
+}
+
+static PoseSensorPacket
+make_sensor_packet(const ControllerSample &sample)
+{
+	PoseSensorPacket sensorPacket;
+
+	sensorPacket.imu_accelerometer_g_units = Eigen::Vector3f(sample.acc[0], sample.acc[1], sample.acc[2]);
+	sensorPacket.imu_gyroscope_rad_per_sec = Eigen::Vector3f(sample.gyro[0], sample.gyro[1], sample.gyro[2]);
+	sensorPacket.imu_magnetometer_unit = Eigen::Vector3f(sample.mag[0], sample.mag[1], sample.mag[2]);
+	sensorPacket.optical_orientation = Eigen::Quaternionf(sample.ori[0], sample.ori[1], sample.ori[2], sample.ori[3]);
+	sensorPacket.tracking_projection_area_px_sqr = sample.area;
+	sensorPacket.optical_position_cm = Eigen::Vector3f(sample.pos[0], sample.pos[1], sample.pos[2]);
+
+	return sensorPacket;
+}
+
 static void
 init_filter_for_psmove(
 	const ControllerInputStream &stationary_stream,
 	const Eigen::Vector3f &initial_position,
 	const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanPoseFilterPrecision precision,
 	PoseFilterSpace **out_pose_filter_space,
 	IPoseFilter **out_pose_filter)
 {
@@ -568,7 +742,7 @@ init_filter_for_psmove(
 	}
 	else
 	{
-		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove();
+		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove(precision);
 		fullPoseFilter->init(constants, initial_position, initial_orientation);
 
 		*out_pose_filter = fullPoseFilter;
@@ -583,6 +757,7 @@ init_filter_for_psdualshock4(
 	const Eigen::Vector3f &initial_position,
 	const Eigen::Quaternionf &initial_orientation,
 	const bool bUseCompoundFilter,
+	const KalmanPoseFilterPrecision precision,
 	PoseFilterSpace **out_pose_filter_space,
 	IPoseFilter **out_pose_filter)
 {
@@ -644,7 +819,7 @@ init_filter_for_psdualshock4(
 	}
 	else
 	{
-		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove();
+		KalmanPoseFilterPSMove *fullPoseFilter = new KalmanPoseFilterPSMove(precision);
 		fullPoseFilter->init(constants, initial_position, initial_orientation);
 
 		*out_pose_filter = fullPoseFilter;
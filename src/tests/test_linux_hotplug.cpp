@@ -0,0 +1,213 @@
+#include "PlatformDeviceAPILinux.h"
+#include "ServerLog.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+
+//-- constants -----
+static const int k_idle_poll_count = 10000;
+static const int k_live_poll_interval_ms = 10;
+static const int k_live_duration_ms = 30000;
+
+//-- private definitions -----
+// Hands out whatever events the test queued up
+class SyntheticHotplugEventSource : public IPlatformHotplugEventSource
+{
+public:
+    SyntheticHotplugEventSource() : m_bIsRunning(false) {}
+
+    bool startup() override { m_bIsRunning = true; return true; }
+    void shutdown() override { m_bIsRunning = false; }
+
+    bool poll_event(PlatformHotplugEvent &out_event) override
+    {
+        if (!m_bIsRunning || m_events.empty())
+        {
+            return false;
+        }
+
+        out_event = m_events.front();
+        m_events.pop_front();
+
+        return true;
+    }
+
+    void inject(
+        PlatformHotplugEvent::eAction action,
+        const char *subsystem,
+        const char *device_path,
+        int vendor_id,
+        int product_id)
+    {
+        PlatformHotplugEvent event;
+
+        event.action = action;
+        event.subsystem = subsystem;
+        event.device_path = device_path;
+        event.vendor_id = vendor_id;
+        event.product_id = product_id;
+        m_events.push_back(event);
+    }
+
+private:
+    std::deque<PlatformHotplugEvent> m_events;
+    bool m_bIsRunning;
+};
+
+struct HotplugNotification
+{
+    bool bConnected;
+    DeviceClass device_class;
+    std::string device_path;
+};
+
+// Stands in for the DeviceManager: every notification here would mark a device list dirty
+class RecordingHotplugListener : public IDeviceHotplugListener
+{
+public:
+    void handle_device_connected(enum DeviceClass device_class, const std::string &device_path) override
+    {
+        m_notifications.push_back({ true, device_class, device_path });
+        printf("  connected:    class %d, %s\n", device_class, device_path.c_str());
+    }
+
+    void handle_device_disconnected(enum DeviceClass device_class, const std::string &device_path) override
+    {
+        m_notifications.push_back({ false, device_class, device_path });
+        printf("  disconnected: class %d, %s\n", device_class, device_path.c_str());
+    }
+
+    std::vector<HotplugNotification> m_notifications;
+};
+
+//-- private methods -----
+static bool check_notification(
+    const RecordingHotplugListener &listener,
+    size_t index,
+    bool bConnected,
+    DeviceClass device_class,
+    const char *device_path)
+{
+    if (index >= listener.m_notifications.size())
+    {
+        printf("Missing notification #%d for %s!\n", static_cast<int>(index), device_path);
+        return false;
+    }
+
+    const HotplugNotification &notification = listener.m_notifications[index];
+
+    if (notification.bConnected != bConnected ||
+        notification.device_class != device_class ||
+        notification.device_path != device_path)
+    {
+        printf("Notification #%d doesn't match %s!\n", static_cast<int>(index), device_path);
+        return false;
+    }
+
+    return true;
+}
+
+static bool run_synthetic_test()
+{
+    SyntheticHotplugEventSource *event_source = new SyntheticHotplugEventSource;
+    PlatformDeviceAPILinux platform_api(event_source);
+    RecordingHotplugListener listener;
+    bool bSuccess = platform_api.startup(&listener);
+
+    // Without any hotplug events nobody should be told to re-enumerate
+    for (int poll_index = 0; bSuccess && poll_index < k_idle_poll_count; ++poll_index)
+    {
+        platform_api.poll();
+    }
+
+    if (bSuccess && !listener.m_notifications.empty())
+    {
+        printf("Got %d notifications while idle!\n", static_cast<int>(listener.m_notifications.size()));
+        bSuccess = false;
+    }
+
+    if (bSuccess)
+    {
+        printf("No notifications in %d idle polls\n", k_idle_poll_count);
+        printf("Injected events:\n");
+
+        // PSMove over Bluetooth
+        event_source->inject(PlatformHotplugEvent::Added, "hidraw", "/dev/hidraw3", 0x054c, 0x03d5);
+        // PS3Eye
+        event_source->inject(PlatformHotplugEvent::Added, "usb", "/dev/bus/usb/001/004", 0x1415, 0x2000);
+        // DS4 over USB, its hidraw node raises its own event
+        event_source->inject(PlatformHotplugEvent::Added, "usb", "/dev/bus/usb/001/005", 0x054c, 0x05c4);
+        event_source->inject(PlatformHotplugEvent::Added, "hidraw", "/dev/hidraw4", 0x054c, 0x05c4);
+        // Some other camera
+        event_source->inject(PlatformHotplugEvent::Removed, "video4linux", "/dev/video0", -1, -1);
+        event_source->inject(PlatformHotplugEvent::Removed, "hidraw", "/dev/hidraw3", 0x054c, 0x03d5);
+        // Nothing the device managers care about
+        event_source->inject(PlatformHotplugEvent::Added, "input", "/dev/input/event7", -1, -1);
+
+        platform_api.poll();
+
+        bSuccess =
+            check_notification(listener, 0, true, DeviceClass_HID, "/dev/hidraw3") &&
+            check_notification(listener, 1, true, DeviceClass_Camera, "/dev/bus/usb/001/004") &&
+            check_notification(listener, 2, true, DeviceClass_HID, "/dev/hidraw4") &&
+            check_notification(listener, 3, false, DeviceClass_Camera, "/dev/video0") &&
+            check_notification(listener, 4, false, DeviceClass_HID, "/dev/hidraw3");
+
+        if (bSuccess && listener.m_notifications.size() != 5)
+        {
+            printf("Expected 5 notifications, got %d!\n", static_cast<int>(listener.m_notifications.size()));
+            bSuccess = false;
+        }
+    }
+
+    platform_api.shutdown();
+
+    return bSuccess;
+}
+
+// Prints the events from the real udev monitor, for checking by plugging devices in and out
+static bool run_live_test()
+{
+    PlatformDeviceAPILinux platform_api;
+    RecordingHotplugListener listener;
+
+    if (!platform_api.startup(&listener))
+    {
+        printf("Failed to start the udev monitor!\n");
+        return false;
+    }
+
+    printf("Listening for udev events for %d seconds...\n", k_live_duration_ms / 1000);
+
+    for (int elapsed_ms = 0; elapsed_ms < k_live_duration_ms; elapsed_ms += k_live_poll_interval_ms)
+    {
+        platform_api.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(k_live_poll_interval_ms));
+    }
+
+    platform_api.shutdown();
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    log_init("info");
+
+    const bool bLive = argc > 1 && strcmp(argv[1], "--live") == 0;
+    const bool bSuccess = bLive ? run_live_test() : run_synthetic_test();
+
+    if (!bLive)
+    {
+        printf(bSuccess ? "Hotplug events OK\n" : "Hotplug events FAILED\n");
+    }
+
+    log_dispose();
+
+    return bSuccess ? 0 : -1;
+}
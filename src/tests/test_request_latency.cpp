@@ -0,0 +1,91 @@
+#include "PSMoveClient_CAPI.h"
+#include "ClientConstants.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+#include <stdio.h>
+
+//-- constants -----
+static const int k_request_count = 200;
+
+//-- private methods -----
+// Times k_request_count back to back blocking calls of the given request
+static bool run_benchmark(const char *request_name, std::function<PSMResult()> request)
+{
+    std::vector<double> round_trip_ms;
+    round_trip_ms.reserve(k_request_count);
+
+    for (int request_index = 0; request_index < k_request_count; ++request_index)
+    {
+        const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+        const PSMResult result = request();
+        const std::chrono::duration<double, std::milli> duration = std::chrono::high_resolution_clock::now() - start_time;
+
+        if (result != PSMResult_Success)
+        {
+            printf("%-24s request %d failed (%d)\n", request_name, request_index, result);
+            return false;
+        }
+
+        round_trip_ms.push_back(duration.count());
+    }
+
+    std::sort(round_trip_ms.begin(), round_trip_ms.end());
+
+    double total_ms = 0.0;
+    for (double sample_ms : round_trip_ms)
+    {
+        total_ms += sample_ms;
+    }
+
+    printf("%-24s min %7.3f ms  median %7.3f ms  p99 %7.3f ms  max %7.3f ms  mean %7.3f ms\n",
+        request_name,
+        round_trip_ms.front(),
+        round_trip_ms[round_trip_ms.size() / 2],
+        round_trip_ms[(round_trip_ms.size() * 99) / 100],
+        round_trip_ms.back(),
+        total_ms / round_trip_ms.size());
+
+    return true;
+}
+
+// Usage: test_request_latency
+// Measures the round trip time of blocking C API requests against a PSMoveService on this machine.
+int main(int, char**)
+{
+    const std::chrono::high_resolution_clock::time_point connect_start_time = std::chrono::high_resolution_clock::now();
+    if (PSM_Initialize(PSMOVESERVICE_DEFAULT_ADDRESS, PSMOVESERVICE_DEFAULT_PORT, PSM_DEFAULT_TIMEOUT) != PSMResult_Success)
+    {
+        printf("Failed to connect to PSMoveService\n");
+        return -1;
+    }
+    const std::chrono::duration<double, std::milli> connect_duration = std::chrono::high_resolution_clock::now() - connect_start_time;
+
+    printf("%-24s %7.3f ms\n", "PSM_Initialize", connect_duration.count());
+    printf("%d requests per run\n", k_request_count);
+
+    char version_string[PSMOVESERVICE_MAX_VERSION_STRING_LEN];
+    PSMControllerList controller_list;
+    PSMTrackerList tracker_list;
+    PSMHmdList hmd_list;
+
+    bool success =
+        run_benchmark("PSM_GetServiceVersion", [&]() {
+            return PSM_GetServiceVersionString(version_string, sizeof(version_string), PSM_DEFAULT_TIMEOUT);
+        }) &&
+        run_benchmark("PSM_GetControllerList", [&]() {
+            return PSM_GetControllerList(&controller_list, PSM_DEFAULT_TIMEOUT);
+        }) &&
+        run_benchmark("PSM_GetTrackerList", [&]() {
+            return PSM_GetTrackerList(&tracker_list, PSM_DEFAULT_TIMEOUT);
+        }) &&
+        run_benchmark("PSM_GetHmdList", [&]() {
+            return PSM_GetHmdList(&hmd_list, PSM_DEFAULT_TIMEOUT);
+        });
+
+    PSM_Shutdown();
+
+    return success ? 0 : -1;
+}
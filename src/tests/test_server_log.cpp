@@ -0,0 +1,131 @@
+#include "ServerLog.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+
+//-- constants -----
+static const int k_frame_count = 20000;
+static const int k_data_frame_size = 256;
+static const char *k_log_filename = "test_server_log.log";
+static const char *k_console_filename = "test_server_log_console.log";
+
+//-- private methods -----
+// Same formatting as show_hex() in PackedMessage.h
+static std::string show_hex(const unsigned char *buffer, unsigned length)
+{
+    std::stringstream ss;
+
+    for (unsigned index = 0; index < length; ++index)
+    {
+        ss << std::hex << std::setfill('0') << std::setw(2) << static_cast<unsigned>(buffer[index]) << " ";
+    }
+
+    return ss.str();
+}
+
+// What ClientConnection::start_udp_write_queued_device_data_frame logs for every data frame
+static void log_data_frame(const unsigned char *buffer, unsigned length)
+{
+    SERVER_LOG_DEBUG("ClientConnection::start_udp_write_queued_device_data_frame") << "Sending UDP DataFrame";
+    SERVER_LOG_DEBUG("   ") << show_hex(buffer, length);
+    SERVER_LOG_DEBUG("   ") << length << " bytes";
+}
+
+// A log line that is almost free to format, so the sink dominates the cost
+static void log_short_line(int frame)
+{
+    SERVER_LOG_DEBUG("ServerRequestHandler::publish_controller_data_frame") << "Published frame " << frame;
+}
+
+// How much the old macros spent on a disabled log line: the operands were always evaluated
+static void eager_log_data_frame(const unsigned char *buffer, unsigned length)
+{
+    volatile size_t sink = 0;
+
+    sink += log_get_timestamp_prefix().size();
+    sink += show_hex(buffer, length).size();
+    sink += log_get_timestamp_prefix().size();
+    sink += log_get_timestamp_prefix().size();
+}
+
+static void run_benchmark(const char *name, const char *log_level, bool bUseAsyncSink, bool bEager, bool bShortLines= false)
+{
+    unsigned char data_frame[k_data_frame_size];
+    for (int index = 0; index < k_data_frame_size; ++index)
+    {
+        data_frame[index] = static_cast<unsigned char>(index * 7);
+    }
+
+    log_init(log_level, k_log_filename, bUseAsyncSink);
+
+    const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+    for (int frame = 0; frame < k_frame_count; ++frame)
+    {
+        if (bShortLines)
+        {
+            log_short_line(frame);
+            continue;
+        }
+
+        if (bEager)
+        {
+            eager_log_data_frame(data_frame, k_data_frame_size);
+        }
+
+        log_data_frame(data_frame, k_data_frame_size);
+    }
+    const std::chrono::duration<double, std::micro> frame_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    // Time to drain whatever the async writer still has queued
+    const std::chrono::high_resolution_clock::time_point dispose_start_time = std::chrono::high_resolution_clock::now();
+    log_dispose();
+    const std::chrono::duration<double, std::milli> dispose_duration = std::chrono::high_resolution_clock::now() - dispose_start_time;
+
+    // The async sink drops lines rather than block, so report how many actually made it out
+    int written_line_count = 0;
+    {
+        std::ifstream log_file(k_log_filename);
+        std::string line;
+
+        while (std::getline(log_file, line))
+        {
+            ++written_line_count;
+        }
+    }
+
+    printf("%-36s %8.3f us/frame (dispose %.1f ms, %d lines written)\n",
+        name, frame_duration.count() / k_frame_count, dispose_duration.count(), written_line_count);
+}
+
+// Usage: test_server_log
+// Measures the logging overhead the UDP data frame path adds to each frame.
+// The console output goes to a real file (like a redirected service stdout) so the
+// synchronous sink pays for a blocking write on every line, same as it does in the service.
+int main(int, char**)
+{
+    std::filebuf console_file_buffer;
+    console_file_buffer.open(k_console_filename, std::ios::out);
+    std::streambuf *console_buffer = std::cout.rdbuf(&console_file_buffer);
+
+    printf("%d frames, %d byte data frames\n", k_frame_count, k_data_frame_size);
+    run_benchmark("info, old eager operand evaluation", "info", false, true);
+    run_benchmark("info, lazy macros", "info", false, false);
+    run_benchmark("debug, synchronous sink", "debug", false, false);
+    run_benchmark("debug, async sink", "debug", true, false);
+    // Formatting the hex dump dominates the lines above, so time the sinks on their own too
+    run_benchmark("debug, synchronous sink, short line", "debug", false, false, true);
+    run_benchmark("debug, async sink, short line", "debug", true, false, true);
+
+    std::cout.rdbuf(console_buffer);
+    console_file_buffer.close();
+    std::remove(k_log_filename);
+    std::remove(k_console_filename);
+
+    return 0;
+}
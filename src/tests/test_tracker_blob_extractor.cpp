@@ -0,0 +1,238 @@
+#include "TrackerBlobExtractor.h"
+#include "opencv2/opencv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+//-- constants -----
+static const int k_iteration_count = 200;
+static const int k_min_points_in_contour = 6;
+
+// Single blob like a controller bulb, and a cloud of blobs like the HMD LEDs
+static const int k_blob_counts[] = { 1, 7 };
+static const int k_blob_count_count = sizeof(k_blob_counts) / sizeof(k_blob_counts[0]);
+
+//-- typedefs -----
+typedef std::vector<cv::Point> t_contour;
+typedef std::vector<t_contour> t_contour_list;
+
+//-- private methods -----
+// What OpenCVBufferState::computeBiggestNContours does without the blob extractor
+static void compute_biggest_contours_opencv(cv::Mat &mask, int max_contour_count, t_contour_list &out_contours)
+{
+    struct ContourInfo
+    {
+        int contour_index;
+        double contour_area;
+    };
+    std::vector<ContourInfo> sorted_contour_list;
+    t_contour_list contours;
+
+    out_contours.clear();
+
+    // findContours used to modify its source image
+    cv::Mat scratch = mask.clone();
+    cv::findContours(scratch, contours, CV_RETR_EXTERNAL, CV_CHAIN_APPROX_SIMPLE);
+
+    for (int contour_index = 0; contour_index < static_cast<int>(contours.size()); ++contour_index)
+    {
+        const ContourInfo contour_info = { contour_index, cv::contourArea(contours[contour_index]) };
+        sorted_contour_list.push_back(contour_info);
+    }
+
+    std::sort(
+        sorted_contour_list.begin(), sorted_contour_list.end(),
+        [](const ContourInfo &a, const ContourInfo &b) {
+            return b.contour_area < a.contour_area;
+    });
+
+    for (auto it = sorted_contour_list.begin();
+        it != sorted_contour_list.end() && static_cast<int>(out_contours.size()) < max_contour_count;
+        ++it)
+    {
+        t_contour &contour = contours[it->contour_index];
+
+        if (contour.size() > k_min_points_in_contour)
+        {
+            // The point by point erase the server used to do
+            t_contour::iterator point_it = contour.begin();
+            while (point_it != contour.end())
+            {
+                if (point_it->x == 0 || point_it->x == mask.cols - 1 || point_it->y == 0 || point_it->y == mask.rows - 1)
+                {
+                    point_it = contour.erase(point_it);
+                }
+                else
+                {
+                    ++point_it;
+                }
+            }
+
+            out_contours.push_back(contour);
+        }
+    }
+}
+
+static void compute_biggest_contours_extractor(
+    TrackerBlobExtractor &extractor,
+    const cv::Mat &mask,
+    int max_contour_count,
+    t_contour_list &out_contours)
+{
+    const int max_x = mask.cols - 1;
+    const int max_y = mask.rows - 1;
+
+    out_contours.clear();
+
+    extractor.extractBlobs(mask, 0, 0, max_contour_count);
+    for (const TrackerBlob &blob : extractor.getBlobs())
+    {
+        t_contour contour;
+        extractor.computeBlobContour(blob, contour);
+
+        if (contour.size() > k_min_points_in_contour)
+        {
+            contour.erase(
+                std::remove_if(
+                    contour.begin(), contour.end(),
+                    [max_x, max_y](const cv::Point &p) {
+                        return p.x == 0 || p.x == max_x || p.y == 0 || p.y == max_y;
+                }),
+                contour.end());
+
+            out_contours.push_back(contour);
+        }
+    }
+}
+
+// Thresholded tracker frame: a few bright blobs of decreasing size over sensor speckle
+static void build_test_mask(int width, int height, int blob_count, unsigned int seed, cv::Mat &mask)
+{
+    cv::RNG rng(seed);
+
+    mask.create(height, width, CV_8UC1);
+    mask.setTo(cv::Scalar::all(0));
+
+    for (int blob_index = 0; blob_index < blob_count; ++blob_index)
+    {
+        const cv::Point center(rng.uniform(width / 8, width - width / 8), rng.uniform(height / 8, height - height / 8));
+        const int radius = std::max(height / (6 + 3 * blob_index), 3);
+        const cv::Size axes(radius, std::max(radius * rng.uniform(60, 100) / 100, 2));
+
+        cv::ellipse(mask, center, axes, rng.uniform(0., 180.), 0, 360, cv::Scalar::all(255), -1);
+    }
+
+    // Isolated noise pixels and small clumps
+    const int noise_count = width * height / 200;
+    for (int noise_index = 0; noise_index < noise_count; ++noise_index)
+    {
+        const cv::Point p(rng.uniform(0, width), rng.uniform(0, height));
+        const int clump_size = rng.uniform(0, 4) == 0 ? 2 : 0;
+
+        cv::rectangle(mask, p, p + cv::Point(clump_size, clump_size), cv::Scalar::all(255), -1);
+    }
+}
+
+static bool run_benchmark(const std::string &mask_name, const cv::Mat &mask, int max_contour_count)
+{
+    TrackerBlobExtractor extractor;
+    cv::Mat opencv_mask = mask.clone();
+    t_contour_list opencv_contours;
+    t_contour_list extractor_contours;
+
+    // Make sure both paths find the same biggest blob before timing them
+    compute_biggest_contours_opencv(opencv_mask, max_contour_count, opencv_contours);
+    compute_biggest_contours_extractor(extractor, mask, max_contour_count, extractor_contours);
+
+    bool bSuccess = opencv_contours.size() == extractor_contours.size();
+    if (bSuccess && opencv_contours.size() > 0)
+    {
+        bSuccess = opencv_contours[0] == extractor_contours[0];
+    }
+
+    // Smaller blobs of similar size may be ranked differently by pixel count and polygon area
+    int shared_contour_count = 0;
+    for (const t_contour &contour : extractor_contours)
+    {
+        if (std::find(opencv_contours.begin(), opencv_contours.end(), contour) != opencv_contours.end())
+        {
+            ++shared_contour_count;
+        }
+    }
+
+    std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        compute_biggest_contours_opencv(opencv_mask, max_contour_count, opencv_contours);
+    }
+    const std::chrono::duration<double, std::milli> opencv_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        compute_biggest_contours_extractor(extractor, mask, max_contour_count, extractor_contours);
+    }
+    const std::chrono::duration<double, std::milli> extractor_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    printf("%s top %d: findContours %.3f ms/frame, blob extractor %.3f ms/frame (%.2fx), %d/%d contours shared%s\n",
+        mask_name.c_str(), max_contour_count,
+        opencv_duration.count() / k_iteration_count,
+        extractor_duration.count() / k_iteration_count,
+        opencv_duration.count() / extractor_duration.count(),
+        shared_contour_count, static_cast<int>(extractor_contours.size()),
+        bSuccess ? "" : " - BIGGEST BLOB MISMATCH");
+
+    return bSuccess;
+}
+
+// Usage: test_tracker_blob_extractor [mask.png ...]
+// Recorded masks are thresholded (nonzero is set); synthetic masks are used when none are given.
+int main(int argc, char** argv)
+{
+    bool bSuccess = true;
+
+    if (argc > 1)
+    {
+        for (int arg_index = 1; arg_index < argc; ++arg_index)
+        {
+            cv::Mat mask = cv::imread(argv[arg_index], cv::IMREAD_GRAYSCALE);
+
+            if (mask.empty())
+            {
+                printf("Failed to load mask %s\n", argv[arg_index]);
+                bSuccess = false;
+                continue;
+            }
+
+            cv::threshold(mask, mask, 0, 255, cv::THRESH_BINARY);
+            for (int count_index = 0; count_index < k_blob_count_count; ++count_index)
+            {
+                bSuccess &= run_benchmark(argv[arg_index], mask, k_blob_counts[count_index]);
+            }
+        }
+    }
+    else
+    {
+        const cv::Size frame_sizes[] = { cv::Size(640, 480), cv::Size(320, 240), cv::Size(160, 120) };
+
+        for (const cv::Size &frame_size : frame_sizes)
+        {
+            for (int count_index = 0; count_index < k_blob_count_count; ++count_index)
+            {
+                const int blob_count = k_blob_counts[count_index];
+                char mask_name[64];
+                cv::Mat mask;
+
+                build_test_mask(frame_size.width, frame_size.height, blob_count, 1234 + count_index, mask);
+                snprintf(mask_name, sizeof(mask_name), "%dx%d %d blobs", frame_size.width, frame_size.height, blob_count);
+
+                bSuccess &= run_benchmark(mask_name, mask, blob_count);
+            }
+        }
+    }
+
+    return bSuccess ? 0 : -1;
+}
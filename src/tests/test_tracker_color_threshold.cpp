@@ -0,0 +1,381 @@
+#include "DeviceInterface.h"
+#include "TrackerColorThreshold.h"
+#include "opencv2/opencv.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+//-- constants -----
+static const int k_iteration_count = 200;
+
+// A few of the default tracking color presets, including ones whose hue range wraps around 0/180
+static const CommonHSVColorRange k_test_color_presets[] = {
+    { { 150.f, 10.f }, { 255.f, 32.f }, { 255.f, 32.f } }, // Magenta
+    { { 90.f, 10.f }, { 255.f, 32.f }, { 255.f, 32.f } }, // Cyan
+    { { 0.f, 10.f }, { 255.f, 32.f }, { 255.f, 32.f } }, // Red (wraps below 0)
+    { { 175.f, 10.f }, { 200.f, 64.f }, { 200.f, 64.f } }, // Pink (wraps above 180)
+};
+static const int k_test_color_preset_count = sizeof(k_test_color_presets) / sizeof(k_test_color_presets[0]);
+
+// Wide saturation and value ranges so most of the color cube reaches the hue test,
+// plus the clamped edges of the saturation and value ranges
+static const CommonHSVColorRange k_regression_color_presets[] = {
+    { { 0.f, 10.f }, { 128.f, 128.f }, { 128.f, 128.f } }, // Wraps below 0
+    { { 175.f, 10.f }, { 128.f, 128.f }, { 128.f, 128.f } }, // Wraps above 180
+    { { 60.f, 30.f }, { 0.f, 40.f }, { 255.f, 200.f } }, // Saturation range clamped at 0
+    { { 120.f, 5.f }, { 200.f, 60.f }, { 10.f, 30.f } }, // Value range clamped at 0
+};
+static const int k_regression_color_preset_count = sizeof(k_regression_color_presets) / sizeof(k_regression_color_presets[0]);
+
+//-- private methods -----
+// The cvtColor + inRange chain that OpenCVBufferState::computeBiggestNContours uses on the non-fused path
+static void compute_opencv_threshold_mask(
+    const cv::Mat &bgr, 
+    const CommonHSVColorRange &hsvColorRange,
+    cv::Mat &hsv,
+    cv::Mat &gsLower,
+    cv::Mat &gsUpper)
+{
+    const float hue_min = hsvColorRange.hue_range.center - hsvColorRange.hue_range.range;
+    const float hue_max = hsvColorRange.hue_range.center + hsvColorRange.hue_range.range;
+    const float saturation_min = std::min(std::max(hsvColorRange.saturation_range.center - hsvColorRange.saturation_range.range, 0.f), 255.f);
+    const float saturation_max = std::min(std::max(hsvColorRange.saturation_range.center + hsvColorRange.saturation_range.range, 0.f), 255.f);
+    const float value_min = std::min(std::max(hsvColorRange.value_range.center - hsvColorRange.value_range.range, 0.f), 255.f);
+    const float value_max = std::min(std::max(hsvColorRange.value_range.center + hsvColorRange.value_range.range, 0.f), 255.f);
+
+    cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+
+    if (hue_min < 0)
+    {
+        cv::inRange(hsv, cv::Scalar(0, saturation_min, value_min), cv::Scalar(std::min(std::max(hue_max, 0.f), 180.f), saturation_max, value_max), gsLower);
+        cv::inRange(hsv, cv::Scalar(std::min(std::max(180 + hue_min, 0.f), 180.f), saturation_min, value_min), cv::Scalar(180, saturation_max, value_max), gsUpper);
+        cv::bitwise_or(gsLower, gsUpper, gsLower);
+    }
+    else if (hue_max > 180)
+    {
+        cv::inRange(hsv, cv::Scalar(0, saturation_min, value_min), cv::Scalar(std::min(std::max(hue_max - 180, 0.f), 180.f), saturation_max, value_max), gsLower);
+        cv::inRange(hsv, cv::Scalar(std::min(std::max(hue_min, 0.f), 180.f), saturation_min, value_min), cv::Scalar(180, saturation_max, value_max), gsUpper);
+        cv::bitwise_or(gsLower, gsUpper, gsLower);
+    }
+    else
+    {
+        cv::inRange(hsv, cv::Scalar(hue_min, saturation_min, value_min), cv::Scalar(hue_max, saturation_max, value_max), gsLower);
+    }
+}
+
+// Same layout as the BGR->HSV table built by OpenCVBGRToHSVMapper in ServerTrackerView.cpp
+class BGRToHSVLookupTable
+{
+public:
+    BGRToHSVLookupTable()
+        : bgr2hsv(256*256*256, 1, CV_8UC3)
+    {
+        int LUTIndex = 0;
+        for (int r = 0; r < 256; ++r)
+        {
+            for (int g = 0; g < 256; ++g)
+            {
+                for (int b = 0; b < 256; ++b)
+                {
+                    bgr2hsv.at<cv::Vec3b>(LUTIndex, 0) = cv::Vec3b(b, g, r);
+                    ++LUTIndex;
+                }
+            }
+        }
+
+        cv::cvtColor(bgr2hsv, bgr2hsv, cv::COLOR_BGR2HSV);
+    }
+
+    void cvtColor(const cv::Mat &bgrBuffer, cv::Mat &hsvBuffer)
+    {
+        hsvBuffer.forEach<cv::Vec3b>([&bgrBuffer, this](cv::Vec3b &hsvColor, const int position[]) -> void {
+            const cv::Vec3b &bgrColor = bgrBuffer.at<cv::Vec3b>(position[0], position[1]);
+            const int LUTIndex = (256 * 256)*bgrColor[2] + 256*bgrColor[1] + bgrColor[0];
+
+            hsvColor = bgr2hsv.at<cv::Vec3b>(LUTIndex, 0);
+        });
+    }
+
+private:
+    cv::Mat bgr2hsv;
+};
+
+// Every 24-bit color exactly once
+static void build_all_colors_frame(cv::Mat &bgr)
+{
+    bgr.create(4096, 4096, CV_8UC3);
+
+    for (int color = 0; color < 256*256*256; ++color)
+    {
+        bgr.at<cv::Vec3b>(color / 4096, color % 4096) = cv::Vec3b(color & 0xff, (color >> 8) & 0xff, (color >> 16) & 0xff);
+    }
+}
+
+// Dim noisy background (trackers run at low exposure) with one bright blob per test color
+static void build_test_frame(int width, int height, cv::Mat &bgr)
+{
+    bgr.create(height, width, CV_8UC3);
+    cv::randu(bgr, cv::Scalar::all(0), cv::Scalar::all(96));
+
+    for (int preset_index = 0; preset_index < k_test_color_preset_count; ++preset_index)
+    {
+        const CommonHSVColorRange &preset = k_test_color_presets[preset_index];
+        cv::Mat hsv_color(1, 1, CV_8UC3, cv::Scalar(preset.hue_range.center, preset.saturation_range.center, preset.value_range.center));
+        cv::Mat bgr_color;
+        cv::cvtColor(hsv_color, bgr_color, cv::COLOR_HSV2BGR);
+
+        const cv::Vec3b color = bgr_color.at<cv::Vec3b>(0, 0);
+        const cv::Point center((preset_index + 1) * width / (k_test_color_preset_count + 1), height / 2);
+        cv::circle(bgr, center, height / 10, cv::Scalar(color[0], color[1], color[2]), -1);
+    }
+}
+
+static bool run_benchmark(int width, int height)
+{
+    cv::Mat bgr;
+    build_test_frame(width, height, bgr);
+
+    cv::Mat hsv(height, width, CV_8UC3);
+    cv::Mat opencv_mask(height, width, CV_8UC1);
+    cv::Mat opencv_upper_mask(height, width, CV_8UC1);
+    cv::Mat fused_mask(height, width, CV_8UC1);
+
+    // Make sure both paths agree before timing them
+    bool bMasksMatch = true;
+    for (int preset_index = 0; preset_index < k_test_color_preset_count; ++preset_index)
+    {
+        HSVColorThreshold threshold;
+        threshold.setColorRange(k_test_color_presets[preset_index]);
+
+        compute_opencv_threshold_mask(bgr, k_test_color_presets[preset_index], hsv, opencv_mask, opencv_upper_mask);
+        computeHSVThresholdMask(bgr, threshold, fused_mask);
+
+        const int mismatch_count = cv::countNonZero(opencv_mask != fused_mask);
+        if (mismatch_count > 0)
+        {
+            printf("%dx%d preset %d: %d mismatched mask pixels\n", width, height, preset_index, mismatch_count);
+            bMasksMatch = false;
+        }
+    }
+
+    std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        const CommonHSVColorRange &preset = k_test_color_presets[iteration % k_test_color_preset_count];
+
+        compute_opencv_threshold_mask(bgr, preset, hsv, opencv_mask, opencv_upper_mask);
+    }
+    const std::chrono::duration<double, std::milli> opencv_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        HSVColorThreshold threshold;
+        threshold.setColorRange(k_test_color_presets[iteration % k_test_color_preset_count]);
+
+        computeHSVThresholdMask(bgr, threshold, fused_mask);
+    }
+    const std::chrono::duration<double, std::milli> fused_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    printf("%dx%d: cvtColor+inRange %.3f ms/frame, fused %.3f ms/frame (%.2fx)\n",
+        width, height,
+        opencv_duration.count() / k_iteration_count,
+        fused_duration.count() / k_iteration_count,
+        opencv_duration.count() / fused_duration.count());
+
+    return bMasksMatch;
+}
+
+// Compares one classification table lookup per pixel against one fused threshold pass per tracked color
+static void run_classification_benchmark(int width, int height)
+{
+    cv::Mat bgr;
+    build_test_frame(width, height, bgr);
+
+    CommonHSVColorRange color_ranges[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+    bool color_used[eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES];
+    for (int color_id = 0; color_id < eCommonTrackingColorID::MAX_TRACKING_COLOR_TYPES; ++color_id)
+    {
+        color_used[color_id] = color_id < k_test_color_preset_count;
+        color_ranges[color_id] = color_used[color_id] ? k_test_color_presets[color_id] : CommonHSVColorRange();
+    }
+
+    std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+    HSVColorClassificationTable classification_table;
+    classification_table.build(color_ranges, color_used);
+    const std::chrono::duration<double, std::milli> build_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    cv::Mat color_bits(height, width, CV_8UC1);
+    cv::Mat classified_mask(height, width, CV_8UC1);
+    cv::Mat fused_mask(height, width, CV_8UC1);
+
+    // The table classifies each quantization cell by its center color,
+    // so pixels right on a preset boundary can land on the other side
+    classification_table.classifyImage(bgr, color_bits);
+    for (int preset_index = 0; preset_index < k_test_color_preset_count; ++preset_index)
+    {
+        HSVColorThreshold threshold;
+        threshold.setColorRange(k_test_color_presets[preset_index]);
+
+        computeHSVThresholdMask(bgr, threshold, fused_mask);
+        computeColorMaskFromClassification(color_bits, static_cast<eCommonTrackingColorID>(preset_index), classified_mask);
+
+        printf("%dx%d preset %d: classified mask differs from exact mask in %d of %d matching pixels\n",
+            width, height, preset_index,
+            cv::countNonZero(classified_mask != fused_mask), cv::countNonZero(fused_mask));
+    }
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        for (int preset_index = 0; preset_index < k_test_color_preset_count; ++preset_index)
+        {
+            HSVColorThreshold threshold;
+            threshold.setColorRange(k_test_color_presets[preset_index]);
+
+            computeHSVThresholdMask(bgr, threshold, fused_mask);
+        }
+    }
+    const std::chrono::duration<double, std::milli> fused_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        classification_table.classifyImage(bgr, color_bits);
+
+        for (int preset_index = 0; preset_index < k_test_color_preset_count; ++preset_index)
+        {
+            computeColorMaskFromClassification(color_bits, static_cast<eCommonTrackingColorID>(preset_index), classified_mask);
+        }
+    }
+    const std::chrono::duration<double, std::milli> classified_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    printf("%dx%d, %d colors: fused %.3f ms/frame, classification table %.3f ms/frame (table build %.3f ms)\n",
+        width, height, k_test_color_preset_count,
+        fused_duration.count() / k_iteration_count,
+        classified_duration.count() / k_iteration_count,
+        build_duration.count());
+}
+
+// Compares the fused mask against cvtColor + inRange for every 24-bit color
+static bool run_threshold_regression()
+{
+    cv::Mat bgr;
+    build_all_colors_frame(bgr);
+
+    cv::Mat hsv(bgr.rows, bgr.cols, CV_8UC3);
+    cv::Mat opencv_mask(bgr.rows, bgr.cols, CV_8UC1);
+    cv::Mat opencv_upper_mask(bgr.rows, bgr.cols, CV_8UC1);
+    cv::Mat fused_mask(bgr.rows, bgr.cols, CV_8UC1);
+
+    bool bMasksMatch = true;
+    for (int preset_index = 0; preset_index < k_test_color_preset_count + k_regression_color_preset_count; ++preset_index)
+    {
+        const CommonHSVColorRange &preset = 
+            (preset_index < k_test_color_preset_count) 
+            ? k_test_color_presets[preset_index] 
+            : k_regression_color_presets[preset_index - k_test_color_preset_count];
+
+        HSVColorThreshold threshold;
+        threshold.setColorRange(preset);
+
+        compute_opencv_threshold_mask(bgr, preset, hsv, opencv_mask, opencv_upper_mask);
+        computeHSVThresholdMask(bgr, threshold, fused_mask);
+
+        const int mismatch_count = cv::countNonZero(opencv_mask != fused_mask);
+        printf("All colors, preset %d: %d of %d matching colors, %d mismatched\n",
+            preset_index, cv::countNonZero(opencv_mask), bgr.rows*bgr.cols, mismatch_count);
+
+        bMasksMatch &= (mismatch_count == 0);
+    }
+
+    return bMasksMatch;
+}
+
+static bool run_hsv_converter_regression()
+{
+    cv::Mat bgr, opencv_hsv, integer_hsv;
+    build_all_colors_frame(bgr);
+
+    cv::cvtColor(bgr, opencv_hsv, cv::COLOR_BGR2HSV);
+    integer_hsv.create(bgr.rows, bgr.cols, CV_8UC3);
+    convertBGRToHSV(bgr, integer_hsv);
+
+    cv::Mat opencv_channels[3], integer_channels[3];
+    cv::split(opencv_hsv, opencv_channels);
+    cv::split(integer_hsv, integer_channels);
+
+    int mismatch_count = 0;
+    for (int channel = 0; channel < 3; ++channel)
+    {
+        mismatch_count += cv::countNonZero(opencv_channels[channel] != integer_channels[channel]);
+    }
+
+    printf("All colors: %d HSV values differ from cv::cvtColor\n", mismatch_count);
+
+    return mismatch_count == 0;
+}
+
+static void run_hsv_converter_benchmark(BGRToHSVLookupTable &lookup_table, const cv::Mat &bgr, const char *frame_name)
+{
+    cv::Mat hsv(bgr.rows, bgr.cols, CV_8UC3);
+
+    std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        cv::cvtColor(bgr, hsv, cv::COLOR_BGR2HSV);
+    }
+    const std::chrono::duration<double, std::milli> opencv_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        lookup_table.cvtColor(bgr, hsv);
+    }
+    const std::chrono::duration<double, std::milli> lookup_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    start_time = std::chrono::high_resolution_clock::now();
+    for (int iteration = 0; iteration < k_iteration_count; ++iteration)
+    {
+        convertBGRToHSV(bgr, hsv);
+    }
+    const std::chrono::duration<double, std::milli> integer_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    printf("%s %dx%d: cvtColor %.3f ms/frame, 48MB lookup table %.3f ms/frame, integer %.3f ms/frame\n",
+        frame_name, bgr.cols, bgr.rows,
+        opencv_duration.count() / k_iteration_count,
+        lookup_duration.count() / k_iteration_count,
+        integer_duration.count() / k_iteration_count);
+}
+
+int main(int, char**)
+{
+    bool bSuccess = true;
+
+    bSuccess &= run_benchmark(640, 480);
+    bSuccess &= run_benchmark(320, 240);
+
+    run_classification_benchmark(640, 480);
+    run_classification_benchmark(320, 240);
+
+    bSuccess &= run_threshold_regression();
+    bSuccess &= run_hsv_converter_regression();
+
+    // The lookup table cost is dominated by cache misses, so compare a camera-like frame
+    // against one whose colors are spread over the whole table.
+    // Run under a profiler (e.g. perf stat -e cache-misses) for the miss counts themselves.
+    {
+        BGRToHSVLookupTable lookup_table;
+        cv::Mat bgr;
+
+        build_test_frame(640, 480, bgr);
+        run_hsv_converter_benchmark(lookup_table, bgr, "Camera-like");
+
+        bgr.create(480, 640, CV_8UC3);
+        cv::randu(bgr, cv::Scalar::all(0), cv::Scalar::all(256));
+        run_hsv_converter_benchmark(lookup_table, bgr, "Random color");
+    }
+
+    return bSuccess ? 0 : -1;
+}
@@ -0,0 +1,259 @@
+#include "PackedMessage.h"
+#include "PSMoveProtocol.pb.h"
+#include "SharedConstants.h"
+
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+//-- constants -----
+static const int k_tick_count = 2000;
+
+// One controller, the max controller count, every controller, hmd and tracker, and a crowded server
+static const int k_device_counts[] = { 1, 5, 17, 64 };
+
+// How long the receiver can go without a datagram before the run is over
+static const int k_receive_settle_milliseconds = 100;
+
+//-- typedefs -----
+typedef std::shared_ptr<PSMoveProtocol::DeviceOutputDataFrame> DeviceOutputDataFramePtr;
+
+//-- definitions -----
+enum eSendMode
+{
+    _send_mode_padded,  // Every frame in its own datagram, zero padded to the max frame size
+    _send_mode_exact,   // Every frame in its own datagram, only the packed bytes
+    _send_mode_batched, // All of a tick's frames in as few datagrams as fit in the batch size
+};
+
+// Parses datagrams the way ClientNetworkManager does and counts what arrived
+class DataFrameReceiver
+{
+public:
+    DataFrameReceiver(boost::asio::io_service &io_service)
+        : m_socket(io_service, boost::asio::ip::udp::endpoint(boost::asio::ip::address_v4::loopback(), 0))
+        , m_packed_data_frame(DeviceOutputDataFramePtr(new PSMoveProtocol::DeviceOutputDataFrame))
+        , m_datagram_count(0)
+        , m_frame_count(0)
+        , m_malformed_count(0)
+    {
+        m_socket.set_option(boost::asio::socket_base::receive_buffer_size(4 << 20));
+    }
+
+    boost::asio::ip::udp::endpoint get_endpoint() const
+    {
+        return m_socket.local_endpoint();
+    }
+
+    int get_datagram_count() const { return m_datagram_count; }
+    int get_frame_count() const { return m_frame_count; }
+    int get_malformed_count() const { return m_malformed_count; }
+
+    // Reads until an empty datagram arrives
+    void run()
+    {
+        boost::asio::ip::udp::endpoint sender_endpoint;
+
+        for (;;)
+        {
+            boost::system::error_code error;
+            const unsigned datagram_size = static_cast<unsigned>(
+                m_socket.receive_from(boost::asio::buffer(m_buffer, sizeof(m_buffer)), sender_endpoint, 0, error));
+
+            if (error || datagram_size == 0)
+            {
+                break;
+            }
+
+            unsigned offset = 0;
+            while (offset + HEADER_SIZE <= datagram_size)
+            {
+                const unsigned msg_len = m_packed_data_frame.decode_header(&m_buffer[offset], datagram_size - offset);
+                const unsigned total_len = HEADER_SIZE + msg_len;
+
+                if (msg_len == 0)
+                {
+                    break;
+                }
+
+                if (total_len > datagram_size - offset || !m_packed_data_frame.unpack(&m_buffer[offset], total_len))
+                {
+                    ++m_malformed_count;
+                    break;
+                }
+
+                ++m_frame_count;
+                offset += total_len;
+            }
+
+            ++m_datagram_count;
+        }
+    }
+
+private:
+    boost::asio::ip::udp::socket m_socket;
+    boost::uint8_t m_buffer[MAX_OUTPUT_DATA_FRAME_BATCH_SIZE];
+    PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> m_packed_data_frame;
+    std::atomic<int> m_datagram_count;
+    std::atomic<int> m_frame_count;
+    std::atomic<int> m_malformed_count;
+};
+
+//-- private methods -----
+// Roughly what ServerControllerView sends for a tracked PSMove with raw sensor data turned on
+static void build_controller_data_frame(int controller_id, PSMoveProtocol::DeviceOutputDataFrame *data_frame)
+{
+    data_frame->set_device_category(PSMoveProtocol::DeviceOutputDataFrame::CONTROLLER);
+
+    auto *controller_data_frame = data_frame->mutable_controller_data_packet();
+    controller_data_frame->set_controller_id(controller_id);
+    controller_data_frame->set_controller_type(PSMoveProtocol::PSMOVE);
+    controller_data_frame->set_isconnected(true);
+    controller_data_frame->set_button_down_bitmask(0x105);
+
+    auto *psmove_data_frame = controller_data_frame->mutable_psmove_state();
+    psmove_data_frame->set_validhardwarecalibration(true);
+    psmove_data_frame->set_istrackingenabled(true);
+    psmove_data_frame->set_iscurrentlytracking(true);
+    psmove_data_frame->set_isorientationvalid(true);
+    psmove_data_frame->set_ispositionvalid(true);
+    psmove_data_frame->mutable_orientation()->set_w(0.7071f);
+    psmove_data_frame->mutable_orientation()->set_x(0.1f);
+    psmove_data_frame->mutable_orientation()->set_y(-0.6f);
+    psmove_data_frame->mutable_orientation()->set_z(0.35f);
+    psmove_data_frame->mutable_position_cm()->set_x(12.5f + controller_id);
+    psmove_data_frame->mutable_position_cm()->set_y(-40.25f);
+    psmove_data_frame->mutable_position_cm()->set_z(130.f);
+    psmove_data_frame->set_trigger_value(128);
+    psmove_data_frame->set_battery_value(4);
+
+    auto *raw_sensor_data = psmove_data_frame->mutable_raw_sensor_data();
+    raw_sensor_data->mutable_accelerometer()->set_i(-112);
+    raw_sensor_data->mutable_accelerometer()->set_j(4003);
+    raw_sensor_data->mutable_accelerometer()->set_k(-260);
+    raw_sensor_data->mutable_gyroscope()->set_i(17);
+    raw_sensor_data->mutable_gyroscope()->set_j(-9);
+    raw_sensor_data->mutable_gyroscope()->set_k(3);
+    raw_sensor_data->mutable_magnetometer()->set_i(-213);
+    raw_sensor_data->mutable_magnetometer()->set_j(87);
+    raw_sensor_data->mutable_magnetometer()->set_k(402);
+}
+
+static void run_benchmark(int device_count, eSendMode send_mode)
+{
+    static const char *k_send_mode_names[] = { "padded", "exact", "batched" };
+
+    boost::asio::io_service io_service;
+    DataFrameReceiver receiver(io_service);
+    const boost::asio::ip::udp::endpoint receiver_endpoint = receiver.get_endpoint();
+    boost::asio::ip::udp::socket sender_socket(io_service, boost::asio::ip::udp::v4());
+
+    std::vector<DeviceOutputDataFramePtr> data_frames;
+    for (int device_index = 0; device_index < device_count; ++device_index)
+    {
+        DeviceOutputDataFramePtr data_frame(new PSMoveProtocol::DeviceOutputDataFrame);
+
+        build_controller_data_frame(device_index, data_frame.get());
+        data_frames.push_back(data_frame);
+    }
+
+    std::thread receiver_thread(&DataFrameReceiver::run, &receiver);
+
+    // Same packing as ClientConnection::start_udp_write_queued_device_data_frame
+    PackedMessage<PSMoveProtocol::DeviceOutputDataFrame> packed_data_frame;
+    boost::uint8_t buffer[MAX_OUTPUT_DATA_FRAME_BATCH_SIZE];
+    const int packet_size =
+        (send_mode == _send_mode_batched)
+        ? sizeof(buffer)
+        : HEADER_SIZE + MAX_OUTPUT_DATA_FRAME_MESSAGE_SIZE;
+    long long sent_byte_count = 0;
+    int sent_datagram_count = 0;
+
+    const std::chrono::high_resolution_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+    for (int tick = 0; tick < k_tick_count; ++tick)
+    {
+        int packed_size = 0;
+
+        for (int device_index = 0; device_index < device_count; ++device_index)
+        {
+            data_frames[device_index]->mutable_controller_data_packet()->set_sequence_num(tick);
+            packed_data_frame.set_msg(data_frames[device_index]);
+
+            if (!packed_data_frame.pack(&buffer[packed_size], packet_size - packed_size))
+            {
+                // Batch is full, send it and start the next one
+                sender_socket.send_to(boost::asio::buffer(buffer, packed_size), receiver_endpoint);
+                sent_byte_count += packed_size;
+                ++sent_datagram_count;
+
+                packed_size = 0;
+                packed_data_frame.pack(buffer, packet_size);
+            }
+
+            packed_size += HEADER_SIZE + packed_data_frame.get_msg()->GetCachedSize();
+
+            if (send_mode != _send_mode_batched)
+            {
+                const int send_size = (send_mode == _send_mode_padded) ? packet_size : packed_size;
+
+                sender_socket.send_to(boost::asio::buffer(buffer, send_size), receiver_endpoint);
+                sent_byte_count += send_size;
+                ++sent_datagram_count;
+
+                packed_size = 0;
+            }
+        }
+
+        if (packed_size > 0)
+        {
+            sender_socket.send_to(boost::asio::buffer(buffer, packed_size), receiver_endpoint);
+            sent_byte_count += packed_size;
+            ++sent_datagram_count;
+        }
+    }
+    const std::chrono::duration<double> send_duration = std::chrono::high_resolution_clock::now() - start_time;
+
+    // Let the receiver drain its socket buffer, then stop it with an empty datagram
+    int last_datagram_count = -1;
+    while (receiver.get_datagram_count() != last_datagram_count && receiver.get_datagram_count() < sent_datagram_count)
+    {
+        last_datagram_count = receiver.get_datagram_count();
+        std::this_thread::sleep_for(std::chrono::milliseconds(k_receive_settle_milliseconds));
+    }
+    sender_socket.send_to(boost::asio::buffer(buffer, 0), receiver_endpoint);
+    receiver_thread.join();
+
+    const int sent_frame_count = k_tick_count * device_count;
+    printf("%3d devices %-8s %9.0f frames/s %9.0f packets/s %8.2f MB/s %6.1f bytes/frame %5.1f%% delivered%s\n",
+        device_count, k_send_mode_names[send_mode],
+        sent_frame_count / send_duration.count(),
+        sent_datagram_count / send_duration.count(),
+        sent_byte_count / send_duration.count() / (1024.0 * 1024.0),
+        static_cast<double>(sent_byte_count) / sent_frame_count,
+        100.0 * receiver.get_frame_count() / sent_frame_count,
+        receiver.get_malformed_count() > 0 ? " - MALFORMED DATAGRAMS" : "");
+}
+
+// Usage: test_udp_data_frame_throughput
+// Streams controller data frames over loopback UDP the way the server does for each send mode.
+int main(int argc, char** argv)
+{
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    printf("%d ticks per run\n", k_tick_count);
+    for (int device_count : k_device_counts)
+    {
+        run_benchmark(device_count, _send_mode_padded);
+        run_benchmark(device_count, _send_mode_exact);
+        run_benchmark(device_count, _send_mode_batched);
+    }
+
+    google::protobuf::ShutdownProtobufLibrary();
+
+    return 0;
+}
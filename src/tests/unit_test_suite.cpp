@@ -13,6 +13,9 @@ main(int argc, char* argv[])
 		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_math_alignment_unit_tests);
 		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_math_eigen_unit_tests);
 		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_math_utility_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_protocol_compact_data_frame_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_service_device_timestamp_unit_tests);
+		UNIT_TEST_SUITE_CALL_CPP_MODULE(run_service_device_state_buffer_unit_tests);
 	UNIT_TEST_SUITE_END()
 
 	return success ? EXIT_SUCCESS : EXIT_FAILURE;